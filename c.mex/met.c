@@ -37,27 +37,28 @@ void metxlogcls( struct met_t *, int, mxArray **, int, const mxArray ** ) ;
 void metxopen  ( struct met_t *, int, mxArray **, int, const mxArray ** ) ;
 void metxclose ( struct met_t *, int, mxArray **, int, const mxArray ** ) ;
 void metxconst ( struct met_t *, int, mxArray **, int, const mxArray ** ) ;
+void metxshmwr ( struct met_t *, int, mxArray **, int, const mxArray ** ) ;
 TESTING */
 
 
 /*--- Supporting function constants ---*/
 
 /* Number of functions i.e. function count */
-#define  FCOUNT  12
+#define  FCOUNT  13
 
 /* Function names & number of characters in each (excluding null byte) */
 const  char *  FNAMES[ FCOUNT ] = { "send" , "write" , "recv" , "read" ,
   "select" , "print" , "flush" , "logopn" , "logcls" , "open" , "close" ,
-  "const" } ;
+  "const" , "shmwr" } ;
 const  unsigned char  FNOCHR[ FCOUNT ] =
-  { 4 , 5 , 4 , 4 , 6 , 5 , 5 , 6 , 6 , 4 , 5 , 5 } ;
+  { 4 , 5 , 4 , 4 , 6 , 5 , 5 , 6 , 6 , 4 , 5 , 5 , 5 } ;
 
 /* Function pointers */
 void ( * METFUN[ FCOUNT ] )
   ( struct met_t  * , int , mxArray  ** , int , const mxArray  ** )  =
   { metxsend , metxwrite , metxrecv , metxread , metxselect , metxprint ,
     metxflush , metxlogopn , metxlogcls , metxopen , metxclose ,
-    metxconst } ;
+    metxconst , metxshmwr } ;
 
 
 /*--- met function definition ---*/
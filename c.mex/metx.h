@@ -48,16 +48,6 @@
 #define  FDSI_PIPE  -1
 
 
-/*   Reading and writing POSIX shared memory   */
-
-/* size_t header , number of values , and named indeces. Latter are number
-  of bytes stored past the size_t header , and the number of Matlab arrays
-  stored therein. */
-#define  SMST_NUM    2
-#define  SMST_BYTES  0
-#define  SMST_NMXAR  1
-
-
 /*--- Macros ---*/
 
 /* Check that mxArray is a string. For input arg check, so 0 is success. */
@@ -66,6 +56,15 @@
                           mxGetNumberOfDimensions ( prhs[ i ] )  >  2  || \
                           mxGetM ( prhs[ i ] )  >  1
 
+/* Pointer to the synchronisation block of the ith shared memory mapping ,
+  and byte pointer to the shm data header that follows it */
+#define  SHMSYNC( R , i )  ( ( struct metshmsync * )  ( R )->shmmap[ i ] )
+#define  SHMDATA( R , i )  ( ( char * )  ( R )->shmmap[ i ]  +  MSHM_SYNC )
+
+/* Initialiser for an array with one element per shared memory object.
+  Uses a GNU range designator so that it follows the value of MAXSHM. */
+#define  SHMV_INIT( v )  { [ 0 ... MAXSHM - 1 ] = v }
+
 /* struct met_t initialiser. It is very important that the memory map
   pointers are initialised to NULL, because this is checked for when
   closing resources. */
@@ -77,25 +76,29 @@
                            AWMSIG_INIT , \
                            { FDINIT  , FDINIT  } , \
                            { FDSINIT , FDSINIT } , \
-                           { NULL , NULL , NULL } , \
-                           { 0 , 0 , 0 } , \
-                           { 0 , 0 , 0 } , \
-                           { 0 , 0 , 0 } , \
-                           { FDINIT , FDINIT , FDINIT } , \
-                           { FDINIT , FDINIT , FDINIT } , \
-                           { 0 , 0 , 0 } , \
-                           { NULL , NULL , NULL } , \
-                           { FDSINIT , FDSINIT , FDSINIT } , \
-                           { FDSINIT , FDSINIT , FDSINIT } , \
-                           { NULL , NULL , NULL } , \
-                           { 0 , 0 , 0 } , \
+                           SHMARG , \
+                           { { '\0' } } , \
+                           SHMV_INIT( NULL ) , \
+                           SHMV_INIT( 0 ) , \
+                           SHMV_INIT( 0 ) , \
+                           SHMV_INIT( 0 ) , \
+                           SHMV_INIT( FDINIT ) , \
+                           SHMV_INIT( FDINIT ) , \
+                           SHMV_INIT( 0 ) , \
+                           SHMV_INIT( NULL ) , \
+                           SHMV_INIT( FDSINIT ) , \
+                           SHMV_INIT( FDSINIT ) , \
+                           SHMV_INIT( NULL ) , \
+                           SHMV_INIT( 0 ) , \
                            NFD_INIT , \
                            MFD_INIT , \
                            NULL , \
                            NULL , \
                            NULL , \
                            NULL , \
-                           NULL \
+                           NULL , \
+                           NULL , \
+                           0 \
                          }
 
 
@@ -112,6 +115,12 @@
   awmsig - Maximum number of MET signals in atomic read or write from pipe.
   p - MET pipe file descriptors.
   pf - Pipe fd status flags e.g. O_NONBLOCK.
+  nshm - The number of shared memory objects. The SHMARG built-in objects
+    come first , followed by any named channels declared in the .cmet file.
+    All of the following per-shm arrays have MAXSHM elements , of which the
+    first nshm are used.
+  shmnam - Name of each shared memory e.g. "eye". Used by 'read' ,
+    'write' , and 'select' to identify it.
   shmmap - Pointers to memory-mapped POSIX shared memory.
   shmsiz - The number of bytes in each memory mapping.
   shmflg - MET opening flags for POSIX shared memory.
@@ -123,7 +132,8 @@
   rflg - Readers' event fd status flags e.g. O_NONBLOCK.
   wflg - Writer's event fd status flags e.g. O_NONBLOCK.
   wflgv - Writer's efd status flag vectors , for efds in wefdv.
-  rcount - Cumulative sum of values read from event fd's since last write.
+  rgen - Last generation of each shared memory that was read , compared
+    against the gen field of the shm's struct metshmsync.
   nfd - Numer of file descriptors watched in synchronous I/O multiplexing.
   maxfd - Maximum value of all fd's kept in fd.
   fd - Array of fd's watched in synchronous I/O multiplexing. The last
@@ -135,6 +145,9 @@
   fdsi - Shared memory index of element in fd. -1 for last , pipe element.
   HOME - Pointer from getenv() pointing to user's home directory string.
   logfile - Writing stream into the MET controller's current log file.
+  rbuf - Receive buffer for MET signals read from the broadcast pipe. It is
+    kept between calls to 'recv' , and only grows.
+  rbufn - The number of MET signals that rbuf can hold.
   
 */
 struct met_t
@@ -146,18 +159,20 @@ struct met_t
     size_t  awmsig ;
     int  p[ METPIP ] ;
     int  pf[ METPIP ] ;
-    void *  shmmap[ SHMARG ] ;
-    size_t  shmsiz[ SHMARG ] ;
-    char  shmflg[ SHMARG ] ;
-    unsigned char  shmnr[ SHMARG ] ;
-    int  refd[ SHMARG ] ;
-    int  wefd[ SHMARG ] ;
-    unsigned char  wefdn[ SHMARG ] ;
-    int *  wefdv[ SHMARG ] ;
-    int  rflg[ SHMARG ] ;
-    int  wflg[ SHMARG ] ;
-    int *  wflgv[ SHMARG ] ;
-    uint64_t  rcount[ SHMARG ] ;
+    unsigned char  nshm ;
+    char  shmnam[ MAXSHM ][ MSHM_NAMLEN ] ;
+    void *  shmmap[ MAXSHM ] ;
+    size_t  shmsiz[ MAXSHM ] ;
+    char  shmflg[ MAXSHM ] ;
+    unsigned char  shmnr[ MAXSHM ] ;
+    int  refd[ MAXSHM ] ;
+    int  wefd[ MAXSHM ] ;
+    unsigned char  wefdn[ MAXSHM ] ;
+    int *  wefdv[ MAXSHM ] ;
+    int  rflg[ MAXSHM ] ;
+    int  wflg[ MAXSHM ] ;
+    int *  wflgv[ MAXSHM ] ;
+    uint32_t  rgen[ MAXSHM ] ;
     int  nfd ;
     int  maxfd ;
     int *  fd ;
@@ -165,6 +180,8 @@ struct met_t
     int *  fdsi ;
     char *  HOME ;
     FILE *  logfile ;
+    struct metsignal *  rbuf ;
+    size_t  rbufn ;
   } ;
 
 
@@ -183,12 +200,18 @@ void metxlogcls( struct met_t *, int, mxArray **, int, const mxArray ** ) ;
 void metxopen  ( struct met_t *, int, mxArray **, int, const mxArray ** ) ;
 void metxclose ( struct met_t *, int, mxArray **, int, const mxArray ** ) ;
 void metxconst ( struct met_t *, int, mxArray **, int, const mxArray ** ) ;
+void metxshmwr ( struct met_t *, int, mxArray **, int, const mxArray ** ) ;
 
 /* Hidden functions */
    uint64_t metxefdread ( struct met_t *, int ) ;
         int metxefdpost ( struct met_t *, const unsigned char, const int *,
               uint64_t ) ;
-       void metxsetfl   ( struct met_t *, unsigned char, int *, int *,
-              char, char * ) ;
-signed char metxshmblk ( const mxArray *, char * ) ;
+signed char metxshmblk ( struct met_t *, const mxArray *, char *,
+              double * ) ;
+       void metxdeadline ( struct met_t *, double, struct timespec * ) ;
+        int metxpollfd ( struct met_t *, int, short,
+              const struct timespec * ) ;
+        int metxfwait ( struct met_t *, uint32_t *, uint32_t,
+              const struct timespec * ) ;
+       void metxfwake ( struct met_t *, uint32_t *, int ) ;
 
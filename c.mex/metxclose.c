@@ -130,7 +130,7 @@ void  metxclose ( struct met_t *  RTCONS ,
   /*-- Unmap POSIX shared memory --*/
   
   /* Loop each shm object */
-  for  ( i = 0 ; i  <  SHMARG ; ++i )
+  for  ( i = 0 ; i  <  RTCONS->nshm ; ++i )
     
     /* Attempt to unmap */
     if  ( RTCONS->shmmap[ i ]  !=  NULL  &&
@@ -178,7 +178,7 @@ void  metxclose ( struct met_t *  RTCONS ,
   for  ( i = 0 ; i  <  NEFDV ; ++i )
   
     /* ... and then shared memory objects */
-    for  ( j = 0 ; j  <  SHMARG ; ++j )
+    for  ( j = 0 ; j  <  RTCONS->nshm ; ++j )
     {
       /* Not assigned , continue to next fd */
       if  ( efd[ i ][ j ]  ==  FDINIT )  continue ;
@@ -191,7 +191,7 @@ void  metxclose ( struct met_t *  RTCONS ,
     }
   
   /* Writer's efd's for other MET controllers */
-  for  ( i = 0 ; i  <  SHMARG ; ++i )
+  for  ( i = 0 ; i  <  RTCONS->nshm ; ++i )
   {
     /* MET controller didn't write, so list wasn't initialised */
     if  (  RTCONS->shmflg[ i ]  !=  MSMG_WRITE  &&
@@ -220,7 +220,7 @@ void  metxclose ( struct met_t *  RTCONS ,
   } /* shm's */
   
   /* Free writer's event fd list memory */
-  for  ( i = 0 ; i  <  SHMARG ; ++i )
+  for  ( i = 0 ; i  <  RTCONS->nshm ; ++i )
   {
     if  ( RTCONS->wefdv[ i ]  !=  NULL )
       { free ( RTCONS->wefdv[ i ] ) ;  RTCONS->wefdv[ i ] = NULL ; }
@@ -236,6 +236,13 @@ void  metxclose ( struct met_t *  RTCONS ,
   free ( RTCONS->fdsi ) ;
   
   
+  /*-- Free MET signal receive buffer --*/
+  
+  free ( RTCONS->rbuf ) ;
+  RTCONS->rbuf = NULL ;
+  RTCONS->rbufn = 0 ;
+  
+  
   /*-- Attempt to send mquit signal --*/
   
   /* Time measurement */
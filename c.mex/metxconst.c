@@ -109,10 +109,9 @@ const int     ERRVAL[] = { ME_NONE , ME_PBSRC , ME_PBSIG ,
   ME_PBCRG , ME_PBTIM , ME_SYSER , ME_BRKBP , ME_BRKRP , ME_CLGBP ,
   ME_CLGRP , ME_CHLD , ME_INTR , ME_INTRN , ME_TMOUT , ME_MATLB } ;
 
-/* met shared memory name constant is defined within the scope of
-  metxconst. Somewhere , possibly in the undocumented boggy moors of
-  Matlab, exists a definition called SHMNAM. By defining within the scope
-  of metxconst, we override the other definition. */
+/* met shared memory names are run-time constants , taken from
+  RTCONS->shmnam. This includes any named channels declared in the .cmet
+  file. */
 
 /* Number of elements per array , the last element contains SHM ,
   set later */
@@ -147,17 +146,17 @@ const char *  ROOTVAL[] = { MDIR_ROOT , MDIR_SESS , MDIR_TRIAL } ;
 
 /* MC.SESS field names and strings */
 const char *  SESSNAM[] = { "FIN" , "FTR" , "HDR" , "LOGS" , "REC" ,
-  "SCHED" , "STIM" , "SUM" , "TLOG" , "TRIAL" } ;
+  "SCHED" , "STIM" , "STORE" , "SUM" , "TLOG" , "TRIAL" } ;
 const char *  SESSVAL[] = { MSESS_FIN , MSESS_FTR , MSESS_HDR ,
-  MSESS_LOGS , MSESS_REC , MSESS_SCHED , MSESS_STIM , MSESS_SUM ,
-  MSESS_TLOG , MSESS_TRIAL } ;
+  MSESS_LOGS , MSESS_REC , MSESS_SCHED , MSESS_STIM , MSESS_STORE ,
+  MSESS_SUM , MSESS_TLOG , MSESS_TRIAL } ;
 
 /* MC.TRIAL field names and strings */
 const char *  TRIALNAM[] = { "PAR" , "PTX" } ;
 const char *  TRIALVAL[] = { MTRLD_PAR , MTRLD_PTX } ;
 
 /* Number of fields in sub-structs */
-const unsigned char  MFIELDS[ NSUBS ] = { 2 , 3 , 1 , 2 , 3 , 10 , 2 } ;
+const unsigned char  MFIELDS[ NSUBS ] = { 2 , 3 , 1 , 2 , 3 , 11 , 2 } ;
 
 /* Arrays of sub-struct field names, cargos, file names */
 const void *  MNAMES[ NSUBS ] = { MREADY , MWAIT , MCALIBRATE , PROGNAM ,
@@ -174,12 +173,6 @@ void  metxconst ( struct met_t *  RTCONS ,
                   int  nrhs , const mxArray *  prhs[] )
 {
   
-  /*-- CONSTANTS --*/
-  
-  /* met shared memory names */
-  char *  SHMNAM[ SHMARG ] = { SNAM_STIM , SNAM_EYE , SNAM_NSP } ;
-  
-  
   /*-- Check input arguments --*/
   
   /* Number of outputs */
@@ -333,7 +326,7 @@ void  metxconst ( struct met_t *  RTCONS ,
     shared mem actions that this controller has permission to do. */
   if  ( !nort )
     
-    for  ( i = j = 0 ; i  <  SHMARG ; ++i )
+    for  ( i = j = 0 ; i  <  RTCONS->nshm ; ++i )
 
       /* The number of actions to count depends on the shm open flag */
       switch  ( RTCONS->shmflg[ i ] )
@@ -358,15 +351,16 @@ void  metxconst ( struct met_t *  RTCONS ,
   CELVAL[ NCELLS - 1 ] = CSMVAL ;
   
   /* Populate shm name and value arrays , depending again on open flags */
-  for  ( i = j = 0 ; i < SHMARG  &&  j < CELNUM[ NCELLS - 1 ] ; ++i )
+  for  ( i = j = 0 ; i < RTCONS->nshm  &&  j < CELNUM[ NCELLS - 1 ] ;
+        ++i )
     switch  ( RTCONS->shmflg[ i ] )
     {
       case  MSMG_BOTH:
-      case  MSMG_READ:   CSMNAM[ j   ] = SHMNAM[ i ] ;
+      case  MSMG_READ:   CSMNAM[ j   ] = RTCONS->shmnam[ i ] ;
                          CSMVAL[ j++ ] = MSMG_READ ;
                          if  ( RTCONS->shmflg[ i ] == MSMG_READ )  break ;
                          
-      case  MSMG_WRITE:  CSMNAM[ j   ] = SHMNAM[ i ] ;
+      case  MSMG_WRITE:  CSMNAM[ j   ] = RTCONS->shmnam[ i ] ;
                          CSMVAL[ j++ ] = MSMG_WRITE ;
                          
     } /* populate CELNAM & CELVAL */
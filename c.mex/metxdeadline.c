@@ -0,0 +1,81 @@
+/*  metxdeadline.c
+  
+  void  metxdeadline ( struct met_t *  RTC , double  tout ,
+                       struct timespec *  dl )
+  
+  Converts a timeout of tout seconds into an absolute deadline on the
+  monotonic system clock, which is returned in dl. tout must be finite and
+  0 or more. Use this with
+  metxpollfd to wait on a file descriptor for at most tout seconds in
+  total, regardless of how many times the wait is interrupted. Run-time
+  constants are handed in RTC for error handling.
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+#include  <math.h>
+#include  <time.h>
+
+#include  "metx.h"
+
+
+/*--- Define block ---*/
+
+#define  ERRHDR  MCSTR ":met:metxdeadline: "
+
+
+/*--- metxdeadline function definition ---*/
+
+void  metxdeadline ( struct met_t *  RTC , double  tout ,
+                     struct timespec *  dl )
+{
+  
+  /*-- Variables --*/
+  
+  /* Timeout fractional and integral parts */
+  double  toutf , touti ;
+  
+  
+  /*-- Check timeout --*/
+  
+  /* Callers handle Inf as no timeout , so none should reach here */
+  if  ( !isfinite ( tout )  ||  tout  <  0 )
+  {
+    RTC->quit = ME_INTRN ;
+    mexErrMsgIdAndTxt ( "MET:metxdeadline:tout" , ERRHDR
+      "timeout must be finite and 0 or more" , RTC->cd ) ;
+  }
+  
+  
+  /*-- Measure current time --*/
+  
+  if  ( clock_gettime ( CLOCK_MONOTONIC , dl )  ==  -1 )
+  {
+    RTC->quit = ME_SYSER ;
+    perror ( "met:metxdeadline:clock_gettime" ) ;
+    mexErrMsgIdAndTxt ( "MET:metxdeadline:clock_gettime" , ERRHDR
+      "error measuring time" , RTC->cd ) ;
+  }
+  
+  
+  /*-- Add timeout --*/
+  
+  toutf = modf ( tout , &touti ) ;
+  
+  dl->tv_sec  += ( time_t )  touti ;
+  dl->tv_nsec += ( long )  ( toutf * NSPERS ) ;
+  
+  /* Carry nanoseconds over into seconds */
+  if  ( dl->tv_nsec  >=  NSPERS )
+  {
+    dl->tv_sec  += 1 ;
+    dl->tv_nsec -= NSPERS ;
+  }
+
+
+} /* metxdeadline */
+
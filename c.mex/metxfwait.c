@@ -0,0 +1,80 @@
+/*  metxfwait.c
+  
+  int  metxfwait ( struct met_t *  RTC , uint32_t *  w , uint32_t  v ,
+                   const struct timespec *  dl )
+  
+  Waits on the futex word w in MET shared memory for as long as it holds
+  the value v. If dl is NULL then the wait is indefinite. Otherwise, dl is
+  an absolute deadline on the monotonic clock, as returned by metxdeadline.
+  Returns 1 if w was found to differ from v , or if the wait was woken or
+  interrupted by a UNIX signal ; the caller must then check w again. Returns
+  0 if the deadline passed first. The futex is not process-private, since
+  the word is shared between MET controllers. Run-time constants are handed
+  in RTC for error handling.
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* metx.h comes first , since met.h defines _GNU_SOURCE for syscall() */
+#include  "metx.h"
+
+#include  <limits.h>
+#include  <time.h>
+
+#include  <linux/futex.h>
+#include  <sys/syscall.h>
+
+
+/*--- Define block ---*/
+
+#define  ERRHDR  MCSTR ":met:metxfwait: "
+
+#define  FWOKEN   1
+#define  TIMEOUT  0
+
+
+/*--- metxfwait function definition ---*/
+
+int  metxfwait ( struct met_t *  RTC , uint32_t *  w , uint32_t  v ,
+                 const struct timespec *  dl )
+{
+  
+  /*-- Wait on futex --*/
+  
+  /* FUTEX_WAIT_BITSET takes an absolute timeout on CLOCK_MONOTONIC , which
+    is exactly what metxdeadline returns. Plain FUTEX_WAIT would need the
+    time remaining to be recomputed after every wakeup. */
+  if  (  syscall ( SYS_futex , w , FUTEX_WAIT_BITSET , v , dl , NULL ,
+                   FUTEX_BITSET_MATCH_ANY )  !=  -1  )
+    
+    return  FWOKEN ;
+  
+  
+  /*-- Handle exit condition --*/
+  
+  switch  ( errno )
+  {
+    /* w no longer holds v , or UNIX signal interruption */
+    case  EAGAIN:
+    case   EINTR:  return  FWOKEN ;
+    
+    /* Deadline passed */
+    case  ETIMEDOUT:  return  TIMEOUT ;
+  }
+  
+  /* Any other error */
+  RTC->quit = ME_SYSER ;
+  perror ( "met:metxfwait:futex" ) ;
+  mexErrMsgIdAndTxt ( "MET:metxfwait:futex" , ERRHDR
+    "error waiting on shared memory" , RTC->cd ) ;
+  
+  /* Never reached , keeps compiler quiet */
+  return  TIMEOUT ;
+
+
+} /* metxfwait */
+
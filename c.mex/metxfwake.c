@@ -0,0 +1,44 @@
+/*  metxfwake.c
+  
+  void  metxfwake ( struct met_t *  RTC , uint32_t *  w , int  n )
+  
+  Wakes up to n processes that are waiting on the futex word w in MET
+  shared memory , using a single system call. Pass INT_MAX to wake all
+  waiting processes. Run-time constants are handed in RTC for error
+  handling.
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* metx.h comes first , since met.h defines _GNU_SOURCE for syscall() */
+#include  "metx.h"
+
+#include  <linux/futex.h>
+#include  <sys/syscall.h>
+
+
+/*--- Define block ---*/
+
+#define  ERRHDR  MCSTR ":met:metxfwake: "
+
+
+/*--- metxfwake function definition ---*/
+
+void  metxfwake ( struct met_t *  RTC , uint32_t *  w , int  n )
+{
+  
+  if  ( syscall ( SYS_futex , w , FUTEX_WAKE , n , NULL , NULL , 0 )  ==  -1 )
+  {
+    RTC->quit = ME_SYSER ;
+    perror ( "met:metxfwake:futex" ) ;
+    mexErrMsgIdAndTxt ( "MET:metxfwake:futex" , ERRHDR
+      "error waking controllers on shared memory" , RTC->cd ) ;
+  }
+
+
+} /* metxfwake */
+
@@ -2,6 +2,8 @@
 /*  metxopen.c
   
   met ( 'open' , cd , stdofd , pfd , shmflg , shmnr , refd , wefd , wefdv )
+  met ( 'open' , cd , stdofd , pfd , shmflg , shmnr , refd , wefd , wefdv ,
+    shmnam )
   
   Opens and initialises met. The standard output file descriptor is
   restored. POSIX shared memory is opened and mapped. A pointer for the
@@ -9,6 +11,12 @@
   pipe file descriptors are stored. Returns a Matlab struct of MET
   constants, including MET signals, MET files, and MET error codes.
   
+  The optional shmnam is a cell array of strings that names any shared
+  memory channels declared in the .cmet file , in order. shmflg , shmnr ,
+  refd , wefd , and wefdv then have one element for each built-in shared
+  memory followed by one for each declared channel. Without shmnam , only
+  the SHMARG built-in shared memory objects are used.
+  
   Written by Jackson Smith - DPAG , University of Oxford
   
 */
@@ -25,7 +33,8 @@
 #define  ERRHD2  MCSTR ":" ERRHD1
 
 #define  NLHS_MAX  1
-#define  NRHS      8
+#define  NRHS_MIN  8
+#define  NRHS_MAX  9
 
 #define  ARG_CD      0
 #define  ARG_STDOFD  1
@@ -35,29 +44,26 @@
 #define  ARG_REFD    5
 #define  ARG_WEFD    6
 #define  ARG_WEFDV   7
+#define  ARG_SHMNAM  8
 
 
 /*--- Constants ---*/
 
 /* Input argument names */
 const char *  ARGNAM[] = { "cd" , "stdofd" , "pfd" , "shmflg" , "shmnr" ,
-  "refd" , "wefd" , "wefdv" } ;
+  "refd" , "wefd" , "wefdv" , "shmnam" } ;
 
 /* Type per input argument */
 const mxClassID  ARGTYP[] = { mxDOUBLE_CLASS , mxDOUBLE_CLASS ,
   mxDOUBLE_CLASS , mxCHAR_CLASS , mxDOUBLE_CLASS , mxDOUBLE_CLASS ,
-  mxDOUBLE_CLASS , mxCELL_CLASS } ;
-
-/* Elements per input argument */
-const unsigned char  ARGSIZ[] = 
-  { 1 , 1 , 2 , SHMARG , SHMARG , SHMARG , SHMARG , SHMARG } ;
+  mxDOUBLE_CLASS , mxCELL_CLASS , mxCELL_CLASS } ;
 
 /* POSIX shared memory open flags */
 const char  SHMFLG[ MSMG_NUM ] =
   { MSMG_CLOSED , MSMG_READ , MSMG_WRITE , MSMG_BOTH } ;
 
-/* POSIX shared memory file names */
-const char *  SHMNAM[] = { MSHM_STIM , MSHM_EYE , MSHM_NSP } ;
+/* Built-in POSIX shared memory names */
+const char *  SHMNAM[ SHMARG ] = { SNAM_STIM , SNAM_EYE , SNAM_NSP } ;
 
 /* Blocked UNIX signals */
 const int  nblk   = 1 ;
@@ -143,6 +149,12 @@ void  metxopen ( struct met_t *  RTCONS ,
   mxChar *  mxc ;
     char      c ;
   
+  /* Number of shared memory objects , elements per input argument , and
+    shared memory file name */
+  unsigned char  nshm = SHMARG ;
+  size_t  argsiz[ NRHS_MAX ] ;
+  char  fnm[ MSHM_FNMLEN ] ;
+  
   /* sigaction structure */
   struct sigaction  sa ;
   
@@ -166,13 +178,37 @@ void  metxopen ( struct met_t *  RTCONS ,
   }
     
   /* Number of inputs */
-  if  ( nrhs  !=  NRHS )
+  if  ( nrhs  <  NRHS_MIN  ||  NRHS_MAX  <  nrhs )
   {
     RTCONS->quit = ME_INTRN ;
     mexErrMsgIdAndTxt ( "MET:open:nrhs" , ERRHD1
-      "takes %d input args , %d given" , NRHS , nrhs ) ;
+      "takes %d to %d input args , %d given" , NRHS_MIN , NRHS_MAX ,
+      nrhs ) ;
   }
   
+  /* Count declared shared memory channels */
+  if  ( nrhs  ==  NRHS_MAX )
+  {
+    if  ( !mxIsCell ( prhs[ ARG_SHMNAM ] )  ||
+          MAXSHM - SHMARG  <  mxGetNumberOfElements ( prhs[ ARG_SHMNAM ] ) )
+    {
+      RTCONS->quit = ME_INTRN ;
+      mexErrMsgIdAndTxt ( "MET:open:prhs" , ERRHD1
+        "arg %s must be cell with max %d elements" ,
+        ARGNAM[ ARG_SHMNAM ] , MAXSHM - SHMARG ) ;
+    }
+    
+    nshm  +=  mxGetNumberOfElements ( prhs[ ARG_SHMNAM ] ) ;
+  }
+  
+  /* Elements per input argument */
+  argsiz[ ARG_CD     ] = 1 ;
+  argsiz[ ARG_STDOFD ] = 1 ;
+  argsiz[ ARG_PFD    ] = 2 ;
+  argsiz[ ARG_SHMFLG ] = argsiz[ ARG_SHMNR ] = argsiz[ ARG_REFD ] =
+    argsiz[ ARG_WEFD ] = argsiz[ ARG_WEFDV ] = nshm ;
+  argsiz[ ARG_SHMNAM ] = nshm - SHMARG ;
+  
   /* Check input argument type and number of elements */
   for  ( i = 0 ; i  <  nrhs  ; ++i )
     
@@ -183,12 +219,43 @@ void  metxopen ( struct met_t *  RTCONS ,
         ARGNAM[ i ] ) ;
     }
     
-    else if  ( ARGSIZ[ i ]  !=  mxGetNumberOfElements ( prhs[ i ] ) )
+    else if  ( argsiz[ i ]  !=  mxGetNumberOfElements ( prhs[ i ] ) )
+    {
+      RTCONS->quit = ME_INTRN ;
+      mexErrMsgIdAndTxt ( "MET:open:prhs" , ERRHD1
+        "arg %s numel not %d" , ARGNAM[ i ] , ( int )  argsiz[ i ] ) ;
+    }
+  
+  /* Shared memory names , built-in followed by declared */
+  for  ( i = 0 ; i  <  SHMARG ; ++i )
+    strcpy ( RTCONS->shmnam[ i ] , SHMNAM[ i ] ) ;
+  
+  for  ( i = SHMARG ; i  <  nshm ; ++i )
+  {
+    /* Get pointer to Matlab array in this element of the cell shmnam */
+    M = mxGetCell ( prhs[ ARG_SHMNAM ] , i - SHMARG ) ;
+    
+    /* Non-empty string that fits , and is not a duplicate */
+    if  ( M == NULL  ||  !mxIsChar ( M )  ||  mxIsEmpty ( M )  ||
+          mxGetString ( M , RTCONS->shmnam[ i ] , MSHM_NAMLEN ) )
     {
       RTCONS->quit = ME_INTRN ;
       mexErrMsgIdAndTxt ( "MET:open:prhs" , ERRHD1
-        "arg %s numel not %d" , ARGNAM[ i ] , ARGSIZ[ i ] ) ;
+        "arg %s{ %d } must be string of max %d chars" ,
+        ARGNAM[ ARG_SHMNAM ] , i - SHMARG + 1 , MSHM_NAMLEN - 1 ) ;
     }
+    
+    for  ( j = 0 ; j  <  i ; ++j )
+      if  ( !strcmp ( RTCONS->shmnam[ i ] , RTCONS->shmnam[ j ] ) )
+      {
+        RTCONS->quit = ME_INTRN ;
+        mexErrMsgIdAndTxt ( "MET:open:prhs" , ERRHD1
+          "arg %s{ %d } duplicate name %s" , ARGNAM[ ARG_SHMNAM ] ,
+          i - SHMARG + 1 , RTCONS->shmnam[ i ] ) ;
+      }
+  }
+  
+  RTCONS->nshm = nshm ;
   
   /* Check shared memory flags
   */
@@ -204,7 +271,7 @@ void  metxopen ( struct met_t *  RTCONS ,
   /* Check each Matlab char ... */
   RTCONS->nfd = NFD_INIT ;
   
-  for  ( i = 0 ; i  <  ARGSIZ[ ARG_SHMFLG ] ; ++i )
+  for  ( i = 0 ; i  <  nshm ; ++i )
   {
     
     /* ... against each valid value. */
@@ -325,7 +392,7 @@ void  metxopen ( struct met_t *  RTCONS ,
   
   /* POSIX shared memory flags , number of readers , readers' and writer's
     event file descriptors */
-  for  ( i = 0 ; i  <  SHMARG ; ++i )
+  for  ( i = 0 ; i  <  nshm ; ++i )
   {
     /* Gather event fd's */
     RTCONS->shmnr[ i ]  = ( unsigned char )  shmnr[ i ] ;
@@ -385,7 +452,7 @@ void  metxopen ( struct met_t *  RTCONS ,
   }
   
   /* Writer's event fd lists , each shm and reader combination */
-  for  ( i = 0 ; i  <  SHMARG ; ++i )
+  for  ( i = 0 ; i  <  nshm ; ++i )
   {
     /* Skip if MET controller is not a writer */
     if  (  RTCONS->shmflg[ i ]  !=  MSMG_WRITE  &&
@@ -469,13 +536,13 @@ void  metxopen ( struct met_t *  RTCONS ,
   
   /* Check that number of writer's efds are same for each shared memory.
     Find index of first shm that controller writes in. */
-  for  ( i = 0 ; i  <  SHMARG  &&
+  for  ( i = 0 ; i  <  nshm  &&
          RTCONS->shmflg[ i ] != MSMG_WRITE  &&
          RTCONS->shmflg[ i ] != MSMG_BOTH ;
          ++i )  ;
   
   /* Then check against remaining shared mems */
-  for  ( j = i + 1 ; j  <  SHMARG ; ++j )
+  for  ( j = i + 1 ; j  <  nshm ; ++j )
     
     /* Not a writer */
     if  ( RTCONS->shmflg[ j ]  !=  MSMG_WRITE  &&
@@ -551,19 +618,19 @@ void  metxopen ( struct met_t *  RTCONS ,
   fdcheck ( METPIP , RTCONS->p    , RTCONS->pf   , RTCONS ) ;
   
   /* Readers' event file descriptors */
-  fdcheck ( SHMARG , RTCONS->refd , RTCONS->rflg , RTCONS ) ;
+  fdcheck ( nshm , RTCONS->refd , RTCONS->rflg , RTCONS ) ;
   
   /* Writer's event file descriptors */
-  fdcheck ( SHMARG , RTCONS->wefd , RTCONS->wflg , RTCONS ) ;
+  fdcheck ( nshm , RTCONS->wefd , RTCONS->wflg , RTCONS ) ;
   
-  for  ( i = 0 ; i  <  SHMARG ; ++i )
+  for  ( i = 0 ; i  <  nshm ; ++i )
     fdcheck ( n[ i ] , RTCONS->wefdv[ i ] , RTCONS->wflgv[ i ] , RTCONS ) ;
   
   
   /*-- Memory map POSIX shared memory --*/
 	
   /* Loop shared memory file names */
-	for  ( i = 0 ; i  <  SHMARG ; ++i )
+	for  ( i = 0 ; i  <  nshm ; ++i )
   {
     
     /* Determine system opening flag from MET shm opening flag */
@@ -572,30 +639,26 @@ void  metxopen ( struct met_t *  RTCONS ,
       /* Stays closed , to next shm */
       case MSMG_CLOSED:  continue ;
       
-      /* Reading only */
-      case   MSMG_READ:  f = O_RDONLY ;
-                         p = PROT_READ ;
-                         break ;
-      
-      /* Writing only */
-      case  MSMG_WRITE:  f = O_RDWR ;
-                         p = PROT_WRITE ;
-                         break ;
-      
-      /* Reading and writing */
+      /* Readers acknowledge each generation and writers check for the
+        acknowledgements in the synchronisation block , so every mapping
+        is readable and writable */
+      case   MSMG_READ:
+      case  MSMG_WRITE:
       case   MSMG_BOTH:  f = O_RDWR ;
                          p = PROT_READ  |  PROT_WRITE ;
                          break ;
     }
     
     /* Open POSIX shared memory */
-    if  ( ( fd = shm_open ( SHMNAM[ i ] , f , 0 ) )  ==  -1 )
+    snprintf ( fnm , MSHM_FNMLEN , MSHM_FNFMT , RTCONS->shmnam[ i ] ) ;
+    
+    if  ( ( fd = shm_open ( fnm , f , 0 ) )  ==  -1 )
     {
       RTCONS->quit = ME_SYSER ;
       perror ( "met:open:shm_open" ) ;
       mexErrMsgIdAndTxt ( "MET:open:shm" , ERRHD2
         "error opening POSIX shared memory %s" ,
-        RTCONS->cd , SHMNAM[ i ] ) ;
+        RTCONS->cd , fnm ) ;
     }
     
     /* Determine size of shared memory by accessing file stats */
@@ -605,7 +668,7 @@ void  metxopen ( struct met_t *  RTCONS ,
       perror ( "met:open:fstat" ) ;
       mexErrMsgIdAndTxt ( "MET:open:shm" , ERRHD2
         "error getting stats on POSIX shared memory %s" ,
-        RTCONS->cd , SHMNAM[ i ] ) ;
+        RTCONS->cd , fnm ) ;
     }
     
     RTCONS->shmsiz[ i ] = s.st_size ;
@@ -621,7 +684,7 @@ void  metxopen ( struct met_t *  RTCONS ,
       perror ( "met:open:mmap" ) ;
       mexErrMsgIdAndTxt ( "MET:open:shm" , ERRHD2
         "error mapping POSIX shared memory %s" ,
-        RTCONS->cd , SHMNAM[ i ] ) ;
+        RTCONS->cd , fnm ) ;
     }
     
     /* Close shared memory */
@@ -634,7 +697,7 @@ void  metxopen ( struct met_t *  RTCONS ,
         perror ( "met:open:close" ) ;
         mexErrMsgIdAndTxt ( "MET:open:shm" , ERRHD2
           "error closing POSIX shared memory %s" ,
-          RTCONS->cd , SHMNAM[ i ] ) ;
+          RTCONS->cd , fnm ) ;
       }
     
   } /* shm */
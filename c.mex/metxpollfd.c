@@ -0,0 +1,129 @@
+/*  metxpollfd.c
+  
+  int  metxpollfd ( struct met_t *  RTC , int  fd , short  ev ,
+                    const struct timespec *  dl )
+  
+  Waits until any of the poll() events in ev occur on file descriptor fd.
+  If dl is NULL then the wait is indefinite. Otherwise, dl is an absolute
+  deadline on the monotonic clock, as returned by metxdeadline. Returns 1
+  if fd is ready, or 0 if the deadline passed first. UNIX signal
+  interruptions are absorbed and the wait resumes with whatever time
+  remains. No change is made to the file status flags of fd, so that it
+  can be left in non-blocking mode. Run-time constants are handed in RTC
+  for error handling.
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* metx.h comes first , since met.h defines _GNU_SOURCE for ppoll() */
+#include  "metx.h"
+
+#include  <poll.h>
+#include  <time.h>
+
+
+/*--- Define block ---*/
+
+#define  ERRHDR  MCSTR ":met:metxpollfd: "
+
+#define  FDREADY  1
+#define  TIMEOUT  0
+
+
+/*--- metxpollfd function definition ---*/
+
+int  metxpollfd ( struct met_t *  RTC , int  fd , short  ev ,
+                  const struct timespec *  dl )
+{
+  
+  /*-- Variables --*/
+  
+  /* poll() file descriptor structure */
+  struct pollfd  p = { fd , ev , 0 } ;
+  
+  /* Time measurement and time remaining until deadline , and pointer to
+    time remaining that is NULL for an indefinite wait */
+  struct timespec  t , r , * rp = NULL ;
+  
+  /* ppoll() return value */
+  int  n ;
+  
+  
+  /*-- Wait loop --*/
+  
+  for  ( ; ; )
+  {
+    
+    /* Deadline given , find the time remaining */
+    if  ( dl  !=  NULL )
+    {
+      if  ( clock_gettime ( CLOCK_MONOTONIC , &t )  ==  -1 )
+      {
+        RTC->quit = ME_SYSER ;
+        perror ( "met:metxpollfd:clock_gettime" ) ;
+        mexErrMsgIdAndTxt ( "MET:metxpollfd:clock_gettime" , ERRHDR
+          "error measuring time" , RTC->cd ) ;
+      }
+      
+      r.tv_sec  = dl->tv_sec  - t.tv_sec  ;
+      r.tv_nsec = dl->tv_nsec - t.tv_nsec ;
+      
+      if  ( r.tv_nsec  <  0 )
+      {
+        r.tv_sec  -= 1 ;
+        r.tv_nsec += NSPERS ;
+      }
+      
+      /* Deadline has been reached or surpassed , but poll once more with
+        zero timeout so that a ready fd is never reported as a timeout */
+      if  ( r.tv_sec  <  0 )
+        r.tv_sec = r.tv_nsec = 0 ;
+      
+      rp = &r ;
+    }
+    
+    /* Wait for events */
+    n = ppoll ( &p , 1 , rp , NULL ) ;
+    
+    /* fd is ready */
+    if  ( 0  <  n )  break ;
+    
+    /* Timed out */
+    else if  ( !n )  return  TIMEOUT ;
+    
+    /* Error other than UNIX signal interruption */
+    else if  ( errno  !=  EINTR )
+    {
+      RTC->quit = ME_SYSER ;
+      perror ( "met:metxpollfd:ppoll" ) ;
+      mexErrMsgIdAndTxt ( "MET:metxpollfd:ppoll" , ERRHDR
+        "error waiting on fd %d" , RTC->cd , fd ) ;
+    }
+  
+  } /* wait loop */
+  
+  
+  /*-- Error on the fd itself --*/
+  
+  /* POLLHUP and POLLERR are always reported. They are returned as ready ,
+    so that the following read() or write() can raise the specific MET
+    error e.g. a broken pipe. But an invalid fd is an internal error. */
+  if  ( p.revents  &  POLLNVAL )
+  {
+    RTC->quit = ME_INTRN ;
+    mexErrMsgIdAndTxt ( "MET:metxpollfd:POLLNVAL" , ERRHDR
+      "fd %d is not open" , RTC->cd , fd ) ;
+  }
+  
+  
+  /*-- Return ready --*/
+  
+  return  FDREADY ;
+
+
+} /* metxpollfd */
+
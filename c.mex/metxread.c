@@ -2,6 +2,7 @@
 /*  metxread.c
   
   C = met ( 'read' , shm )
+  C = met ( 'read' , { shm , tout } )
   
   Reads Matlab arrays from the POSIX shared memory named by shm into cell
   array C. If the shared memory contains N arrays, then C will have N
@@ -14,6 +15,13 @@
   prefixed then the function immediately returns {} if there is no new
   data ; this is the default action when no character is prefixed.
   
+  A blocking read waits on a futex in the shared memory's synchronisation
+  block until the writer increments its generation counter , and can be
+  given a timeout by passing shm as the first element of a cell array with
+  tout in the second. Then, a blocking read waits at most tout seconds and
+  returns {} if no data was written in that time. An empty tout i.e. []
+  , or Inf , waits indefinitely.
+  
   A blocking read fails as an error if the calling controller is also a
   writer to the shared memory.
   
@@ -310,8 +318,8 @@ void  metxread ( struct met_t *  RTCONS ,
       "%d input arg required , %d given" , RTCONS->cd , NRHS , nrhs ) ;
   }
   
-  /* Arg shm must be string */
-  if  (  CHK_IS_STR( PRHS_SHM )  )
+  /* Arg shm must be string , or { string , tout } cell array */
+  if  (  !mxIsCell ( prhs[ PRHS_SHM ] )  &&  ( CHK_IS_STR( PRHS_SHM ) )  )
   {
     RTCONS->quit = ME_INTRN ;
     mexErrMsgIdAndTxt ( "MET:read:nrhs" , ERRHDR
@@ -324,11 +332,17 @@ void  metxread ( struct met_t *  RTCONS ,
   /* Shared memory blocking mode */
   char  bm ;
   
+  /* Timeout in seconds , and deadline pointer that stays NULL when the
+    wait is indefinite */
+  double  tout ;
+  struct timespec  dl , * dlp = NULL ;
+  
   /* Double pointer to Return array's data */
   double *  d ;
   
-  /* Event fd read/write buffer */
-  uint64_t  efdval ;
+  /* Shared memory synchronisation block , and generation counter */
+  struct metshmsync *  sync ;
+  uint32_t  gen ;
   
   /* Byte-resolution pointer for mapped POSIX shared memory */
   char *  shm ;
@@ -346,7 +360,8 @@ void  metxread ( struct met_t *  RTCONS ,
   
   /*-- Get POSIX shared memory name and blocking mode --*/
   
-  if  ( ( si = metxshmblk ( prhs[ PRHS_SHM ] , &bm ) )  ==  -1 )
+  if  ( ( si = metxshmblk ( RTCONS , prhs[ PRHS_SHM ] , &bm ,
+                                &tout ) )  ==  -1 )
   {
     RTCONS->quit = ME_INTRN ;
     mexErrMsgIdAndTxt ( "MET:read:shm" , ERRHDR
@@ -375,23 +390,29 @@ void  metxread ( struct met_t *  RTCONS ,
   }
   
   
-  /*-- Perform blocking read , so change event fd blocking mode --*/
+  /*-- Blocking read with timeout --*/
   
-  if  ( bm  ==  SCHBLOCK )
-    
-    /* This controller's specific writer's event fd set to blocking , so
-      that controller can wait for writer */
-    metxsetfl ( RTCONS , 1 ,
-                RTCONS->wefd + si , RTCONS->wflg + si , 'b' ,
-             "shm read error switch to blocking on writer's event fd\n" ) ;
+  if  ( bm  ==  SCHBLOCK  &&  0  <=  tout )
+  {
+    metxdeadline ( RTCONS , tout , &dl ) ;
+    dlp = &dl ;
+  }
   
   
   /*-- Check if writer has written new shm contents --*/
   
-  efdval = metxefdread ( RTCONS , RTCONS->wefd[ si ] ) ;
+  /* Point to the synchronisation block */
+  sync = SHMSYNC( RTCONS , si ) ;
+  
+  /* New data is ready when the generation counter differs from the last
+    generation that was read. A blocking read waits on the counter's futex
+    until the writer increments it , or until the deadline passes. */
+  while  (  ( gen = __atomic_load_n ( &sync->gen , __ATOMIC_ACQUIRE ) )  ==
+              RTCONS->rgen[ si ]  &&  bm  ==  SCHBLOCK  &&
+            metxfwait ( RTCONS , &sync->gen , gen , dlp )  )  ;
   
   /* No new data ready in shm */
-  if  ( efdval  <  WEFD_POST )
+  if  ( gen  ==  RTCONS->rgen[ si ] )
   {
     /* Make empty cell array */
     if  ( ( plhs[ 0 ] = mxCreateCellMatrix ( 0 , 0 ) )  ==  NULL )
@@ -405,23 +426,15 @@ void  metxread ( struct met_t *  RTCONS ,
     return ;
   }
   
-  /* Error check reader count */
-  else if  ( WEFD_POST  <  efdval )
-  {
-    RTCONS->quit = ME_INTRN ;
-    mexErrMsgIdAndTxt ( "MET:read:readrefd" , ERRHDR
-      "writer's event fd returned %llu , larger than WEFD_POST %d" ,
-      RTCONS->cd , (unsigned long long) efdval , WEFD_POST ) ;
-  }
-  
   
   /*-- Read from POSIX shared memory --*/
   
-  /* Point to the first size_t value of the header */
-  hdr = RTCONS->shmmap[ si ] ;
+  /* Point to the first size_t value of the header , past the
+    synchronisation block */
+  hdr = ( size_t * )  SHMDATA( RTCONS , si ) ;
   
   /* Set byte pointer shm to first byte past the size_t header */
-  shm = ( char * )  RTCONS->shmmap[ si ]  +  SMST_NUM * sizeof ( *hdr ) ;
+  shm = SHMDATA( RTCONS , si )  +  SMST_NUM * sizeof ( *hdr ) ;
   
   /* Make output arg C , one element per mxArray stored in shared mem */
   if  ( ( plhs[ 0 ] = mxCreateCellMatrix ( hdr[ SMST_NMXAR ] , 1 ) )  ==
@@ -452,22 +465,25 @@ void  metxread ( struct met_t *  RTCONS ,
   }
   
   
-  /*-- Post to readers' event file descriptor --*/
+  /*-- Acknowledge this generation --*/
   
-  if  ( metxefdpost ( RTCONS , 1 ,  RTCONS->refd + si , REFD_POST ) )
+  RTCONS->rgen[ si ] = gen ;
     
-    mexErrMsgIdAndTxt ( "MET:read:post" , ERRHDR
-      "failed to post to readers' event fd" , RTCONS->cd ) ;
-  
-  
-  /*-- Restore non-blocking reads --*/
-  
-  if  ( !( RTCONS->wflg[ si ]  &  O_NONBLOCK ) )
+  /* The increment is ordered after all reads from shm , so the writer can
+    not overwrite data that is still being read. Only the last reader to
+    acknowledge must wake the writer , with a single futex wake. An event
+    fd post is added if the writer is waiting in met ( 'select' ). */
+  if  ( __atomic_add_fetch ( &sync->ack , 1 , __ATOMIC_SEQ_CST )  ==
+          RTCONS->shmnr[ si ] )
+  {
+    metxfwake ( RTCONS , &sync->ack , 1 ) ;
     
-    /* Set this controller's writer's efd to non-blocking */
-    metxsetfl ( RTCONS , 1 ,
-                RTCONS->wefd + si , RTCONS->wflg + si , 'n' ,
-           "shm read error switch to non-blocking on writer's event fd" ) ;
+    if  (  __atomic_load_n ( &sync->wsel , __ATOMIC_SEQ_CST )  &&
+           metxefdpost ( RTCONS , 1 , RTCONS->refd + si , REFD_POST )  )
+      
+      mexErrMsgIdAndTxt ( "MET:read:post" , ERRHDR
+        "failed to post to readers' event fd" , RTCONS->cd ) ;
+  }
   
   
 }  /* metxread */
@@ -1,7 +1,6 @@
-
 /*  metxrecv.c
   
-  [ n , src , sig , crg , tim ] = met ( 'recv' , blk )
+  [ n , src , sig , crg , tim ] = met ( 'recv' , blk , opt )
   
   Receives MET signals from the MET server controller. The number of
   signals received is returned in n, with a value of 0 up to the MET signal
@@ -13,6 +12,19 @@
   blk is an optional argument ; if non-zero then a blocking read is
   performed , non-blocking if zero.
   
+  opt is an optional string of option characters, in any order:
+    
+    't' - Typed output. src and sig are returned as uint8 , crg as uint16 ,
+      and tim as double. These are the native MET signal types , so that
+      less memory is allocated than with double columns.
+    'a' - All. Every MET signal that is waiting in the broadcast pipe is
+      returned by a single read , and n may exceed the atomic read/write
+      limit. When blocking , 'recv' waits for at least one signal.
+  
+  e.g. [ n , src , sig ] = met ( 'recv' , 0 , 'ta' ) returns the whole
+  backlog of MET signals as uint8 columns. If opt is omitted or empty then
+  all output arguments are double.
+  
   Written by Jackson Smith - DPAG , University of Oxford
   
 */
@@ -22,13 +34,17 @@
 
 #include  "metx.h"
 
+#include  <poll.h>
+#include  <stdlib.h>
+#include  <sys/ioctl.h>
+
 
 /*--- Define block ---*/
 
-#define  ERRHDR  MCSTR ":met:send: "
+#define  ERRHDR  MCSTR ":met:recv: "
 
 #define  NLHS_MAX  5
-#define  NRHS_MAX  1
+#define  NRHS_MAX  2
 
 /* Array index of each output argument , starting from src */
 #define  PLHS_SRC  0
@@ -36,8 +52,21 @@
 #define  PLHS_CRG  2
 #define  PLHS_TIM  3
 
-/* prhs index of blk */
+/* prhs index of blk and opt */
 #define  PRHS_BLK  0
+#define  PRHS_OPT  1
+
+/* Option characters , and maximum length of opt plus null byte */
+#define  OPT_TYPED  't'
+#define  OPT_ALL    'a'
+#define  OPTLEN     3
+
+
+/*--- Constants ---*/
+
+/* Matlab class of each output arg from src to tim , for typed output */
+const mxClassID  TYPCLS[ NLHS_MAX - 1 ] =
+  { mxUINT8_CLASS , mxUINT8_CLASS , mxUINT16_CLASS , mxDOUBLE_CLASS } ;
 
 
 /*--- metxrecv function definition ---*/
@@ -63,11 +92,11 @@ void  metxrecv ( struct met_t *  RTCONS ,
   {
     RTCONS->quit = ME_INTRN ;
     mexErrMsgIdAndTxt ( "MET:recv:nrhs" , ERRHDR
-     "takes max %d input arg , %d given" , RTCONS->cd , NRHS_MAX , nrhs ) ;
+     "takes max %d input args , %d given" , RTCONS->cd , NRHS_MAX , nrhs ) ;
   }
   
   /* Input arg blk is scalar double */
-  if  (  nrhs  ==  NRHS_MAX  &&
+  if  (  PRHS_BLK  <  nrhs  &&
        ( mxGetNumberOfElements ( prhs[ PRHS_BLK ] ) != 1  ||
          !mxIsDouble ( prhs[ PRHS_BLK ] ) )  )
   {
@@ -76,34 +105,123 @@ void  metxrecv ( struct met_t *  RTCONS ,
       "blk must be a scalar double" , RTCONS->cd ) ;
   }
   
+  /* Input arg opt is a string , or empty */
+  if  (  PRHS_OPT  <  nrhs  &&  !mxIsEmpty ( prhs[ PRHS_OPT ] )  &&
+       ( CHK_IS_STR( PRHS_OPT )  ||
+         OPTLEN  <=  mxGetNumberOfElements ( prhs[ PRHS_OPT ] ) )  )
+  {
+    RTCONS->quit = ME_INTRN ;
+    mexErrMsgIdAndTxt ( "MET:recv:nrhs" , ERRHDR
+      "opt must be a string of up to %d option chars" , RTCONS->cd ,
+      OPTLEN - 1 ) ;
+  }
+  
   
   /*-- Variables --*/
   
   /* Generic counter */
   size_t  i ;
   
-  /* MET signal receive buffer , and byte pointer to buffer head */
-  struct metsignal  s[ RTCONS->awmsig ] ;
-  char *  pb = ( char * )  s ;
+  /* Blocking , typed output , and read-all flags */
+  unsigned char  blk = 0 , typ = 0 , all = 0 ;
+  
+  /* Option string */
+  char  opt[ OPTLEN ] = "" ;
+  
+  /* Number of bytes waiting in broadcast pipe */
+  int  nb ;
+  
+  /* Receive buffer pointer , and byte pointer to buffer head */
+  struct metsignal *  s ;
+  char *  pb ;
   
   /* Number of bytes in buffer, number of bytes / signals read , and bytes
     of fractional read */
-  size_t  b = sizeof ( s ) , n = 0 , f = 0 ;
+  size_t  b , n = 0 , f = 0 ;
   
   /* Return value from read */
   ssize_t  r ;
   
-  /* Vector of output argument double arrays */
-  double *  argov[ NLHS_MAX - 1 ] ;
+  /* Vector of output argument data */
+  void *  argov[ NLHS_MAX - 1 ] ;
+  
+  
+  /*-- Get options --*/
+  
+  if  ( PRHS_BLK  <  nrhs )
+    blk = mxGetScalar ( prhs[ PRHS_BLK ] )  !=  0 ;
+  
+  if  ( PRHS_OPT  <  nrhs  &&  !mxIsEmpty ( prhs[ PRHS_OPT ] )  &&
+        mxGetString ( prhs[ PRHS_OPT ] , opt , OPTLEN ) )
+  {
+    RTCONS->quit = ME_MATLB ;
+    mexErrMsgIdAndTxt ( "MET:recv:opt" , ERRHDR
+      "failed to convert opt to string" , RTCONS->cd ) ;
+  }
+  
+  for  ( i = 0 ; opt[ i ] ; ++i )
+    
+    switch  ( opt[ i ] )
+    {
+      case  OPT_TYPED:  typ = 1 ;  break ;
+      case    OPT_ALL:  all = 1 ;  break ;
+      
+      default:
+        RTCONS->quit = ME_INTRN ;
+        mexErrMsgIdAndTxt ( "MET:recv:opt" , ERRHDR
+          "unrecognised option char '%c'" , RTCONS->cd , opt[ i ] ) ;
+    }
   
   
   /*-- Perform blocking read --*/
   
-  if  ( nrhs  ==  NRHS_MAX  &&  mxGetScalar ( prhs[ PRHS_BLK ] ) )
+  /* The broadcast pipe stays non-blocking. Wait for signals instead. */
+  if  ( blk )
+    
+    metxpollfd ( RTCONS , RTCONS->p[ BCASTR ] , POLLIN , NULL ) ;
+  
+  
+  /*-- Size the receive buffer --*/
+  
+  /* Default is the atomic read/write limit */
+  b = RTCONS->awmsig ;
+  
+  /* Reading all signals , so ask how many bytes are waiting */
+  if  ( all )
+  {
+    if  ( ioctl ( RTCONS->p[ BCASTR ] , FIONREAD , &nb )  ==  -1 )
+    {
+      RTCONS->quit = ME_SYSER ;
+      perror ( "met:metxrecv:ioctl" ) ;
+      mexErrMsgIdAndTxt ( "MET:recv:ioctl" , ERRHDR
+        "error counting bytes in broadcast pipe" , RTCONS->cd ) ;
+    }
+    
+    /* Round up to whole MET signals */
+    nb = ( nb + sizeof ( struct metsignal ) - 1 ) /
+           sizeof ( struct metsignal ) ;
     
-    metxsetfl ( RTCONS , 1 ,
-                RTCONS->p + BCASTR , RTCONS->pf + BCASTR , 'b' ,
-                "error switching to blocking read on broadcast pipe" ) ;
+    if  ( b  <  ( size_t )  nb )  b = nb ;
+  }
+  
+  /* Grow buffer , if needed */
+  if  ( RTCONS->rbufn  <  b )
+  {
+    if  ( ( s = realloc ( RTCONS->rbuf , b * sizeof ( *s ) ) )  ==  NULL )
+    {
+      RTCONS->quit = ME_SYSER ;
+      mexErrMsgIdAndTxt ( "MET:recv:rbuf" , ERRHDR
+        "failed to allocate receive buffer" , RTCONS->cd ) ;
+    }
+    
+    RTCONS->rbuf  = s ;
+    RTCONS->rbufn = b ;
+  }
+  
+  /* Point to buffer , and convert from signals to bytes */
+   s = RTCONS->rbuf ;
+  pb = ( char * )  s ;
+   b = b  *  sizeof ( struct metsignal ) ;
   
   
   /*-- Read MET signals --*/
@@ -165,15 +283,6 @@ void  metxrecv ( struct met_t *  RTCONS ,
   } /* read loop */
   
   
-  /*-- Restore non-blocking reads --*/
-  
-  if  ( !( RTCONS->pf[ BCASTR ]  &  O_NONBLOCK ) )
-    
-    metxsetfl ( RTCONS , 1 ,
-                RTCONS->p + BCASTR , RTCONS->pf + BCASTR , 'n' ,
-               "error switching to non-blocking read on broadcast pipe" ) ;
-  
-  
   /*-- Output arguments --*/
   
   /* Number of signals read */
@@ -197,11 +306,14 @@ void  metxrecv ( struct met_t *  RTCONS ,
   /* Number of columns i.e. is n non-zero? Yes, 1 col. No, 0 col. */
   f = 0  <  n ;
   
-  /* Alocate output vectors */
+  /* Alocate output vectors. Every element is about to be set , so skip
+    initialisation. */
   for  ( i = 1 ; i  <  nlhs ; ++i )
     
     /* Make Matlab array */
-    if  ( ( plhs[ i ] = mxCreateDoubleMatrix ( n , f , mxREAL ) ) == NULL )
+    if  ( ( plhs[ i ] = mxCreateUninitNumericMatrix ( n , f ,
+            typ  ?  TYPCLS[ i - 1 ]  :  mxDOUBLE_CLASS , mxREAL ) )  ==
+            NULL )
     {
       RTCONS->quit = ME_MATLB ;
       mexErrMsgIdAndTxt ( "MET:recv:outargs" , ERRHDR
@@ -210,30 +322,53 @@ void  metxrecv ( struct met_t *  RTCONS ,
     
     /* Access array's real value data */
     else if  (  n  &&
-              ( argov[ i - 1 ] =  mxGetPr ( plhs[ i ] ) )  ==  NULL  )
+              ( argov[ i - 1 ] =  mxGetData ( plhs[ i ] ) )  ==  NULL  )
     {
       RTCONS->quit = ME_MATLB ;
       mexErrMsgIdAndTxt ( "MET:recv:outargs" , ERRHDR
         "no real value component to output arg %d" , RTCONS->cd , i + 1 ) ;
     }
   
-  /* Load each received MET signal */
-  for  ( i = 0 ; i  <  n ; ++i )
+  /* Load each received MET signal in native type */
+  if  ( typ )
     
-    switch  ( r )
-    {
-      /* Time */
-      case  PLHS_TIM:  argov[ PLHS_TIM ][ i ] = ( double )  s[ i ].time   ;
+    for  ( i = 0 ; i  <  n ; ++i )
       
-      /* Cargo */
-      case  PLHS_CRG:  argov[ PLHS_CRG ][ i ] = ( double )  s[ i ].cargo  ;
+      switch  ( r )
+      {
+        case  PLHS_TIM:
+          ( (   mettime_t * )  argov[ PLHS_TIM ] )[ i ] = s[ i ].time   ;
+        case  PLHS_CRG:
+          ( (  metcargo_t * )  argov[ PLHS_CRG ] )[ i ] = s[ i ].cargo  ;
+        case  PLHS_SIG:
+          ( ( metsignal_t * )  argov[ PLHS_SIG ] )[ i ] = s[ i ].signal ;
+        case  PLHS_SRC:
+          ( ( metsource_t * )  argov[ PLHS_SRC ] )[ i ] = s[ i ].source ;
+      }
       
-      /* Signal identifier */
-      case  PLHS_SIG:  argov[ PLHS_SIG ][ i ] = ( double )  s[ i ].signal ;
+  /* Or convert to double */
+  else
       
-      /* Source controller descriptor */
-      case  PLHS_SRC:  argov[ PLHS_SRC ][ i ] = ( double )  s[ i ].source ;
-    }
+    for  ( i = 0 ; i  <  n ; ++i )
+      
+      switch  ( r )
+      {
+        /* Time */
+        case  PLHS_TIM:
+          ( ( double * )  argov[ PLHS_TIM ] )[ i ] = s[ i ].time   ;
+        
+        /* Cargo */
+        case  PLHS_CRG:
+          ( ( double * )  argov[ PLHS_CRG ] )[ i ] = s[ i ].cargo  ;
+        
+        /* Signal identifier */
+        case  PLHS_SIG:
+          ( ( double * )  argov[ PLHS_SIG ] )[ i ] = s[ i ].signal ;
+        
+        /* Source controller descriptor */
+        case  PLHS_SRC:
+          ( ( double * )  argov[ PLHS_SRC ] )[ i ] = s[ i ].source ;
+      }
   
   
 } /* metxrecv */
@@ -51,18 +51,80 @@
 #define  SHMACTCOL  2
 
 
-/*--- metxwrite function definition ---*/
+/*--- shmrdy function definition ---*/
 
-void  metxselect ( struct met_t *  RTCONS ,
-                   int  nlhs ,       mxArray *  plhs[] ,
-                   int  nrhs , const mxArray *  prhs[] )
+/* Returns non-zero if the action on shared memory listed at element i of
+  RTC->fd can be performed now , according to the shm's synchronisation
+  block. Reading is possible when there is a new generation. Writing is
+  possible when nothing was ever written , or all readers acknowledged. */
+
+static int  shmrdy ( struct met_t *  RTC , int  i )
 {
   
-  /*--- CONSTANTS ---*/
+  /* Shared memory index and synchronisation block */
+  int  si = RTC->fdsi[ i ] ;
+  struct metshmsync *  sync = SHMSYNC( RTC , si ) ;
+  
+  /* New data to read */
+  if  ( RTC->fdio[ i ]  ==  MSMG_READ )
+    return  __atomic_load_n ( &sync->gen , __ATOMIC_SEQ_CST )  !=
+              RTC->rgen[ si ] ;
+  
+  /* Free to write */
+  return  !__atomic_load_n ( &sync->gen , __ATOMIC_SEQ_CST )  ||
+          RTC->shmnr[ si ]  <=
+            __atomic_load_n ( &sync->ack , __ATOMIC_SEQ_CST ) ;
+
 
-  /* Shared memory names */
-  const char *  SHMNAM[ SHMARG ] = { SNAM_STIM , SNAM_EYE , SNAM_NSP } ;
+} /* shmrdy */
+
+
+/*--- shmarm function definition ---*/
+
+/* Flags in each monitored shared memory's synchronisation block that this
+  controller is waiting in select() , if a is non-zero , or clears the flag
+  if a is zero. While flagged , the other side posts to this controller's
+  event fd. Sequentially consistent ordering guarantees that either the
+  other side sees the flag , or shmrdy sees the other side's update. */
+
+static void  shmarm ( struct met_t *  RTC , int  a )
+{
+  
+  /* fd index , and this controller's bit in the rsel field */
+  int  i ;
+  uint32_t  b = 1U << ( RTC->cd - 1 ) ;
+  
+  /* Shared memory synchronisation block */
+  struct metshmsync *  sync ;
   
+  /* Monitored shared memory , the last fd is the broadcast pipe */
+  for  ( i = 0 ; i  <  RTC->nfd - 1 ; ++i )
+  {
+    sync = SHMSYNC( RTC , RTC->fdsi[ i ] ) ;
+    
+    /* Reader's bit */
+    if  ( RTC->fdio[ i ]  ==  MSMG_READ )
+    {
+      if  ( a )  __atomic_or_fetch  ( &sync->rsel ,  b , __ATOMIC_SEQ_CST ) ;
+      else       __atomic_and_fetch ( &sync->rsel , ~b , __ATOMIC_SEQ_CST ) ;
+    }
+    
+    /* Writer's flag */
+    else
+      __atomic_store_n ( &sync->wsel , a ? 1 : 0 , __ATOMIC_SEQ_CST ) ;
+  
+  } /* shm */
+
+
+} /* shmarm */
+
+
+/*--- metxselect function definition ---*/
+
+void  metxselect ( struct met_t *  RTCONS ,
+                   int  nlhs ,       mxArray *  plhs[] ,
+                   int  nrhs , const mxArray *  prhs[] )
+{
   
   /*-- Compile time variables , for input checking --*/
   
@@ -134,12 +196,20 @@ void  metxselect ( struct met_t *  RTCONS ,
   /* Number of fd's ready for ee-yi-ee-yi-oh */
   int  n ;
   
+  /* Number of shm actions that are possible , flag for each monitored shm
+    , and flag for MET signals in the broadcast pipe */
+  int  nr , msig ;
+  char  rdy[ RTCONS->nfd ] ;
+  
   /* File descriptor set */
   fd_set  fset ;
   
   /* Timer specification and time measurement , timeval pointer */
   struct timeval  t , * tvp = NULL ;
   
+  /* Zero timeout , for polling the pipe when shm is already ready */
+  struct timeval  z ;
+  
   /* Timeout deadline and time measurement , in seconds */ 
   double  toutd = 0 , tmeas ;
   
@@ -174,9 +244,20 @@ void  metxselect ( struct met_t *  RTCONS ,
   
   /*-- Multiplexing --*/
   
-  /* Return here after UNIX signal interruption */
+  /* Shared memory event fd's are only posted while this controller is
+    flagged as waiting in the synchronisation block. A post may therefore
+    be stale by the time select() returns , so readiness is always decided
+    by the synchronisation block itself. */
+  
+  /* Return here after UNIX signal interruption , or a stale post */
   reset:
   
+  /* Flag that we are waiting , then see what is ready already */
+  shmarm ( RTCONS , 1 ) ;
+  
+  for  ( i = nr = 0 ; i  <  RTCONS->nfd - 1 ; ++i )
+    nr  +=  rdy[ i ] = shmrdy ( RTCONS , i ) ;
+  
   /* Load fd's into set */
   FD_ZERO( &fset ) ;
   
@@ -184,20 +265,37 @@ void  metxselect ( struct met_t *  RTCONS ,
     
     FD_SET( RTCONS->fd[ i ] , &fset ) ;
   
-  /* Wait for fds , or timeout */
-  n = select ( RTCONS->maxfd + 1 , &fset , NULL , NULL , tvp ) ;
+  /* Wait for fds , or timeout. Only poll if shm is ready already. */
+  z.tv_sec = z.tv_usec = 0 ;
+  n = select ( RTCONS->maxfd + 1 , &fset , NULL , NULL , nr ? &z : tvp ) ;
+  
+  /* No longer waiting */
+  shmarm ( RTCONS , 0 ) ;
   
   /* Error handling */
-  if  ( n  ==  -1 )
+  if  ( n  ==  -1  &&  errno  !=  EINTR )
+  {
+    RTCONS->quit = ME_SYSER ;
+    perror ( "met:metxselect:select" ) ;
+    mexErrMsgIdAndTxt ( "MET:select:select" , ERRHDR
+      "error during select" , RTCONS->cd ) ;
+  }
+  
+  /* Drain shm event fd's returned by select , and check shm again */
+  for  ( i = nr = 0 ; i  <  RTCONS->nfd - 1 ; ++i )
+  {
+    if  ( 0  <  n  &&  FD_ISSET( RTCONS->fd[ i ] , &fset ) )
+      metxefdread ( RTCONS , RTCONS->fd[ i ] ) ;
+    
+    nr  +=  rdy[ i ] = shmrdy ( RTCONS , i ) ;
+  }
+  
+  /* Pipe fd was returned by select , hence signals ready */
+  msig  =  0 < n  &&  FD_ISSET( RTCONS->fd[ RTCONS->nfd - 1 ] , &fset ) ;
+  
+  /* UNIX signal interruption or stale post , nothing is ready */
+  if  ( n  &&  !nr  &&  !msig )
   {
-    /* Not UNIX signal interruption */
-    if  ( errno  !=  EINTR )
-    {
-      RTCONS->quit = ME_SYSER ;
-      perror ( "met:metxselect:select" ) ;
-      mexErrMsgIdAndTxt ( "MET:select:select" , ERRHDR
-        "error during select" , RTCONS->cd ) ;
-    }
     
     /* Call select() again immediately if there is no timeout */
     if  ( !ntout )  goto  reset ;
@@ -226,10 +324,9 @@ void  metxselect ( struct met_t *  RTCONS ,
     }
 
     /* Otherwise the deadline has been reached or surpassed , so report
-      no fd's ready */
-    n = 0 ;
+      nothing ready */
       
-  } /* errors */
+  } /* nothing ready */
   
   
   /*-- Make output arrays --*/
@@ -237,14 +334,8 @@ void  metxselect ( struct met_t *  RTCONS ,
   /* msig */
   if  ( PLHS_MSIG + 1  <=  nlhs )
   {
-    /* Index of broadcast pipe file descriptor */
-    i = RTCONS->nfd - 1 ;
-    
-    /* Pipe fd was returned by select , hence signals ready */
-    i =  n  &&  FD_ISSET( RTCONS->fd[ i ] , &fset )  ?  1  :  0  ;
-    
     /* Make Matlab array */
-    if  (  ( M = mxCreateDoubleScalar ( (double)  i ) )  ==  NULL  )
+    if  (  ( M = mxCreateDoubleScalar ( (double)  msig ) )  ==  NULL  )
     {
       RTCONS->quit = ME_MATLB ;
       mexErrMsgIdAndTxt ( "MET:select:mxCreateDoubleScalar" , ERRHDR
@@ -263,18 +354,12 @@ void  metxselect ( struct met_t *  RTCONS ,
     /* Row counter */
     int  j ;
     
-    /* Number of rows and columns , initialise nr to number of fd's */
-    mwSize  nr = n , nc ;
+    /* Number of columns */
+    mwSize  nc ;
     
     /* shm action string buffer , ends in null byte , don't touch this */
     char  c[ 2 ] = { ' ' , '\0' } ;
     
-    /* Number of columns is 2 if shared mem is ready. How we determine this
-      depends on whether the pipe fd was returned i.e. the value left over
-      in i from making msig. If signals ready, then reduce the fd count by
-      1, to get the number of shared mem actions. */
-    if  ( i )  --nr ;
-    
     /* Number of columns is > 0 if there are shm actions , and 0 if not */
     nc  =  nr  ?  SHMNUMCOL  :  0  ;
     
@@ -292,15 +377,16 @@ void  metxselect ( struct met_t *  RTCONS ,
     /* Empty cell , skip to time measurement */
     if  ( !nr )  goto  tmeasure ;
     
-    /* Check each event fd to see if it was returned by select() , while
-      there are still unassigned rows in shm */
+    /* Check each monitored shm to see if it is ready , while there are
+      still unassigned rows in shm */
     for  ( i = j = 0 ; i < RTCONS->nfd - 1  &&  j < nr ; ++i )
     {
-      /* fd was not returned , so check next one */
-      if  ( !FD_ISSET( RTCONS->fd[ i ] , &fset ) )  continue ;
+      /* shm action is not possible , so check next one */
+      if  ( !rdy[ i ] )  continue ;
       
       /* This fd is ready , make shared memory name into Matlab string */
-      if  ( ( M = mxCreateString (SHMNAM[ RTCONS->fdsi[i] ]) )  ==  NULL )
+      if  ( ( M = mxCreateString (
+                    RTCONS->shmnam[ RTCONS->fdsi[ i ] ] ) )  ==  NULL )
       {
         RTCONS->quit = ME_MATLB ;
         mexErrMsgIdAndTxt ( "MET:select:mxCreateString" , ERRHDR
@@ -1,18 +1,30 @@
-
 /*  metxsend.c
   
-  n = met ( 'send' , sig , crg , tim , blk )
-  
-  Sends MET signal requests to the MET server controller. Up to the atomic
-  write limit of signals can be sent, while the ith signal has MET signal
-  identifier sig( i ), cargo crg( i ), and time tim( i ). All signals have
-  a source value of the calling controller's controller descriptor. Returns
-  the number of MET signals that were sent. sig, crg, and tim must be
-  Matlab type double matrices. blk is optional ; if non-zero then a
-  blocking write is performed on the request pipe. Otherwise, a
-  non-blocking write is performed. If tim is an empty double i.e. [] then
-  'send' takes a time measurement and supplies this to all requested
-  signals.
+  n = met ( 'send' , sig , crg , tim , blk , tout )
+  
+  Sends MET signal requests to the MET server controller. Any number of
+  signals can be sent, while the ith signal has MET signal identifier
+  sig( i ), cargo crg( i ), and time tim( i ). All signals have a source
+  value of the calling controller's controller descriptor. Returns the
+  number of MET signals that were sent. sig, crg, and tim must be Matlab
+  type double matrices. If tim is an empty double i.e. [] then 'send'
+  takes a time measurement and supplies this to all requested signals.
+  
+  Signals are written to the request pipe in consecutive chunks of up to
+  the atomic write limit, MC.AWMSIG. Each chunk is written atomically, so
+  that signals from other controllers cannot be interleaved within it, and
+  the chunks are written in the same order as the signals in sig. Every
+  signal is checked before any chunk is written ; thus an error in the ith
+  signal means that none are sent.
+  
+  blk is optional ; if non-zero then 'send' waits for space in the request
+  pipe before writing each chunk, so that all signals are sent. Otherwise,
+  a non-blocking write is performed ; chunks are written until the request
+  pipe is full and the remaining signals are not sent. tout is optional ,
+  and sets the maximum number of seconds that a blocking 'send' will wait
+  in total. When the timeout expires, 'send' returns the number of signals
+  sent in the chunks that were written so far. If tout is omitted , empty
+  i.e. [] , or Inf then a blocking 'send' waits indefinitely.
   
   Written by Jackson Smith - DPAG , University of Oxford
   
@@ -21,6 +33,8 @@
 
 /*--- Include block ---*/
 
+#include  <poll.h>
+
 #include  "metx.h"
 
 
@@ -30,18 +44,13 @@
 
 #define  NLHS_MAX  1
 #define  NRHS_MIN  3
-#define  NRHS_MAX  4
+#define  NRHS_MAX  5
 
 #define  PRHS_SIG  0
 #define  PRHS_CRG  1
 #define  PRHS_TIM  2
 #define  PRHS_BLK  3
-
-
-/*--- Macros ---*/
-
-/* Current signal identifier */
-#define  CSI( i )  s[ i ].signal
+#define  PRHS_TOUT 4
 
 
 /*--- Constants ---*/
@@ -79,10 +88,24 @@ void  metxsend ( struct met_t *  RTCONS ,
     Use also to check number of elements in the input arguments. */
   size_t  q , n ;
   
+  /* Number of signals in current chunk , and bytes left to write */
+  size_t  c , b ;
+  
   /* Time measurement flag , default low, and time measurement */
   unsigned char  tf = 0 ;
   mettime_t  tm ;
   
+  /* Blocking flag , default low */
+  unsigned char  blk = 0 ;
+  
+  /* Timeout deadline , and pointer to it that stays NULL if the wait is
+    indefinite */
+  struct timespec  dl , * dlp = NULL ;
+  
+  /* Signal identifier and time of the signal being checked */
+  metsignal_t  id ;
+  mettime_t  t ;
+  
   /* MET signal buffer byte pointer */
   char *  p ;
   
@@ -130,7 +153,7 @@ void  metxsend ( struct met_t *  RTCONS ,
   q = mxGetNumberOfElements ( prhs[ 0 ] ) ;
   
   /* Chain compare remainder of args */
-  for  ( i = 1 ; i  <  NRHS_MAX - 1 ; ++i , q = n )
+  for  ( i = 1 ; i  <=  PRHS_TIM ; ++i , q = n )
   {
     /* numel of next arg */
     n = mxGetNumberOfElements ( prhs[ i ] ) ;
@@ -155,12 +178,38 @@ void  metxsend ( struct met_t *  RTCONS ,
   }
   
   /* Blocking argument is scalar double */
-  if  ( nrhs  ==  NRHS_MAX  &&
-        mxGetNumberOfElements ( prhs[ PRHS_BLK ] )  !=  1 )
+  if  ( PRHS_BLK  <  nrhs )
   {
-    RTCONS->quit = ME_INTRN ;
-    mexErrMsgIdAndTxt ( "MET:send:prhs" , ERRHDR
-      "blk must be scalar double" , RTCONS->cd ) ;
+    if  ( mxGetNumberOfElements ( prhs[ PRHS_BLK ] )  !=  1 )
+    {
+      RTCONS->quit = ME_INTRN ;
+      mexErrMsgIdAndTxt ( "MET:send:prhs" , ERRHDR
+        "blk must be scalar double" , RTCONS->cd ) ;
+    }
+    
+    blk = mxGetScalar ( prhs[ PRHS_BLK ] )  !=  0 ;
+  }
+  
+  /* Timeout argument is scalar double of 0 or more , or empty */
+  if  (  PRHS_TOUT  <  nrhs  &&
+         mxGetNumberOfElements ( prhs[ PRHS_TOUT ] )  )
+  {
+    if  ( mxGetNumberOfElements ( prhs[ PRHS_TOUT ] )  !=  1  ||
+          mxIsNaN ( mxGetScalar ( prhs[ PRHS_TOUT ] ) )  ||
+          mxGetScalar ( prhs[ PRHS_TOUT ] )  <  0 )
+    {
+      RTCONS->quit = ME_INTRN ;
+      mexErrMsgIdAndTxt ( "MET:send:prhs" , ERRHDR
+        "tout must be scalar double >= 0 , or empty i.e. []" ,
+        RTCONS->cd ) ;
+    }
+    
+    /* Only a blocking send can time out , Inf never does */
+    if  ( blk  &&  !mxIsInf ( mxGetScalar ( prhs[ PRHS_TOUT ] ) ) )
+    {
+      metxdeadline ( RTCONS , mxGetScalar ( prhs[ PRHS_TOUT ] ) , &dl ) ;
+      dlp = &dl ;
+    }
   }
   
   
@@ -200,13 +249,7 @@ void  metxsend ( struct met_t *  RTCONS ,
   }
   
   
-  /*-- MET signal buffer --*/
-  
-  /* Number of requested signals is minimum of number provided vs atomic */
-  q =  RTCONS->awmsig  <  q  ?  RTCONS->awmsig  :  q  ;
-  
-  /* Make buffer */
-  struct metsignal  s[ q ] ;
+  /*-- Check requested MET signals --*/
   
   /* Get pointers to input values */
   sig = mxGetPr ( prhs[ PRHS_SIG ] ) ;
@@ -222,21 +265,10 @@ void  metxsend ( struct met_t *  RTCONS ,
       "an input arg has no real value data" , RTCONS->cd ) ;
   }
   
-  /* Load buffer */
+  /* Every signal is checked before any are written , so that a bad
+    request can't leave a partial batch in the request pipe */
   for  ( i = 0 ; i  <  q ; ++i )
   {
-    /* Current controller's descriptor */
-    s[ i ].source = RTCONS->cd ;
-    
-    /* MET signal identifier */
-    s[ i ].signal = ( metsignal_t )  sig[ i ] ;
-    
-    /* Cargo */
-    s[ i ].cargo = ( metcargo_t )  crg[ i ] ;
-    
-    /* Time , return new measurement unless values provided in tim */
-    s[ i ].time  =  tf  ?  tm  :  ( mettime_t )  tim[ i ]  ;
-    
     /* Check signal identifier */
     if  ( sig[ i ] < 0  ||  MAXMSI < sig[ i ] )
     {
@@ -245,107 +277,134 @@ void  metxsend ( struct met_t *  RTCONS ,
         "signal %llu identifier %0.0f out of range 0 to %d" ,
         RTCONS->cd , (unsigned long long) i , sig[ i ] , MAXMSI ) ;
     }
+    
+    /* Identifier is valid , and time is either measured or given */
+    id = ( metsignal_t )  sig[ i ] ;
+     t = tf  ?  tm  :  ( mettime_t )  tim[ i ]  ;
+    
     /* Check cargo */
-    else if ( crg[ i ] < CRGMIN[ CSI( i ) ]  ||
-              crg[ i ] > CRGMAX[ CSI( i ) ] )
+    if ( crg[ i ] < CRGMIN[ id ]  ||  crg[ i ] > CRGMAX[ id ] )
     {
       RTCONS->quit = ME_PBCRG ;
       mexErrMsgIdAndTxt ( "MET:send:sigcrg" , ERRHDR
         "signal %llu %s cargo %d out of range %d to %d" ,
-        RTCONS->cd , (unsigned long long) i , MSIGNM[ CSI( i ) ] ,
-        s[ i ].cargo , CRGMIN[ CSI( i ) ] , CRGMAX[ CSI( i ) ] ) ;
+        RTCONS->cd , (unsigned long long) i , MSIGNM[ id ] ,
+        ( metcargo_t )  crg[ i ] , CRGMIN[ id ] , CRGMAX[ id ] ) ;
     }
     /* Check time */
-    else if  ( s[ i ].time < MIN_MSTIME  ||  MAX_MSTIME < s[ i ].time )
+    else if  ( t < MIN_MSTIME  ||  MAX_MSTIME < t )
     {
       RTCONS->quit = ME_PBTIM ;
       mexErrMsgIdAndTxt ( "MET:send:sigtime" , ERRHDR
         "signal %llu %s time " MST2STR " out of range " MST2STR " to "
         MST2STR , RTCONS->cd , (unsigned long long) i ,
-        MSIGNM[ CSI( i ) ] , s[ i ].time , MIN_MSTIME , MAX_MSTIME ) ;
+        MSIGNM[ id ] , t , MIN_MSTIME , MAX_MSTIME ) ;
     }
     
-  } /* load buf */
+  } /* check signals */
   
   
-  /*-- Perform blocking write --*/
+  /*-- MET signal buffer --*/
   
-  if  ( nrhs  ==  NRHS_MAX  &&  mxGetScalar ( prhs[ PRHS_BLK ] ) )
-    
-    metxsetfl ( RTCONS , 1 ,
-                RTCONS->p + REQSTW , RTCONS->pf + REQSTW , 'b' ,
-                "error switching to blocking write on request pipe" ) ;
+  /* Holds one chunk , up to the atomic write limit */
+  struct metsignal  s[ RTCONS->awmsig ] ;
   
   
-  /*-- Write MET signals to request pipe --*/
+  /*-- Write MET signals to request pipe , one chunk at a time --*/
   
-  /* Initialise number of bytes sent */
+  /* Initialise number of signals sent */
   n = 0 ;
   
-  /* Convert from number of signals to number of bytes requested */
-  q = q  *  sizeof ( struct metsignal ) ;
-  
-  /* Point to head of buffer */
-  p = (char *)  s ;
-  
-  /* Write loop */
-  while  ( q  &&  ( r = write ( RTCONS->p[ REQSTW ] , p , q ) ) )
+  /* Chunk loop */
+  while  ( n  <  q )
   {
     
-    /* Error checking */
-    if  ( r  ==  -1 )
+    /* Number of signals in this chunk */
+    c = q - n  <  RTCONS->awmsig  ?  q - n  :  RTCONS->awmsig  ;
+    
+    /* Load buffer */
+    for  ( i = 0 ; i  <  c ; ++i )
     {
-      /* Unix signal interruption , try again */
-      if  ( errno  ==  EINTR )  continue ;
+      /* Current controller's descriptor */
+      s[ i ].source = RTCONS->cd ;
       
-      /* Clogged pipe , only matters in non-blocking writes */
-      else if  ( ( errno == EAGAIN  ||  errno == EWOULDBLOCK )  &&
-                 !( RTCONS->pf[ REQSTW ]  &  O_NONBLOCK ) )
-      {
-        RTCONS->quit = ME_CLGRP ;
-        mexErrMsgIdAndTxt ( "MET:send:clogged" , ERRHDR
-          "clogged request pipe" , RTCONS->cd ) ;
-      }
+      /* MET signal identifier */
+      s[ i ].signal = ( metsignal_t )  sig[ n + i ] ;
       
-      /* Broken pipe */
-      else if  ( errno  ==  EPIPE )
-      {
-        RTCONS->quit = ME_BRKRP ;
-        mexErrMsgIdAndTxt ( "MET:send:broken" , ERRHDR
-          "broken request pipe" , RTCONS->cd ) ;
-      }
+      /* Cargo */
+      s[ i ].cargo = ( metcargo_t )  crg[ n + i ] ;
       
-      /* Other */
-      else
+      /* Time , return new measurement unless values provided in tim */
+      s[ i ].time  =  tf  ?  tm  :  ( mettime_t )  tim[ n + i ]  ;
+    
+    } /* load buf */
+    
+    /* Convert from number of signals to number of bytes in chunk */
+    b = c  *  sizeof ( struct metsignal ) ;
+    
+    /* Point to head of buffer */
+    p = (char *)  s ;
+    
+    /* Write loop. The request pipe always stays non-blocking. Writes up to
+      PIPE_BUF bytes are atomic , so a chunk is written whole or not at
+      all. */
+    while  ( b  &&  ( r = write ( RTCONS->p[ REQSTW ] , p , b ) ) )
+    {
+      
+      /* Error checking */
+      if  ( r  ==  -1 )
       {
-        RTCONS->quit = ME_SYSER ;
-        perror ( "met:metxsend:write" ) ;
-        mexErrMsgIdAndTxt ( "MET:send:write" , ERRHDR
-          "error while writing to request pipe" , RTCONS->cd ) ;
-      }
-    } /* error */
+        /* Unix signal interruption , try again */
+        if  ( errno  ==  EINTR )  continue ;
+      
+        /* Full pipe */
+        else if  ( errno == EAGAIN  ||  errno == EWOULDBLOCK )
+        {
+          /* Non-blocking write , or timeout while waiting for space. The
+            rest of the signals are not sent. */
+          if  ( !blk  ||
+                !metxpollfd ( RTCONS , RTCONS->p[ REQSTW ] , POLLOUT ,
+                              dlp ) )
+            goto  done ;
+      
+          /* Space available , try again */
+          continue ;
+        }
     
-    /* Update counters and pointer */
-    p += r ;
-    n += r ;
-    q -= r ;
+        /* Broken pipe */
+        else if  ( errno  ==  EPIPE )
+        {
+          RTCONS->quit = ME_BRKRP ;
+          mexErrMsgIdAndTxt ( "MET:send:broken" , ERRHDR
+            "broken request pipe" , RTCONS->cd ) ;
+        }
     
-  } /* write loop */
-  
-  
-  /*-- Restore non-blocking writes --*/
-  
-  if  ( !( RTCONS->pf[ REQSTW ]  &  O_NONBLOCK ) )
+        /* Other */
+        else
+        {
+          RTCONS->quit = ME_SYSER ;
+          perror ( "met:metxsend:write" ) ;
+          mexErrMsgIdAndTxt ( "MET:send:write" , ERRHDR
+            "error while writing to request pipe" , RTCONS->cd ) ;
+        }
+      } /* error */
+  
+      /* Update counter and pointer */
+      p += r ;
+      b -= r ;
+  
+    } /* write loop */
+  
+    /* Count signals in the chunk that was written */
+    n += c ;
     
-    metxsetfl ( RTCONS , 1 ,
-                RTCONS->p + REQSTW , RTCONS->pf + REQSTW , 'n' ,
-                "error switching to non-blocking write on request pipe" ) ;
+  } /* chunk loop */
   
+  /* Jump here when no more chunks can be written */
+  done:
   
-  /*-- Return number of MET signals requested --*/
   
-  /* Convert from bytes to signals */
-  n  /=  sizeof ( struct metsignal ) ;
+  /*-- Return number of MET signals requested --*/
   
   /* Convert to Matlab array */
   if  ( ( plhs[ 0 ] = mxCreateDoubleScalar ( (double)  n ) )  ==  NULL )
@@ -1,16 +1,27 @@
 
 /*  metxshmblk.c
   
-  signed char  metxshmblk ( const mxArray *  shm , char *  bm )
+  signed char  metxshmblk ( struct met_t *  RTCONS ,
+                            const mxArray *  shm , char *  bm ,
+                            double *  tout )
   
   Returns the array index of the POSIX shared memory named in shm. The
   blocking mode is returned in bm as either '+' to indicate blocking, and
   '-' to indicate non-blocking. On error, returns -1.
   
+  shm is either a string , or a 2-element cell array { name , tout } with
+  the string in the first element and a scalar double timeout of 0 or more
+  seconds in the second ; this is returned in tout. An empty timeout i.e.
+  [] , Inf , or a plain string , returns a tout of -1 to say that there is
+  no timeout.
+  
   Array index - POSIX shared memory name
             0 - 'stim'
             1 - 'eye'
             2 - 'nsp'
+  3 ... nshm-1 - Named channels declared in the .cmet file , in order
+  
+  Names are looked up in RTCONS->shmnam.
   
   Written by Jackson Smith - DPAG , University of Oxford
   
@@ -26,20 +37,24 @@
 
 #define  ERRHDR  MCSTR ":met:shm: "
 
-#define  BUFLEN  6
+/* Longest name , plus blocking mode prefix char */
+#define  BUFLEN  ( MSHM_NAMLEN + 1 )
+
+/* Number of elements in { name , tout } cell array form of shm */
+#define  CELNUM  2
+
+/* tout value when no timeout is given */
+#define  NOTOUT  -1
 
 
 /*--- metxshmblk function definition ---*/
 
-signed char  metxshmblk ( const mxArray *  shm , char *  bm )
+signed char  metxshmblk ( struct met_t *  RTCONS ,
+                          const mxArray *  shm , char *  bm ,
+                          double *  tout )
 {
   
   
-  /*-- Constants --*/
-  
-  char *  SHMNAM[ SHMARG ] = { SNAM_STIM , SNAM_EYE , SNAM_NSP } ;
-  
-  
   /*-- Variables --*/
   
   /* Input string buffer and pointer */
@@ -49,9 +64,42 @@ signed char  metxshmblk ( const mxArray *  shm , char *  bm )
   signed char  r ;
   
   
+  /*-- Timeout --*/
+  
+  /* Default , none */
+  *tout = NOTOUT ;
+  
+  /* Cell array form i.e. { name , tout } */
+  if  ( mxIsCell ( shm ) )
+  {
+    /* Timeout array */
+    const mxArray *  T ;
+    
+    /* Must have name and timeout */
+    if  ( mxGetNumberOfElements ( shm )  !=  CELNUM  ||
+          ( T = mxGetCell ( shm , 1 ) )  ==  NULL )
+      return  -1 ;
+    
+    /* Non-empty timeout must be scalar double of 0 or more. Inf is the
+       same as no timeout. */
+    if  ( !mxIsEmpty ( T ) )
+    {
+      if  ( !mxIsDouble ( T )  ||  mxGetNumberOfElements ( T ) != 1  ||
+            mxIsNaN ( mxGetScalar ( T ) )  ||  mxGetScalar ( T )  <  0 )
+        return  -1 ;
+      
+      if  ( !mxIsInf ( mxGetScalar ( T ) ) )  *tout = mxGetScalar ( T ) ;
+    }
+    
+    /* Name comes from the first element */
+    if  ( ( shm = mxGetCell ( shm , 0 ) )  ==  NULL )
+      return  -1 ;
+  }
+  
+  
   /*-- Get shared memory name --*/
   
-  if  ( mxGetString ( shm , buf , BUFLEN ) )
+  if  ( !mxIsChar ( shm )  ||  mxGetString ( shm , buf , BUFLEN ) )
     
     return  -1 ;
   
@@ -80,10 +128,10 @@ signed char  metxshmblk ( const mxArray *  shm , char *  bm )
   
   /*-- Find shared memory index and blocking mode --*/
   
-  for  ( r = 0 ; r  <  SHMARG ; ++r )
+  for  ( r = 0 ; r  <  RTCONS->nshm ; ++r )
     
     /* Check shared mem name */
-    if  ( !strcmp ( SHMNAM[ r ] , p ) )
+    if  ( !strcmp ( RTCONS->shmnam[ r ] , p ) )
       
       /* Name found! Return index and blocking mode */
       return  r ;
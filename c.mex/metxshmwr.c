@@ -0,0 +1,154 @@
+
+/*  metxshmwr.c
+
+  W = met ( 'shmwr' , shm )
+
+  Returns what another MEX function needs to act as the writer of the
+  POSIX shared memory named by shm , on behalf of the calling controller.
+  This allows a utility such as ivxudp to write straight into shared
+  memory from C , without passing through Matlab. The utility runs in the
+  same process , so the event fd's in W remain valid for it. The calling
+  controller must have write access to shm. W is a struct with fields:
+
+    W.name - string - The name of the shared memory e.g. 'eye'.
+    W.file - string - The POSIX shared memory file name e.g. '/eye.met'.
+    W.nr - scalar double - The number of readers.
+    W.wefdv - double row vector - The writer's event fd for each reader.
+      Element i is posted when bit i - 1 of the synchronisation block's
+      rsel mask is set. Unused elements hold FDINIT.
+
+  The writer must follow the same protocol as met ( 'write' ). That is ,
+  write only when the synchronisation block's gen is zero or its ack equals
+  W.nr ; place the SMST_NUM size_t header and data past MSHM_SYNC bytes ;
+  reset ack , increment gen , wake gen's futex , then post to the event
+  fd's of readers in rsel. met ( 'write' ) must not be used on shm while
+  another writer acts for the controller.
+
+  The shm string may carry a blocking mode prefix , as with 'write' , but
+  this is ignored.
+
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+#include  "metx.h"
+
+
+/*--- Define block ---*/
+
+#define  ERRHDR  MCSTR ":met:shmwr: "
+
+#define  NLHS_MAX  1
+#define  NRHS      1
+
+#define  PRHS_SHM  0
+
+/* Fields of W */
+#define  NFIELD  4
+#define  FNAME   0
+#define  FFILE   1
+#define  FNR     2
+#define  FWEFDV  3
+
+
+/*--- Global constants ---*/
+
+const char *  WFIELD[ NFIELD ] = { "name" , "file" , "nr" , "wefdv" } ;
+
+
+/*--- metxshmwr function definition ---*/
+
+void  metxshmwr ( struct met_t *  RTCONS ,
+                  int  nlhs ,       mxArray *  plhs[] ,
+                  int  nrhs , const mxArray *  prhs[] )
+{
+
+
+  /*-- Check input arguments --*/
+
+  /* Number of outputs */
+  if  ( nlhs  >  NLHS_MAX )
+  {
+    RTCONS->quit = ME_INTRN ;
+    mexErrMsgIdAndTxt ( "MET:shmwr:nlhs" , ERRHDR
+      "max %d output args , %d requested" ,
+      RTCONS->cd , NLHS_MAX , nlhs ) ;
+  }
+
+  /* Number of inputs */
+  if  ( nrhs  !=  NRHS )
+  {
+    RTCONS->quit = ME_INTRN ;
+    mexErrMsgIdAndTxt ( "MET:shmwr:nrhs" , ERRHDR
+      "takes %d input arg , %d given" , RTCONS->cd , NRHS , nrhs ) ;
+  }
+
+
+  /*-- Variables --*/
+
+  /* Shared memory index , ignored blocking mode and timeout */
+  signed char  si ;
+  char  bm ;
+  double  tout ;
+
+  /* Shared memory file name */
+  char  fnm[ MSHM_FNMLEN ] ;
+
+  /* Event fd vector , and counter */
+  double *  v ;
+  unsigned char  i ;
+
+
+  /*-- Get POSIX shared memory index --*/
+
+  if  ( ( si = metxshmblk ( RTCONS , prhs[ PRHS_SHM ] , &bm ,
+                                &tout ) )  ==  -1 )
+  {
+    RTCONS->quit = ME_INTRN ;
+    mexErrMsgIdAndTxt ( "MET:shmwr:shm" , ERRHDR
+      "arg shm unrecognised" , RTCONS->cd ) ;
+  }
+
+  /* No write access on this shared memory */
+  if  (  RTCONS->shmflg[ si ]  !=  MSMG_WRITE  &&
+         RTCONS->shmflg[ si ]  !=  MSMG_BOTH   )
+  {
+    RTCONS->quit = ME_INTRN ;
+    mexErrMsgIdAndTxt ( "MET:shmwr:shm" , ERRHDR
+      "no write access to shared mem %d" , RTCONS->cd , si + 1 ) ;
+  }
+
+
+  /*-- Make W --*/
+
+  if  ( ( plhs[ 0 ] = mxCreateStructMatrix ( 1 , 1 , NFIELD , WFIELD ) )
+        ==  NULL )
+  {
+    RTCONS->quit = ME_MATLB ;
+    mexErrMsgIdAndTxt ( "MET:shmwr:plhs" , ERRHDR
+      "not enough heap memory to make output arg W" , RTCONS->cd ) ;
+  }
+
+  snprintf ( fnm , MSHM_FNMLEN , MSHM_FNFMT , RTCONS->shmnam[ si ] ) ;
+
+  mxSetFieldByNumber ( plhs[ 0 ] , 0 , FNAME ,
+    mxCreateString ( RTCONS->shmnam[ si ] ) ) ;
+  mxSetFieldByNumber ( plhs[ 0 ] , 0 , FFILE , mxCreateString ( fnm ) ) ;
+  mxSetFieldByNumber ( plhs[ 0 ] , 0 , FNR ,
+    mxCreateDoubleScalar ( RTCONS->shmnr[ si ] ) ) ;
+
+  /* Event fd's */
+  mxSetFieldByNumber ( plhs[ 0 ] , 0 , FWEFDV ,
+    mxCreateDoubleMatrix ( 1 , RTCONS->wefdn[ si ] , mxREAL ) ) ;
+
+  v = mxGetPr ( mxGetFieldByNumber ( plhs[ 0 ] , 0 , FWEFDV ) ) ;
+
+  for  ( i = 0 ; i  <  RTCONS->wefdn[ si ] ; ++i )
+    v[ i ] = RTCONS->wefdv[ si ][ i ] ;
+
+
+}  /* metxshmwr */
+
@@ -2,6 +2,7 @@
 /*  metxwrite.c
   
   i = met ( 'write' , shm , ... )
+  i = met ( 'write' , { shm , tout } , ... )
   
   Writes a set of Matlab arrays to the POSIX shared memory named by shm.
   All arguments provided after shm are written as a separate array. Returns
@@ -15,10 +16,20 @@
   written ; this is the default action when no character is prefixed.
   
   Data can be written only when all N readers of the named shared memory
-  have posted 1 to the corresponding readers' event fd i.e. when all
-  readers have read the current contents of the named shared memory. A
-  blocking write fails as an error if the calling controller is also a
-  reader of the shared memory.
+  have acknowledged the current generation in the shared memory's
+  synchronisation block i.e. when all readers have read the current
+  contents of the named shared memory. A blocking write fails as an error
+  if the calling controller is also a reader of the shared memory.
+  
+  A write increments the generation counter and wakes all blocked readers
+  with one futex wake , regardless of the number of readers. Event fd's are
+  only posted for readers that are waiting in met ( 'select' ).
+  
+  A blocking write waits on a futex for the readers' acknowledgements, and
+  can be given a timeout by passing shm as the first element of a cell
+  array with tout in the second. Then, a blocking write waits at most tout
+  seconds for the readers and returns 0 if they are not all ready in that
+  time. An empty tout i.e. [] , or Inf , waits indefinitely.
   
   Only struct, cell, char, logical, and numeric arrays may be written. Take
   heed , nested arrays in a struct or cell must be one of these types. Full
@@ -42,6 +53,8 @@
 
 #include  "metx.h"
 
+#include  <limits.h>
+
 
 /*--- Define block ---*/
 
@@ -75,9 +88,6 @@
 
 /*--- Global constants ---*/
 
-/* Size, in bytes, of each type of POSIX shared memory */
-const size_t  SHMSIZ[ SHMARG ] = { MSMS_STIM , MSMS_EYE , MSMS_NSP } ;
-
 /* Forbidden mxClassID values , if any such mxArray is passed as an
   argument then an error is thrown */
 const mxClassID  FORBIDDEN[ NFORBID ] =
@@ -413,8 +423,8 @@ void  metxwrite ( struct met_t *  RTCONS ,
       "min %d input args , %d given" , RTCONS->cd , NRHS_MIN , nrhs ) ;
   }
   
-  /* Arg shm must be string */
-  if  (  CHK_IS_STR( PRHS_SHM )  )
+  /* Arg shm must be string , or { string , tout } cell array */
+  if  (  !mxIsCell ( prhs[ PRHS_SHM ] )  &&  ( CHK_IS_STR( PRHS_SHM ) )  )
   {
     RTCONS->quit = ME_INTRN ;
     mexErrMsgIdAndTxt ( "MET:write:shm" , ERRHDR
@@ -427,11 +437,18 @@ void  metxwrite ( struct met_t *  RTCONS ,
   /* Shared memory blocking mode */
   char  bm ;
   
+  /* Timeout in seconds , and deadline pointer that stays NULL when the
+    wait is indefinite */
+  double  tout ;
+  struct timespec  dl , * dlp = NULL ;
+  
   /* Double pointer of return array's data */
   double *  dpret ;
   
-  /* Event fd read buffer */
-  uint64_t  efdval ;
+  /* Shared memory synchronisation block , acknowledgement count , and
+    mask of readers waiting in select() */
+  struct metshmsync *  sync ;
+  uint32_t  ack , rsel ;
   
   /* Byte-resolution pointer for mapped POSIX shared memory */
   char *  shm ;
@@ -452,7 +469,8 @@ void  metxwrite ( struct met_t *  RTCONS ,
   
   /*-- Get POSIX shared memory index and blocking mode --*/
   
-  if  ( ( si = metxshmblk ( prhs[ PRHS_SHM ] , &bm ) )  ==  -1 )
+  if  ( ( si = metxshmblk ( RTCONS , prhs[ PRHS_SHM ] , &bm ,
+                                &tout ) )  ==  -1 )
   {
     RTCONS->quit = ME_INTRN ;
     mexErrMsgIdAndTxt ( "MET:write:shm" , ERRHDR
@@ -491,52 +509,56 @@ void  metxwrite ( struct met_t *  RTCONS ,
   }
   
   
-  /*-- Perform blocking write , so change event fd blocking mode --*/
+  /*-- Blocking write with timeout --*/
   
-  if  ( bm  ==  SCHBLOCK )
-    
-    /* Set readers' efd to blocking , so writer can wait for readers */
-    metxsetfl ( RTCONS , 1 ,
-                RTCONS->refd + si , RTCONS->rflg + si , 'b' ,
-              "shm write error switch to blocking on readers' event fd" ) ;
+  if  ( bm  ==  SCHBLOCK  &&  0  <=  tout )
+  {
+    metxdeadline ( RTCONS , tout , &dl ) ;
+    dlp = &dl ;
+  }
   
   
   /*-- Check that all readers have read current shm contents --*/
   
-  /* Reading loop. Necessary for blocking reads & UNIX sig interruption. */
-  while  (  RTCONS->rcount[ si ]  <  RTCONS->shmnr[ si ]  &&
-           ( efdval = metxefdread ( RTCONS , RTCONS->refd[ si ] ) )  )
+  /* Point to the synchronisation block */
+  sync = SHMSYNC( RTCONS , si ) ;
     
-    /* Count more readers. */
-    RTCONS->rcount[ si ]  +=  efdval ;
+  /* Nothing has been written while gen is zero. Otherwise , wait for all
+    readers to acknowledge the current generation. A blocking write waits
+    on the acknowledgement counter's futex , but not past the deadline.
+    Loop is also necessary for spurious wakeups & UNIX sig interruption. */
+  while  (  ( ack = __atomic_load_n ( &sync->ack , __ATOMIC_ACQUIRE ) )  <
+              RTCONS->shmnr[ si ]  &&  sync->gen  &&
+            bm  ==  SCHBLOCK  &&
+            metxfwait ( RTCONS , &sync->ack , ack , dlp )  )  ;
   
   /* Not enough readers reported ready, yet. Return 0 */
-  if  ( RTCONS->rcount[ si ]  <  RTCONS->shmnr[ si ] )  return ;
+  if  ( ack  <  RTCONS->shmnr[ si ]  &&  sync->gen )  return ;
   
   /* Error check reader count */
-  else if  ( RTCONS->shmnr[ si ]  <  RTCONS->rcount[ si ] )
+  else if  ( RTCONS->shmnr[ si ]  <  ack )
   {
     RTCONS->quit = ME_INTRN ;
-    mexErrMsgIdAndTxt ( "MET:write:readrefd" , ERRHDR
-      "%d readers for shm %d but %llu report ready" ,
-      RTCONS->cd , RTCONS->shmnr[ si ] , si ,
-      (unsigned long long) RTCONS->rcount[ si ] ) ;
+    mexErrMsgIdAndTxt ( "MET:write:ack" , ERRHDR
+      "%d readers for shm %d but %lu report ready" ,
+      RTCONS->cd , RTCONS->shmnr[ si ] , si , (unsigned long) ack ) ;
   }
   
   
   /*-- Write to POSIX shared memory --*/
   
-  /* Point to the first size_t value of the header */
-  hdr = RTCONS->shmmap[ si ] ;
+  /* Point to the first size_t value of the header , past the
+    synchronisation block */
+  hdr = ( size_t * )  SHMDATA( RTCONS , si ) ;
   
   /* Initialise header , zero number of bytes , number of Matlab arrays */
   hdr[ SMST_NMXAR ] = nrhs - NRHS_PAR ;
   
   /* Set byte pointer shm to first byte past the size_t header */
-  shm = ( char * )  RTCONS->shmmap[ si ]  +  SMST_NUM * sizeof ( ret ) ;
+  shm = SHMDATA( RTCONS , si )  +  SMST_NUM * sizeof ( ret ) ;
   
   /* Bytes remaining in shared memory */
-  s = SHMSIZ[ si ]  -  SMST_NUM * sizeof ( ret ) ;
+  s = RTCONS->shmsiz[ si ]  -  MSHM_SYNC  -  SMST_NUM * sizeof ( ret ) ;
   
   /* Write each input argument past 'shm' to shared memory */
   for  ( i = PRHS_ARG1 ; i  <  nrhs ; ++i )
@@ -550,32 +572,34 @@ void  metxwrite ( struct met_t *  RTCONS ,
     
   } /* write shm */
   
-  /* Number of bytes written to shared mem */
-  hdr[ SMST_BYTES ] = SHMSIZ[ si ]  -  s ;
+  /* Number of bytes written to shared mem , counting from the header */
+  hdr[ SMST_BYTES ] = RTCONS->shmsiz[ si ]  -  MSHM_SYNC  -  s ;
   
   
-  /*-- Post to all writer's efd --*/
+  /*-- Publish new generation --*/
   
-  if  (  metxefdpost ( RTCONS , RTCONS->wefdn[ si ] ,
-                       RTCONS->wefdv[ si ] , WEFD_POST )  )
+  /* Reset acknowledgements before the readers can see the new generation.
+    The increment then orders all writes to shm before the new value of
+    gen , and a single futex wake reaches every blocked reader. */
+  __atomic_store_n ( &sync->ack , 0 , __ATOMIC_RELAXED ) ;
     
-    mexErrMsgIdAndTxt ( "MET:write:post" , ERRHDR
-      "failed to post to writer's event fd" , RTCONS->cd ) ;
-  
-  
-  /*-- Reset reader counter for next call to metxwrite --*/
-  
-  RTCONS->rcount[ si ] = 0 ;
+  /* gen is never allowed to return to zero , which means 'never written' */
+  if  ( !__atomic_add_fetch ( &sync->gen , 1 , __ATOMIC_SEQ_CST ) )
+    __atomic_add_fetch ( &sync->gen , 1 , __ATOMIC_SEQ_CST ) ;
   
+  metxfwake ( RTCONS , &sync->gen , INT_MAX ) ;
   
-  /*-- Restore non-blocking writes --*/
+  /* Post only to the event fd's of readers that wait in met ( 'select' ) */
+  if  ( ( rsel = __atomic_load_n ( &sync->rsel , __ATOMIC_SEQ_CST ) ) )
   
-  if  ( !( RTCONS->rflg[ si ]  &  O_NONBLOCK ) )
-  
-    /* Set readers' efd to non-blocking */
-    metxsetfl ( RTCONS , 1 ,
-                RTCONS->refd + si , RTCONS->rflg + si , 'n' ,
-          "shm write error switch to non-blocking on readers' event fd" ) ;
+    for  ( i = 0 ; i  <  RTCONS->wefdn[ si ] ; ++i )
+      
+      if  (  ( rsel  &  ( 1U << i ) )  &&
+             metxefdpost ( RTCONS , 1 , RTCONS->wefdv[ si ] + i ,
+                           WEFD_POST )  )
+        
+        mexErrMsgIdAndTxt ( "MET:write:post" , ERRHDR
+          "failed to post to writer's event fd" , RTCONS->cd ) ;
   
   
   /*-- Return success value --*/
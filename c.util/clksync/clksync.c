@@ -0,0 +1,519 @@
+/*  clksync.c
+  
+  [ ... ] = clksync ( fun , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. Keeps a running ,
+  robust linear regression of local PTB time stamps on NSP sample
+  numbers , for metcbmex. The regression is fitted to the most recent
+  calibration points , over as many trials as it takes to fill a window of
+  fixed length , so that both the offset and the drift of the two clocks
+  are followed as the session goes on. The coefficients are returned in a
+  two-element row vector c = [ intercept , slope ] so that the local time
+  of NSP sample number nsp is c( 1 ) + c( 2 ) * nsp.
+  
+  Each new calibration point is first compared with the current fit. Once
+  the fit has MINFIT points , any new point whose residual is more than
+  REJECT times its standard error is rejected as an outlier , and is not
+  added to the window. The standard error grows with the distance from the
+  mean NSP sample number of the fit , according to the uncertainty of the
+  slope , because calibration points come in short bursts. But if every
+  point in a batch of at least MINFIT points is rejected then the clocks
+  are assumed to have been reset , for instance after the NSP restarted ,
+  and the fit starts again from that batch.
+  
+  After new points are added , the fit is found by iteratively reweighted
+  least squares with Tukey's bisquare weights , as with Matlab's
+  robustfit. The scale of the residuals is their median absolute
+  deviation divided by 0.6745 , but never less than MINSCL seconds.
+  
+  Sub-functions:
+    
+    clksync ( 'o' , n ) -- Allocates a window for the n most recent
+      calibration points , a scalar double of at least MINFIT , and
+      forgets any previous fit.
+    
+    clksync ( 'r' ) -- Forgets all calibration points.
+    
+    [ c , nrej ] = clksync ( 'a' , nsp , ptb ) -- Adds calibration points
+      and refits. nsp and ptb are double vectors of equal length with the
+      NSP sample number and local PTB time stamp of each point. Returns
+      the new coefficients in c , and the number of new points that were
+      rejected in nrej , a scalar double. c is [ 0 , 0 ] until there are at
+      least two points with different NSP sample numbers.
+    
+    c = clksync ( 'c' ) -- Returns the current coefficients.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* General */
+#include  <math.h>
+#include  <stdlib.h>
+#include  <string.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Allocate window */
+  #define  FUN_OPEN   'o'
+  
+  /* Forget points */
+  #define  FUN_RESET  'r'
+  
+  /* Add points */
+  #define  FUN_ADD    'a'
+  
+  /* Get coefficients */
+  #define  FUN_COEF   'c'
+
+
+/* Number of input and output args , including fun */
+  
+  #define  NRHS_OPEN   2
+  #define  NRHS_RESET  1
+  #define  NRHS_ADD    3
+  #define  NRHS_COEF   1
+  #define  NLHS_ADD    2
+  #define  NLHS_COEF   1
+
+
+/* Minimum number of points before outliers are rejected */
+#define  MINFIT  3
+
+/* Outlier threshold , in units of the residual scale */
+#define  REJECT  6.0
+
+/* Minimum residual scale , in seconds */
+#define  MINSCL  1e-4
+
+/* Bisquare tuning constant , and normal consistency constant of the
+   median absolute deviation */
+#define  TUNE    4.685
+#define  MADNRM  0.6745
+
+/* Maximum number of reweighting iterations , and convergence tolerance in
+   seconds */
+#define  MAXITR  50
+#define  TOLITR  1e-9
+
+
+/*--- Global static variables ---*/
+
+/* Window of calibration points as a ring buffer , relative to the
+   reference point nsp0 , ptb0. NULL until 'o'. Then the bisquare weights
+   and a scratch buffer. */
+static double  * x = NULL , * y = NULL , * w = NULL , * sb = NULL ;
+
+/* Window length , number of points , and index of the oldest one */
+static size_t  nwin = 0 , npts = 0 , old = 0 ;
+
+/* Reference point , the first one added since the fit was forgotten */
+static double  nsp0 = 0 , ptb0 = 0 ;
+
+/* Coefficients relative to the reference point , the residual scale , and
+   the weighted mean and sum of squared deviations of NSP sample numbers.
+   fit is non-zero when they are valid. */
+static double  a = 0 , b = 0 , scl = 0 , xm = 0 , xss = 0 ;
+static int  fit = 0 ;
+
+
+/*--- Function definitions ---*/
+
+void  clkfree ( void ) ;
+void  clkopen ( const mxArray * ) ;
+void  clkreset ( void ) ;
+void  clkadd  ( int , mxArray ** , const mxArray ** ) ;
+void  clkfit  ( void ) ;
+void  clkpush ( double , double ) ;
+ int  outlier ( double , double ) ;
+mxArray *  clkcoef ( void ) ;
+double  median ( double * , size_t ) ;
+ int  dblcmp ( const void * , const void * ) ;
+ int  notscalar ( const mxArray * ) ;
+
+
+/*** clksync function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  /* Required number of inputs , and maximum number of outputs */
+  int  nin , nout = 0 ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:clksync:fun"  ,
+      "clksync arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:clksync:fun"  ,
+      "clksync arg fun must be a single char"  ) ;
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   nin = NRHS_OPEN  ;  break ;
+    case  FUN_RESET:  nin = NRHS_RESET ;  break ;
+    case  FUN_ADD:    nin = NRHS_ADD   ;  nout = NLHS_ADD  ;  break ;
+    case  FUN_COEF:   nin = NRHS_COEF  ;  nout = NLHS_COEF ;  break ;
+    
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:clksync:fun"  ,
+        "clksync arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  }
+  
+  if  ( nrhs  !=  nin )
+    
+    mexErrMsgIdAndTxt (  "MET:clksync:fun"  ,
+      "clksync '%c' requires %d input arguments in total"  ,  c[ 0 ]  ,
+        nin  ) ;
+  
+  else if  ( nout  <  nlhs )
+    
+    mexErrMsgIdAndTxt (  "MET:clksync:fun"  ,
+      "clksync '%c' provides at most %d output arguments"  ,  c[ 0 ]  ,
+        nout  ) ;
+  
+  else if  ( x == NULL  &&  c[ 0 ] != FUN_OPEN )
+    
+    mexErrMsgIdAndTxt (  "MET:clksync:fun"  ,
+      "clksync must be opened with 'o' before '%c'"  ,  c[ 0 ]  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   clkopen  ( prhs[ 1 ] ) ;  break ;
+    case  FUN_RESET:  clkreset ( ) ;  break ;
+    case  FUN_ADD:    clkadd   ( nlhs , plhs , prhs + 1 ) ;  break ;
+    case  FUN_COEF:   plhs[ 0 ] = clkcoef ( ) ;  break ;
+  }
+
+
+} /* clksync */
+
+
+/*---Subroutines---*/
+
+/* Returns non-zero if m is not a real , finite , scalar double */
+int  notscalar ( const mxArray *  m )
+{
+  
+  return  !mxIsDouble ( m )  ||  !mxIsScalar ( m )  ||  mxIsComplex ( m )
+    ||  mxIsNaN ( mxGetScalar ( m ) )  ||  mxIsInf ( mxGetScalar ( m ) ) ;
+
+} /* notscalar */
+
+
+/* Ascending order of doubles , for qsort */
+int  dblcmp ( const void *  p , const void *  q )
+{
+  
+  const double  u = *( const double * ) p , v = *( const double * ) q ;
+  
+  return  ( u > v )  -  ( u < v ) ;
+
+} /* dblcmp */
+
+
+/* Returns the median of the n values in v , which are reordered */
+double  median ( double *  v , size_t  n )
+{
+  
+  qsort ( v , n , sizeof ( *v ) , dblcmp ) ;
+  
+  return  n % 2  ?  v[ n / 2 ]  :  ( v[ n / 2 - 1 ] + v[ n / 2 ] ) / 2 ;
+
+} /* median */
+
+
+/* Release the window */
+void  clkfree ( void )
+{
+  
+  if  ( x  != NULL )  mxFree ( x  ) ;
+  if  ( y  != NULL )  mxFree ( y  ) ;
+  if  ( w  != NULL )  mxFree ( w  ) ;
+  if  ( sb != NULL )  mxFree ( sb ) ;
+  
+  x = y = w = sb = NULL ;
+  nwin = 0 ;
+
+} /* clkfree */
+
+
+/* Returns persistent memory for n doubles */
+static double *  pmalloc ( size_t  n )
+{
+  
+  double *  p = mxCalloc ( n , sizeof ( double ) ) ;
+  mexMakeMemoryPersistent ( p ) ;
+  
+  return  p ;
+
+} /* pmalloc */
+
+
+/* Allocate a window of length m */
+void  clkopen ( const mxArray *  m )
+{
+  
+  if  ( notscalar ( m )  ||  mxGetScalar ( m ) < MINFIT )
+    mexErrMsgIdAndTxt (  "MET:clksync:open"  ,
+      "clksync 'o' , n must be a finite scalar double of at least %d"  ,
+        MINFIT  ) ;
+  
+  clkfree ( ) ;
+  mexAtExit ( clkfree ) ;
+  
+  nwin = ( size_t ) mxGetScalar ( m ) ;
+  
+  x  = pmalloc ( nwin ) ;
+  y  = pmalloc ( nwin ) ;
+  w  = pmalloc ( nwin ) ;
+  sb = pmalloc ( nwin ) ;
+  
+  clkreset ( ) ;
+
+} /* clkopen */
+
+
+/* Forget all points */
+void  clkreset ( void )
+{
+  
+  npts = old = 0 ;
+  nsp0 = ptb0 = a = b = scl = xm = xss = 0 ;
+  fit = 0 ;
+
+} /* clkreset */
+
+
+/* Add a point relative to the reference , dropping the oldest if the
+   window is full */
+void  clkpush ( double  u , double  v )
+{
+  
+  size_t  i ;
+  
+  if  ( npts  <  nwin )
+    i = ( old + npts++ ) % nwin ;
+  else
+    i = old ,  old = ( old + 1 ) % nwin ;
+  
+  x[ i ] = u ;
+  y[ i ] = v ;
+
+} /* clkpush */
+
+
+/* Returns non-zero if NSP sample number u and PTB time stamp v make an
+   outlier of the current fit */
+int  outlier ( double  u , double  v )
+{
+  
+  /* Residual , and squared standard error */
+  double  r , e ;
+  
+  if  ( !fit  ||  npts < MINFIT )  return  0 ;
+  
+  u -= nsp0 ;
+  r  = v  -  ptb0  -  a  -  b * u ;
+  e  = scl * scl  *  ( 1  +  ( u - xm ) * ( u - xm ) / xss ) ;
+  
+  return  REJECT * REJECT * e  <  r * r ;
+
+} /* outlier */
+
+
+/* Robust refit of all points in the window */
+void  clkfit  ( void )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Counters */
+  size_t  i , k ;
+  
+  /* Weighted sums , means , and the new coefficients */
+  double  sw , mx , my , sxx , sxy , na , nb , r ;
+  
+  
+  /*-- Reweighting iterations --*/
+  
+  for  ( i = 0  ;  i < npts  ;  i++ )  w[ i ] = 1 ;
+  
+  for  ( k = 0  ;  k < MAXITR  ;  k++ )
+  {
+    
+    /* Weighted least squares */
+    sw = mx = my = 0 ;
+    for  ( i = 0  ;  i < npts  ;  i++ )
+    {
+      sw += w[ i ] ;
+      mx += w[ i ] * x[ i ] ;
+      my += w[ i ] * y[ i ] ;
+    }
+    
+    if  ( sw  <=  0 )  break ;
+    mx /= sw ;
+    my /= sw ;
+    
+    sxx = sxy = 0 ;
+    for  ( i = 0  ;  i < npts  ;  i++ )
+    {
+      sxx += w[ i ] * ( x[ i ] - mx ) * ( x[ i ] - mx ) ;
+      sxy += w[ i ] * ( x[ i ] - mx ) * ( y[ i ] - my ) ;
+    }
+    
+    /* No spread of NSP sample numbers , keep the last fit */
+    if  ( sxx  <=  0 )  break ;
+    
+    nb = sxy / sxx ;
+    na = my  -  nb * mx ;
+    
+    /* Residual scale */
+    for  ( i = 0  ;  i < npts  ;  i++ )
+      sb[ i ] = fabs ( y[ i ] - na - nb * x[ i ] ) ;
+    
+    scl = median ( sb , npts ) / MADNRM ;
+    if  ( scl  <  MINSCL )  scl = MINSCL ;
+    
+    /* Converged once the fit stops moving , at the reference point and at
+       the weighted mean NSP sample number */
+    r = fit  ?  fabs ( na - a )  +  fabs ( ( nb - b ) * mx )  :  INFINITY ;
+    
+    a = na ;
+    b = nb ;
+    xm  = mx ;
+    xss = sxx ;
+    fit = 1 ;
+    
+    if  ( r  <  TOLITR )  break ;
+    
+    /* Bisquare weights */
+    for  ( i = 0  ;  i < npts  ;  i++ )
+    {
+      r = ( y[ i ] - a - b * x[ i ] )  /  ( TUNE * scl ) ;
+      w[ i ] = fabs ( r ) < 1  ?  ( 1 - r * r ) * ( 1 - r * r )  :  0 ;
+    }
+  
+  } /* iterations */
+
+} /* clkfit */
+
+
+/* Returns coefficients in a new 1 x 2 double */
+mxArray *  clkcoef ( void )
+{
+  
+  mxArray *  m = mxCreateDoubleMatrix ( 1 , 2 , mxREAL ) ;
+  double *  p = mxGetPr ( m ) ;
+  
+  if  ( fit )
+  {
+    p[ 0 ] = ptb0  +  a  -  b * nsp0 ;
+    p[ 1 ] = b ;
+  }
+  
+  return  m ;
+
+} /* clkcoef */
+
+
+/* Add points m[ 0 ] and m[ 1 ] , then refit */
+void  clkadd ( int  nlhs , mxArray *  plhs[] , const mxArray *  m[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Counter , number of new points , and number rejected */
+  size_t  i , n , nrej = 0 ;
+  
+  /* NSP sample numbers and PTB time stamps */
+  const double  * nsp , * ptb ;
+  
+  
+  /*-- Check input --*/
+  
+  n = mxGetNumberOfElements ( m[ 0 ] ) ;
+  
+  for  ( i = 0  ;  i < 2  ;  i++ )
+    if  ( !mxIsDouble ( m[ i ] )  ||  mxIsComplex ( m[ i ] )  ||
+          mxGetNumberOfElements ( m[ i ] ) != n )
+      mexErrMsgIdAndTxt (  "MET:clksync:add"  ,
+        "clksync 'a' , nsp and ptb must be real double vectors of equal "
+        "length"  ) ;
+  
+  nsp = mxGetPr ( m[ 0 ] ) ;
+  ptb = mxGetPr ( m[ 1 ] ) ;
+  
+  for  ( i = 0  ;  i < n  ;  i++ )
+    if  ( !isfinite ( nsp[ i ] )  ||  !isfinite ( ptb[ i ] ) )
+      mexErrMsgIdAndTxt (  "MET:clksync:add"  ,
+        "clksync 'a' , nsp and ptb must be finite"  ) ;
+  
+  
+  /*-- Outlier rejection --*/
+  
+  for  ( i = 0  ;  i < n  ;  i++ )  nrej += outlier ( nsp[ i ] , ptb[ i ] ) ;
+  
+  /* Every point of a big enough batch rejected , clocks were reset */
+  if  ( nrej  &&  nrej == n  &&  MINFIT <= n )
+  {
+    clkreset ( ) ;
+    nrej = 0 ;
+  }
+  
+  
+  /*-- Add points --*/
+  
+  for  ( i = 0  ;  i < n  ;  i++ )
+  {
+    if  ( !npts )
+    {
+      nsp0 = nsp[ i ] ;
+      ptb0 = ptb[ i ] ;
+    }
+    
+    if  ( !outlier ( nsp[ i ] , ptb[ i ] ) )
+      clkpush ( nsp[ i ] - nsp0 , ptb[ i ] - ptb0 ) ;
+  }
+  
+  if  ( 2  <=  npts )  clkfit ( ) ;
+  
+  
+  /*-- Output --*/
+  
+  plhs[ 0 ] = clkcoef ( ) ;
+  
+  if  ( 1  <  nlhs )  plhs[ 1 ] = mxCreateDoubleScalar ( ( double ) nrej ) ;
+
+} /* clkadd */
+
@@ -0,0 +1,425 @@
+/*  eyefilt.c
+  
+  [ ... ] = eyefilt ( fun , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. A streaming filter
+  that says which eye samples are valid for targeting , following
+  Rayner et al. 2007. Vision Research, 47(21), 2714–2726. A sample is valid
+  if both eyes are on screen in it and in the two samples before it , and
+  if neither eye's velocity nor acceleration exceeds a threshold. Blinks
+  are not timed here ; seltarg does that with the samples that eyefilt
+  finds invalid. The filter keeps the last two samples between calls , so
+  that each new block of samples is treated as a continuation of the
+  last. Each block is done in one pass that is free of branches , so that
+  the compiler can vectorise it.
+  
+  Eye samples come as N x 5 double arrays of [ time , x-left , y-left ,
+  x-right , y-right ] , as read from 'eye' shared memory. Positions are in
+  degrees of visual field from the centre of the screen , and time is
+  local time in seconds.
+  
+  Sub-functions:
+    
+    eyefilt ( 'o' , lim , hz , vel , acc ) -- Sets the filter's
+      parameters and forgets all past samples. lim is a four-element
+      double [ minhor , maxhor , minver , maxver ] giving the edges of the
+      screen in degrees ; a position on or beyond an edge is off screen.
+      hz is the eye sampling rate in Hertz , used to differentiate
+      positions. vel is the velocity threshold in degrees per second , and
+      acc the acceleration threshold in degrees per second-squared. All
+      scalar doubles.
+    
+    [ v , p ] = eyefilt ( 'f' , eyepos ) -- Filters the new block of eye
+      samples in eyepos , which may be empty. Returns:
+      
+      v - N x 1 logical - True for each valid sample.
+      
+      p - N x 5 double - eyepos , with NaN positions in invalid samples.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* General */
+#include  <math.h>
+#include  <string.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Set parameters and reset */
+  #define  FUN_OPEN  'o'
+  
+  /* Filter a block of eye samples */
+  #define  FUN_FILT  'f'
+
+
+/* Number of input and output args */
+  
+  /* Open function number of right-hand side input arguments */
+  #define  NRHS_OPEN  5
+  
+  /* Filter function number of right-hand side input arguments , and
+     maximum number of outputs */
+  #define  NRHS_FILT  2
+  #define  NLHS_FILT  2
+
+
+/* Eye samples */
+  
+  /* Number of columns , and column index of time followed by left x ,
+     left y , right x , right y */
+  #define  EYECOL  5
+  #define  COL_T   0
+  #define  COL_XL  1
+  #define  COL_YL  2
+  #define  COL_XR  3
+  #define  COL_YR  4
+  
+  /* Number of past samples needed to find the acceleration of a new one */
+  #define  NHIST  2
+  
+  /* Number of screen edges , and index of each in lim */
+  #define  NUMLIM   4
+  #define  LIM_MNH  0
+  #define  LIM_MXH  1
+  #define  LIM_MNV  2
+  #define  LIM_MXV  3
+
+
+/*--- Global static variables ---*/
+
+/* Parameters have been set if non-zero */
+static int  fon = 0 ;
+
+/* Screen edges , sampling rate , and squared velocity and acceleration
+   thresholds */
+static double  lim[ NUMLIM ] ;
+static double  hz = 0 , vel2 = 0 , acc2 = 0 ;
+
+/* Positions of the last NHIST samples , oldest first , in columns of left
+   x , left y , right x , right y. NaN until seen , which makes them off
+   screen. */
+static double  hist[ NHIST ][ EYECOL - 1 ] ;
+
+
+/*--- Function definitions ---*/
+
+void  fltopen ( const mxArray ** ) ;
+void  fltrun ( int , mxArray ** , const mxArray ** ) ;
+ int  notscalar ( const mxArray * ) ;
+
+
+/*** eyefilt function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:eyefilt:fun"  ,
+      "eyefilt arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:eyefilt:fun"  ,
+      "eyefilt arg fun must be a single char"  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    
+    /* Set parameters */
+    case  FUN_OPEN:
+      
+      if  ( nrhs  !=  NRHS_OPEN )
+        
+        mexErrMsgIdAndTxt (  "MET:eyefilt:fun"  ,
+          "eyefilt open requires %d input arguments in total"  ,
+            NRHS_OPEN  ) ;
+      
+      else if  ( nlhs )
+        
+        mexErrMsgIdAndTxt (  "MET:eyefilt:fun"  ,
+          "eyefilt open returns no output argument"  ) ;
+      
+      fltopen ( prhs + 1 ) ;
+      break ;
+    
+    
+    /* Filter eye samples */
+    case  FUN_FILT:
+      
+      if  ( !fon )
+        
+        mexErrMsgIdAndTxt (  "MET:eyefilt:fun"  ,
+          "eyefilt must be opened before filtering"  ) ;
+      
+      else if  ( nrhs  !=  NRHS_FILT )
+        
+        mexErrMsgIdAndTxt (  "MET:eyefilt:fun"  ,
+          "eyefilt filter requires %d input arguments in total"  ,
+            NRHS_FILT  ) ;
+      
+      else if  ( NLHS_FILT  <  nlhs )
+        
+        mexErrMsgIdAndTxt (  "MET:eyefilt:fun"  ,
+          "eyefilt filter provides at most %d output arguments"  ,
+            NLHS_FILT  ) ;
+      
+      fltrun ( nlhs , plhs , prhs + 1 ) ;
+      break ;
+    
+    
+    /* Unrecognised function */
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:eyefilt:fun"  ,
+        "eyefilt arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  
+  } /* choose sub-function */
+
+
+} /* eyefilt */
+
+
+/*---Subroutines---*/
+
+/* Returns non-zero if m is not a real , finite , scalar double */
+int  notscalar ( const mxArray *  m )
+{
+  
+  return  !mxIsDouble ( m )  ||  !mxIsScalar ( m )  ||  mxIsComplex ( m )
+    ||  mxIsNaN ( mxGetScalar ( m ) )  ||  mxIsInf ( mxGetScalar ( m ) ) ;
+
+} /* notscalar */
+
+
+/* Set parameters from m , which holds lim , hz , vel , and acc. Forgets
+   all past samples. */
+void  fltopen ( const mxArray *  m[] )
+{
+  
+  /* Generic counter , and screen edges */
+  int  i ;
+  double *  l ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( !mxIsDouble ( m[ 0 ] )  ||  mxIsComplex ( m[ 0 ] )  ||
+        mxGetNumberOfElements ( m[ 0 ] )  !=  NUMLIM )
+    mexErrMsgIdAndTxt (  "MET:eyefilt:open"  ,
+      "eyefilt 'open' , lim must be a real double with %d elements"  ,
+        NUMLIM  ) ;
+  
+  l = mxGetPr ( m[ 0 ] ) ;
+  
+  if  ( !( l[ LIM_MNH ] < l[ LIM_MXH ] )  ||
+        !( l[ LIM_MNV ] < l[ LIM_MXV ] ) )
+    mexErrMsgIdAndTxt (  "MET:eyefilt:open"  ,
+      "eyefilt 'open' , lim must have each minimum below its maximum"  ) ;
+  
+  for  ( i = 1  ;  i < NRHS_OPEN - 1  ;  i++ )
+    if  ( notscalar ( m[ i ] )  ||  mxGetScalar ( m[ i ] ) < 0 )
+      mexErrMsgIdAndTxt (  "MET:eyefilt:open"  ,
+        "eyefilt 'open' , hz , vel , and acc must be finite , "
+        "non-negative scalar doubles"  ) ;
+  
+  if  ( !( 0 < mxGetScalar ( m[ 1 ] ) ) )
+    mexErrMsgIdAndTxt (  "MET:eyefilt:open"  ,
+      "eyefilt 'open' , hz must be over zero"  ) ;
+  
+  
+  /*-- Set parameters --*/
+  
+  memcpy ( lim , l , sizeof ( lim ) ) ;
+  
+  hz    = mxGetScalar ( m[ 1 ] ) ;
+  vel2  = mxGetScalar ( m[ 2 ] ) ;
+  acc2  = mxGetScalar ( m[ 3 ] ) ;
+  
+  /* Thresholds are compared with squared magnitudes */
+  vel2 *= vel2 ;
+  acc2 *= acc2 ;
+  
+  /* Forget the past */
+  for  ( i = 0  ;  i < NHIST * ( EYECOL - 1 )  ;  i++ )
+    hist[ i / ( EYECOL - 1 ) ][ i % ( EYECOL - 1 ) ] = NAN ;
+  
+  fon = 1 ;
+
+} /* fltopen */
+
+
+/* Filter the block of eye samples in m[ 0 ] , see the header for
+   outputs */
+void  fltrun ( int  nlhs , mxArray *  plhs[] , const mxArray *  m[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Number of samples , and counters */
+  size_t  N , i , j ;
+  
+  /* New eye samples */
+  double *  e ;
+  
+  /* Positions of the past samples followed by the new ones , one array per
+     column of left x , left y , right x , right y. Sample i of the
+     input is at index NHIST + i of each , so that no index is negative. */
+  double  * x , * c[ EYECOL - 1 ] ;
+  
+  /* Velocity of each sample , acceleration of one , and screen and
+     threshold checks per sample */
+  double  * dx , * dy , ax , ay ;
+  unsigned char  * on , * ok ;
+  
+  /* Outputs , validity mask and filtered positions */
+  mxLogical *  v ;
+  double *  p ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( !mxIsDouble ( m[ 0 ] )  ||  mxIsComplex ( m[ 0 ] )  ||
+        ( !mxIsEmpty ( m[ 0 ] )  &&
+          ( mxGetNumberOfDimensions ( m[ 0 ] ) != 2  ||
+            mxGetN ( m[ 0 ] ) != EYECOL ) ) )
+    mexErrMsgIdAndTxt (  "MET:eyefilt:filt"  ,
+      "eyefilt 'filt' , eyepos must be a real N x %d double"  ,  EYECOL  ) ;
+  
+  N = mxIsEmpty ( m[ 0 ] )  ?  0  :  mxGetM ( m[ 0 ] ) ;
+  e = mxGetPr ( m[ 0 ] ) ;
+  
+  
+  /*-- Working memory --*/
+  
+  /* Past and new positions */
+  x = mxMalloc ( ( EYECOL - 1 ) * ( N + NHIST ) * sizeof ( double ) ) ;
+  
+  for  ( j = 0  ;  j < EYECOL - 1  ;  j++ )
+  {
+    c[ j ] = x  +  j * ( N + NHIST ) ;
+    
+    for  ( i = 0  ;  i < NHIST  ;  i++ )
+      c[ j ][ i ] = hist[ i ][ j ] ;
+    
+    memcpy ( c[ j ] + NHIST , e + ( COL_XL + j ) * N ,
+             N * sizeof ( double ) ) ;
+  }
+  
+  /* Per-sample scratch , on screen flags start with the past samples */
+  dx = mxMalloc ( 2 * ( N + 1 ) * sizeof ( double ) ) ;
+  dy = dx  +  N + 1 ;
+  on = mxMalloc ( ( N + NHIST ) * sizeof ( unsigned char ) ) ;
+  ok = mxMalloc ( ( N + 1 ) * sizeof ( unsigned char ) ) ;
+  
+  
+  /*-- Filter --*/
+  
+  /* Both eyes on screen , from the oldest past sample. NaN is off
+     screen. */
+  for  ( i = 0  ;  i < N + NHIST  ;  i++ )
+    on[ i ] =
+      ( lim[ LIM_MNH ] < c[ 0 ][ i ] ) & ( c[ 0 ][ i ] < lim[ LIM_MXH ] ) &
+      ( lim[ LIM_MNV ] < c[ 1 ][ i ] ) & ( c[ 1 ][ i ] < lim[ LIM_MXV ] ) &
+      ( lim[ LIM_MNH ] < c[ 2 ][ i ] ) & ( c[ 2 ][ i ] < lim[ LIM_MXH ] ) &
+      ( lim[ LIM_MNV ] < c[ 3 ][ i ] ) & ( c[ 3 ][ i ] < lim[ LIM_MXV ] ) ;
+  
+  /* A new sample and the two before it are all on screen */
+  for  ( i = 0  ;  i < N  ;  i++ )
+    ok[ i ] = on[ i ] & on[ i + 1 ] & on[ i + 2 ] ;
+  
+  /* Each eye in turn , left columns 0 and 1 , right columns 2 and 3 */
+  for  ( j = 0  ;  j < EYECOL - 1  ;  j += 2 )
+  {
+    
+    /* Velocity of the last past sample and each new one , per sample.
+       dx[ i ] belongs to the sample at index i + NHIST - 1. */
+    for  ( i = 0  ;  i < N + 1  ;  i++ )
+    {
+      dx[ i ] = ( c[ j     ][ i + NHIST - 1 ] -
+                  c[ j     ][ i + NHIST - 2 ] ) * hz ;
+      dy[ i ] = ( c[ j + 1 ][ i + NHIST - 1 ] -
+                  c[ j + 1 ][ i + NHIST - 2 ] ) * hz ;
+    }
+    
+    /* Squared speed and acceleration of each new sample must not exceed
+       thresholds. Comparisons with NaN are false. */
+    for  ( i = 0  ;  i < N  ;  i++ )
+    {
+      ax = ( dx[ i + 1 ] - dx[ i ] ) * hz ;
+      ay = ( dy[ i + 1 ] - dy[ i ] ) * hz ;
+      
+      ok[ i ] &=
+        ( dx[ i + 1 ] * dx[ i + 1 ]  +  dy[ i + 1 ] * dy[ i + 1 ]  <=  vel2 ) &
+        ( ax * ax  +  ay * ay  <=  acc2 ) ;
+    }
+  
+  } /* eyes */
+  
+  
+  /*-- Keep last samples --*/
+  
+  for  ( i = 0  ;  i < NHIST  ;  i++ )
+    for  ( j = 0  ;  j < EYECOL - 1  ;  j++ )
+      hist[ i ][ j ] = c[ j ][ N + i ] ;
+  
+  
+  /*-- Outputs --*/
+  
+  if  ( 0  <  nlhs )
+  {
+    plhs[ 0 ] = mxCreateLogicalMatrix ( N , 1 ) ;
+    v = mxGetLogicals ( plhs[ 0 ] ) ;
+    
+    for  ( i = 0  ;  i < N  ;  i++ )
+      v[ i ] = ok[ i ] ;
+  }
+  
+  if  ( 1  <  nlhs )
+  {
+    plhs[ 1 ] = mxCreateDoubleMatrix ( N , N ? EYECOL : 0 , mxREAL ) ;
+    p = mxGetPr ( plhs[ 1 ] ) ;
+    
+    if  ( N )
+      memcpy ( p , e , N * EYECOL * sizeof ( double ) ) ;
+    
+    for  ( j = COL_XL  ;  j < EYECOL  ;  j++ )
+      for  ( i = 0  ;  i < N  ;  i++ )
+        if  ( !ok[ i ] )
+          p[ j * N + i ] = NAN ;
+  }
+  
+  mxFree ( x ) ;
+  mxFree ( dx ) ;
+  mxFree ( on ) ;
+  mxFree ( ok ) ;
+
+} /* fltrun */
+
@@ -0,0 +1,634 @@
+/*  frametel.c
+  
+  [ ... ] = frametel ( fun , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. Frame-timing
+  telemetry for metptb. One record is kept for each frame that metptb
+  flips to the screen. Records are appended to a log of the current
+  trial , which metptb saves in the trial directory at the end of the
+  trial. If metptb writes to a shared memory channel that is declared in
+  the .cmet file then each record is also published to a ring in that
+  shared memory as soon as the frame is flipped. Any controller with read
+  access to the channel can then poll the ring for new records while the
+  trial runs.
+  
+  Each record is one row of FTCOL doubles:
+    
+    [ trial , frame , target , vbl , onset , flip , missed , draw ,
+      d( 1 ) , d( 2 ) , ... d( MAXLNK ) ]
+  
+  trial is the trial identifier and frame counts the frames of the trial
+  from 1. target is the deadline of the flip. vbl , onset , flip , and
+  missed are the VBLTimestamp , StimulusOnsetTime , FlipTimestamp , and
+  Missed outputs of Screen 'Flip'. d( j ) is the time , in seconds , that
+  was spent in the stimulation function of the j'th stimulus link while
+  the frame was drawn , and draw is the total over all links. Only the
+  first MAXLNK links have their own column , but draw includes the rest.
+  
+  The ring has one writer and is lock-free. It follows the MSHM_SYNC
+  synchronisation block of the shared memory , which is not used. A small
+  header holds the number of records that were ever written , which the
+  writer stores with release semantics after each new record. A reader
+  copies every record that it has not seen , then checks the count again
+  and drops any record that the writer may have overwritten in the mean
+  time. Hence the writer never waits for readers , and a slow reader only
+  loses the oldest records. The header also holds a generation count
+  that the writer increments each time that it opens the ring. When it
+  changes , a reader starts again from the first record of the new
+  writer. Readers must poll with frametel ( 'p' ) rather than met (
+  'read' ) or met ( 'select' ).
+  
+  Sub-functions:
+    
+    frametel ( 'o' )
+    frametel ( 'o' , shm ) -- Opens an empty trial log. If string shm is
+      given then it names a declared shared memory channel that the
+      controller writes to , and the ring is initialised there. From then
+      on , every record is published to the ring.
+    
+    frametel ( 'r' , tid , n ) -- Empties the trial log for a new trial
+      with identifier tid that has n stimulus links , both scalar doubles.
+    
+    frametel ( 'a' , target , vbl , onset , flip , missed , d ) -- Adds a
+      record for the next frame of the trial. All are scalar doubles
+      except for d , a double vector of draw times for each stimulus link.
+    
+    F = frametel ( 'g' ) -- Returns the records of the current trial , one
+      row per frame. F only has the first 8 + min ( n , MAXLNK ) columns.
+    
+    frametel ( 'm' , shm ) -- Maps the ring in the declared shared memory
+      channel named by string shm , for reading. The first poll returns
+      all records that remain in the ring.
+    
+    [ F , nd ] = frametel ( 'p' ) -- Polls the ring. Returns every record
+      that was published since the last poll , one row per record , and
+      the number of records that were lost because they were overwritten
+      before they could be read. An empty F is returned until the writer
+      has initialised the ring.
+    
+    frametel ( 'c' ) -- Frees the trial log and unmaps any shared memory.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* MET */
+#include  "met.h"
+
+/* Shared memory */
+#include  <fcntl.h>
+#include  <sys/mman.h>
+#include  <sys/stat.h>
+#include  <unistd.h>
+
+/* General */
+#include  <stdint.h>
+#include  <stdio.h>
+#include  <string.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Open trial log and ring writer */
+  #define  FUN_OPEN   'o'
+  
+  /* New trial */
+  #define  FUN_RESET  'r'
+  
+  /* Add a frame record */
+  #define  FUN_ADD    'a'
+  
+  /* Get trial log */
+  #define  FUN_GET    'g'
+  
+  /* Map ring for reading */
+  #define  FUN_MAP    'm'
+  
+  /* Poll ring */
+  #define  FUN_POLL   'p'
+  
+  /* Close */
+  #define  FUN_CLOSE  'c'
+
+
+/* Number of input and output args , including fun */
+  
+  #define  NRHS_OPEN   2
+  #define  NRHS_RESET  3
+  #define  NRHS_ADD    7
+  #define  NRHS_GET    1
+  #define  NRHS_MAP    2
+  #define  NRHS_POLL   1
+  #define  NRHS_CLOSE  1
+  #define  NLHS_GET    1
+  #define  NLHS_POLL   2
+
+
+/* Maximum number of stimulus links with their own column */
+#define  MAXLNK  16
+
+/* Record columns , those before the draw times , and column indices */
+#define  FTHEAD  8
+#define  FTCOL   ( FTHEAD + MAXLNK )
+#define  COL_TRIAL   0
+#define  COL_FRAME   1
+#define  COL_TARGET  2
+#define  COL_DRAW    7
+
+/* Bytes of a record */
+#define  FTREC  ( FTCOL * sizeof ( double ) )
+
+/* Bytes reserved for the ring header , one cache line */
+#define  FTHDR  64
+
+/* Marks a ring header that the writer has initialised , "MFTR" */
+#define  FTMAGIC  0x5254464DU
+
+/* Initial number of records in the trial log */
+#define  LOGINI  4096
+
+
+/*--- Types ---*/
+
+/* Ring header , follows the synchronisation block. ncol is FTCOL , cap
+   the number of records in the ring , and head the number of records
+   ever written ; the record with count i is in slot i % cap. gen is
+   incremented each time that a writer opens the ring. */
+struct fthead
+  {
+    uint32_t  magic ;
+    uint32_t  ncol ;
+    uint64_t  cap ;
+    uint64_t  head ;
+    uint64_t  gen ;
+  } ;
+
+
+/*--- Global static variables ---*/
+
+/* Trial log of records , number of records in it , and its capacity */
+static double *  tlog = NULL ;
+static size_t  nlog = 0 , caplog = 0 ;
+
+/* Trial identifier , and number of stimulus links */
+static double  trial = 0 ;
+static size_t  nlnk = 0 ;
+
+/* Writer's mapping , its size , ring header , and first record */
+static void *  wmap = NULL ;
+static size_t  wsiz = 0 ;
+static struct fthead *  whdr = NULL ;
+static double *  wrec = NULL ;
+
+/* Reader's mapping , its size , ring header , first record , count of
+   the next record to read , and the writer generation that it belongs to
+*/
+static void *  rmap = NULL ;
+static size_t  rsiz = 0 ;
+static struct fthead *  rhdr = NULL ;
+static double *  rrec = NULL ;
+static uint64_t  rtail = 0 , rgen = 0 ;
+
+
+/*--- Function definitions ---*/
+
+void  ftfree ( void ) ;
+void  ftopen ( int , const mxArray ** ) ;
+void  ftreset ( const mxArray ** ) ;
+void  ftadd ( const mxArray ** ) ;
+mxArray *  ftget ( void ) ;
+void  ftmap ( const mxArray * ) ;
+void  ftpoll ( int , mxArray ** ) ;
+void *  shmmap ( const mxArray * , int , size_t * , char ) ;
+ int  notscalar ( const mxArray * ) ;
+
+
+/*** frametel function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  /* Required number of inputs , and maximum number of outputs */
+  int  nin , nout = 0 ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:frametel:fun"  ,
+      "frametel arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:frametel:fun"  ,
+      "frametel arg fun must be a single char"  ) ;
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   nin = NRHS_OPEN  ;  break ;
+    case  FUN_RESET:  nin = NRHS_RESET ;  break ;
+    case  FUN_ADD:    nin = NRHS_ADD   ;  break ;
+    case  FUN_GET:    nin = NRHS_GET   ;  nout = NLHS_GET  ;  break ;
+    case  FUN_MAP:    nin = NRHS_MAP   ;  break ;
+    case  FUN_POLL:   nin = NRHS_POLL  ;  nout = NLHS_POLL ;  break ;
+    case  FUN_CLOSE:  nin = NRHS_CLOSE ;  break ;
+    
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:frametel:fun"  ,
+        "frametel arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  }
+  
+  /* shm is optional for 'o' */
+  if  ( nrhs  !=  nin  &&  !( c[ 0 ] == FUN_OPEN  &&  nrhs == 1 ) )
+    
+    mexErrMsgIdAndTxt (  "MET:frametel:fun"  ,
+      "frametel '%c' requires %d input arguments in total"  ,  c[ 0 ]  ,
+        nin  ) ;
+  
+  else if  ( nout  <  nlhs )
+    
+    mexErrMsgIdAndTxt (  "MET:frametel:fun"  ,
+      "frametel '%c' provides at most %d output arguments"  ,  c[ 0 ]  ,
+        nout  ) ;
+  
+  else if  ( tlog == NULL  &&  ( c[ 0 ] == FUN_RESET  ||
+             c[ 0 ] == FUN_ADD  ||  c[ 0 ] == FUN_GET ) )
+    
+    mexErrMsgIdAndTxt (  "MET:frametel:fun"  ,
+      "frametel must be opened with 'o' before '%c'"  ,  c[ 0 ]  ) ;
+  
+  else if  ( rmap == NULL  &&  c[ 0 ] == FUN_POLL )
+    
+    mexErrMsgIdAndTxt (  "MET:frametel:fun"  ,
+      "frametel must be mapped with 'm' before '%c'"  ,  c[ 0 ]  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   ftopen  ( nrhs , prhs ) ;  break ;
+    case  FUN_RESET:  ftreset ( prhs + 1 ) ;  break ;
+    case  FUN_ADD:    ftadd   ( prhs + 1 ) ;  break ;
+    case  FUN_GET:    plhs[ 0 ] = ftget ( ) ;  break ;
+    case  FUN_MAP:    ftmap   ( prhs[ 1 ] ) ;  break ;
+    case  FUN_POLL:   ftpoll  ( nlhs , plhs ) ;  break ;
+    case  FUN_CLOSE:  ftfree  ( ) ;  break ;
+  }
+
+
+} /* frametel */
+
+
+/*---Subroutines---*/
+
+/* Returns non-zero if m is not a real , finite , scalar double */
+int  notscalar ( const mxArray *  m )
+{
+  
+  return  !mxIsDouble ( m )  ||  !mxIsScalar ( m )  ||  mxIsComplex ( m )
+    ||  mxIsNaN ( mxGetScalar ( m ) )  ||  mxIsInf ( mxGetScalar ( m ) ) ;
+
+} /* notscalar */
+
+
+/* Free the trial log and unmap shared memory */
+void  ftfree ( void )
+{
+  
+  if  ( tlog != NULL )  mxFree ( tlog ) ;
+  if  ( wmap != NULL )  munmap ( wmap , wsiz ) ;
+  if  ( rmap != NULL )  munmap ( rmap , rsiz ) ;
+  
+  tlog = NULL ;  nlog = caplog = 0 ;
+  wmap = NULL ;  whdr = NULL ;  wrec = NULL ;  wsiz = 0 ;
+  rmap = NULL ;  rhdr = NULL ;  rrec = NULL ;  rsiz = 0 ;
+  rtail = rgen = 0 ;
+
+} /* ftfree */
+
+
+/* Map the declared shared memory channel named by string s. Read-write if
+   w is non-zero , otherwise read-only. Returns the size of the mapping in
+   siz. f is the fun char for error messages. */
+void *  shmmap ( const mxArray *  s , int  w , size_t *  siz , char  f )
+{
+  
+  /* Channel name and file name */
+  char  nam[ MSHM_NAMLEN ] , fnm[ MSHM_FNMLEN ] ;
+  
+  /* File descriptor , status , and mapping */
+  int  fd ;
+  struct stat  st ;
+  void *  m ;
+  
+  if  ( !mxIsChar ( s )  ||  mxGetString ( s , nam , MSHM_NAMLEN ) )
+    
+    mexErrMsgIdAndTxt (  "MET:frametel:shm"  ,
+      "frametel '%c' , shm must be a string of up to %d chars"  ,  f  ,
+        MSHM_NAMLEN - 1  ) ;
+  
+  snprintf ( fnm , MSHM_FNMLEN , MSHM_FNFMT , nam ) ;
+  
+  if  ( ( fd = shm_open ( fnm , w ? O_RDWR : O_RDONLY , 0 ) )  ==  -1 )
+  {
+    perror ( "MET:frametel:shm_open" ) ;
+    mexErrMsgIdAndTxt (  "MET:frametel:shm"  ,
+      "frametel '%c' , failed to open shared memory %s"  ,  f  ,  fnm  ) ;
+  }
+  
+  /* Room for the synchronisation block , ring header , and two records */
+  if  ( fstat ( fd , &st )  ==  -1  ||
+        st.st_size < ( off_t ) ( MSHM_SYNC + FTHDR + 2 * FTREC )  ||
+        ( m = mmap ( NULL , st.st_size ,
+            w ? PROT_READ | PROT_WRITE : PROT_READ , MAP_SHARED , fd , 0 ) )
+          ==  MAP_FAILED )
+  {
+    perror ( "MET:frametel:mmap" ) ;
+    close ( fd ) ;
+    mexErrMsgIdAndTxt (  "MET:frametel:shm"  ,
+      "frametel '%c' , failed to map shared memory %s"  ,  f  ,  fnm  ) ;
+  }
+  
+  /* The mapping stays valid without the file descriptor */
+  close ( fd ) ;
+  
+  *siz = st.st_size ;
+  
+  return  m ;
+
+} /* shmmap */
+
+
+/* Open an empty trial log , and the ring writer if shm is given */
+void  ftopen ( int  nrhs , const mxArray **  prhs )
+{
+  
+  ftfree ( ) ;
+  mexAtExit ( ftfree ) ;
+  
+  tlog = mxCalloc ( LOGINI * FTCOL , sizeof ( double ) ) ;
+  mexMakeMemoryPersistent ( tlog ) ;
+  caplog = LOGINI ;
+  
+  trial = 0 ;
+  nlnk = 0 ;
+  
+  if  ( nrhs  <  NRHS_OPEN )  return ;
+  
+  wmap = shmmap ( prhs[ 1 ] , 1 , &wsiz , FUN_OPEN ) ;
+  whdr = ( struct fthead * ) ( ( char * ) wmap  +  MSHM_SYNC ) ;
+  wrec = ( double * ) ( ( char * ) whdr  +  FTHDR ) ;
+  
+  /* Readers ignore the ring until the header is complete */
+  __atomic_store_n ( &whdr->magic , 0 , __ATOMIC_RELEASE ) ;
+  
+  whdr->ncol = FTCOL ;
+  whdr->cap  = ( wsiz - MSHM_SYNC - FTHDR )  /  FTREC ;
+  
+  /* A new generation , before head restarts , so that readers can tell
+     this writer's records from the last one's */
+  __atomic_store_n ( &whdr->gen , whdr->gen + 1 , __ATOMIC_RELEASE ) ;
+  __atomic_store_n ( &whdr->head , 0 , __ATOMIC_RELEASE ) ;
+  
+  __atomic_store_n ( &whdr->magic , FTMAGIC , __ATOMIC_RELEASE ) ;
+
+} /* ftopen */
+
+
+/* Empty the trial log for a new trial */
+void  ftreset ( const mxArray **  prhs )
+{
+  
+  if  ( notscalar ( prhs[ 0 ] )  ||  notscalar ( prhs[ 1 ] )  ||
+        mxGetScalar ( prhs[ 1 ] ) < 0 )
+    
+    mexErrMsgIdAndTxt (  "MET:frametel:reset"  ,
+      "frametel 'r' , tid and n must be finite scalar doubles , n >= 0"  ) ;
+  
+  trial = mxGetScalar ( prhs[ 0 ] ) ;
+  nlnk = ( size_t ) mxGetScalar ( prhs[ 1 ] ) ;
+  nlog = 0 ;
+
+} /* ftreset */
+
+
+/* Add a record for the next frame */
+void  ftadd ( const mxArray **  prhs )
+{
+  
+  /* New record , draw times , number of them , and index */
+  double *  r ;
+  const double *  d ;
+  size_t  nd , i ;
+  
+  /* Ring count */
+  uint64_t  h ;
+  
+  for  ( i = 0 ; i < 5 ; ++i )
+    
+    if  ( !mxIsDouble ( prhs[ i ] )  ||  !mxIsScalar ( prhs[ i ] )  ||
+          mxIsComplex ( prhs[ i ] ) )
+      
+      mexErrMsgIdAndTxt (  "MET:frametel:add"  ,
+        "frametel 'a' , arg %d must be a scalar double"  ,  i + 2  ) ;
+  
+  if  ( !mxIsDouble ( prhs[ 5 ] )  ||  mxIsComplex ( prhs[ 5 ] ) )
+    
+    mexErrMsgIdAndTxt (  "MET:frametel:add"  ,
+      "frametel 'a' , d must be a real double vector"  ) ;
+  
+  /* Grow the log by doubling */
+  if  ( nlog  ==  caplog )
+  {
+    tlog = mxRealloc ( tlog , 2 * caplog * FTREC ) ;
+    mexMakeMemoryPersistent ( tlog ) ;
+    caplog *= 2 ;
+  }
+  
+  r = tlog  +  nlog * FTCOL ;
+  
+  r[ COL_TRIAL ] = trial ;
+  r[ COL_FRAME ] = ( double ) ++nlog ;
+  
+  for  ( i = 0 ; i < 5 ; ++i )
+    r[ COL_TARGET + i ] = mxGetScalar ( prhs[ i ] ) ;
+  
+  d = mxGetPr ( prhs[ 5 ] ) ;
+  nd = mxGetNumberOfElements ( prhs[ 5 ] ) ;
+  
+  r[ COL_DRAW ] = 0 ;
+  
+  for  ( i = 0 ; i < nd ; ++i )  r[ COL_DRAW ] += d[ i ] ;
+  
+  for  ( i = 0 ; i < MAXLNK ; ++i )
+    r[ FTHEAD + i ] = i < nd  ?  d[ i ]  :  0 ;
+  
+  /* Publish. The writer is the only one to change head. */
+  if  ( wmap  ==  NULL )  return ;
+  
+  h = whdr->head ;
+  
+  memcpy ( wrec  +  ( h % whdr->cap ) * FTCOL , r , FTREC ) ;
+  
+  __atomic_store_n ( &whdr->head , h + 1 , __ATOMIC_RELEASE ) ;
+
+} /* ftadd */
+
+
+/* Return the trial log , one row per frame */
+mxArray *  ftget ( void )
+{
+  
+  /* Number of columns , output array , its values , and indices */
+  const size_t  nc = FTHEAD  +  ( nlnk < MAXLNK ? nlnk : MAXLNK ) ;
+  mxArray *  m = mxCreateDoubleMatrix ( nlog , nc , mxREAL ) ;
+  double *  F = mxGetPr ( m ) ;
+  size_t  i , j ;
+  
+  /* Records are rows , Matlab is column-major */
+  for  ( i = 0 ; i < nlog ; ++i )
+    for  ( j = 0 ; j < nc ; ++j )
+      F[ i + j * nlog ] = tlog[ i * FTCOL + j ] ;
+  
+  return  m ;
+
+} /* ftget */
+
+
+/* Map the ring for reading */
+void  ftmap ( const mxArray *  s )
+{
+  
+  if  ( rmap  !=  NULL )  munmap ( rmap , rsiz ) ;
+  
+  rmap = NULL ;
+  
+  mexAtExit ( ftfree ) ;
+  
+  rmap = shmmap ( s , 0 , &rsiz , FUN_MAP ) ;
+  rhdr = ( struct fthead * ) ( ( char * ) rmap  +  MSHM_SYNC ) ;
+  rrec = ( double * ) ( ( char * ) rhdr  +  FTHDR ) ;
+  rtail = rgen = 0 ;
+
+} /* ftmap */
+
+
+/* Poll the ring for new records */
+void  ftpoll ( int  nlhs , mxArray **  plhs )
+{
+  
+  /* Ring capacity , count of records written before and after the copy ,
+     first record to copy , number copied , number lost , and writer
+     generation */
+  uint64_t  cap , h , h2 , t , n = 0 , nd = 0 , k , g ;
+  
+  /* Output , its values , records , and indices */
+  mxArray *  m ;
+  double *  F ;
+  const double *  r ;
+  uint64_t  i , j ;
+  
+  /* Writer has not initialised the ring , or the mapping is too small */
+  if  ( __atomic_load_n ( &rhdr->magic , __ATOMIC_ACQUIRE ) != FTMAGIC  ||
+        rhdr->ncol != FTCOL  ||  rhdr->cap < 2  ||
+        ( rsiz - MSHM_SYNC - FTHDR ) / FTREC  <  rhdr->cap )
+  {
+    plhs[ 0 ] = mxCreateDoubleMatrix ( 0 , FTCOL , mxREAL ) ;
+    if  ( 1 < nlhs )  plhs[ 1 ] = mxCreateDoubleScalar ( 0 ) ;
+    return ;
+  }
+  
+  cap = rhdr->cap ;
+  
+  /* The writer started again , its records count from zero */
+  g = __atomic_load_n ( &rhdr->gen , __ATOMIC_ACQUIRE ) ;
+  
+  if  ( g  !=  rgen )
+  {
+    rgen = g ;
+    rtail = 0 ;
+  }
+  
+  h = __atomic_load_n ( &rhdr->head , __ATOMIC_ACQUIRE ) ;
+  
+  /* A writer that predates gen leaves it at zero , but head still goes
+     backwards when it starts again */
+  if  ( h  <  rtail )  rtail = 0 ;
+  
+  /* The slot of the next record may be mid-write , so at most cap - 1
+     records can be read */
+  t = rtail ;
+  
+  if  ( cap - 1  <  h - t )
+  {
+    nd = h - t - ( cap - 1 ) ;
+    t = h - ( cap - 1 ) ;
+  }
+  
+  n = h - t ;
+  
+  m = mxCreateDoubleMatrix ( n , FTCOL , mxREAL ) ;
+  F = mxGetPr ( m ) ;
+  
+  for  ( i = 0 ; i < n ; ++i )
+  {
+    r = rrec  +  ( ( t + i ) % cap ) * FTCOL ;
+    for  ( j = 0 ; j < FTCOL ; ++j )  F[ i + j * n ] = r[ j ] ;
+  }
+  
+  /* Records with counts up to h2 - cap may have been overwritten while
+     they were copied */
+  __atomic_thread_fence ( __ATOMIC_ACQUIRE ) ;
+  h2 = __atomic_load_n ( &rhdr->head , __ATOMIC_RELAXED ) ;
+  
+  k = h2 + 1  <=  t + cap  ?  0  :  h2 + 1 - t - cap ;
+  
+  /* A new writer opened the ring during the copy , none of it is safe.
+     The next poll starts on the new generation. */
+  if  ( __atomic_load_n ( &rhdr->gen , __ATOMIC_RELAXED )  !=  g )
+  {
+    k = n ;
+    h = 0 ;
+  }
+  
+  if  ( n  <  k )  k = n ;
+  
+  /* Shift valid records up to the first row */
+  if  ( k )
+  {
+    for  ( j = 0 ; j < FTCOL ; ++j )
+      memmove ( F + j * ( n - k ) , F + j * n + k ,
+        ( n - k ) * sizeof ( double ) ) ;
+    
+    mxSetM ( m , n - k ) ;
+    nd += k ;
+  }
+  
+  rtail = h ;
+  
+  plhs[ 0 ] = m ;
+  if  ( 1 < nlhs )  plhs[ 1 ] = mxCreateDoubleScalar ( ( double ) nd ) ;
+
+} /* ftpoll */
+
@@ -0,0 +1,764 @@
+/*  hitgrid.c
+  
+  [ ... ] = hitgrid ( fun , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. A spatial index of the
+  hit regions of a trial's stimulus links , used by mettarget to find which
+  task stimulus is being targeted by the eyes or mouse. All hit regions
+  are binned once into a uniform grid of cells that covers their bounding
+  boxes , so that each point is only compared against the few hit regions
+  whose bounding boxes overlap its cell. Hence the time taken to check a
+  point does not grow with the number of hit regions that are shown
+  elsewhere on screen.
+  
+  Hit regions come in the formats of MET ptb-type stimulus definitions ,
+  see MCC.SHM.STIM.RECT8 and .CIRC6 from metctrlconst. That is , N x 8
+  double matrices of rectangles [ x , y , width , height , rotation ,
+  disparity , tolerance , ignore ] or N x 6 matrices of circles [ x , y ,
+  radius , disparity , tolerance , ignore ]. Positions are in degrees of
+  visual field from the centre of the screen and rotation is in degrees ,
+  clockwise. A point is in a rectangle or circle if it is on or
+  inside the edge. Hit regions with a zero in the ignore column are never
+  hit. Disparity is not checked.
+  
+  Sub-functions:
+    
+    hitgrid ( 'o' , lnkind , hitregion ) -- Opens a new trial. lnkind is a
+      cell array with one element per task stimulus , listing the indices
+      of its stimulus links. hitregion is a cell array with one element
+      per stimulus link , holding its hit region matrix , or an empty
+      matrix if it is not a ptb-type stimulus. See metptblink. No stimulus
+      is visible until 'v' is called.
+    
+    hitgrid ( 'r' , I , H ) -- Replaces the hit regions of stimulus links
+      with new ones , as when hit regions are read from 'stim' shared
+      memory. I is a logical index with one element per stimulus link ,
+      and H is a cell array with the new hit region matrix of each link
+      where I is true , in order. Does nothing before the first 'o'.
+    
+    hitgrid ( 'v' , istim ) -- Sets the visible task stimuli. istim is a
+      double vector of task stimulus indices , in the order that they are
+      checked. The first one that is hit is the one that is targeted ;
+      thus the stimulus drawn last should be first.
+    
+    i = hitgrid ( 'q' , x , y ) -- Finds the targeted stimulus at each of
+      N points. x and y are N x 1 double matrices of mouse positions , or N
+      x 2 of [ left , right ] eye positions. When there are two points per
+      row then both must fall in hit regions of the same stimulus link.
+      Returns N x 1 double i , with the index of the first visible task
+      stimulus that is hit at each row , or 0 if none is.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* General */
+#include  <math.h>
+#include  <stdlib.h>
+#include  <string.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Open new trial */
+  #define  FUN_OPEN  'o'
+  
+  /* Replace hit regions */
+  #define  FUN_RGN   'r'
+  
+  /* Set visible stimuli */
+  #define  FUN_VIS   'v'
+  
+  /* Query points */
+  #define  FUN_QRY   'q'
+
+
+/* Number of input and output args , including fun */
+  
+  #define  NRHS_OPEN  3
+  #define  NRHS_RGN   3
+  #define  NRHS_VIS   2
+  #define  NRHS_QRY   3
+  #define  NLHS_QRY   1
+
+
+/* Hit regions */
+  
+  /* Rectangle columns , see MCC.SHM.STIM.RECT8 */
+  #define  RECT_NCOL  8
+  #define  RECT_X     0
+  #define  RECT_Y     1
+  #define  RECT_W     2
+  #define  RECT_H     3
+  #define  RECT_ROT   4
+  #define  RECT_IGN   7
+  
+  /* Circle columns , see MCC.SHM.STIM.CIRC6 */
+  #define  CIRC_NCOL  6
+  #define  CIRC_X     0
+  #define  CIRC_Y     1
+  #define  CIRC_R     2
+  #define  CIRC_IGN   5
+  
+  /* Bounding box , index of each edge */
+  #define  NUMBB   4
+  #define  BB_MNX  0
+  #define  BB_MXX  1
+  #define  BB_MNY  2
+  #define  BB_MXY  3
+  
+  /* Maximum number of grid cells along each side */
+  #define  GRIDMAX  64
+  
+  /* Degrees to radians */
+  #define  DEG2RAD  ( M_PI / 180.0 )
+
+
+/*--- Data types ---*/
+
+/* One hit region. lnk is the index of its stimulus link , from 0 , and
+   rect is non-zero for a rectangle. bb is the bounding box. A rectangle
+   has centre x , y , cosine c and sine s of its rotation , and half width
+   hw and half height hh. A circle has centre x , y and squared radius in
+   hw. */
+struct hreg
+{
+  int  lnk , rect ;
+  double  bb[ NUMBB ] ;
+  double  x , y , c , s , hw , hh ;
+} ;
+
+
+/*--- Global static variables ---*/
+
+/* A trial has been opened if non-zero */
+static int  gon = 0 ;
+
+/* Number of stimulus links , and each link's hit regions with the number
+   of them. Only hit regions that are not ignored are kept. */
+static int  nlnk = 0 ;
+static struct hreg **  lreg = NULL ;
+static int *  lnr = NULL ;
+
+/* Number of task stimuli , and each stimulus' link indices from 0 , with
+   the number of them */
+static int  nstm = 0 ;
+static int **  slnk = NULL ;
+static int *  snl = NULL ;
+
+/* Visible task stimuli in checking order , indices from 0 , and the
+   number of them */
+static int *  vis = NULL ;
+static int  nvis = 0 ;
+
+/* Grid. Number of cells per side , lower edge , upper edge , and cell
+   width and height. Cell ( i , j ) is gst[ j * gn + i ] , and its hit
+   regions are greg[ gid[ k ] ] for k from gst[ cell ] up to gst[ cell + 1
+   ]. */
+static int  gn = 0 ;
+static double  gbb[ NUMBB ] , gdx , gdy ;
+static int *  gst = NULL ;
+static int *  gid = NULL ;
+static struct hreg *  greg = NULL ;
+
+/* Query stamps , one per stimulus link. A link was hit by the first point
+   of the current query if stl equals qid , and by all points if stb
+   equals qid. */
+static unsigned int  * stl = NULL , * stb = NULL , qid = 0 ;
+
+
+/*--- Function definitions ---*/
+
+void  hgfree ( void ) ;
+void  hgopen ( const mxArray ** ) ;
+void  hgrgn ( const mxArray ** ) ;
+void  hgvis ( const mxArray ** ) ;
+void  hgqry ( mxArray ** , const mxArray ** ) ;
+void  hgbuild ( void ) ;
+ int  chkregion ( const mxArray * ) ;
+ int  prepregion ( const mxArray * , int , struct hreg ** ) ;
+void *  hgalloc ( size_t ) ;
+
+
+/*** hitgrid function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  /* Required number of inputs , and maximum number of outputs */
+  int  nin , nout = 0 ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:hitgrid:fun"  ,
+      "hitgrid arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:hitgrid:fun"  ,
+      "hitgrid arg fun must be a single char"  ) ;
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:  nin = NRHS_OPEN ;  break ;
+    case  FUN_RGN:   nin = NRHS_RGN  ;  break ;
+    case  FUN_VIS:   nin = NRHS_VIS  ;  break ;
+    case  FUN_QRY:   nin = NRHS_QRY  ;  nout = NLHS_QRY ;  break ;
+    
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:hitgrid:fun"  ,
+        "hitgrid arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  }
+  
+  if  ( nrhs  !=  nin )
+    
+    mexErrMsgIdAndTxt (  "MET:hitgrid:fun"  ,
+      "hitgrid '%c' requires %d input arguments in total"  ,  c[ 0 ]  ,
+        nin  ) ;
+  
+  else if  ( nout  <  nlhs )
+    
+    mexErrMsgIdAndTxt (  "MET:hitgrid:fun"  ,
+      "hitgrid '%c' provides at most %d output arguments"  ,  c[ 0 ]  ,
+        nout  ) ;
+  
+  else if  ( !gon  &&  ( c[ 0 ] == FUN_VIS  ||  c[ 0 ] == FUN_QRY ) )
+    
+    mexErrMsgIdAndTxt (  "MET:hitgrid:fun"  ,
+      "hitgrid must be opened with 'o' before '%c'"  ,  c[ 0 ]  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:  hgopen ( prhs + 1 ) ;  break ;
+    case  FUN_RGN:   if  ( gon )  hgrgn ( prhs + 1 ) ;  break ;
+    case  FUN_VIS:   hgvis ( prhs + 1 ) ;  break ;
+    case  FUN_QRY:   hgqry ( plhs , prhs + 1 ) ;  break ;
+  }
+
+
+} /* hitgrid */
+
+
+/*---Subroutines---*/
+
+/* malloc that raises a Matlab error on failure. n may be zero. */
+void *  hgalloc ( size_t  n )
+{
+  
+  void *  p = malloc ( n ? n : 1 ) ;
+  
+  if  ( p  ==  NULL )
+    mexErrMsgIdAndTxt (  "MET:hitgrid:malloc"  ,
+      "hitgrid: out of memory"  ) ;
+  
+  return  p ;
+
+} /* hgalloc */
+
+
+/* Release all memory , also run at exit */
+void  hgfree ( void )
+{
+  
+  int  i ;
+  
+  for  ( i = 0  ;  i < nlnk  ;  i++ )  free ( lreg[ i ] ) ;
+  for  ( i = 0  ;  i < nstm  ;  i++ )  free ( slnk[ i ] ) ;
+  
+  free ( lreg ) ;  free ( lnr ) ;
+  free ( slnk ) ;  free ( snl ) ;
+  free ( vis  ) ;
+  free ( gst  ) ;  free ( gid ) ;  free ( greg ) ;
+  free ( stl  ) ;  free ( stb ) ;
+  
+  lreg = NULL ;  lnr = NULL ;  slnk = NULL ;  snl = NULL ;  vis = NULL ;
+  gst = NULL ;  gid = NULL ;  greg = NULL ;  stl = NULL ;  stb = NULL ;
+  
+  nlnk = nstm = nvis = gn = 0 ;
+  qid = 0 ;
+  gon = 0 ;
+
+} /* hgfree */
+
+
+/* Returns non-zero if m is not a valid hit region matrix , empty or NULL
+   is valid */
+int  chkregion ( const mxArray *  m )
+{
+  
+  if  ( m  ==  NULL )  return  0 ;
+  if  ( !mxIsDouble ( m )  ||  mxIsComplex ( m ) )  return  1 ;
+  if  ( mxIsEmpty ( m ) )  return  0 ;
+  
+  return  mxGetNumberOfDimensions ( m ) != 2  ||
+    ( mxGetN ( m ) != RECT_NCOL  &&  mxGetN ( m ) != CIRC_NCOL ) ;
+
+} /* chkregion */
+
+
+/* Converts hit region matrix m of stimulus link l into an array of struct
+   hreg at *r , skipping ignored regions. Returns the number kept. */
+int  prepregion ( const mxArray *  m , int  l , struct hreg **  r )
+{
+  
+  /* Counters , number of rows , and number kept */
+  size_t  i , N ;
+  int  n = 0 ;
+  
+  /* Hit region columns , and the region being made */
+  const double *  h ;
+  struct hreg *  g ;
+  
+  /* Half extents of rotated rectangle's bounding box */
+  double  ex , ey ;
+  
+  
+  N = m == NULL  ||  mxIsEmpty ( m )  ?  0  :  mxGetM ( m ) ;
+  h = N  ?  mxGetPr ( m )  :  NULL ;
+  *r = hgalloc ( N * sizeof ( struct hreg ) ) ;
+  
+  for  ( i = 0  ;  i < N  ;  i++ )
+  {
+    
+    g = *r + n ;
+    g->lnk = l ;
+    
+    /* Rectangle */
+    if  ( mxGetN ( m )  ==  RECT_NCOL )
+    {
+      if  ( !h[ RECT_IGN * N + i ] )  continue ;
+      
+      g->rect = 1 ;
+      g->x  = h[ RECT_X * N + i ] ;
+      g->y  = h[ RECT_Y * N + i ] ;
+      g->c  = cos ( h[ RECT_ROT * N + i ]  *  DEG2RAD ) ;
+      g->s  = sin ( h[ RECT_ROT * N + i ]  *  DEG2RAD ) ;
+      g->hw = h[ RECT_W * N + i ]  /  2.0 ;
+      g->hh = h[ RECT_H * N + i ]  /  2.0 ;
+      
+      ex = fabs ( g->hw * g->c )  +  fabs ( g->hh * g->s ) ;
+      ey = fabs ( g->hw * g->s )  +  fabs ( g->hh * g->c ) ;
+    }
+    
+    /* Circle */
+    else
+    {
+      if  ( !h[ CIRC_IGN * N + i ] )  continue ;
+      
+      g->rect = 0 ;
+      g->x  = h[ CIRC_X * N + i ] ;
+      g->y  = h[ CIRC_Y * N + i ] ;
+      g->hw = h[ CIRC_R * N + i ]  *  h[ CIRC_R * N + i ] ;
+      
+      ex = ey = fabs ( h[ CIRC_R * N + i ] ) ;
+    }
+    
+    g->bb[ BB_MNX ] = g->x - ex ;  g->bb[ BB_MXX ] = g->x + ex ;
+    g->bb[ BB_MNY ] = g->y - ey ;  g->bb[ BB_MXY ] = g->y + ey ;
+    
+    /* A region that is not finite can never be hit */
+    if  ( isfinite ( g->bb[ BB_MNX ] )  &&  isfinite ( g->bb[ BB_MXX ] )  &&
+          isfinite ( g->bb[ BB_MNY ] )  &&  isfinite ( g->bb[ BB_MXY ] ) )
+      n++ ;
+  
+  } /* rows */
+  
+  return  n ;
+
+} /* prepregion */
+
+
+/* Bin all kept hit regions into a new grid */
+void  hgbuild ( void )
+{
+  
+  /* Counters , cell index ranges , total number of hit regions , and
+     total number of hit regions over all cells */
+  int  i , j , k , l , x0 , x1 , y0 , y1 , R = 0 , T = 0 ;
+  
+  
+  free ( gst ) ;  free ( gid ) ;  free ( greg ) ;
+  
+  for  ( l = 0  ;  l < nlnk  ;  l++ )  R += lnr[ l ] ;
+  
+  /* Flatten hit regions , and find their bounding box */
+  greg = hgalloc ( R * sizeof ( struct hreg ) ) ;
+  
+  gbb[ BB_MNX ] = gbb[ BB_MNY ] = +INFINITY ;
+  gbb[ BB_MXX ] = gbb[ BB_MXY ] = -INFINITY ;
+  
+  for  ( k = l = 0  ;  l < nlnk  ;  l++ )
+    for  ( i = 0  ;  i < lnr[ l ]  ;  i++ , k++ )
+    {
+      greg[ k ] = lreg[ l ][ i ] ;
+      
+      gbb[ BB_MNX ] = fmin ( gbb[ BB_MNX ] , greg[ k ].bb[ BB_MNX ] ) ;
+      gbb[ BB_MXX ] = fmax ( gbb[ BB_MXX ] , greg[ k ].bb[ BB_MXX ] ) ;
+      gbb[ BB_MNY ] = fmin ( gbb[ BB_MNY ] , greg[ k ].bb[ BB_MNY ] ) ;
+      gbb[ BB_MXY ] = fmax ( gbb[ BB_MXY ] , greg[ k ].bb[ BB_MXY ] ) ;
+    }
+  
+  /* Roughly one hit region per cell , if they were spread evenly */
+  gn = ( int ) ceil ( sqrt ( ( double ) R ) ) ;
+  if  ( gn  <  1  )  gn = 1 ;
+  if  ( GRIDMAX  <  gn )  gn = GRIDMAX ;
+  
+  gdx = ( gbb[ BB_MXX ] - gbb[ BB_MNX ] )  /  gn ;
+  gdy = ( gbb[ BB_MXY ] - gbb[ BB_MNY ] )  /  gn ;
+  if  ( !( 0 < gdx ) )  gdx = 1 ;
+  if  ( !( 0 < gdy ) )  gdy = 1 ;
+  
+  /* Count hit regions per cell , then fill cells in the same order */
+  gst = hgalloc ( ( gn * gn + 1 ) * sizeof ( int ) ) ;
+  memset ( gst , 0 , ( gn * gn + 1 ) * sizeof ( int ) ) ;
+  
+  for  ( l = 0  ;  l < 2  ;  l++ )
+  {
+    
+    /* Cumulative counts give the end of each cell , filling moves them
+       back to its start */
+    if  ( l )
+    {
+      for  ( i = 1  ;  i <= gn * gn  ;  i++ )  gst[ i ] += gst[ i - 1 ] ;
+      T = gst[ gn * gn ] ;
+      gid = hgalloc ( T * sizeof ( int ) ) ;
+    }
+    
+    for  ( k = 0  ;  k < R  ;  k++ )
+    {
+      x0 = ( int ) ( ( greg[ k ].bb[ BB_MNX ] - gbb[ BB_MNX ] ) / gdx ) ;
+      x1 = ( int ) ( ( greg[ k ].bb[ BB_MXX ] - gbb[ BB_MNX ] ) / gdx ) ;
+      y0 = ( int ) ( ( greg[ k ].bb[ BB_MNY ] - gbb[ BB_MNY ] ) / gdy ) ;
+      y1 = ( int ) ( ( greg[ k ].bb[ BB_MXY ] - gbb[ BB_MNY ] ) / gdy ) ;
+      if  ( gn  <=  x1 )  x1 = gn - 1 ;
+      if  ( gn  <=  y1 )  y1 = gn - 1 ;
+      
+      for  ( j = y0  ;  j <= y1  ;  j++ )
+        for  ( i = x0  ;  i <= x1  ;  i++ )
+          if  ( l )  gid[ --gst[ j * gn + i + 1 ] ] = k ;
+          else       gst[ j * gn + i + 1 ]++ ;
+    }
+  
+  } /* count and fill */
+  
+  /* Filling left the start of each cell one place up , shift down */
+  for  ( i = 0  ;  i < gn * gn  ;  i++ )  gst[ i ] = gst[ i + 1 ] ;
+  gst[ gn * gn ] = T ;
+
+} /* hgbuild */
+
+
+/* Open a new trial from m , lnkind and hitregion */
+void  hgopen ( const mxArray *  m[] )
+{
+  
+  /* Counters , number of task stimuli and links */
+  int  i , j , n , S , L ;
+  
+  /* Link indices of one stimulus */
+  const mxArray *  a ;
+  const double *  d ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( !mxIsCell ( m[ 0 ] )  ||  !mxIsCell ( m[ 1 ] ) )
+    mexErrMsgIdAndTxt (  "MET:hitgrid:open"  ,
+      "hitgrid 'o' , lnkind and hitregion must be cell arrays"  ) ;
+  
+  S = mxGetNumberOfElements ( m[ 0 ] ) ;
+  L = mxGetNumberOfElements ( m[ 1 ] ) ;
+  
+  for  ( i = 0  ;  i < L  ;  i++ )
+    if  ( chkregion ( mxGetCell ( m[ 1 ] , i ) ) )
+      mexErrMsgIdAndTxt (  "MET:hitgrid:open"  ,
+        "hitgrid 'o' , hitregion{ %d } must be empty , or a real N x %d "
+        "or N x %d double"  ,  i + 1  ,  CIRC_NCOL  ,  RECT_NCOL  ) ;
+  
+  for  ( i = 0  ;  i < S  ;  i++ )
+  {
+    a = mxGetCell ( m[ 0 ] , i ) ;
+    
+    if  ( a  ==  NULL )  continue ;
+    
+    if  ( !mxIsDouble ( a )  ||  mxIsComplex ( a ) )
+      mexErrMsgIdAndTxt (  "MET:hitgrid:open"  ,
+        "hitgrid 'o' , lnkind{ %d } must be a real double"  ,  i + 1  ) ;
+    
+    d = mxGetPr ( a ) ;
+    
+    for  ( j = 0  ;  j < ( int ) mxGetNumberOfElements ( a )  ;  j++ )
+      if  ( d[ j ] != ( int ) d[ j ]  ||  d[ j ] < 1  ||  L < d[ j ] )
+        mexErrMsgIdAndTxt (  "MET:hitgrid:open"  ,
+          "hitgrid 'o' , lnkind{ %d } must index hitregion"  ,  i + 1  ) ;
+  }
+  
+  
+  /*-- New trial --*/
+  
+  hgfree ( ) ;
+  mexAtExit ( hgfree ) ;
+  
+  /* Task stimuli */
+  nstm = S ;
+  slnk = hgalloc ( S * sizeof ( int * ) ) ;
+  snl  = hgalloc ( S * sizeof ( int ) ) ;
+  memset ( slnk , 0 , S * sizeof ( int * ) ) ;
+  
+  for  ( i = 0  ;  i < S  ;  i++ )
+  {
+    a = mxGetCell ( m[ 0 ] , i ) ;
+    n = a  ?  mxGetNumberOfElements ( a )  :  0 ;
+    
+    slnk[ i ] = hgalloc ( n * sizeof ( int ) ) ;
+    snl[ i ] = n ;
+    
+    for  ( j = 0  ;  j < n  ;  j++ )
+      slnk[ i ][ j ] = ( int ) mxGetPr ( a )[ j ]  -  1 ;
+  }
+  
+  /* Stimulus links , and their query stamps */
+  nlnk = L ;
+  lreg = hgalloc ( L * sizeof ( struct hreg * ) ) ;
+  lnr  = hgalloc ( L * sizeof ( int ) ) ;
+  stl  = hgalloc ( L * sizeof ( unsigned int ) ) ;
+  stb  = hgalloc ( L * sizeof ( unsigned int ) ) ;
+  memset ( lreg , 0 , L * sizeof ( struct hreg * ) ) ;
+  memset ( lnr  , 0 , L * sizeof ( int ) ) ;
+  memset ( stl  , 0 , L * sizeof ( unsigned int ) ) ;
+  memset ( stb  , 0 , L * sizeof ( unsigned int ) ) ;
+  
+  for  ( i = 0  ;  i < L  ;  i++ )
+    lnr[ i ] = prepregion ( mxGetCell ( m[ 1 ] , i ) , i , lreg + i ) ;
+  
+  hgbuild ( ) ;
+  gon = 1 ;
+
+} /* hgopen */
+
+
+/* Replace hit regions of links m[ 0 ] with m[ 1 ] */
+void  hgrgn ( const mxArray *  m[] )
+{
+  
+  /* Counters */
+  int  i , j ;
+  
+  /* Logical index */
+  const mxLogical *  I ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( !mxIsLogical ( m[ 0 ] )  ||
+        ( int ) mxGetNumberOfElements ( m[ 0 ] )  !=  nlnk )
+    mexErrMsgIdAndTxt (  "MET:hitgrid:rgn"  ,
+      "hitgrid 'r' , I must be logical with %d elements"  ,  nlnk  ) ;
+  
+  I = mxGetLogicals ( m[ 0 ] ) ;
+  
+  for  ( i = j = 0  ;  i < nlnk  ;  i++ )  j += I[ i ] != 0 ;
+  
+  if  ( !mxIsCell ( m[ 1 ] )  ||
+        ( int ) mxGetNumberOfElements ( m[ 1 ] )  !=  j )
+    mexErrMsgIdAndTxt (  "MET:hitgrid:rgn"  ,
+      "hitgrid 'r' , H must be a cell array with %d elements"  ,  j  ) ;
+  
+  for  ( i = 0  ;  i < j  ;  i++ )
+    if  ( chkregion ( mxGetCell ( m[ 1 ] , i ) ) )
+      mexErrMsgIdAndTxt (  "MET:hitgrid:rgn"  ,
+        "hitgrid 'r' , H{ %d } must be empty , or a real N x %d "
+        "or N x %d double"  ,  i + 1  ,  CIRC_NCOL  ,  RECT_NCOL  ) ;
+  
+  
+  /*-- Replace and rebuild --*/
+  
+  for  ( i = j = 0  ;  i < nlnk  ;  i++ )
+  {
+    if  ( !I[ i ] )  continue ;
+    
+    free ( lreg[ i ] ) ;
+    lreg[ i ] = NULL ;
+    lnr[ i ] = prepregion ( mxGetCell ( m[ 1 ] , j++ ) , i , lreg + i ) ;
+  }
+  
+  hgbuild ( ) ;
+
+} /* hgrgn */
+
+
+/* Set visible task stimuli from m[ 0 ] */
+void  hgvis ( const mxArray *  m[] )
+{
+  
+  /* Counter , number of stimuli , and indices */
+  int  i , n ;
+  const double *  d ;
+  
+  
+  if  ( !mxIsDouble ( m[ 0 ] )  ||  mxIsComplex ( m[ 0 ] ) )
+    mexErrMsgIdAndTxt (  "MET:hitgrid:vis"  ,
+      "hitgrid 'v' , istim must be a real double"  ) ;
+  
+  n = mxGetNumberOfElements ( m[ 0 ] ) ;
+  d = mxGetPr ( m[ 0 ] ) ;
+  
+  for  ( i = 0  ;  i < n  ;  i++ )
+    if  ( d[ i ] != ( int ) d[ i ]  ||  d[ i ] < 1  ||  nstm < d[ i ] )
+      mexErrMsgIdAndTxt (  "MET:hitgrid:vis"  ,
+        "hitgrid 'v' , istim must index lnkind"  ) ;
+  
+  free ( vis ) ;
+  vis = hgalloc ( n * sizeof ( int ) ) ;
+  nvis = n ;
+  
+  for  ( i = 0  ;  i < n  ;  i++ )  vis[ i ] = ( int ) d[ i ]  -  1 ;
+
+} /* hgvis */
+
+
+/* Stamp each link with a hit region that contains point ( x , y ) with s.
+   Only links already stamped with p are stamped , if p is not NULL. */
+static inline void  hgpoint ( double  x , double  y , unsigned int *  p ,
+                              unsigned int *  s )
+{
+  
+  /* Cell , hit region index , and point in rectangle's frame */
+  int  c , k ;
+  const struct hreg *  g ;
+  double  u , w ;
+  
+  
+  /* Outside of the grid , or NaN */
+  if  ( !( gbb[ BB_MNX ] <= x  &&  x <= gbb[ BB_MXX ]  &&
+           gbb[ BB_MNY ] <= y  &&  y <= gbb[ BB_MXY ] ) )
+    return ;
+  
+  c = ( int ) ( ( x - gbb[ BB_MNX ] ) / gdx ) ;
+  k = ( int ) ( ( y - gbb[ BB_MNY ] ) / gdy ) ;
+  if  ( gn  <=  c )  c = gn - 1 ;
+  if  ( gn  <=  k )  k = gn - 1 ;
+  c += k * gn ;
+  
+  for  ( k = gst[ c ]  ;  k < gst[ c + 1 ]  ;  k++ )
+  {
+    
+    g = greg  +  gid[ k ] ;
+    
+    if  ( s[ g->lnk ] == qid  ||  ( p  &&  p[ g->lnk ] != qid ) )
+      continue ;
+    
+    u = x - g->x ;
+    w = y - g->y ;
+    
+    /* Rotate point counter-clockwise into the rectangle's frame */
+    if  ( g->rect )
+    {
+      if  ( fabs ( u * g->c  -  w * g->s )  <=  g->hw  &&
+            fabs ( u * g->s  +  w * g->c )  <=  g->hh )
+        s[ g->lnk ] = qid ;
+    }
+    
+    else if  ( u * u  +  w * w  <=  g->hw )
+      s[ g->lnk ] = qid ;
+  
+  } /* hit regions in cell */
+
+} /* hgpoint */
+
+
+/* Query points x = m[ 0 ] and y = m[ 1 ] */
+void  hgqry ( mxArray *  plhs[] , const mxArray *  m[] )
+{
+  
+  /* Counters , number of points per row , and number of rows */
+  size_t  i , N ;
+  int  j , k , P ;
+  
+  /* Inputs and output */
+  const double  * x , * y ;
+  double *  r ;
+  
+  /* Stamps of links hit by all points */
+  const unsigned int *  h ;
+  
+  
+  /*-- Check input --*/
+  
+  for  ( j = 0  ;  j < 2  ;  j++ )
+    if  ( !mxIsDouble ( m[ j ] )  ||  mxIsComplex ( m[ j ] )  ||
+          mxGetNumberOfDimensions ( m[ j ] ) != 2  ||
+          ( mxGetN ( m[ j ] ) != 1  &&  mxGetN ( m[ j ] ) != 2 )  ||
+          mxGetM ( m[ j ] ) != mxGetM ( m[ 0 ] )  ||
+          mxGetN ( m[ j ] ) != mxGetN ( m[ 0 ] ) )
+      mexErrMsgIdAndTxt (  "MET:hitgrid:qry"  ,
+        "hitgrid 'q' , x and y must be real N x 1 or N x 2 doubles of "
+        "the same size"  ) ;
+  
+  N = mxGetM ( m[ 0 ] ) ;
+  P = mxGetN ( m[ 0 ] ) ;
+  x = mxGetPr ( m[ 0 ] ) ;
+  y = mxGetPr ( m[ 1 ] ) ;
+  
+  plhs[ 0 ] = mxCreateDoubleMatrix ( N , 1 , mxREAL ) ;
+  r = mxGetPr ( plhs[ 0 ] ) ;
+  
+  h = P  ==  1  ?  stl  :  stb ;
+  
+  
+  /*-- Check each row --*/
+  
+  for  ( i = 0  ;  i < N  ;  i++ )
+  {
+    
+    /* New stamp , clear old ones when the counter wraps around */
+    if  ( !++qid )
+    {
+      memset ( stl , 0 , nlnk * sizeof ( unsigned int ) ) ;
+      memset ( stb , 0 , nlnk * sizeof ( unsigned int ) ) ;
+      qid = 1 ;
+    }
+    
+    hgpoint ( x[ i ] , y[ i ] , NULL , stl ) ;
+    
+    if  ( P  ==  2 )
+      hgpoint ( x[ N + i ] , y[ N + i ] , stl , stb ) ;
+    
+    /* First visible stimulus with a link that was hit */
+    for  ( j = 0  ;  j < nvis  &&  !r[ i ]  ;  j++ )
+      for  ( k = 0  ;  k < snl[ vis[ j ] ]  ;  k++ )
+        if  ( h[ slnk[ vis[ j ] ][ k ] ]  ==  qid )
+        {
+          r[ i ] = vis[ j ]  +  1 ;
+          break ;
+        }
+  
+  } /* rows */
+
+} /* hgqry */
+
@@ -0,0 +1,243 @@
+
+/*  eyefile.h
+  
+  File-replay backend for the eye-tracker ingest interface of eyein.h.
+  Replays recorded iViewX eye samples at their original timing , so that a
+  gaze-driven session can be reproduced offline at full rate.
+  
+  The file holds iViewX commands in the binocular ET_SPL format that
+  ivxudp asks for , one after another , as in a dump of the datagrams that
+  iViewX streams e.g.  nc -u -l 5555 > dump  while iViewX streams to the
+  MET host. ivxsim streams the same format. Any other command is skipped.
+  
+  The first sample is due as soon as the file is opened. Each following
+  sample is due when as much time has passed , divided by the replay
+  speed , as passed between its iViewX time stamp and the first. Samples
+  keep their recorded time stamps , while their local receive time is the
+  time at which they were due. A sample with an earlier time stamp than
+  the one before it is due immediately. Replay stops at the end of the
+  file.
+  
+  The whole file is read into memory when it is opened. There is no Matlab
+  dependency.
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+#ifndef  EYEFILE_H
+#define  EYEFILE_H
+
+
+/*--- Include block ---*/
+
+#include  <errno.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <time.h>
+
+#include  "eyein.h"
+#include  "ivxspl.h"
+
+
+/*--- Define block ---*/
+
+/* Data range of iViewX gaze positions , as in ivxudp */
+#define  EYEFILE_GMIN  4095.0
+#define  EYEFILE_GMAX  12287.0
+
+/* Microseconds per second , iViewX time stamps are in microseconds */
+#define  EYEFILE_USPERS  1000000.0
+
+
+/*--- Data types ---*/
+
+/* Replay state. Whole file in buf , parsing from c up to e. t0 is the
+   local time when replay began , tim0 the first time stamp , and spd the
+   replay speed. nxt is non-zero when p holds the next sample , which is
+   due at local time pt. */
+struct eyefile
+{
+  char *  buf ;
+  const char  * c , * e ;
+  double  t0 , tim0 , spd , pt ;
+  int  nxt ;
+  struct eyespl  p ;
+} ;
+
+
+/*--- Function definitions ---*/
+
+/* Local time in seconds , same clock as gettimeofday ( ) */
+static inline double  eyefile_now ( void )
+{
+  struct timespec  t ;
+  clock_gettime ( CLOCK_REALTIME , &t ) ;
+  return  t.tv_sec  +  t.tv_nsec / 1e9 ;
+}
+
+
+/* Parse the next sample of replay state f into f->p , raw , and set when
+   it is due. Returns f->nxt , which is 0 at the end of the file. */
+static int  eyefile_next ( struct eyein *  e , struct eyefile *  f )
+{
+  
+  /* iViewX sample values , and ET_SPL to eyein column mapping */
+  static const int  MAP[ EYEIN_NUMCOL ] = { 0 , 2 , 1 , 3 } ;
+  double  d[ IVXSPL_NUMVAL ] ;
+  const char *  c ;
+  size_t  bad = 0 ;
+  int  j ;
+  
+  c = ivxnext ( f->c , f->e , &bad ) ;
+  e->bad += bad ;
+  
+  if  ( c  ==  NULL )
+  {
+    f->c = f->e ;
+    return  f->nxt = 0 ;
+  }
+  
+  f->c = ivxvals ( c , f->e , d ) ;
+  
+  f->p.tim = d[ 0 ]  /  EYEFILE_USPERS ;
+  
+  for  ( j = 0  ;  j < EYEIN_NUMCOL  ;  j++ )
+  {
+    f->p.gaze[ j ] = d[ 1 + MAP[ j ] ] ;
+    f->p.diam[ j ] = d[ 5 + MAP[ j ] ] ;
+  }
+  
+  /* Due time , never before the last one */
+  if  ( !f->nxt )  f->tim0 = f->p.tim ;
+  
+  d[ 0 ] = f->t0  +  ( f->p.tim - f->tim0 ) / f->spd ;
+  if  ( !f->nxt  ||  f->pt < d[ 0 ] )  f->pt = d[ 0 ] ;
+  f->p.rtim = f->pt ;
+  
+  return  f->nxt = 1 ;
+
+} /* eyefile_next */
+
+
+/* eyein read , all samples that are due , up to n */
+static long  eyefile_read ( struct eyein *  e , struct eyespl *  v ,
+                            long  n )
+{
+  
+  struct eyefile *  f = e->st ;
+  double  t = eyefile_now ( ) ;
+  long  k = 0 ;
+  
+  while  ( k < n  &&  f->nxt  &&  f->pt <= t )
+  {
+    v[ k++ ] = f->p ;
+    eyefile_next ( e , f ) ;
+  }
+  
+  return  k ;
+
+} /* eyefile_read */
+
+
+/* eyein due , seconds until the next sample , or -1 after the last */
+static double  eyefile_due ( struct eyein *  e )
+{
+  
+  struct eyefile *  f = e->st ;
+  double  d ;
+  
+  if  ( !f->nxt )  return  -1 ;
+  
+  d = f->pt  -  eyefile_now ( ) ;
+  
+  return  d < 0  ?  0  :  d ;
+
+} /* eyefile_due */
+
+
+/* eyein close */
+static void  eyefile_close ( struct eyein *  e )
+{
+  
+  struct eyefile *  f = e->st ;
+  
+  if  ( f  ==  NULL )  return ;
+  
+  free ( f->buf ) ;
+  free ( f ) ;
+  e->st = NULL ;
+
+} /* eyefile_close */
+
+
+/* Open file name fn for replay at speed spd , where 1 is the original
+   timing , and fill in backend e. Returns 0 on success , or -1 with errno
+   set. */
+static int  eyefile_open ( struct eyein *  e , const char *  fn ,
+                           double  spd )
+{
+  
+  struct eyefile *  f ;
+  FILE *  fp ;
+  long  n ;
+  int  r ;
+  
+  if  ( !( 0 < spd ) )
+  {
+    errno = EINVAL ;
+    return  -1 ;
+  }
+  
+  if  ( ( f = calloc ( 1 , sizeof ( *f ) ) )  ==  NULL )
+    return  -1 ;
+  
+  /* Read whole file */
+  if  ( ( fp = fopen ( fn , "rb" ) )  ==  NULL )
+  {
+    free ( f ) ;
+    return  -1 ;
+  }
+  
+  if  ( fseek ( fp , 0 , SEEK_END )  ==  -1  ||
+        ( n = ftell ( fp ) )  ==  -1  ||
+        fseek ( fp , 0 , SEEK_SET )  ==  -1  ||
+        ( f->buf = malloc ( n + 1 ) )  ==  NULL  ||
+        fread ( f->buf , 1 , n , fp )  !=  ( size_t ) n )
+  {
+    r = errno ? errno : EIO ;
+    fclose ( fp ) ;
+    free ( f->buf ) ;
+    free ( f ) ;
+    errno = r ;
+    return  -1 ;
+  }
+  
+  fclose ( fp ) ;
+  f->buf[ n ] = '\0' ;
+  
+  /* Backend */
+  memset ( e , 0 , sizeof ( *e ) ) ;
+  e->name  = "file" ;
+  e->fd    = -1 ;
+  e->gmin  = EYEFILE_GMIN ;
+  e->gmax  = EYEFILE_GMAX ;
+  e->st    = f ;
+  e->read  = eyefile_read ;
+  e->due   = eyefile_due ;
+  e->close = eyefile_close ;
+  
+  /* Replay starts now */
+  f->c = f->buf ;
+  f->e = f->buf + n ;
+  f->spd = spd ;
+  f->t0 = eyefile_now ( ) ;
+  eyefile_next ( e , f ) ;
+  
+  return  0 ;
+
+} /* eyefile_open */
+
+
+#endif  /* EYEFILE_H */
+
@@ -0,0 +1,207 @@
+
+/*  eyein.h
+  
+  Eye-tracker ingest interface. An eye tracker is read through a backend ,
+  a struct eyein that says how to read a batch of samples , how long until
+  the next sample is due , and how to close it. Each backend has its own
+  open function , since every tracker needs different things to start
+  streaming. Samples come out of a backend as struct eyespl , with the
+  tracker's own time stamp and the local time that the sample was
+  received.
+  
+  Everything after the backend is shared. eyenorm ( ) clips and normalises
+  raw gaze positions to the screen , given the backend's data range.
+  struct eyering is a single-producer , single-consumer ring of samples
+  that lets one thread ingest samples while another takes them out.
+  eyecal ( ) is the calibration stage that converts normalised gaze to
+  degrees of visual field from the centre of the screen , as metdaqeye
+  does.
+  
+  Backends:
+    
+    ivxudp.c  - SMI iViewX UDP stream , see ivxudp 'o'.
+    eyefile.h - Replay of recorded iViewX samples at their original timing ,
+                see ivxudp 'f'.
+  
+  There is no Matlab dependency.
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+#ifndef  EYEIN_H
+#define  EYEIN_H
+
+
+/*--- Include block ---*/
+
+#include  <stdint.h>
+#include  <string.h>
+
+
+/*--- Define block ---*/
+
+/* Number of samples in a ring , a power of two */
+#define  EYEIN_RINGN  16384
+
+/* Cache line size in bytes , to keep ring head and tail apart */
+#define  EYEIN_CACHLN  64
+
+/* Gaze and pupil diameter column order , left x , left y , right x , right
+   y */
+#define  EYEIN_XL  0
+#define  EYEIN_YL  1
+#define  EYEIN_XR  2
+#define  EYEIN_YR  3
+#define  EYEIN_NUMCOL  4
+
+
+/*--- Data types ---*/
+
+/* One binocular eye sample. tim is the tracker's time stamp and rtim the
+   local time at which the sample was received , both in seconds ; rtim is
+   on the same clock as gettimeofday ( ). Gaze positions and pupil
+   diameters are in EYEIN_XL to EYEIN_YR column order. After eyenorm ( ) ,
+   gaze is from 0 to 1 , where ( 0 , 0 ) is the top-left corner of the
+   screen. */
+struct eyespl
+{
+  double  tim ;
+  double  rtim ;
+  double  gaze[ EYEIN_NUMCOL ] ;
+  double  diam[ EYEIN_NUMCOL ] ;
+} ;
+
+/* Ingest backend. fd is a file descriptor that becomes readable when
+   samples arrive , or -1 if the backend is driven by time alone. gmin and
+   gmax are the raw gaze values at the edges of the screen. bad is the
+   running count of invalid samples that the backend skipped. st holds the
+   backend's own state. Functions are:
+     
+     read  - Non-blocking. Puts up to n new samples into v and returns the
+             number , which is 0 if none are waiting. Gaze is raw. Returns
+             -1 on error , with errno set. Samples beyond n are kept for
+             the next call.
+     due   - Seconds until the next sample is due , or a negative value if
+             that is unknown , in which case wait on fd. May be NULL.
+     close - Releases everything that open took. May be NULL if the
+             owner of the backend releases it. */
+struct eyein
+{
+  const char *  name ;
+  int  fd ;
+  double  gmin , gmax ;
+  uint64_t  bad ;
+  void *  st ;
+  long    ( * read  ) ( struct eyein * , struct eyespl * , long ) ;
+  double  ( * due   ) ( struct eyein * ) ;
+  void    ( * close ) ( struct eyein * ) ;
+} ;
+
+/* Sample ring. The producer advances hd , the consumer advances tl. Both
+   only ever increase ; the slot of count c is c & ( EYEIN_RINGN - 1 ). */
+struct eyering
+{
+  struct eyespl  s[ EYEIN_RINGN ] ;
+  uint64_t  hd __attribute__ ( ( aligned ( EYEIN_CACHLN ) ) ) ;
+  uint64_t  tl __attribute__ ( ( aligned ( EYEIN_CACHLN ) ) ) ;
+} ;
+
+/* Calibration. Screen width and height in degrees of visual field ,
+   height is negative if y increases upwards. swp is non-zero to take the
+   left eye as the right , and vice versa. */
+struct eyecal
+{
+  double  wid , hei ;
+  int  swp ;
+} ;
+
+
+/*--- Function definitions ---*/
+
+/* Clip gaze of sample p to the backend's data range , then normalise it
+   from 0 to 1 */
+static inline void  eyenorm ( const struct eyein *  e , struct eyespl *  p )
+{
+  
+  int  j ;
+  double  r = e->gmax - e->gmin ;
+  
+  for  ( j = 0  ;  j < EYEIN_NUMCOL  ;  j++ )
+  {
+    if       ( p->gaze[ j ]  <  e->gmin )  p->gaze[ j ] = e->gmin ;
+    else if  ( p->gaze[ j ]  >  e->gmax )  p->gaze[ j ] = e->gmax ;
+    
+    p->gaze[ j ] = ( p->gaze[ j ]  -  e->gmin )  /  r ;
+  }
+
+} /* eyenorm */
+
+
+/* Convert normalised sample p to degrees of visual field from the centre
+   of the screen , in place , swapping eyes if asked */
+static inline void  eyecal ( const struct eyecal *  c , struct eyespl *  p )
+{
+  
+  struct eyespl  q = *p ;
+  int  j , k ;
+  
+  for  ( j = 0  ;  j < EYEIN_NUMCOL  ;  j++ )
+  {
+    
+    /* Source column , left x and y swap with right x and y */
+    k = c->swp  ?  ( j + 2 ) % EYEIN_NUMCOL  :  j ;
+    
+    p->gaze[ j ] = ( q.gaze[ k ] - 0.5 ) * ( j % 2  ?  c->hei  :  c->wid ) ;
+    p->diam[ j ] = q.diam[ k ] ;
+  
+  }
+
+} /* eyecal */
+
+
+/* Empty ring r. Only while neither end is in use. */
+static inline void  eyering_init ( struct eyering *  r )
+{
+  r->hd = r->tl = 0 ;
+}
+
+
+/* Producer , copy sample p into ring r. Returns 0 if the ring is full and
+   p was not copied , 1 otherwise. */
+static inline int  eyering_push ( struct eyering *  r ,
+                                  const struct eyespl *  p )
+{
+  
+  uint64_t  h = r->hd ;
+  
+  if  ( EYEIN_RINGN  <=  h - __atomic_load_n ( &r->tl , __ATOMIC_ACQUIRE ) )
+    return  0 ;
+  
+  r->s[ h & ( EYEIN_RINGN - 1 ) ] = *p ;
+  __atomic_store_n ( &r->hd , h + 1 , __ATOMIC_RELEASE ) ;
+  
+  return  1 ;
+
+} /* eyering_push */
+
+
+/* Consumer , number of samples waiting in ring r. *t is set to the count
+   of the oldest one ; sample i of n is then r->s[ ( *t + i ) & (
+   EYEIN_RINGN - 1 ) ]. Call eyering_pop ( ) when done with them. */
+static inline uint64_t  eyering_peek ( struct eyering *  r , uint64_t *  t )
+{
+  *t = r->tl ;
+  return  __atomic_load_n ( &r->hd , __ATOMIC_ACQUIRE )  -  *t ;
+}
+
+
+/* Consumer , release n samples from the tail of ring r */
+static inline void  eyering_pop ( struct eyering *  r , uint64_t  n )
+{
+  __atomic_store_n ( &r->tl , r->tl + n , __ATOMIC_RELEASE ) ;
+}
+
+
+#endif  /* EYEIN_H */
+
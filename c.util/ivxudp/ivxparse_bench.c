@@ -0,0 +1,342 @@
+/*  ivxparse_bench.c
+  
+  ivxparse_bench  [ N | dump ... ]
+  
+  Matlab Electrophysiology Toolbox utility benchmark. Measures how quickly
+  ivxudp can parse a receive buffer of iViewX ET_SPL eye samples. Two
+  parsers are compared:
+    
+    original    - The original two-pass parse. Every byte is compared
+                  against the sample command to find and count samples ,
+                  then each value is converted by strtod ( ).
+    single-pass - The single-pass tokeniser of ivxspl.h that ivxudp now uses.
+  
+  If the first argument is a number then N synthetic binocular samples are
+  generated , in the same format that iViewX streams. Otherwise , each
+  argument names a dump file of recorded datagrams , for example the output
+  of  nc -u -l 5555 > dump  while iViewX streams to the MET host. Because
+  every iViewX command ends with a newline , datagrams are simply
+  concatenated in a dump file. Each file is read in turn , and processed in
+  chunks of up to RECBUF bytes that end at a command terminator , just as
+  ivxudp would see them.
+  
+  Each parser runs over the whole buffer NREP times. The best throughput in
+  MB/s and samples/s is reported. The values returned by both parsers are
+  then compared , and any difference is reported ; ivxparse_bench returns
+  a failure if there are any.
+  
+  Default N is 100000.
+  
+  Build with:  gcc -O2 -o ivxparse_bench ivxparse_bench.c
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+
+/* ET_SPL tokeniser */
+#include  "ivxspl.h"
+
+
+/*--- Define block ---*/
+
+/* System error and exit */
+#define  PEX( s )  { perror ( s ) ; exit ( EXIT_FAILURE ) ; }
+
+/* Default number of synthetic samples */
+#define  DEFNUM  100000
+
+/* Repetitions per parser */
+#define  NREP  10
+
+/* Same receive buffer size as ivxudp */
+#define  RECBUF  524288
+
+/* Largest synthetic sample string */
+#define  SPLBUF  128
+
+
+/*--- Global variables ---*/
+
+/* Whole input , and its size in bytes */
+static char *  inp = NULL ;
+static size_t  inb = 0 ;
+
+/* Parsed values , one row of IVXSPL_NUMVAL per sample , for each parser ,
+   and the number of values allocated */
+static double  * vo = NULL , * vs = NULL ;
+static size_t  vn = 0 ;
+
+
+/*--- Subroutines ---*/
+
+/* Time difference in seconds */
+static double  tdiff ( struct timespec *  a , struct timespec *  b )
+{
+  return  ( b->tv_sec - a->tv_sec )  +  ( b->tv_nsec - a->tv_nsec ) / 1e9 ;
+}
+
+
+/* Append n bytes from c to the input */
+static void  append ( const char *  c , size_t  n )
+{
+  
+  static size_t  cap = 0 ;
+  
+  if  ( cap  <  inb + n + 1 )
+  {
+    cap = 2 * ( inb + n + 1 ) ;
+    if  ( ( inp = realloc ( inp , cap ) )  ==  NULL )
+      PEX ( "ivxparse_bench:realloc" )
+  }
+  
+  memcpy ( inp + inb , c , n ) ;
+  inb += n ;
+  inp[ inb ] = '\0' ;
+
+} /* append */
+
+
+/* Generate N synthetic binocular samples at 500Hz , with gaze in pixels
+   and pupil diameters like those from a real iViewX */
+static void  synth ( long  N )
+{
+  
+  char  s[ SPLBUF ] ;
+  long  i ;
+  int  n ;
+  
+  srand ( 1 ) ;
+  
+  for  ( i = 0  ;  i < N  ;  i++ )
+  {
+    n = snprintf ( s , SPLBUF ,
+      "ET_SPL b %ld %d %d %d %d %.2f %.2f %.2f %.2f\n" ,
+      1000000000L + 2000L * i ,
+      rand ( ) % 1920 , rand ( ) % 1920 , rand ( ) % 1080 ,
+      rand ( ) % 1080 , 10 + rand ( ) % 3000 / 100.0 ,
+      10 + rand ( ) % 3000 / 100.0 , 10 + rand ( ) % 3000 / 100.0 ,
+      10 + rand ( ) % 3000 / 100.0 ) ;
+    append ( s , n ) ;
+  }
+
+} /* synth */
+
+
+/* Read a dump file onto the end of the input */
+static void  readdump ( const char *  f )
+{
+  
+  char  b[ 65536 ] ;
+  size_t  n ;
+  FILE *  fp ;
+  
+  if  ( ( fp = fopen ( f , "rb" ) )  ==  NULL )
+    PEX ( f )
+  
+  while  ( ( n = fread ( b , 1 , sizeof ( b ) , fp ) )  >  0 )
+    append ( b , n ) ;
+  
+  if  ( ferror ( fp ) )
+    PEX ( f )
+  
+  fclose ( fp ) ;
+
+} /* readdump */
+
+
+/* Original parse , as ivxudp did it. Returns the number of samples , and
+   stores values in v */
+static size_t  parseorig ( char *  c , size_t  n , double *  v )
+{
+  
+  /* Scanning pointers , sample pointers , sample count */
+  char  * ci = c , * cj = c + n ,  ** p ;
+  size_t  i , j , N = 0 ;
+  
+  if  ( ( p = malloc ( ( n / IVXSPL_MINLEN + 1 ) * sizeof ( char * ) ) )
+        ==  NULL )
+    PEX ( "ivxparse_bench:malloc" )
+  
+  /* Locate and count samples , one byte at a time */
+  while  ( ci  <  cj )
+  {
+    if  ( ci[ 0 ] != IVXSPL_CMD[ 0 ]  ||  ci[ 1 ] != IVXSPL_CMD[ 1 ]  ||
+          ci[ 2 ] != IVXSPL_CMD[ 2 ]  ||  ci[ 3 ] != IVXSPL_CMD[ 3 ]  ||
+          ci[ 4 ] != IVXSPL_CMD[ 4 ]  ||  ci[ 5 ] != IVXSPL_CMD[ 5 ] )
+    {
+      ci++ ;
+      continue ;
+    }
+    
+    ci += IVXSPL_CMN ;
+    while  ( *ci  ==  IVXSPL_SEP )  ci++ ;
+    if  ( *( ci++ )  !=  IVXSPL_BIN )  continue ;
+    while  ( *ci  ==  IVXSPL_SEP )  ci++ ;
+    if  ( *ci == IVXSPL_TRM  ||  *ci == IVXSPL_TR2 )  {  ci++ ;  continue ;  }
+    
+    p[ N++ ] = ci ;
+    
+    while  ( *ci != IVXSPL_TRM  &&  *ci != IVXSPL_TR2 )  ci++ ;
+  }
+  
+  /* Convert values */
+  for  ( i = 0  ;  i < N  ;  i++ )
+    for  ( ci = p[ i ] , j = 0  ;  j < IVXSPL_NUMVAL  ;  j++ )
+      v[ i * IVXSPL_NUMVAL + j ] = strtod ( ci , &ci ) ;
+  
+  free ( p ) ;
+  return  N ;
+
+} /* parseorig */
+
+
+/* Single-pass parse. Returns the number of samples , and stores values in
+   v */
+static size_t  parsespl ( char *  c , size_t  n , double *  v )
+{
+  
+  const char  * ci = c , * ce = c + n ;
+  size_t  N = 0 , bad = 0 ;
+  
+  while  ( ( ci = ivxnext ( ci , ce , &bad ) )  !=  NULL )
+    ci = ivxvals ( ci , ce , v + IVXSPL_NUMVAL * N++ ) ;
+  
+  return  N ;
+
+} /* parsespl */
+
+
+/* Run parser f over the input in receive-buffer sized chunks , storing
+   all values in v. Returns the number of samples. */
+static size_t  runall ( size_t ( *f ) ( char * , size_t , double * ) ,
+                        double *  v )
+{
+  
+  size_t  i = 0 , n , N = 0 ;
+  char  t ;
+  
+  while  ( i  <  inb )
+  {
+    
+    /* Chunk ends after the last terminator that fits */
+    n = inb - i  <  RECBUF - 1  ?  inb - i  :  RECBUF - 1 ;
+    while  ( i + n < inb  &&  n  &&  inp[ i + n - 1 ] != IVXSPL_TRM )  --n ;
+    if  ( !n )  n = RECBUF - 1 ;
+    
+    /* Null terminate , like ivxudp's receive buffer */
+    t = inp[ i + n ] ;
+    inp[ i + n ] = '\0' ;
+    
+    N += f ( inp + i , n , v + IVXSPL_NUMVAL * N ) ;
+    
+    inp[ i + n ] = t ;
+    i += n ;
+  }
+  
+  return  N ;
+
+} /* runall */
+
+
+/* Time parser f , report , and return the number of samples */
+static size_t  bench ( const char *  name ,
+                       size_t ( *f ) ( char * , size_t , double * ) ,
+                       double *  v )
+{
+  
+  struct timespec  t0 , t1 ;
+  double  t , best = 0 ;
+  size_t  N = 0 ;
+  int  r ;
+  
+  for  ( r = 0  ;  r < NREP  ;  r++ )
+  {
+    clock_gettime ( CLOCK_MONOTONIC , &t0 ) ;
+    N = runall ( f , v ) ;
+    clock_gettime ( CLOCK_MONOTONIC , &t1 ) ;
+    
+    t = tdiff ( &t0 , &t1 ) ;
+    if  ( !r  ||  t < best )  best = t ;
+  }
+  
+  printf ( "  %-12s %10.1f MB/s %14.0f samples/s %10.1f ns/sample\n" ,
+    name , inb / best / 1e6 , N / best , N ? best * 1e9 / N : 0.0 ) ;
+  
+  return  N ;
+
+} /* bench */
+
+
+/*--- ivxparse_bench ---*/
+
+int  main ( int  argc , char **  argv )
+{
+  
+  size_t  No , Ns , i , d = 0 ;
+  char *  e ;
+  long  N = DEFNUM ;
+  int  a ;
+  
+  /* Synthetic samples */
+  if  ( argc < 2  ||  ( N = strtol ( argv[ 1 ] , &e , 10 ) , *e == '\0' ) )
+  {
+    if  ( N <= 0 )
+    {
+      fprintf ( stderr , "ivxparse_bench: N must be over 0\n" ) ;
+      exit ( EXIT_FAILURE ) ;
+    }
+    
+    synth ( N ) ;
+    printf ( "ivxparse_bench: %ld synthetic samples , %zu bytes\n" ,
+      N , inb ) ;
+  }
+  
+  /* Dump files */
+  else
+  {
+    for  ( a = 1  ;  a < argc  ;  a++ )
+      readdump ( argv[ a ] ) ;
+    
+    printf ( "ivxparse_bench: %d dump files , %zu bytes\n" , argc - 1 ,
+      inb ) ;
+  }
+  
+  /* Room for the most samples that could be in the input */
+  vn = ( inb / IVXSPL_MINLEN + 1 ) * IVXSPL_NUMVAL ;
+  if  ( ( vo = malloc ( vn * sizeof ( double ) ) )  ==  NULL  ||
+        ( vs = malloc ( vn * sizeof ( double ) ) )  ==  NULL )
+    PEX ( "ivxparse_bench:malloc" )
+  
+  No = bench ( "original" , parseorig , vo ) ;
+  Ns = bench ( "single-pass" , parsespl , vs ) ;
+  
+  /* Compare output */
+  if  ( No  !=  Ns )
+  {
+    printf ( "ivxparse_bench: sample count differs , %zu vs %zu\n" ,
+      No , Ns ) ;
+    return  EXIT_FAILURE ;
+  }
+  
+  for  ( i = 0  ;  i < No * IVXSPL_NUMVAL  ;  i++ )
+    if  ( vo[ i ]  !=  vs[ i ] )
+      if  ( !d++ )
+        printf ( "ivxparse_bench: sample %zu value %zu differs , %.17g vs "
+          "%.17g\n" , i / IVXSPL_NUMVAL , i % IVXSPL_NUMVAL , vo[ i ] ,
+          vs[ i ] ) ;
+  
+  printf ( "ivxparse_bench: %zu samples , %zu values differ\n" , No , d ) ;
+  
+  free ( inp ) ;  free ( vo ) ;  free ( vs ) ;
+  
+  return  d  ?  EXIT_FAILURE  :  EXIT_SUCCESS ;
+
+} /* ivxparse_bench */
@@ -0,0 +1,532 @@
+/*  ivxsim.c
+  
+  ivxsim  [ -a addr ] [ -p port ] [ -r rate ] [ -n N ] [ -t traj ]
+          [ -l loss ] [ -o reord ] [ -b burst ] [ -s seed ] [ -q ]
+  
+  Matlab Electrophysiology Toolbox utility. A local simulator of the SMI
+  iViewX UDP protocol , as far as ivxudp uses it , so that ivxudp and the
+  eye pipeline can be tested and benchmarked without an SMI system. ivxsim
+  binds a UDP socket to the iViewX address and port , then waits for
+  commands. It answers ET_PNG with ET_PNG. It accepts ET_FRM , but always
+  streams the binocular format that ivxudp asks for i.e.
+    
+    ET_SPL b <%TU> <%SX left> <%SX right> <%SY left> <%SY right> ...
+      <%DX left> <%DX right> <%DY left> <%DY right>
+  
+  ET_STR starts streaming to the address that sent it , one sample per
+  datagram , and ET_EST stops. Any other command is ignored. Options are:
+    
+    -a addr  - iViewX IPv4 address. Default 127.0.0.1.
+    -p port  - iViewX port. Default 4444.
+    -r rate  - Samples per second. Default 500.
+    -n N     - Samples per stream. 0 streams until ET_EST. Default 0.
+    -t traj  - Gaze trajectory , one of:
+                 fix  - Steady fixation on the centre of the screen.
+                 sin  - Smooth pursuit of a Lissajous figure.
+                 sacc - Fixations of 200 to 600ms at random places ,
+                        joined by 40ms saccades.
+                 rand - A new random position every sample , including
+                        positions outside of the iViewX data range.
+               Default sin.
+    -l loss  - Probability of dropping each datagram. Default 0.
+    -o reord - Probability of holding each datagram back until after the
+               next one. Default 0.
+    -b burst - Samples are sent back to back in bursts of this many
+               datagrams , once every burst / rate seconds. Default 1.
+    -s seed  - Random number generator seed. Default 1.
+    -q       - Quit when the first stream ends.
+  
+  Gaze positions are in the iViewX analogue data range of 4095 to 12287 ,
+  with a little noise , and the right eye slightly offset from the left.
+  The time stamp of each sample is the local CLOCK_REALTIME , in
+  microseconds , at which the sample was due. Hence , a receiver on the same
+  system can measure latency from sample to , say , shared memory , using
+  the same clock as Psych Toolbox's GetSecs. Lost samples still advance the
+  time stamp , so that they appear as gaps. A summary of each stream is
+  printed to standard output when it ends.
+  
+  For example , ivxsim can stand in for iViewX with met_ivxudp_test.m if
+  both the host and iViewX addresses there are set to 127.0.0.1 ; a long
+  run with loss and reordering is then a soak test of ivxudp.
+  
+  Build with:  gcc -O2 -o ivxsim ivxsim.c -lm
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Sockets */
+#include  <arpa/inet.h>
+#include  <netinet/in.h>
+#include  <sys/types.h>
+#include  <sys/socket.h>
+
+/* General */
+#include  <errno.h>
+#include  <math.h>
+#include  <poll.h>
+#include  <signal.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <strings.h>
+#include  <time.h>
+#include  <unistd.h>
+
+
+/*--- Define block ---*/
+
+/* System error and exit */
+#define  PEX( s )  { perror ( s ) ; exit ( EXIT_FAILURE ) ; }
+
+/* Usage error and exit */
+#define  UEX( s )  { fprintf ( stderr , "ivxsim: %s\n" , s ) ; \
+                     exit ( EXIT_FAILURE ) ; }
+
+/* Defaults */
+#define  DEFADD  "127.0.0.1"
+#define  DEFPRT  4444
+#define  DEFRAT  500
+
+/* Commands , and length to compare */
+#define  CMDPNG  "ET_PNG"
+#define  CMDSTR  "ET_STR"
+#define  CMDEST  "ET_EST"
+#define  CMDLEN  6
+
+/* Largest command or sample string */
+#define  CMDBUF  1024
+#define  SPLBUF   256
+
+/* iViewX analogue data range , and centre */
+#define  GAZMIN  4095.0
+#define  GAZMAX  12287.0
+#define  GAZCEN  ( ( GAZMIN + GAZMAX ) / 2 )
+
+/* Gaze noise standard deviation , and right eye offset , in data units */
+#define  GAZSTD  8.0
+#define  GAZOFF  40.0
+
+/* Lissajous amplitude in data units , and x and y frequencies in Hz */
+#define  SINAMP  3000.0
+#define  SINFRX  0.5
+#define  SINFRY  0.33
+
+/* Fixation durations and saccade duration in seconds , and fixation
+   amplitude in data units */
+#define  FIXMIN  0.2
+#define  FIXMAX  0.6
+#define  SACDUR  0.04
+#define  FIXAMP  3500.0
+
+/* Pupil diameter mean and noise , in pixels of the eye image */
+#define  DIAMEN  40.0
+#define  DIASTD  0.5
+
+/* Microseconds and nanoseconds per second */
+#define  USPERS  1000000.0
+#define  NSPERS  1000000000LL
+
+/* Trajectory codes */
+#define  TRJFIX   0
+#define  TRJSIN   1
+#define  TRJSAC   2
+#define  TRJRND   3
+
+
+/*--- Global variables ---*/
+
+/* Options */
+static const char *  add = DEFADD ;
+static int  prt = DEFPRT , trj = TRJSIN , bst = 1 , qt = 0 ;
+static long  rat = DEFRAT , num = 0 ;
+static double  los = 0 , ord = 0 ;
+static unsigned  sed = 1 ;
+
+/* Saccade trajectory state , start and end of current movement , start
+   time of saccade , and end time of fixation */
+static double  sx0 , sy0 , sx1 , sy1 , st0 , st1 = -1 ;
+
+/* Quit on signal */
+static volatile sig_atomic_t  quit = 0 ;
+
+
+/*--- Subroutines ---*/
+
+/* Signal handler */
+static void  onsig ( int  s )
+{
+  quit = s ;
+}
+
+
+/* Uniform random number on [ 0 , 1 ) */
+static double  urand ( void )
+{
+  return  rand ( )  /  ( RAND_MAX + 1.0 ) ;
+}
+
+
+/* Standard normal random number , Box-Muller */
+static double  nrand ( void )
+{
+  return  sqrt ( -2 * log ( 1 - urand ( ) ) ) * cos ( 2 * M_PI * urand ( ) ) ;
+}
+
+
+/* Seconds of a timespec */
+static double  tsec ( struct timespec *  t )
+{
+  return  t->tv_sec  +  t->tv_nsec / ( double ) NSPERS ;
+}
+
+
+/* Gaze position of the left eye at t seconds into the stream */
+static void  gaze ( double  t , double *  x , double *  y )
+{
+  
+  double  f ;
+  
+  switch  ( trj )
+  {
+    
+    case  TRJFIX:
+    default:
+      *x = *y = GAZCEN ;
+      break ;
+    
+    case  TRJSIN:
+      *x = GAZCEN  +  SINAMP * sin ( 2 * M_PI * SINFRX * t ) ;
+      *y = GAZCEN  +  SINAMP * sin ( 2 * M_PI * SINFRY * t ) ;
+      break ;
+    
+    case  TRJSAC:
+      
+      /* Fixation over , start a saccade to a new place */
+      if  ( st1  <  t )
+      {
+        sx0 = sx1 ;  sy0 = sy1 ;
+        sx1 = GAZCEN  +  FIXAMP * ( 2 * urand ( ) - 1 ) ;
+        sy1 = GAZCEN  +  FIXAMP * ( 2 * urand ( ) - 1 ) ;
+        st0 = t ;
+        st1 = t  +  SACDUR  +  FIXMIN  +  ( FIXMAX - FIXMIN ) * urand ( ) ;
+      }
+      
+      /* Fraction of saccade done */
+      f = ( t - st0 ) / SACDUR ;
+      if  ( 1  <  f )  f = 1 ;
+      
+      *x = sx0  +  f * ( sx1 - sx0 ) ;
+      *y = sy0  +  f * ( sy1 - sy0 ) ;
+      break ;
+    
+    case  TRJRND:
+      *x = GAZMIN - 1000  +  ( GAZMAX - GAZMIN + 2000 ) * urand ( ) ;
+      *y = GAZMIN - 1000  +  ( GAZMAX - GAZMIN + 2000 ) * urand ( ) ;
+      return ;
+  
+  }
+  
+  /* Measurement noise */
+  *x += GAZSTD * nrand ( ) ;
+  *y += GAZSTD * nrand ( ) ;
+
+} /* gaze */
+
+
+/* Format sample i of a stream that started at t0 into s , returning the
+   number of bytes */
+static int  sample ( char *  s , long  i , struct timespec *  t0 )
+{
+  
+  /* Sample time into stream , and realtime time stamp in microseconds */
+  double  t = i / ( double ) rat ;
+  long long  tu = ( long long ) ( tsec ( t0 ) * USPERS  +  t * USPERS ) ;
+  
+  /* Gaze */
+  double  x , y ;
+  
+  gaze ( t , &x , &y ) ;
+  
+  /* Order is %SX left , right , %SY left , right , %DX , %DY likewise */
+  return  snprintf ( s , SPLBUF ,
+    "ET_SPL b %lld %.0f %.0f %.0f %.0f %.2f %.2f %.2f %.2f\n" , tu ,
+    x , x + GAZOFF , y , y + GAZOFF ,
+    DIAMEN + DIASTD * nrand ( ) , DIAMEN + DIASTD * nrand ( ) ,
+    DIAMEN + DIASTD * nrand ( ) , DIAMEN + DIASTD * nrand ( ) ) ;
+
+} /* sample */
+
+
+/* Read options */
+static void  options ( int  argc , char **  argv )
+{
+  
+  int  c ;
+  
+  while  ( ( c = getopt ( argc , argv , "a:p:r:n:t:l:o:b:s:q" ) )  !=  -1 )
+    
+    switch  ( c )
+    {
+      case  'a':  add = optarg ;  break ;
+      case  'p':  prt = atoi ( optarg ) ;  break ;
+      case  'r':  rat = atol ( optarg ) ;  break ;
+      case  'n':  num = atol ( optarg ) ;  break ;
+      case  'l':  los = atof ( optarg ) ;  break ;
+      case  'o':  ord = atof ( optarg ) ;  break ;
+      case  'b':  bst = atoi ( optarg ) ;  break ;
+      case  's':  sed = strtoul ( optarg , NULL , 10 ) ;  break ;
+      case  'q':  qt = 1 ;  break ;
+      
+      case  't':
+        if       ( !strcmp ( optarg , "fix"  ) )  trj = TRJFIX ;
+        else if  ( !strcmp ( optarg , "sin"  ) )  trj = TRJSIN ;
+        else if  ( !strcmp ( optarg , "sacc" ) )  trj = TRJSAC ;
+        else if  ( !strcmp ( optarg , "rand" ) )  trj = TRJRND ;
+        else  UEX ( "traj must be fix , sin , sacc , or rand" )
+        break ;
+      
+      default:  UEX ( "unrecognised option , see ivxsim.c" )
+    }
+  
+  if  ( prt < 1  ||  65535 < prt )  UEX ( "port out of range" )
+  if  ( rat < 1 )  UEX ( "rate must be at least 1" )
+  if  ( num < 0 )  UEX ( "N must not be negative" )
+  if  ( bst < 1 )  UEX ( "burst must be at least 1" )
+  if  ( los < 0  ||  1 < los  ||  ord < 0  ||  1 < ord )
+    UEX ( "loss and reord must be probabilities" )
+
+} /* options */
+
+
+/*--- ivxsim ---*/
+
+int  main ( int  argc , char **  argv )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Socket , and iViewX , command sender's , and stream destination
+     addresses */
+  int  s ;
+  struct sockaddr_in  ia , ha , da ;
+  socklen_t  hl , dl = sizeof ( da ) ;
+  
+  /* Command buffer , sample buffer , held-back sample , and their lengths */
+  char  cmd[ CMDBUF ] , spl[ SPLBUF ] , hld[ SPLBUF ] ;
+  ssize_t  br ;
+  int  n , hn = 0 ;
+  
+  /* Streaming flag , sample counter , and counts of sent , lost , and
+     reordered datagrams */
+  int  str = 0 ;
+  long  i = 0 , j , ns = 0 , nl = 0 , no = 0 ;
+  
+  /* Stream start time on realtime and monotonic clocks , time of next
+     burst , current time , and poll ( ) timeout */
+  struct timespec  t0 , m0 , tb , tn ;
+  double  w ;
+  int  to ;
+  
+  /* poll ( ) descriptor */
+  struct pollfd  p ;
+  
+  
+  /*-- Setup --*/
+  
+  options ( argc , argv ) ;
+  srand ( sed ) ;
+  sx1 = sy1 = GAZCEN ;
+  
+  signal ( SIGINT  , onsig ) ;
+  signal ( SIGTERM , onsig ) ;
+  
+  memset ( &ia , 0 , sizeof ( ia ) ) ;
+  ia.sin_family = AF_INET ;
+  ia.sin_port = htons ( prt ) ;
+  
+  if  ( !inet_aton ( add , &ia.sin_addr ) )
+    UEX ( "invalid IPv4 address" )
+  
+  if  ( ( s = socket ( AF_INET , SOCK_DGRAM , 0 ) )  ==  -1 )
+    PEX ( "ivxsim:socket" )
+  
+  if  ( bind ( s , ( struct sockaddr * ) &ia , sizeof ( ia ) )  ==  -1 )
+    PEX ( "ivxsim:bind" )
+  
+  p.fd = s ;
+  p.events = POLLIN ;
+  
+  printf ( "ivxsim: iViewX at %s:%d , %ld samples/s\n" , add , prt , rat ) ;
+  fflush ( stdout ) ;
+  
+  
+  /*-- Event loop --*/
+  
+  while  ( !quit )
+  {
+    
+    /* Wait for a command , or until the next burst is due */
+    to = -1 ;
+    
+    if  ( str )
+    {
+      if  ( clock_gettime ( CLOCK_MONOTONIC , &tn )  ==  -1 )
+        PEX ( "ivxsim:clock_gettime" )
+      
+      w = tsec ( &tb ) - tsec ( &tn ) ;
+      to = w <= 0  ?  0  :  ( int ) ( w * 1000 ) ;
+    }
+    
+    if  ( poll ( &p , 1 , to )  ==  -1 )
+    {
+      if  ( errno == EINTR )  continue ;
+      PEX ( "ivxsim:poll" )
+    }
+    
+    
+    /*-- Command --*/
+    
+    if  ( p.revents & POLLIN )
+    {
+      
+      hl = sizeof ( ha ) ;
+      
+      if  ( ( br = recvfrom ( s , cmd , CMDBUF - 1 , 0 ,
+                              ( struct sockaddr * ) &ha , &hl ) )  ==  -1 )
+      {
+        if  ( errno == EINTR )  continue ;
+        PEX ( "ivxsim:recvfrom" )
+      }
+      
+      cmd[ br ] = '\0' ;
+      
+      /* Ping , reply in kind */
+      if  ( !strncasecmp ( cmd , CMDPNG , CMDLEN ) )
+      {
+        if  ( sendto ( s , CMDPNG "\n" , CMDLEN + 1 , 0 ,
+                       ( struct sockaddr * ) &ha , hl )  ==  -1 )
+          PEX ( "ivxsim:sendto" )
+      }
+      
+      /* Start streaming */
+      else if  ( !strncasecmp ( cmd , CMDSTR , CMDLEN )  &&  !str )
+      {
+        if  ( clock_gettime ( CLOCK_REALTIME  , &t0 )  ==  -1  ||
+              clock_gettime ( CLOCK_MONOTONIC , &m0 )  ==  -1 )
+          PEX ( "ivxsim:clock_gettime" )
+        
+        da = ha ;
+        dl = hl ;
+        tb = m0 ;
+        str = 1 ;
+        i = ns = nl = no = hn = 0 ;
+      }
+      
+      /* Stop streaming */
+      else if  ( !strncasecmp ( cmd , CMDEST , CMDLEN ) )
+        str = -str ;
+      
+      /* ET_FRM is accepted , and anything else ignored */
+    
+    } /* command */
+    
+    
+    /*-- Burst of samples --*/
+    
+    if  ( 0 < str )
+    {
+      
+      if  ( clock_gettime ( CLOCK_MONOTONIC , &tn )  ==  -1 )
+        PEX ( "ivxsim:clock_gettime" )
+      
+      while  ( tsec ( &tb ) <= tsec ( &tn )  &&  ( !num  ||  i < num ) )
+      {
+        
+        for  ( j = 0  ;  j < bst  &&  ( !num  ||  i < num )  ;  j++ , i++ )
+        {
+          
+          n = sample ( spl , i , &t0 ) ;
+          
+          /* Lost */
+          if  ( urand ( )  <  los )
+          {
+            ++nl ;
+            continue ;
+          }
+          
+          /* Hold back until after the next datagram */
+          if  ( !hn  &&  urand ( ) < ord )
+          {
+            memcpy ( hld , spl , n ) ;
+            hn = n ;
+            ++no ;
+            continue ;
+          }
+          
+          if  ( sendto ( s , spl , n , 0 , ( struct sockaddr * ) &da , dl )
+                ==  -1 )
+            PEX ( "ivxsim:sendto" )
+          ++ns ;
+          
+          if  ( hn )
+          {
+            if  ( sendto ( s , hld , hn , 0 , ( struct sockaddr * ) &da ,
+                           dl )  ==  -1 )
+              PEX ( "ivxsim:sendto" )
+            ++ns ;
+            hn = 0 ;
+          }
+        
+        } /* burst */
+        
+        /* Time of next burst */
+        tb.tv_nsec += bst * NSPERS / rat ;
+        while  ( NSPERS  <=  tb.tv_nsec )
+        {
+          tb.tv_nsec -= NSPERS ;
+          ++tb.tv_sec ;
+        }
+      
+      } /* due bursts */
+      
+      /* All samples sent */
+      if  ( num  &&  num <= i )  str = -1 ;
+    
+    } /* streaming */
+    
+    
+    /*-- End of stream --*/
+    
+    if  ( str < 0 )
+    {
+      
+      /* Flush held-back datagram */
+      if  ( hn )
+      {
+        if  ( sendto ( s , hld , hn , 0 , ( struct sockaddr * ) &da , dl )
+              ==  -1 )
+          PEX ( "ivxsim:sendto" )
+        ++ns ;
+        hn = 0 ;
+      }
+      
+      printf ( "ivxsim: stream of %ld samples , %ld sent , %ld lost , "
+        "%ld reordered\n" , i , ns , nl , no ) ;
+      fflush ( stdout ) ;
+      
+      str = 0 ;
+      if  ( qt )  break ;
+    }
+  
+  } /* event loop */
+  
+  close ( s ) ;
+  
+  return  EXIT_SUCCESS ;
+
+} /* ivxsim */
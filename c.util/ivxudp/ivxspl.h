@@ -0,0 +1,201 @@
+
+/*  ivxspl.h
+  
+  Single-pass tokeniser for iViewX ET_SPL eye sample commands. This is
+  specialised for the fixed binocular data format that ivxudp requests from
+  iViewX with ET_FRM i.e.
+    
+    ET_SPL b <%TU> <%SX left> <%SX right> <%SY left> <%SY right> ...
+      <%DX left> <%DX right> <%DY left> <%DY right>
+  
+  Two functions are provided. ivxnext ( ) finds the next binocular sample
+  in a buffer , using memchr ( ) to jump between candidate command
+  characters rather than comparing every byte. ivxvals ( ) then converts
+  the IVXSPL_NUMVAL numeric values of the sample with an integer fast path
+  that handles plain integers and decimal fractions exactly as strtod ( )
+  would ; anything else e.g. an exponent falls back on strtod ( ). Neither
+  function reads past the end of the buffer , except for the strtod ( )
+  fallback , which stops at the first character that cannot be part of a
+  number.
+  
+  There is no Matlab dependency , so that the parser can be benchmarked on
+  its own by ivxparse_bench.c.
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+#ifndef  IVXSPL_H
+#define  IVXSPL_H
+
+
+/*--- Include block ---*/
+
+#include  <stdint.h>
+#include  <stdlib.h>
+#include  <string.h>
+
+
+/*--- Define block ---*/
+
+/* iViewX sample command and its length */
+#define  IVXSPL_CMD  "ET_SPL"
+#define  IVXSPL_CMN  6
+
+/* iViewX command terminators , separator , and binocular eye type */
+#define  IVXSPL_TRM  '\n'
+#define  IVXSPL_TR2  '\r'
+#define  IVXSPL_SEP  ' '
+#define  IVXSPL_BIN  'b'
+
+/* The number of numeric values per sample */
+#define  IVXSPL_NUMVAL  9
+
+/* Smallest number of bytes between the starts of two samples , i.e. the
+   command and eye type with no separators. A buffer of n bytes holds no
+   more than n / IVXSPL_MINLEN + 1 samples. */
+#define  IVXSPL_MINLEN  ( IVXSPL_CMN + 1 )
+
+/* Most fraction digits taken by the integer fast path , and largest
+   mantissa that a double holds exactly i.e. 2 ^ 53 */
+#define  IVXSPL_MAXFRC  15
+#define  IVXSPL_MAXMAN  9007199254740992ULL
+
+/* True if char c is a decimal digit */
+#define  IVXSPL_DIG( c )  ( (unsigned) ( ( c ) - '0' )  <=  9 )
+
+
+/*--- Function definitions ---*/
+
+/* Returns a pointer to the first byte after the eye type of the next
+   binocular ET_SPL sample in [ c , e ) , or NULL if there are no more.
+   Samples that are not binocular , or that terminate before any data , are
+   skipped and counted in *bad. */
+static inline const char *  ivxnext ( const char *  c , const char *  e ,
+                                      size_t *  bad )
+{
+  
+  /* Look for the first character of the command */
+  while  ( ( c = memchr ( c , IVXSPL_CMD[ 0 ] , e - c ) )  !=  NULL )
+  {
+    
+    /* Not the sample command , keep looking */
+    if  ( e - c  <  IVXSPL_CMN  ||
+          memcmp ( c , IVXSPL_CMD , IVXSPL_CMN ) )
+    {
+      ++c ;
+      continue ;
+    }
+    
+    /* Skip command and separators */
+    c += IVXSPL_CMN ;
+    while  ( c < e  &&  *c == IVXSPL_SEP )  ++c ;
+    
+    /* Eye type must be binocular */
+    if  ( c == e  ||  *c != IVXSPL_BIN )
+    {
+      ++( *bad ) ;
+      continue ;
+    }
+    
+    /* Skip eye type and separators */
+    ++c ;
+    while  ( c < e  &&  *c == IVXSPL_SEP )  ++c ;
+    
+    /* Must have some data before the end of the command */
+    if  ( c == e  ||  *c == IVXSPL_TRM  ||  *c == IVXSPL_TR2 )
+    {
+      ++( *bad ) ;
+      continue ;
+    }
+    
+    return  c ;
+  
+  } /* search */
+  
+  return  NULL ;
+
+} /* ivxnext */
+
+
+/* Converts the number at c , ending before e , into *d and returns a
+   pointer to the byte after it. If there is no number then *d is zero and
+   c is returned , like strtod ( ). */
+static inline const char *  ivxnum ( const char *  c , const char *  e ,
+                                     double *  d )
+{
+  
+  /* Exact powers of ten */
+  static const double  P10[ IVXSPL_MAXFRC + 1 ] = { 1e0 , 1e1 , 1e2 , 1e3 ,
+    1e4 , 1e5 , 1e6 , 1e7 , 1e8 , 1e9 , 1e10 , 1e11 , 1e12 , 1e13 , 1e14 ,
+    1e15 } ;
+  
+  /* Start of number , mantissa , fraction digits , sign */
+  const char *  s = c ;
+  uint64_t  m = 0 ;
+  int  f = 0 , neg = 0 ;
+  
+  /* Sign */
+  if  ( c < e  &&  ( *c == '-'  ||  *c == '+' ) )
+    neg = *c++ == '-' ;
+  
+  /* No digits at all , no number */
+  if  ( c == e  ||  ( !IVXSPL_DIG( *c )  &&
+                      ( *c != '.'  ||  c + 1 == e  ||
+                        !IVXSPL_DIG( c[ 1 ] ) ) ) )
+  {
+    *d = 0 ;
+    return  s ;
+  }
+  
+  /* Integer digits */
+  while  ( c < e  &&  IVXSPL_DIG( *c )  &&  m < IVXSPL_MAXMAN / 10 )
+    m = 10 * m  +  ( *c++ - '0' ) ;
+  
+  /* Fraction digits */
+  if  ( c < e  &&  *c == '.' )
+    for  ( ++c ;  c < e  &&  IVXSPL_DIG( *c )  &&  f < IVXSPL_MAXFRC  &&
+                  m < IVXSPL_MAXMAN / 10 ;  ++f )
+      m = 10 * m  +  ( *c++ - '0' ) ;
+  
+  /* Too many digits , or an exponent , so fall back on strtod */
+  if  ( c < e  &&  ( IVXSPL_DIG( *c )  ||
+                     *c == 'e'  ||  *c == 'E'  ||  *c == '.' ) )
+  {
+    char *  r ;
+    *d = strtod ( s , &r ) ;
+    return  r ;
+  }
+  
+  /* Both mantissa and power of ten are exact , so the division is rounded
+     once , just as strtod would round */
+  *d = f  ?  (double) m / P10[ f ]  :  (double) m ;
+  if  ( neg )  *d = -*d ;
+  
+  return  c ;
+
+} /* ivxnum */
+
+
+/* Converts the IVXSPL_NUMVAL values of the sample at c , ending before e ,
+   into d. Returns a pointer to the byte after the last value. Missing
+   values are zero. */
+static inline const char *  ivxvals ( const char *  c , const char *  e ,
+                                      double *  d )
+{
+  
+  int  i ;
+  
+  for  ( i = 0  ;  i < IVXSPL_NUMVAL  ;  i++ )
+  {
+    while  ( c < e  &&  *c == IVXSPL_SEP )  ++c ;
+    c = ivxnum ( c , e , d + i ) ;
+  }
+  
+  return  c ;
+
+} /* ivxvals */
+
+
+#endif  /* IVXSPL_H */
+
@@ -26,8 +26,8 @@
   version 2.8 build 43.
   
   Sub-functions:
-  
-      s = ivxudp ( 'o' , hipa , hprt , iipa , iprt ) -- Make and bind a
+      
+      s = ivxudp ( 'o' , hipa , hprt , iipa , iprt , bg ) -- Make and bind a
         socket. The user must provide the IP address and port for the host
         (upon which Matlab is running) and SMI (upon which iViewX is
         running) computers. hipa and iprt must be strings containing IP
@@ -39,11 +39,21 @@
         stream. Finally, data streaming from iViewX is started. Returns
         scalar double s, which is the value of the socket file descriptor ;
         for use with multiplexing functions, like select( ).
-
+        
+        bg is optional. If it is given and is non-zero then a background
+        receive thread is started. The thread drains the socket as soon as
+        data arrives, parses eye samples, and keeps them in a ring that
+        holds up to 16384 samples. ivxudp 'r' then copies samples out of the
+        ring. Thus, samples are not lost when the MET controller is slow to
+        read. Samples are only dropped if the ring is full. While the thread
+        runs, s will not signal new eye samples to select( ), because the
+        thread has already read them. The default is no thread.
+      
       ivxudp ( 'c' ) -- Stops iViewX from streaming data, and close the
-        socket.
-  
-      [ tret , tim , gaze , diam ] = ivxudp ( 'r' ) -- Read new
+        socket. Stops the background receive thread, if there is one. Closes
+        the replay file instead, if 'f' opened one.
+      
+      [ tret , tim , gaze , diam , rtim ] = ivxudp ( 'r' ) -- Read new
         eye samples from the socket buffer. This is a non-blocking read.
         So when no new data is available, then all output arguments will be
         empty double arrays i.e. they will all be []. The exception is
@@ -54,11 +64,12 @@
           This is taken immediately after reading from the socket, and will
           be directly comparable to local time measurements returned by
           Psych Toolbox functions, like GetSecs( ). If no new data was
-          available then tret returns zero.
+          available then tret returns zero. With the background receive
+          thread, this is taken when samples are copied out of the ring.
         
         All following outputs will have 1 <= N rows, where the ith row in
         each output argument refers to the same data sample.
-  
+        
         tim - N x 1 - Contains the time stamp of each eye sample. These
           measurements are NOT from the local system running MET. They are
           from the SMI computer. In seconds.
@@ -76,25 +87,99 @@
           same as for gaze. Hence, the diameter is measured separately in
           both the x- and y-axis, for each eye. In pixels of the eye
           tracking video image.
+        
+        rtim - N x 1 - The local time at which the kernel received the
+          datagram that carried each eye sample , taken by the socket option
+          SO_TIMESTAMPNS. In seconds , on the same clock as tret. Unlike
+          tret , this does not depend on when Matlab got round to reading
+          the socket. Paired with tim , it allows gaze-contingent timing and
+          clock drift estimates that are accurate to the datagram.
+      
+      [ nspl , kdrop , rdrop , gaps , nbad , nshm , trunc ] = ...
+        ivxudp ( 'n' ) --
+        Returns counters, as scalar doubles, that are reset each time that
+        ivxudp is opened. nspl is the number of binocular eye samples parsed.
+        kdrop is the number of datagrams dropped by the kernel because the
+        socket receive buffer was full. rdrop is the number of samples dropped
+        because the background receive thread's ring was full, or because
+        they did not fit into eye shared memory. gaps is the number of times
+        that consecutive iViewX time stamps were more than 1.5 times the
+        shortest sample interval apart. nbad is the number of ET_SPL commands
+        that were not binocular or had no data. nshm is the number of writes
+        to eye shared memory. trunc is the number of datagrams that were
+        dropped because they were truncated on receipt. Samples are only
+        counted when they are parsed, which does not happen if ivxudp 'r' is
+        called without output arguments and no background thread.
+      
+      ivxudp ( 'e' , W , cal ) -- The background receive thread writes eye
+        samples straight into 'eye' shared memory , in place of the MET
+        controller. Requires the thread , see 'o' and 'f'. May be called
+        once after each 'o' or 'f'. W must be returned by met ( 'shmwr' ,
+        'eye' ) , see met. cal is a four-element double [ scrwid , scrhei ,
+        xyswap , dur ]. Gaze positions are centred and multiplied by scrwid
+        or scrhei , the screen width and height in degrees of visual field ;
+        scrhei is negative when y increases upwards. If xyswap is non-zero
+        then left and right eyes are swapped. The thread writes no more
+        often than once every dur seconds , and only when all readers have
+        read the last write. Writes the same arrays as metdaqeye: [ time ,
+        x-left , y-left , x-right , y-right ] gaze positions , pupil
+        diameters with the same columns , and an empty double for mouse
+        positions. Times are converted to local time by assuming that the
+        last sample in each batch of datagrams arrived at its kernel receive
+        time. Samples no longer go to the ring , so ivxudp 'r' returns
+        nothing new.
+      
+      ivxudp ( 'f' , file , speed ) -- Replays recorded iViewX eye samples
+        from file at their original timing , in place of a live iViewX
+        stream. Thus , a gaze-driven session can be reproduced offline. file
+        is a string naming a dump of the datagrams that iViewX streams in the
+        format that 'o' asks for , such as nc -u -l 5555 > file will save ;
+        ivxsim streams the same format. speed is an optional scalar double ,
+        1 by default , that multiplies the replay rate. The background
+        receive thread is always started , so that 'r' , 'n' , 'e' , and 'c'
+        work as they do after 'o' with bg. rtim is the local time at which
+        each sample was due. Time stamps in tim are the recorded ones.
   
   
   Written by Jackson Smith - DPAG , University of Oxford
-  
+
 */
 
 
 /*--- Include block ---*/
 
+/* recvmmsg ( ) */
+#define  _GNU_SOURCE
+
 /* Matlab */
 #include  "mex.h"
 #include  "matrix.h"
 
+/* MET constants and shared memory layout , met.h is linked from ./c */
+#include  "met.h"
+
 /* Sockets */
 #include  <arpa/inet.h>
 #include  <netinet/in.h>
 #include  <sys/types.h>
 #include  <sys/socket.h>
 
+/* ET_SPL tokeniser */
+#include  "ivxspl.h"
+
+/* Eye ingest interface , and file-replay backend */
+#include  "eyein.h"
+#include  "eyefile.h"
+
+/* Background receive thread */
+#include  <poll.h>
+#include  <pthread.h>
+
+/* Writing eye shared memory */
+#include  <limits.h>
+#include  <linux/futex.h>
+#include  <sys/syscall.h>
+
 /* General */
 #include  <errno.h>
 #include  <stdio.h>
@@ -112,88 +197,159 @@
 
 
 /* ivxfun values */
-
+  
   /* Open socket and start data streaming */
   #define  IVXFUN_OPEN  'o'
-
+  
   /* Close socket and stop data streaming */
   #define  IVXFUN_CLOSE  'c'
-
+  
   /* Close socket and stop data streaming */
   #define  IVXFUN_READ  'r'
+  
+  /* Return sample , drop , and gap counters */
+  #define  IVXFUN_COUNT  'n'
 
+  /* Write eye samples straight into shared memory */
+  #define  IVXFUN_EYE  'e'
 
-/* Number of input and output args */
+  /* Replay recorded eye samples from a file */
+  #define  IVXFUN_FILE  'f'
 
-  /* Open function number of right-hand side input arguments */
-  #define  NRHS_OPEN  5
 
+/* Number of input and output args */
+  
+  /* Open function number of right-hand side input arguments , without
+     and with the optional background thread flag */
+  #define  NRHS_OPEN  5
+  #define  NRHS_OPTH  6
+  
   /* Maximum number of output arguments from read function */
-  #define  NLHS_READ  4
+  #define  NLHS_READ  5
+  
+  /* Maximum number of output arguments from count function */
+  #define  NLHS_COUNT  7
+  
+  /* Eye shared memory function number of right-hand side input arguments
+     and number of calibration values */
+  #define  NRHS_EYE  3
+  #define  NUMCAL    4
+  
+  /* File function number of right-hand side input arguments , without and
+     with the optional replay speed */
+  #define  NRHS_FILE  2
+  #define  NRHS_FISP  3
 
 
 /*   Buffers   */
-
+  
   /* Socket receive buffer size -- 2 ^ 19 bytes */
   #define  RECBUF  524288
-
-  /* Return buffer threshold in bytes. This is the minimum size of a TCP/IP
-     datagram. The user-space receive buffer must have at least this much
-     space left before executing another read on the socket */
-  #define  BUFTHR  576 
-
-  /* Function name buffer size in bytes */
-  #define  FNAMEB  6
+  
+  /* Space given to each datagram in a batched read. This is the largest
+     UDP payload over IPv4 , so that no datagram is ever truncated. The
+     user-space receive buffer must have at least this much space left
+     before executing another read on the socket */
+  #define  BUFTHR  65507
+  
+  /* Maximum number of datagrams received per recvmmsg ( ) call */
+  #define  MMSGN  64
+  
+  /* Maximum number of datagrams held in the user-space receive buffer */
+  #define  MAXDGM  8192
+  
+  /* Ancillary data space for one SO_TIMESTAMPNS time stamp and one
+     SO_RXQ_OVFL drop count */
+  #define  CTLBUF  ( CMSG_SPACE ( sizeof ( struct timespec ) )  +  \
+                     CMSG_SPACE ( sizeof ( uint32_t ) ) )
   
   /* Socket receive buffer pause to flush, in microseconds */
   #define  BFUSEC  25000
 
 
-/* IP addressing */
+/* Background receive thread */
+  
+  /* Number of samples held by the sample ring , and by the buffer of
+     samples pending for eye shared memory. At 1250Hz this is over 13
+     seconds of eye samples. */
+  #define  RINGN  EYEIN_RINGN
+  
+  /* Number of samples taken from the backend per read */
+  #define  EYEBAT  256
+  
+  /* Backend poll timeout in seconds. This bounds the time taken for the
+     thread to notice that it must stop. */
+  #define  PLSEC  0.1
+  
+  /* Backend poll timeout in seconds while eye samples are waiting to be
+     written to shared memory */
+  #define  PLWAIT  0.001
+
+
+/* Eye shared memory */
+  
+  /* Number of Matlab arrays written , in order: eye positions , pupil
+     diameters , and mouse positions. This matches metdaqeye. */
+  #define  EYEARR  3
+  
+  /* Number of columns in eye position and pupil diameter arrays , time
+     followed by left x , left y , right x , right y */
+  #define  EYECOL  5
+  
+  /* Bytes in the wshm header of a 2D double array i.e. mxClassID ,
+     complexity flag , number of dimensions , and two dimensions */
+  #define  ARRHDR  ( sizeof ( mxClassID ) + sizeof ( char ) + \
+                     3 * sizeof ( mwSize ) )
+  
+  /* Index of calibration values , screen width and height in degrees ,
+     left/right swap flag , and minimum seconds between writes */
+  #define  CAL_WID  0
+  #define  CAL_HEI  1
+  #define  CAL_SWP  2
+  #define  CAL_DUR  3
 
+
+/* IP addressing */
+  
   /* Maximum reserved port */
   #define  MAXPRT  1023
-
+  
   /* Ping test socket timeout */
   #define   TOSEC  1
   #define  TOUSEC  0
 
 
 /*   Parsing constants   */
-
+  
   /* iViewX command terminator */
   #define  IVXTRM  '\n'
-
-  /* iViewX alternate command terminator */
-  #define  IVXTR2  '\r'
-
-  /* iViewX command separator */
-  #define  IVXSEP  ' '
-
-  /* iViewX eye type for binocular data streaming */
-  #define  IVXBIN  'b'
-
+  
   /* The number of numeric values to be returned per sample form iViewX */
-  #define  NUMVAL  9
-
+  #define  NUMVAL  IVXSPL_NUMVAL
+  
   /* microseconds per second */
   #define  USPERS  1000000.0
-
+  
   /* Gaze position minimum and maximum values , and range */
   #define  GAZMIN  4095.0
   #define  GAZMAX  12287.0
   #define  GAZRNG  8192.0
-
+  
+  /* A time stamp gap is counted when consecutive eye samples are more
+     than this many times the shortest sample interval apart */
+  #define  GAPTHR  1.5
+  
   /* Output argument index , from ivxparse */
   #define  AOUT_TIM   0
   #define  AOUT_GAZE  1
   #define  AOUT_DIAM  2
-
+  #define  AOUT_RTIM  3
+  
   /* ivxparse return values */
     
     /* Eye samples received and parsed */
     #define  IVXPARSE_GOT_SAMPLES  0
-
+    
     /* No eye samples received */
     #define  IVXPARSE_NO_SAMPLES   1
 
@@ -214,54 +370,134 @@ static char *  recbuf ;
 static size_t  rbi = 0 ;
 static size_t  rbd = 0 ;
 
+/* Batched receive , one message header , io vector , and ancillary data
+   buffer per datagram */
+static struct mmsghdr  msgv[ MMSGN ] ;
+static struct iovec     iov[ MMSGN ] ;
+static char             ctl[ MMSGN ][ CTLBUF ] ;
+
+/* Kernel receive time in seconds , and starting byte offset , of each
+   datagram in the user-space receive buffer */
+static double  dgt[ MAXDGM ] ;
+static size_t  dgo[ MAXDGM ] ;
+
+/* Counters of parsed eye samples , datagrams dropped by the kernel because
+   the socket receive buffer was full , samples dropped because the sample
+   ring was full , gaps in iViewX time stamps , and invalid ET_SPL commands.
+   Written by whichever thread parses samples , read with atomic loads. */
+static uint64_t  nspl = 0 , nkdr = 0 , nrdr = 0 , ngap = 0 , nbad = 0 ;
+
+/* Counter of datagrams that were dropped because they were truncated */
+static uint64_t  ntrc = 0 ;
+
+/* Previous iViewX time stamp , and shortest interval between samples , in
+   seconds. For gap detection. Negative until known. */
+static double  tprv = -1.0 , tmin = -1.0 ;
+
+/* Background receive thread is running if non-zero , and its handle. The
+   thread stops when ts_stop becomes non-zero. If it stops because of an
+   error then ts_err holds errno. */
+static int  tson = 0 ;
+static pthread_t  tsid ;
+static int  ts_stop = 0 , ts_err = 0 ;
+
+/* Ingest backend that the receive thread reads , either the iViewX socket
+   or a replay file. ein.read is NULL when there is none. Parsing resumes
+   from rbc in the user-space receive buffer , with rbg the index of its
+   datagram ; rbc is NULL once the buffer is used up. */
+static struct eyein  ein ;
+static const char *  rbc = NULL ;
+static size_t  rbg = 0 ;
+
+/* Single-producer single-consumer sample ring. The receive thread pushes
+   normalised eye samples , ivxudp 'r' copies them out. */
+static struct eyering  ring ;
+
+/* Eye shared memory pipeline. When eyeon is non-zero , the receive thread
+   writes samples to the shared memory mapped at eyemap , of eyesiz bytes ,
+   instead of the sample ring. eyenr readers are expected to acknowledge
+   each write , and eyefdv holds the writer's event fd for each reader.
+   eycl holds the calibration , and eydur the minimum seconds between
+   writes. Counts the number of writes in nshm. */
+static int  eyeon = 0 ;
+static void *  eyemap = NULL ;
+static size_t  eyesiz = 0 ;
+static uint32_t  eyenr = 0 ;
+static int  eyefdv[ MAXCHLD ] ;
+static unsigned char  eyefdn = 0 ;
+static struct eyecal  eycl ;
+static double  eydur = 0 ;
+static uint64_t  nshm = 0 ;
+
+/* Samples waiting to be written to eye shared memory , a circular buffer
+   of pn samples starting at ph. Only the receive thread uses this. Local
+   monotonic time of the last write , in seconds. */
+static struct eyespl  pend[ RINGN ] ;
+static size_t  ph = 0 , pn = 0 ;
+static double  eywt = 0 ;
+
 
 /*--- Global constant variables ---*/
 
 /* iViewX command strings. In memory so that we can measure length. */
-
+  
   /* Ping */
   const char  IVXPNG[] = "ET_PNG\n" ;
-
+  
   /* Streamed data format: eye type character, microsecond time stamp, x-
      axis gaze positions, y-axis gaze positions, x-axis pupil diameters, y-
      axis pupil diameters */
   const char  IVXFRM[] = "ET_FRM \"%ET %TU %SX %SY %DX %DY\"\n" ;
-
+  
   /* Start data streaming */
   const char  IVXSTR[] = "ET_STR\n" ;
-
+  
   /* One sample of eye data from iViewX */
-  const char  IVXSPL[] = "ET_SPL" ;
-
+  const char  IVXSPL[] = IVXSPL_CMD ;
+  
   /* Stops data streaming */
   const char  IVXEST[] = "ET_EST\n" ;
-
+  
   /* Stop fixation detection */
   const char  IVXEFX[] = "ET_EFX\n" ;
-
+  
   /* Stops calibration */
   const char  IVXBRK[] = "ET_BRK\n" ;
 
 /* ivxparse output constants */
   
   /* The number of columns per output argument */
-  const unsigned char  NUMCOL[] = { 1 , 4 , 4 } ;
+  const unsigned char  NUMCOL[] = { 1 , 4 , 4 , 1 } ;
   
   /* The ET_SPL to column mapping for left and right eye values */
   const unsigned char  COLMAP[] = { 0 , 2 , 1 , 3 } ;
-
+  
 
 /*--- Function definitions ---*/
-
+     
      int  notstr ( const mxArray * ) ;
 uint16_t  getport ( const mxArray * ) ;
     void  ivxsock ( const mxArray ** ) ;
+    void  ivxfile ( int , const mxArray ** ) ;
     void  xclose ( void ) ;
- ssize_t  xsendto ( int , const void * , size_t , int , 
+ ssize_t  xsendto ( int , const void * , size_t , int ,
                                     const struct sockaddr * , socklen_t ) ;
  ssize_t  xrecvfrom ( int , void * , size_t , int ) ;
+     int  sdrain ( void ) ;
   double  sread ( void ) ;
+    void  ivxnorm ( double * ) ;
+    void  ivxcount ( double ) ;
     char  ivxparse ( int , mxArray ** ) ;
+    long  ivxin_read ( struct eyein * , struct eyespl * , long ) ;
+    void  tsstart ( void ) ;
+    void  tsstop ( void ) ;
+  void *  tsrecv ( void * ) ;
+    char  ringread ( int , mxArray ** ) ;
+    void  ivxcounters ( int , mxArray ** ) ;
+    void  eyeopen ( const mxArray ** ) ;
+    void  eyepend ( const struct eyespl * ) ;
+    void  eyetime ( size_t , double , double ) ;
+     int  eyewrite ( void ) ;
 
 
 /*** ivxudp function definition ***/
@@ -282,7 +518,7 @@ void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
   /* There must be at least one input argument that is a single Matlab
      char */
   if  ( nrhs  <  1 )
-  
+    
     mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
       "ivxudp arg ivxfun required"  ) ;
   
@@ -304,22 +540,23 @@ void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
     mexErrMsgIdAndTxt (  "MET:ivxudp:funchar"  ,
       "ivxudp error reading arg ivxfun"  ) ;
   
-  /* Additional error checking if function char is not 'o' i.e. open */
-  else if  ( c[ 0 ]  !=  IVXFUN_OPEN )
+  /* Additional error checking if function char is not 'o' or 'f' i.e.
+     open */
+  else if  ( c[ 0 ]  !=  IVXFUN_OPEN  &&  c[ 0 ]  !=  IVXFUN_FILE )
   {
     
-    /* Only ivxfun allowed , no other input args */
-    if  (  nrhs != 1 )
+    /* Only ivxfun allowed , no other input args , except for 'e' */
+    if  (  nrhs != 1  &&  c[ 0 ] != IVXFUN_EYE  )
       
       mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
         "ivxudp too many input args for function '%c'"  ,  c[ 0 ]  ) ;
     
-    /* Socket must be open */
-    else if  (  !s  )
+    /* Socket or replay file must be open */
+    else if  (  !s  &&  !tson  )
       
       mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
         "ivxudp must be open before using function '%c'"  ,  c[ 0 ]  ) ;
-    
+  
   } /* extra error checking */
   
   
@@ -341,30 +578,62 @@ void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
             NLHS_READ  ) ;
       
       /* Read data from socket's buffer and place into ivxudp's buffer.
-         Returns time measurement. */
-      double  tret = sread (  ) ;
+         Returns time measurement. The background receive thread has
+         already done this , so take the time now. */
+      double  tret ;
+      
+      if  ( tson )
+      {
+        
+        /* Quit if the receive thread died */
+        if  ( __atomic_load_n ( &ts_err , __ATOMIC_ACQUIRE ) )
+          mexErrMsgIdAndTxt (  "MET:ivxudp:sread"  ,
+            "ivxudp 'read', receive thread stopped , errno %d"  ,
+              ts_err  ) ;
+        
+        tret = sread (  ) ;
+        
+        /* Copy samples out of the ring */
+        if  (  ringread ( nlhs - 1 , plhs + 1 )  )
+          tret = 0 ;
+      }
       
-      /* Parse data into double values , returns non-zero if NO samples
-         were found i.e. tret must be zero */
-      if  (  ivxparse ( nlhs - 1 , plhs + 1 )  )
-        tret = 0 ;
+      else
+      {
+        tret = sread (  ) ;
+        
+        /* Parse data into double values , returns non-zero if NO samples
+           were found i.e. tret must be zero */
+        if  (  ivxparse ( nlhs - 1 , plhs + 1 )  )
+          tret = 0 ;
+      }
       
       /* Return scalar double time value */
       plhs[ 0 ] = mxCreateDoubleScalar ( tret ) ;
       
       /* Finished reading */
       break ;
-      
-      
+    
+    
     /* Open socket and start data streaming */
     case  IVXFUN_OPEN:
       
       /* Check correct number of input arguments ... */
-      if  ( nrhs  !=  NRHS_OPEN )
+      if  ( nrhs  !=  NRHS_OPEN  &&  nrhs  !=  NRHS_OPTH )
         
         mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
-          "ivxudp open requires %d input arguments in total"  ,
-            NRHS_OPEN  ) ;
+          "ivxudp open requires %d or %d input arguments in total"  ,
+            NRHS_OPEN  ,  NRHS_OPTH  ) ;
+      
+      /* ... and that the thread flag is a real scalar ... */
+      else if  (  nrhs == NRHS_OPTH  &&
+                 ( !mxIsScalar ( prhs[ NRHS_OPTH - 1 ] )  ||
+                   mxIsComplex ( prhs[ NRHS_OPTH - 1 ] )  ||
+                   !( mxIsNumeric ( prhs[ NRHS_OPTH - 1 ] )  ||
+                      mxIsLogical ( prhs[ NRHS_OPTH - 1 ] ) ) )  )
+        
+        mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
+          "ivxudp open arg bg must be a real scalar number or logical"  ) ;
       
       /* ... and output arguments */
       else if  ( 1  <  nlhs )
@@ -372,342 +641,1108 @@ void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
         mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
           "ivxudp open returns at most 1 output argument"  ) ;
       
-      /* No socket can be open yet */
-      else if  ( s )
+      /* No socket or replay file can be open yet */
+      else if  ( s  ||  tson )
         
         mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
           "ivxudp is already open"  ) ;
-        
+      
       
       /* Open and test socket */
       ivxsock ( prhs + 1 ) ;
-
+      
       /* Return socket file descriptor */
       plhs[ 0 ]  =  mxCreateDoubleScalar (  (double) s  ) ;
-
+      
       /* Report */
       mexPrintf (  "ivxudp: opened UDP socket %d, allocated buffer\n"  ,
         s  ) ;
       
+      /* Start background receive thread , if asked to. It reads the
+         socket through the eyein interface. */
+      if  (  nrhs == NRHS_OPTH  &&  mxGetScalar ( prhs[ NRHS_OPTH - 1 ] )  )
+      {
+        memset ( &ein , 0 , sizeof ( ein ) ) ;
+        ein.name = "iViewX UDP" ;
+        ein.fd   = s ;
+        ein.gmin = GAZMIN ;
+        ein.gmax = GAZMAX ;
+        ein.read = ivxin_read ;
+        rbc = NULL ;
+        
+        tsstart ( ) ;
+      }
+      
       /* Finished opening */
       break ;
+    
+    
+    /* Open replay file and start background receive thread */
+    case  IVXFUN_FILE:
+      
+      if  ( nrhs  !=  NRHS_FILE  &&  nrhs  !=  NRHS_FISP )
+        
+        mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
+          "ivxudp file requires %d or %d input arguments in total"  ,
+            NRHS_FILE  ,  NRHS_FISP  ) ;
       
+      else if  ( nlhs )
+        
+        mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
+          "ivxudp file returns no output argument"  ) ;
+      
+      else if  ( s  ||  tson )
+        
+        mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
+          "ivxudp is already open"  ) ;
       
+      ivxfile ( nrhs - 1 , prhs + 1 ) ;
+      break ;
+    
+    
     /* Close socket and stop data streaming */
     case  IVXFUN_CLOSE:
       
       xclose () ;
       break ;
+    
+    
+    /* Return counters */
+    case  IVXFUN_COUNT:
+      
+      if  ( NLHS_COUNT  <  nlhs )
+        
+        mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
+          "ivxudp count provides at most %d output arguments"  ,
+            NLHS_COUNT  ) ;
+      
+      ivxcounters ( nlhs , plhs ) ;
+      break ;
+    
+    
+    /* Write eye samples straight into shared memory */
+    case  IVXFUN_EYE:
+      
+      if  ( nrhs  !=  NRHS_EYE )
+        
+        mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
+          "ivxudp eye requires %d input arguments in total"  ,
+            NRHS_EYE  ) ;
       
+      else if  ( nlhs )
+        
+        mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
+          "ivxudp eye returns no output argument"  ) ;
       
+      eyeopen ( prhs + 1 ) ;
+      break ;
+    
+    
     /* Unrecognised function */
     default:
       
       mexErrMsgIdAndTxt (  "MET:ivxudp:ivxfun"  ,
         "ivxudp arg ivxfun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  
+  
+  } /* choose sub-function */
+
+
+} /* ivxudp */
+
+
+/*---Subroutines---*/
+
+/* Parse iViewX commands , returns 0 if eye samples parsed , returns non-
+   zero value if NO eye samples found. This is a single pass over the
+   receive buffer ; each sample is found by ivxnext , its values are
+   converted by ivxvals , and the result goes straight into the output
+   columns. */
+char  ivxparse ( int  nlhs , mxArray *  plhs[] )
+{
+  
+  
+  /*-- Check input --*/
+  
+  /* No output arguments requested at all, empty user-space receive buffer
+     and return assuming no samples (it doesn't matter anyway) */
+  if  ( nlhs  <=  -1 )
+  {
+    rbi = rbd = 0 ;
+    return  IVXPARSE_NO_SAMPLES ;
+  }
+  
+  
+  /*-- Variables --*/
+  
+  /* char pointers - ci for scanning receive buffer (initialised at head of
+     receive buffer) , ce the first byte past end of rec buffer */
+  const char  * ci = recbuf  ,  * ce = recbuf + rbi ;
+  
+  /* Counters - i & j generic counters , N is the number of binocular eye
+     samples (initialised to zero) , R is the number of rows allocated per
+     output column , g is the index of the datagram being scanned , bad is
+     the number of invalid samples */
+  size_t  i , j , N = 0 , R , g = 0 , bad = 0 ;
+  
+  /* double pointer array , each element points to memory allocated for
+     output arguments */
+  double *  dp[ NLHS_READ - 1 ] ;
+  
+  /* double value parsing buffer , has enough space to read in one full
+     sample */
+  double  d[ NUMVAL ] ;
+  
+  
+  /*-- Pre-allocate empty double arrays --*/
+  
+  /* Start with empties , in case there are no new eye samples */
+  for  ( i = 0  ;  i < ( size_t ) nlhs  ;  i++ )
+    
+    plhs[ i ] = mxCreateDoubleMatrix ( 0 , 0 , mxREAL ) ;
+  
+  /* Alas! There are no new eye samples. Return now. */
+  if  ( !rbi )
+    return  IVXPARSE_NO_SAMPLES ;
+  
+  
+  /*-- Allocate memory for new samples --*/
+  
+  /* Upper bound on the number of samples in the buffer */
+  R = rbi / IVXSPL_MINLEN  +  1 ;
+  
+  /* Allocate for each requested output argument */
+  for  ( i = 0  ;  i < ( size_t ) nlhs  ;  i++ )
+    
+    dp[ i ] = mxMalloc (  R * NUMCOL[ i ] * sizeof( double )  ) ;
+  
+  
+  /*-- Locate and parse new eye samples --*/
+  
+  while  ( ( ci = ivxnext ( ci , ce , &bad ) )  !=  NULL )
+  {
+    
+    /* Find the datagram that holds this sample */
+    while  ( g + 1 < rbd  &&  dgo[ g + 1 ]  <=  ( size_t ) ( ci - recbuf ) )
+      ++g ;
+    
+    /* Parse each individual numeric value , and count the sample */
+    ci = ivxvals ( ci , ce , d ) ;
+    ivxcount ( d[ 0 ]  /  USPERS ) ;
+    
+    /* No eye-data output arguments requested , only count samples */
+    if  ( nlhs  <=  0 )
+    {
+      ++N ;
+      continue ;
+    }
+    
+    /* Convert gaze positions to normalised values */
+    ivxnorm ( d ) ;
+    
+    /* We are guaranteed to return time values at this point , so convert
+       to seconds from microseconds */
+    dp[ AOUT_TIM ][ N ] = d[ 0 ]  /  USPERS ;
+    
+    /* Map gaze and diameter values into allocated memory , where columns
+       start R elements apart */
+    if  ( AOUT_GAZE  <  nlhs )
+      for  ( j = 0  ;  j < 4  ;  j++ )
+        dp[ AOUT_GAZE ][ R * j + N ] = d[ COLMAP[ j ] + 1 ] ;
+    
+    if  ( AOUT_DIAM  <  nlhs )
+      for  ( j = 0  ;  j < 4  ;  j++ )
+        dp[ AOUT_DIAM ][ R * j + N ] = d[ COLMAP[ j ] + 5 ] ;
+    
+    /* Store kernel receive time */
+    if  ( AOUT_RTIM  <  nlhs )
+      dp[ AOUT_RTIM ][ N ] = dgt[ g ] ;
+    
+    /* Count sample */
+    ++N ;
+  
+  } /* parse receive buffer */
+  
+  /* Empty user-space receive buffer */
+  rbi = rbd = 0 ;
+  
+  /* Report invalid samples */
+  nbad += bad ;
+  
+  if  ( bad )
+    mexPrintf (  "ivxudp: %zu invalid %s commands , not binocular or no "
+      "data provided\n" ,  bad ,  IVXSPL  ) ;
+  
+  /* No new eye samples , return now */
+  if  ( !N )
+  {
+    for  ( i = 0  ;  i < ( size_t ) nlhs  ;  ++i )
+      mxFree ( dp[ i ] ) ;
+    
+    return  IVXPARSE_NO_SAMPLES ;
+  }
+  
+  /* Otherwise, no eye-data output arguments requested */
+  if  ( nlhs  <=  0 )
+    return  IVXPARSE_GOT_SAMPLES ;
+  
+  
+  /*-- Return parsed output in Matlab matrices --*/
+  
+  for  ( i = 0  ;  i < ( size_t ) nlhs  ;  ++i )
+  {
+    
+    /* Close the gaps between columns , now that N is known */
+    for  ( j = 1  ;  j < NUMCOL[ i ]  ;  j++ )
+      memmove ( dp[ i ] + N * j , dp[ i ] + R * j , N * sizeof ( double ) ) ;
+    
+    /* Set data and dimensions */
+    mxSetData (  plhs[ i ]  ,  dp[ i ]      ) ;
+    mxSetM    (  plhs[ i ]  ,  N            ) ;
+    mxSetN    (  plhs[ i ]  ,  NUMCOL[ i ]  ) ;
+  
+  } /* pack output */
+  
+  /* Beware that we didn't need to free memory pointed to by dp because
+     it is attached to an output array that Matlab will now keep track of
+   */
+  
+  
+  /*-- Return function output --*/
+  
+  /* We wouldn't get this far if there were no samples */
+  return  IVXPARSE_GOT_SAMPLES ;
+
+
+} /* ivxparse */
+
+
+/* Read streamed eye data from iViewX out of socket and return local time
+   as measured immediately after reading. If the background receive thread
+   is running then it owns the socket , and only the time is taken. */
+double  sread ( void )
+{
+  
+  /* Read time measurement */
+  struct timeval  t ;
+  
+  /* Drain socket */
+  if  ( !tson  &&  sdrain ( ) )
+    mexErrMsgIdAndTxt (  "MET:ivxudp:sread"  ,
+      "ivxudp 'read', Unexpected error"  ) ;
+  
+  /* Read time */
+  if  ( gettimeofday ( &t , NULL ) == -1 )
+    mexErrMsgIdAndTxt ( "MET:ivxudp:sread" ,
+            "ivxudp: gettimeofday errno %d" , errno ) ;
+  
+  /* Return time in seconds */
+  return   (double) t.tv_sec  +  (double) t.tv_usec / USPERS ;
+
+} /* sread */
+
+
+/* Drain the socket into the user-space receive buffer. Datagrams are
+   received in batches of up to MMSGN with recvmmsg ( ) , each into its own
+   BUFTHR byte slot of the receive buffer. They are then packed end to end ,
+   so that ivxparse sees the same contiguous stream of commands as before.
+   Makes no Matlab API calls , so that the receive thread can use it.
+   Returns 0 on success , or -1 on error with errno set. */
+int  sdrain ( void )
+{
+  
+  
+  /*--Variables--*/
+  
+  /* Number of datagrams requested and received , and a counter */
+  int  n , r , i ;
+  
+  /* Ancillary data of one datagram */
+  struct cmsghdr *  cm ;
+  struct timespec  ts ;
+  
+  /* Bytes in one datagram */
+  size_t  br ;
+  
+  /* Receive buffer pointer variable */
+  char *  pv = recbuf + rbi ;
+  
+  /* Space remaining in receive buffer */
+  size_t  rem = RECBUF - rbi ;
+  
+  /* Kernel drop count */
+  uint32_t  kd ;
+  
+  
+  /*--Read eye data from socket--*/
+  
+  /* User-space receive buffer must still have enough space , and room to
+     keep track of more datagrams */
+  while  ( BUFTHR  <=  rem  &&  rbd < MAXDGM )
+  {
+    
+    /* Number of datagram slots that fit in the remaining space */
+    n = rem / BUFTHR ;
+    if  ( MMSGN  <  n )  n = MMSGN ;
+    if  ( MAXDGM - rbd  <  ( size_t ) n )  n = MAXDGM - rbd ;
+    
+    /* Point each slot into the receive buffer. The kernel shrinks
+       msg_controllen to what it used , so restore it each time. */
+    for  ( i = 0  ;  i < n  ;  i++ )
+    {
+      iov[ i ].iov_base = pv  +  i * BUFTHR ;
+      iov[ i ].iov_len  = BUFTHR ;
+      msgv[ i ].msg_hdr.msg_controllen = CTLBUF ;
+    }
     
+    /* Receive as many datagrams as are waiting , up to n */
+    r = recvmmsg ( s , msgv , n , MSG_DONTWAIT , NULL ) ;
+    
+    /* Error detected */
+    if  (  r == -1  )
+    {
       
-  } /* choose sub-function */
+      /* Signal interruption , try again */
+      if  (  errno == EINTR  )
+        continue ;
+      
+      /* Non-blocking read, no data available */
+      else if  (  errno == EAGAIN  ||  errno == EWOULDBLOCK  )
+        break ;
+      
+      /* This shouldn't happen */
+      else
+        return  -1 ;
+    
+    } /* error */
+    
+    /* Pack datagrams end to end. Slot i never starts before pv , so the
+       copy only ever moves data towards the head of the buffer */
+    for  ( i = 0  ;  i < r  ;  i++ )
+    {
+      
+      br = msgv[ i ].msg_len ;
+      
+      /* A datagram too big for its slot was truncated. Slots hold the
+         largest UDP payload , so this should not happen. Drop it rather
+         than parse a partial sample , and count it. */
+      if  ( msgv[ i ].msg_hdr.msg_flags  &  MSG_TRUNC )
+      {
+        __atomic_add_fetch ( &ntrc , 1 , __ATOMIC_RELAXED ) ;
+        continue ;
+      }
+      
+      if  ( pv  !=  iov[ i ].iov_base )
+        memmove ( pv , iov[ i ].iov_base , br ) ;
+      
+      /* Kernel receive time stamp. Zero if , somehow , there is none */
+      ts.tv_sec = ts.tv_nsec = 0 ;
+      
+      for  ( cm = CMSG_FIRSTHDR ( &msgv[ i ].msg_hdr ) ;  cm != NULL ;
+             cm = CMSG_NXTHDR ( &msgv[ i ].msg_hdr , cm ) )
+        
+        if  ( cm->cmsg_level == SOL_SOCKET  &&
+              cm->cmsg_type  == SCM_TIMESTAMPNS )
+          memcpy ( &ts , CMSG_DATA ( cm ) , sizeof ( ts ) ) ;
+        
+        /* Running total of datagrams that the kernel dropped */
+        else if  ( cm->cmsg_level == SOL_SOCKET  &&
+                   cm->cmsg_type  == SO_RXQ_OVFL )
+        {
+          memcpy ( &kd , CMSG_DATA ( cm ) , sizeof ( kd ) ) ;
+          __atomic_store_n ( &nkdr , kd , __ATOMIC_RELAXED ) ;
+        }
+      
+      /* Remember where the datagram starts and when it arrived */
+      dgo[ rbd ] = pv - recbuf ;
+      dgt[ rbd ] = (double) ts.tv_sec  +  (double) ts.tv_nsec / NSPERS ;
+      
+      /* Update buffer position and remaining space */
+      pv += br ;
+      rem -= br ;
+      
+      /* Count datagram */
+      ++rbd ;
     
+    } /* pack */
+    
+    /* Fewer datagrams than slots , so the socket is drained */
+    if  ( r  <  n )
+      break ;
   
-} /* ivxudp */
+  } /* read loop */
+  
+  
+  /*--Number of bytes in buffer--*/
+  
+  rbi  =  RECBUF - rem  ;
+  
+  return  0 ;
+
+
+} /* sdrain */
+
+
+/* Clip and normalise the gaze positions of one parsed sample , d[ 1 ] to
+   d[ 4 ] */
+void  ivxnorm ( double *  d )
+{
+  
+  unsigned char  j ;
+  
+  for  ( j = 1  ;  j < 5  ;  j++ )
+  {
+    /* Clip to minimum ... */
+    if  ( d[ j ]  <  GAZMIN )
+      
+      d[ j ] = GAZMIN ;
+    
+    /* ... and maximum values */
+    else if  ( d[ j ]  >  GAZMAX )
+      
+      d[ j ] = GAZMAX ;
+    
+    /* Normalised value */
+    d[ j ] = ( d[ j ]  -  GAZMIN )  /  GAZRNG ;
+  }
+
+} /* ivxnorm */
+
+
+/* Count one parsed sample with iViewX time stamp t , in seconds , and look
+   for a gap since the previous sample. Only called by the thread that
+   parses samples. */
+void  ivxcount ( double  t )
+{
+  
+  /* Interval since last sample */
+  double  dt = t - tprv ;
+  
+  __atomic_add_fetch ( &nspl , 1 , __ATOMIC_RELAXED ) ;
+  
+  /* Have a previous sample that came earlier */
+  if  ( 0 <= tprv  &&  0 < dt )
+  {
+    
+    /* Interval is a gap compared with the shortest one so far */
+    if  ( 0 < tmin  &&  GAPTHR * tmin  <  dt )
+      __atomic_add_fetch ( &ngap , 1 , __ATOMIC_RELAXED ) ;
+    
+    /* Shortest interval */
+    if  ( tmin < 0  ||  dt < tmin )
+      tmin = dt ;
+  
+  }
+  
+  tprv = t ;
+
+} /* ivxcount */
+
+
+/* Start the background receive thread on backend ein. From now on it owns
+   the backend , including any socket and the user-space receive buffer.
+   The MEX file is locked in memory , so that Matlab cannot clear it while
+   the thread runs. */
+void  tsstart ( void )
+{
+  
+  int  e ;
+  
+  __atomic_store_n ( &ts_stop , 0 , __ATOMIC_RELAXED ) ;
+  __atomic_store_n ( &ts_err  , 0 , __ATOMIC_RELAXED ) ;
+  eyering_init ( &ring ) ;
+  
+  if  ( ( e = pthread_create ( &tsid , NULL , tsrecv , NULL ) ) )
+  {
+    xclose ( ) ;
+    mexErrMsgIdAndTxt (  "MET:ivxudp:thread"  ,
+      "ivxudp 'open' , failed to start receive thread , error %d"  ,  e  ) ;
+  }
+  
+  tson = 1 ;
+  mexLock ( ) ;
+  
+  mexPrintf (  "ivxudp: started receive thread\n"  ) ;
+
+} /* tsstart */
+
+
+/* Stop the background receive thread and wait for it to finish */
+void  tsstop ( void )
+{
+  
+  if  ( !tson )  return ;
+  
+  __atomic_store_n ( &ts_stop , 1 , __ATOMIC_RELEASE ) ;
+  pthread_join ( tsid , NULL ) ;
+  
+  tson = 0 ;
+  mexUnlock ( ) ;
+  
+  mexPrintf (  "ivxudp: stopped receive thread\n"  ) ;
+
+} /* tsstop */
+
+
+/* eyein read function of the iViewX UDP stream , for the receive thread.
+   Parses up to n binocular samples out of the user-space receive buffer ,
+   with the kernel receive time of each sample's datagram. Drains the
+   socket again once every sample in the buffer has been taken. Gaze is
+   raw , as the interface requires. Makes no Matlab API calls. */
+long  ivxin_read ( struct eyein *  e , struct eyespl *  v , long  n )
+{
+  
+  /* End of receive buffer , one parsed sample , invalid sample count */
+  const char *  ce ;
+  double  d[ NUMVAL ] ;
+  size_t  bad = 0 ;
+  
+  /* Number of samples , generic counter */
+  long  k = 0 ;
+  unsigned char  j ;
+  
+  /* Receive buffer used up , drain the socket into it */
+  if  ( rbc  ==  NULL )
+  {
+    rbi = rbd = 0 ;
+    
+    if  ( sdrain ( ) )
+      return  -1 ;
+    
+    rbc = recbuf ;
+    rbg = 0 ;
+  }
+  
+  ce = recbuf + rbi ;
+  
+  while  ( k < n  &&  ( rbc = ivxnext ( rbc , ce , &bad ) )  !=  NULL )
+  {
+    
+    /* Datagram that holds the sample */
+    while  ( rbg + 1 < rbd  &&  dgo[ rbg + 1 ] <= ( size_t ) ( rbc - recbuf ) )
+      ++rbg ;
+    
+    rbc = ivxvals ( rbc , ce , d ) ;
+    
+    v[ k ].tim  = d[ 0 ]  /  USPERS ;
+    v[ k ].rtim = dgt[ rbg ] ;
+    
+    for  ( j = 0  ;  j < EYEIN_NUMCOL  ;  j++ )
+    {
+      v[ k ].gaze[ j ] = d[ COLMAP[ j ] + 1 ] ;
+      v[ k ].diam[ j ] = d[ COLMAP[ j ] + 5 ] ;
+    }
+    
+    ++k ;
+  
+  } /* parse */
+  
+  e->bad += bad ;
+  
+  return  k ;
+
+} /* ivxin_read */
+
+
+/* Background receive thread. Waits until the backend has samples , or
+   until the next one is due , then reads them in batches. Each sample is
+   counted and normalised , then either pushed into the sample ring or held
+   for eye shared memory. If the ring is full then new samples are dropped
+   and counted. Makes no Matlab API calls. */
+void *  tsrecv ( void *  arg )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Backend poll , ignored when the backend has no file descriptor , and
+     its timeout */
+  struct pollfd  p = { ein.fd , POLLIN , 0 } ;
+  struct timespec  pt ;
+  double  to , du ;
+  
+  /* One batch of samples , the number in it , and a counter */
+  struct eyespl  b[ EYEBAT ] ;
+  long  k , i ;
+  
+  /* Eye shared memory pipeline is on , and number of samples that it
+     received from one wake-up */
+  int  eon ;
+  size_t  n ;
+  
+  /* No argument is handed to the thread */
+  ( void ) arg ;
+  
+  
+  /*-- Receive loop --*/
+  
+  while  ( !__atomic_load_n ( &ts_stop , __ATOMIC_ACQUIRE ) )
+  {
+    
+    /* Eye shared memory pipeline is on */
+    eon = __atomic_load_n ( &eyeon , __ATOMIC_ACQUIRE ) ;
+    
+    /* Wait for data , or for the next sample to be due , or time out to
+       check the stop flag. Check back soon if samples are waiting for
+       readers of eye shared memory. */
+    to = eon && pn  ?  PLWAIT  :  PLSEC ;
+    
+    if  ( ein.due  &&  0 <= ( du = ein.due ( &ein ) )  &&  du < to )
+      to = du ;
+    
+    pt.tv_sec  = ( time_t ) to ;
+    pt.tv_nsec = ( long ) ( ( to - pt.tv_sec ) * NSPERS ) ;
+    
+    if  ( ppoll ( &p , 1 , &pt , NULL )  ==  -1 )
+    {
+      if  ( errno  ==  EINTR )  continue ;
+      break ;
+    }
+    
+    /* A socket with nothing new */
+    if  ( ein.fd != -1  &&  !( p.revents & POLLIN ) )
+    {
+      if  ( eon  &&  pn )  eyewrite ( ) ;
+      continue ;
+    }
+    
+    
+    /*-- Read batches --*/
+    
+    n = 0 ;
+    
+    do
+    {
+      
+      if  ( ( k = ein.read ( &ein , b , EYEBAT ) )  ==  -1 )
+        break ;
+      
+      for  ( i = 0  ;  i < k  ;  i++ )
+      {
+        
+        ivxcount ( b[ i ].tim ) ;
+        eyenorm ( &ein , b + i ) ;
+        
+        /* Eye shared memory pipeline , hold sample for writing */
+        if  ( eon )
+        {
+          eyepend ( b + i ) ;
+          ++n ;
+        }
+        
+        /* Ring is full */
+        else if  ( !eyering_push ( &ring , b + i ) )
+          __atomic_add_fetch ( &nrdr , 1 , __ATOMIC_RELAXED ) ;
+      
+      } /* samples */
+    
+    /* A full batch means that there may be more */
+    } while  ( k  ==  EYEBAT ) ;
+    
+    if  ( k  ==  -1 )
+      break ;
+    
+    __atomic_store_n ( &nbad , ein.bad , __ATOMIC_RELAXED ) ;
+    
+    /* Convert new pending samples to local time , using the last sample
+       of the last batch that had any , then try to write them to eye
+       shared memory */
+    if  ( n )
+      eyetime ( n , pend[ ( ph + pn - 1 ) & ( RINGN - 1 ) ].tim ,
+                    pend[ ( ph + pn - 1 ) & ( RINGN - 1 ) ].rtim ) ;
+    
+    if  ( eon  &&  pn )
+      eyewrite ( ) ;
+  
+  } /* receive loop */
+  
+  /* Stopped by error , tell ivxudp 'r' and the terminal , because
+     nothing else may be watching when samples go to shared memory */
+  if  ( !__atomic_load_n ( &ts_stop , __ATOMIC_ACQUIRE ) )
+  {
+    perror ( "MET:ivxudp:tsrecv" ) ;
+    __atomic_store_n ( &ts_err , errno ? errno : EIO , __ATOMIC_RELEASE ) ;
+  }
+  
+  return  NULL ;
+
+} /* tsrecv */
+
+
+/* Copy all eye samples out of the sample ring into output arguments , in
+   the same form as ivxparse. Returns IVXPARSE_NO_SAMPLES if the ring was
+   empty , and IVXPARSE_GOT_SAMPLES otherwise. */
+char  ringread ( int  nlhs , mxArray *  plhs[] )
+{
+  
+  /* Ring tail , number of samples , counters */
+  uint64_t  t ;
+  size_t  N , j , k ;
+  int  i ;
+  
+  /* Output argument data , and one ring sample */
+  double *  dp ;
+  const struct eyespl *  q ;
+  
+  /* Everything that the receive thread has published */
+  N = eyering_peek ( &ring , &t ) ;
+  
+  /* No eye sample output arguments requested , release the samples */
+  if  ( nlhs  <  1 )
+  {
+    eyering_pop ( &ring , N ) ;
+    return  N ? IVXPARSE_GOT_SAMPLES : IVXPARSE_NO_SAMPLES ;
+  }
+  
+  /* Start with empties */
+  for  ( i = 0  ;  i < nlhs  ;  i++ )
+    plhs[ i ] = mxCreateDoubleMatrix ( 0 , 0 , mxREAL ) ;
+  
+  if  ( !N )
+    return  IVXPARSE_NO_SAMPLES ;
+  
+  /* Copy out columns of each requested output argument */
+  for  ( i = 0  ;  i < nlhs  ;  i++ )
+  {
+    
+    dp = mxMalloc (  N * NUMCOL[ i ] * sizeof( double )  ) ;
+    
+    for  ( k = 0  ;  k < N  ;  k++ )
+    {
+      q = ring.s + ( ( t + k ) & ( RINGN - 1 ) ) ;
+      
+      switch  ( i )
+      {
+        case  AOUT_TIM:   dp[ k ] = q->tim ;   break ;
+        case  AOUT_RTIM:  dp[ k ] = q->rtim ;  break ;
+        
+        case  AOUT_GAZE:
+          for  ( j = 0  ;  j < NUMCOL[ i ]  ;  j++ )
+            dp[ N * j + k ] = q->gaze[ j ] ;
+          break ;
+        
+        case  AOUT_DIAM:
+          for  ( j = 0  ;  j < NUMCOL[ i ]  ;  j++ )
+            dp[ N * j + k ] = q->diam[ j ] ;
+      }
+    }
+    
+    mxSetData (  plhs[ i ]  ,  dp           ) ;
+    mxSetM    (  plhs[ i ]  ,  N            ) ;
+    mxSetN    (  plhs[ i ]  ,  NUMCOL[ i ]  ) ;
+  
+  }
+  
+  /* Release slots to the receive thread */
+  eyering_pop ( &ring , N ) ;
+  
+  return  IVXPARSE_GOT_SAMPLES ;
+
+} /* ringread */
+
+
+/* Return counters as scalar doubles , in order: parsed samples , datagrams
+   dropped by the kernel , samples dropped by the ring , time stamp gaps ,
+   invalid ET_SPL commands , writes to eye shared memory , and truncated
+   datagrams */
+void  ivxcounters ( int  nlhs , mxArray *  plhs[] )
+{
+  
+  uint64_t *  c[ NLHS_COUNT ] =
+    { &nspl , &nkdr , &nrdr , &ngap , &nbad , &nshm , &ntrc } ;
+  int  i ;
+  
+  for  ( i = 0  ;  i < nlhs  ||  i < 1  ;  i++ )
+    plhs[ i ] = mxCreateDoubleScalar (
+      ( double ) __atomic_load_n ( c[ i ] , __ATOMIC_RELAXED ) ) ;
 
+} /* ivxcounters */
 
-/*---Subroutines---*/
 
-/* Parse iViewX commands , returns 0 if eye samples parsed , returns non-
-   zero value if NO eye samples found */
-char  ivxparse ( int  nlhs , mxArray *  plhs[] )
+/* Map the shared memory described by W = met ( 'shmwr' , shm ) and make
+   the receive thread write eye samples to it. m[ 0 ] is W , m[ 1 ] holds
+   the calibration values. See eyewrite for the format. */
+void  eyeopen ( const mxArray *  m[] )
 {
   
   
-  /*-- Check input --*/
+  /*-- Variables --*/
   
-  /* No output arguments requested at all, empty user-space receive buffer
-     and return assuming no samples (it doesn't matter anyway) */
-  if  ( nlhs  <=  -1 )
-  {
-    rbi = rbd = 0 ;
-    return  IVXPARSE_NO_SAMPLES ;
-  }
+  /* Fields of W */
+  const mxArray  * f , * nr , * v ;
   
+  /* Shared memory file name , file descriptor , and file status */
+  char  fnm[ MSHM_FNMLEN ] ;
+  int  fd ;
+  struct stat  st ;
   
-  /*-- Variables --*/
+  /* Calibration values and event fd's , and a counter */
+  double  * c , * e ;
+  size_t  i ;
   
-  /* char pointers - ci for scanning receive buffer (initialised at head of
-     receive buffer) , cj another scanning pointer (initialised to first
-     byte past end of rec buffer) , p an array of pointers that locate the
-     first byte of the first numeric value from each sample */
-  char  * ci = recbuf  ,  * cj = recbuf + rbi ,  * p[ rbd ] ;
-  
-  /* Counters - i, j & k generic counters , N is the number of binocular
-     eye samples (initialised to zero) , icol[ c ] the starting index for
-     column c in a N x 4 array , aout and oset are output argument index
-     and d index offset */
-  size_t  i , N = 0 , icol[ 4 ] ;
-  unsigned char  j , k , aout , oset ;
   
-  /* double pointer array , each element points to memory allocated for
-     output arguments */
-  double *  dp[ NLHS_READ - 1 ] ;
+  /*-- Check input --*/
   
-  /* double value parsing buffer , has enough space to read in one full
-     sample */
-  double  d[ NUMVAL ] ;
+  /* Samples only reach shared memory through the receive thread */
+  if  ( !tson )
+    mexErrMsgIdAndTxt (  "MET:ivxudp:eye"  ,
+      "ivxudp 'eye' , needs the background receive thread , see 'open' "
+      "or 'file'"  ) ;
   
+  else if  ( eyemap  !=  NULL )
+    mexErrMsgIdAndTxt (  "MET:ivxudp:eye"  ,
+      "ivxudp 'eye' , already writing to shared memory"  ) ;
   
-  /*-- Pre-allocate empty double arrays --*/
+  /* W must be a scalar struct from met 'shmwr' */
+  if  ( !mxIsStruct ( m[ 0 ] )  ||  !mxIsScalar ( m[ 0 ] )  ||
+        ( f  = mxGetField ( m[ 0 ] , 0 , "file"  ) )  ==  NULL  ||
+        ( nr = mxGetField ( m[ 0 ] , 0 , "nr"    ) )  ==  NULL  ||
+        (  v = mxGetField ( m[ 0 ] , 0 , "wefdv" ) )  ==  NULL  ||
+        notstr ( f )  ||  !mxIsDouble ( nr )  ||  !mxIsScalar ( nr )  ||
+        !mxIsDouble ( v )  ||  MAXCHLD < mxGetNumberOfElements ( v )  )
+    mexErrMsgIdAndTxt (  "MET:ivxudp:eye"  ,
+      "ivxudp 'eye' , W must be returned by met ( 'shmwr' , shm )"  ) ;
   
-  /* Start with empties , in case there are no new eye samples */
-  for  ( i = 0  ;  i < nlhs  ;  i++ )
-    
-    plhs[ i ] = mxCreateDoubleMatrix ( 0 , 0 , mxREAL ) ;
+  /* Calibration */
+  if  ( !mxIsDouble ( m[ 1 ] )  ||  mxIsComplex ( m[ 1 ] )  ||
+        mxGetNumberOfElements ( m[ 1 ] )  !=  NUMCAL )
+    mexErrMsgIdAndTxt (  "MET:ivxudp:eye"  ,
+      "ivxudp 'eye' , cal must be a real double with %d elements" ,
+        NUMCAL ) ;
   
-  /* Alas! There are no new eye samples. Return now. */
-  if  ( !rbi )
-    return  IVXPARSE_NO_SAMPLES ;
+  c = mxGetPr ( m[ 1 ] ) ;
+  
+  for  ( i = 0  ;  i < NUMCAL  ;  i++ )
+    if  ( mxIsNaN ( c[ i ] )  ||  mxIsInf ( c[ i ] ) )
+      mexErrMsgIdAndTxt (  "MET:ivxudp:eye"  ,
+        "ivxudp 'eye' , cal must be finite"  ) ;
   
   
-  /*-- Locate and count new eye samples --*/
+  /*-- Map shared memory --*/
   
-  /* Scan entire receive buffer for samples */
-  while  ( ci  <  cj )
+  mxGetString ( f , fnm , MSHM_FNMLEN ) ;
+  
+  if  ( ( fd = shm_open ( fnm , O_RDWR , 0 ) )  ==  -1 )
   {
-    
-    /* We have NOT yet placed ci upon the first byte of an iViewX sample
-       command string , so advance pointer by one more character */
-    if  ( ci[ 0 ] != IVXSPL[ 0 ]  ||
-          ci[ 1 ] != IVXSPL[ 1 ]  ||
-          ci[ 2 ] != IVXSPL[ 2 ]  ||
-          ci[ 3 ] != IVXSPL[ 3 ]  ||
-          ci[ 4 ] != IVXSPL[ 4 ]  ||
-          ci[ 5 ] != IVXSPL[ 5 ]  )
-    {
-      ci++ ;
-      continue ;
-    }
-    
-    /* Jump to first byte past the command string */
-    ci += FNAMEB ;
-    
-    /* Skip separator characters */
-    while  ( *ci  ==  IVXSEP )
-      ci++ ;
-    
-    /* Invalid case check. This byte should be the eye type for binocular,
-       not any other character. In either case, step forward one byte. */
-    if  ( *( ci++ )  !=  IVXBIN )
-    {
-      mexPrintf (  "ivxudp: invalid %s command , not binocular"  ,
-        IVXSPL  ) ;
-      continue ;
-    }
-    
-    /* Skip separator characters */
-    while  ( *ci  ==  IVXSEP )
-      ci++ ;
-    
-    /* If we have encountered the end of a datagram then the data sample
-       format is invalid. Say so, and keep checking the buffer. */
-    if  ( *ci == IVXTRM  ||  *ci == IVXTR2 )
-    {
-      mexPrintf (  "ivxudp: invalid %s command , terminates before "
-        "any data provided" ,  IVXSPL  ) ;
-      ci++ ;
-      continue ;
-    }
-    
-    /* Store pointer location in the buffer AND increment the sample
-       counter */
-    p[ N++ ] = ci ;
-    
-    /* Look for the end of the datagram */
-    while  ( *ci != IVXTRM  &&  *ci != IVXTR2 )
-      ci++ ;
-    
-  } /* scan receive buffer */
+    perror ( "MET:ivxudp:shm_open" ) ;
+    mexErrMsgIdAndTxt (  "MET:ivxudp:eye"  ,
+      "ivxudp 'eye' , failed to open shared memory %s"  ,  fnm  ) ;
+  }
   
-  /* Empty user-space receive buffer */
-  rbi = rbd = 0 ;
+  if  ( fstat ( fd , &st )  ==  -1  ||  st.st_size <= MSHM_SYNC  ||
+        ( eyemap = mmap ( NULL , st.st_size , PROT_READ | PROT_WRITE ,
+                          MAP_SHARED , fd , 0 ) )  ==  MAP_FAILED )
+  {
+    perror ( "MET:ivxudp:mmap" ) ;
+    eyemap = NULL ;
+    close ( fd ) ;
+    mexErrMsgIdAndTxt (  "MET:ivxudp:eye"  ,
+      "ivxudp 'eye' , failed to map shared memory %s"  ,  fnm  ) ;
+  }
   
-  /* No new eye samples , return now */
-  if  ( !N )
-    return  IVXPARSE_NO_SAMPLES ;
+  /* The mapping stays valid without the file descriptor */
+  close ( fd ) ;
   
-  /* Otherwise, no eye-data output arguments requested */
-  if  ( nlhs  <=  0 )
-    return  IVXPARSE_GOT_SAMPLES ;
   
-  /* Find index values */
-  for  ( i = 0  ;  i < 4  ;  i++ )
-    icol[ i ] = N  *  i ;
+  /*-- Configure pipeline --*/
   
+  eyesiz = st.st_size ;
+  eyenr  = ( uint32_t ) mxGetScalar ( nr ) ;
+  eyefdn = mxGetNumberOfElements ( v ) ;
   
-  /*-- Allocate memory for new samples --*/
+  for  ( i = 0 , e = mxGetPr ( v )  ;  i < eyefdn  ;  i++ )
+    eyefdv[ i ] = ( int ) e[ i ] ;
   
-  /* Allocate for each requested output argument */
-  for  ( i = 0  ;  i < nlhs  ;  i++ )
-    
-    dp[ i ] = mxMalloc (  N * NUMCOL[ i ] * sizeof( double )  ) ;
+  eycl.wid = c[ CAL_WID ] ;
+  eycl.hei = c[ CAL_HEI ] ;
+  eycl.swp = c[ CAL_SWP ]  !=  0 ;
+  eydur = c[ CAL_DUR ] ;
+  ph = pn = 0 ;
+  eywt = 0 ;
   
+  /* Hand over to the receive thread. Release orders everything above
+     before the thread sees eyeon. */
+  __atomic_store_n ( &eyeon , 1 , __ATOMIC_RELEASE ) ;
   
-  /*-- Parse strings to doubles --*/
+  mexPrintf (  "ivxudp: writing eye samples to shared memory %s\n"  ,
+    fnm  ) ;
+
+} /* eyeopen */
+
+
+/* Hold one normalised sample q for writing to eye shared memory. The
+   calibration stage converts positions to degrees of visual field from
+   the centre of the screen , as metdaqeye does. If the pending buffer is
+   full then the oldest sample is dropped. The iViewX time stamp is kept
+   until eyetime converts it. */
+void  eyepend ( const struct eyespl *  q )
+{
   
-  /* Parse each eye sample */
-  for  ( i = 0  ;  i < N  ;  i++ )
+  struct eyespl *  p ;
+  
+  /* Buffer full , drop oldest */
+  if  ( pn  ==  RINGN )
   {
-    
-    /* Place pointer at start of sample's first value */
-    ci = p[ i ] ;
-    
-    /* Parse each individual numeric value */
-    for  ( j = 0  ;  j < NUMVAL  ;  j++ )
-    {
-      d[ j ] = strtod (  ci  ,  &cj  ) ;  /* parse */
-      ci = cj ;                           /* next number */
-    }
-    
-    /* Convert gaze positions to normalised values */
-    for  ( j = 1  ;  j < 5  ;  j++ )
-    {
-      /* Clip to minimum ... */
-      if  ( d[ j ]  <  GAZMIN )
-        
-        d[ j ] = GAZMIN ;
-        
-      /* ... and maximum values */
-      else if  ( d[ j ]  >  GAZMAX )
-        
-        d[ j ] = GAZMAX ;
-        
-      /* Normalised value */
-      d[ j ] = ( d[ j ]  -  GAZMIN )  /  GAZRNG ;
-    }
-    
-    /* We are guaranteed to return time values at this point , so convert
-       to seconds from microseconds */
-    dp[ AOUT_TIM ][ i ] = d[ 0 ]  /  USPERS ;
-    
-    /* Store gaze and diameter values */
-    for  ( j = 0  ;  j < nlhs - 1  ;  j++ )
-    {
-      
-      /* Determine output argument index and d's index offset */
-      if  ( j )
-        {  aout = AOUT_DIAM ;  oset = 5 ;  }
-      
-      else
-        {  aout = AOUT_GAZE ;  oset = 1 ;  }
-      
-      /* Map newly parsed data into allocated memory */
-      for  ( k = 0  ;  k < 4  ;  k++ )
-      
-        dp[ aout ][ icol[ k ] + i ] = d[ COLMAP[ k ] + oset ] ;
-      
-    } /* store gaze and diam */
-    
-  } /* samples */
+    ph = ( ph + 1 ) & ( RINGN - 1 ) ;
+    --pn ;
+    __atomic_add_fetch ( &nrdr , 1 , __ATOMIC_RELAXED ) ;
+  }
+  
+  p = pend + ( ( ph + pn++ ) & ( RINGN - 1 ) ) ;
+  *p = *q ;
+  eyecal ( &eycl , p ) ;
+
+} /* eyepend */
+
+
+/* Convert the iViewX time stamps of the newest n pending samples to local
+   time. As in metdaqeye , the last sample is taken to arrive at local time
+   rt , and its iViewX time is t , both in seconds. */
+void  eyetime ( size_t  n , double  t , double  rt )
+{
   
+  size_t  i ;
+  struct eyespl *  p ;
   
-  /*-- Return parsed output in Matlab matrices --*/
+  /* Some of the new samples may have been dropped */
+  if  ( pn  <  n )  n = pn ;
   
-  for  ( i = 0  ;  i < nlhs  ;  ++i )
+  for  ( i = pn - n  ;  i < pn  ;  i++ )
   {
-    
-    /* Set data and dimensions */
-    mxSetData (  plhs[ i ]  ,  dp[ i ]      ) ;
-    mxSetM    (  plhs[ i ]  ,  N            ) ;
-    mxSetN    (  plhs[ i ]  ,  NUMCOL[ i ]  ) ;
-    
-  } /* pack output */
+    p = pend + ( ( ph + i ) & ( RINGN - 1 ) ) ;
+    p->tim = p->tim  -  t  +  rt ;
+  }
+
+} /* eyetime */
+
+
+/* Write pending samples to eye shared memory , if all readers have read
+   the last write and at least eydur seconds have passed since
+   then. Follows the same protocol as met 'write' , and writes EYEARR
+   arrays in the format of wshm , so that met 'read' returns the same as
+   for metdaqeye: an N x 5 double of [ time , left x , left y , right x ,
+   right y ] eye positions in degrees , an N x 5 double of pupil diameters
+   with the same column order , and an empty double for mouse positions.
+   Returns 1 if written , 0 if not. Makes no Matlab API calls. */
+int  eyewrite ( void )
+{
   
-  /* Beware that we didn't need to free memory pointed to by dp because
-     it is attached to an output array that Matlab will now keep track of
-   */
   
+  /*-- Variables --*/
   
-  /*-- Return function output --*/
+  /* Synchronisation block , and bitmask of readers in select */
+  struct metshmsync *  sync = eyemap ;
+  uint32_t  rsel ;
   
-  /* We wouldn't get this far if there were no samples */
-  return  IVXPARSE_GOT_SAMPLES ;
+  /* Data header , write pointer , and number of samples */
+  size_t  * hdr ;
+  char  * w ;
+  size_t  N , i ;
   
+  /* One pending sample , array header values */
+  const struct eyespl *  p ;
+  mxClassID  cid = mxDOUBLE_CLASS ;
+  char  cfl = 0 ;
+  mwSize  dim[ 3 ] ;
   
-} /* ivxparse */
-
-
-/* Read streamed eye data from iViewX out of socket and return local time
-   as measured immediately after reading */
-double  sread ( void )
-{
+  /* Current time , and event fd post value */
+  struct timespec  ts ;
+  double  now ;
+  uint64_t  v = WEFD_POST ;
   
+  /* Array , and column counters */
+  unsigned char  a , j ;
   
-  /*--Variables--*/
   
-  /* Bytes received */
-  ssize_t  br = 0 ;
+  /*-- Ready to write? --*/
   
-  /* Receive buffer pointer variable */
-  char *  pv = recbuf ;
+  /* Readers have not all read the last write */
+  if  ( sync->gen  &&
+        __atomic_load_n ( &sync->ack , __ATOMIC_ACQUIRE )  <  eyenr )
+    return  0 ;
   
-  /* Space remaining in receive buffer */
-  size_t  rem = RECBUF - rbi ;
+  /* Too soon since the last write */
+  clock_gettime ( CLOCK_MONOTONIC , &ts ) ;
+  now = ts.tv_sec  +  ts.tv_nsec / ( double ) NSPERS ;
   
-  /* Read time measurement */
-  struct timeval  t ;
+  if  ( now  <  eywt + eydur )
+    return  0 ;
   
+  /* Drop the oldest samples if the newest do not all fit */
+  N = ( eyesiz - MSHM_SYNC - SMST_NUM * sizeof ( size_t ) -
+        EYEARR * ARRHDR )  /  ( 2 * EYECOL * sizeof ( double ) ) ;
   
-  /*--Read eye data from socket--*/
-
-  /* Non-zero value must return from recvfrom, and user-space receive
-     buffer must still have enough space.
-   */
-  while (  ( br = xrecvfrom ( s , pv , rem , MSG_DONTWAIT ) )  &&
-             BUFTHR <= rem  )
+  if  ( N  <  pn )
+  {
+    __atomic_add_fetch ( &nrdr , pn - N , __ATOMIC_RELAXED ) ;
+    ph = ( ph + pn - N ) & ( RINGN - 1 ) ;
+    pn = N ;
+  }
+  
+  N = pn ;
+  
+  
+  /*-- Write data --*/
+  
+  hdr = ( size_t * ) ( ( char * ) eyemap  +  MSHM_SYNC ) ;
+  hdr[ SMST_NMXAR ] = EYEARR ;
+  w = ( char * ) ( hdr + SMST_NUM ) ;
+  
+  for  ( a = 0  ;  a < EYEARR  ;  a++ )
   {
     
-    /* Error detected */
-    if  (  br == -1  )
-    {
-      
-      /* Non-blocking read, no data available */
-      if  (  errno == EAGAIN  ||  errno == EWOULDBLOCK  )
-        break ;
-      
-      /* This shouldn't happen */
-      else
-        mexErrMsgIdAndTxt (  "MET:ivxudp:sread"  ,
-          "ivxudp 'read', Unexpected error"  ) ;
-      
-    } /* error */
+    /* Array header , mouse positions are empty */
+    dim[ 0 ] = 2 ;
+    dim[ 1 ] = a < 2  ?  N  :  0 ;
+    dim[ 2 ] = a < 2  ?  EYECOL  :  0 ;
     
-    /* Update buffer position and remaining space */
-    pv += br ;
-    rem -= br ;
+    memcpy ( w , &cid , sizeof ( cid ) ) ;  w += sizeof ( cid ) ;
+    memcpy ( w , &cfl , sizeof ( cfl ) ) ;  w += sizeof ( cfl ) ;
+    memcpy ( w , dim  , sizeof ( dim ) ) ;  w += sizeof ( dim ) ;
     
-    /* Count datagram */
-    ++rbd ;
+    if  ( 2  <=  a )  continue ;
     
-  } /* read loop */
-  
+    /* Columns of time and either gaze or pupil diameter */
+    for  ( j = 0  ;  j < EYECOL  ;  j++ )
+      for  ( i = 0  ;  i < N  ;  i++ , w += sizeof ( double ) )
+      {
+        p = pend + ( ( ph + i ) & ( RINGN - 1 ) ) ;
+        memcpy ( w , !j  ?  &p->tim  :
+                     a   ?  p->diam + j - 1  :  p->gaze + j - 1 ,
+          sizeof ( double ) ) ;
+      }
   
-  /*--Read time measurement--*/
+  } /* arrays */
   
-  if  ( gettimeofday ( &t , NULL ) == -1 )
-    mexErrMsgIdAndTxt ( "MET:ivxudp:sread" ,
-            "ivxudp: gettimeofday errno %d" , errno ) ;
+  /* Number of bytes , counting from the header */
+  hdr[ SMST_BYTES ] = w  -  ( char * ) hdr ;
   
   
-  /*--Number of bytes in buffer--*/
+  /*-- Publish new generation --*/
   
-  rbi  =  RECBUF - rem  ;
+  __atomic_store_n ( &sync->ack , 0 , __ATOMIC_RELAXED ) ;
   
+  if  ( !__atomic_add_fetch ( &sync->gen , 1 , __ATOMIC_SEQ_CST ) )
+    __atomic_add_fetch ( &sync->gen , 1 , __ATOMIC_SEQ_CST ) ;
   
-  /*-- Return time in seconds --*/
+  syscall ( SYS_futex , &sync->gen , FUTEX_WAKE , INT_MAX , NULL , NULL ,
+    0 ) ;
   
-  return   (double) t.tv_sec  +  (double) t.tv_usec / USPERS ;
+  /* Post to the event fd's of readers waiting in met ( 'select' ) */
+  if  ( ( rsel = __atomic_load_n ( &sync->rsel , __ATOMIC_SEQ_CST ) ) )
+    for  ( a = 0  ;  a < eyefdn  ;  a++ )
+      if  ( ( rsel & ( 1U << a ) )  &&  eyefdv[ a ] != FDINIT )
+        while  ( write ( eyefdv[ a ] , &v , sizeof ( v ) ) == -1  &&
+                 errno == EINTR ) ;
   
+  /* Samples written */
+  ph = pn = 0 ;
+  eywt = now ;
+  __atomic_add_fetch ( &nshm , 1 , __ATOMIC_RELAXED ) ;
   
-} /* sread */
+  return  1 ;
+
+} /* eyewrite */
 
 
 /* Open socket and test that it can reach iViewX */
@@ -726,12 +1761,12 @@ void  ivxsock ( const mxArray *  m[] )
   /* Host address */
   struct  sockaddr_in  a ;
   
-  /* Socket receive buffer size */
-  int  rbs = RECBUF ;
+  /* Socket receive buffer size , and flag to switch on socket options */
+  int  rbs = RECBUF , on = 1 ;
   
   /* Socket receive timeout duration, default with size, and temporary */
   struct timeval def ;
-  int  sdef = sizeof ( def ) ;
+  socklen_t  sdef = sizeof ( def ) ;
   
   struct timeval  rto = { TOSEC , TOUSEC } ;
   
@@ -745,7 +1780,7 @@ void  ivxsock ( const mxArray *  m[] )
   if  ( notstr ( m[ 0 ] ) )
     mexErrMsgIdAndTxt ( "MET:ivxudp:openargs" ,
               "ivxudp 'open' , hipa must be a string" ) ;
-    
+  
   if  ( notstr ( m[ 2 ] ) )
     mexErrMsgIdAndTxt ( "MET:ivxudp:openargs" ,
               "ivxudp 'open' , iipa must be a string" ) ;
@@ -772,7 +1807,7 @@ void  ivxsock ( const mxArray *  m[] )
   if  ( !hprt )
     mexErrMsgIdAndTxt ( "MET:ivxudp:openargs" ,
               "ivxudp 'open' , hprt must be a double over 1023" ) ;
-    
+  
   if  ( !iprt )
     mexErrMsgIdAndTxt ( "MET:ivxudp:openargs" ,
               "ivxudp 'open' , iprt must be a double over 1023" ) ;
@@ -798,8 +1833,23 @@ void  ivxsock ( const mxArray *  m[] )
   if  (  ( recbuf = malloc ( RECBUF ) )  ==  NULL  )
     PEX ( "malloc" )
   
-  /* No data in buffer */
+  /* No data in buffer , and nothing counted */
   rbi = rbd = 0 ;
+  nspl = nkdr = nrdr = ngap = nbad = nshm = ntrc = 0 ;
+  tprv = tmin = -1.0 ;
+  
+  /* Each batched message header gathers into its own io vector , and has
+     its own buffer for the kernel receive time stamp. No source address is
+     wanted. */
+  memset ( msgv , 0 , sizeof ( msgv ) ) ;
+  
+  for  ( nb = 0  ;  nb < MMSGN  ;  nb++ )
+  {
+    msgv[ nb ].msg_hdr.msg_iov        = iov + nb ;
+    msgv[ nb ].msg_hdr.msg_iovlen     = 1 ;
+    msgv[ nb ].msg_hdr.msg_control    = ctl[ nb ] ;
+    msgv[ nb ].msg_hdr.msg_controllen = CTLBUF ;
+  }
   
   
   /*--Make UDP socket--*/
@@ -813,10 +1863,22 @@ void  ivxsock ( const mxArray *  m[] )
        )
     PEX ( "MET:ivxudp:setsockopt" )
   
+  /* Kernel time stamps each datagram on arrival */
+  if  (
+  setsockopt ( s , SOL_SOCKET , SO_TIMESTAMPNS , &on , sizeof ( on ) )  ==  -1
+       )
+    PEX ( "MET:ivxudp:setsockopt" )
+  
+  /* Kernel reports how many datagrams it dropped */
+  if  (
+  setsockopt ( s , SOL_SOCKET , SO_RXQ_OVFL , &on , sizeof ( on ) )  ==  -1
+       )
+    PEX ( "MET:ivxudp:setsockopt" )
+  
   /* Get default receive timeout */
   if  ( getsockopt ( s , SOL_SOCKET , SO_RCVTIMEO , &def , &sdef ) == -1 )
     PEX ( "MET:ivxudp:getsockopt" )
-    
+  
   /* Set receive timeout */
   if  (
 setsockopt ( s , SOL_SOCKET , SO_RCVTIMEO , &rto , sizeof ( rto ) )  ==  -1
@@ -839,7 +1901,7 @@ setsockopt ( s , SOL_SOCKET , SO_RCVTIMEO , &rto , sizeof ( rto ) )  ==  -1
       mexErrMsgIdAndTxt ( "MET:ivxudp:openargs" ,
               "ivxudp 'open' hipa & hprt , "
               "address is protected or search permission denied") ;
-      
+    
     else if  ( errno == EADDRINUSE )
       mexErrMsgIdAndTxt ( "MET:ivxudp:openargs" ,
               "ivxudp 'open' hipa & hprt , this address is in use" ) ;
@@ -873,7 +1935,7 @@ setsockopt ( s , SOL_SOCKET , SO_RCVTIMEO , &rto , sizeof ( rto ) )  ==  -1
     
     else
       PEX ( "MET:ivxudp:bind" )
-      
+  
   } /* bind socket -- error handling */
   
   
@@ -881,28 +1943,28 @@ setsockopt ( s , SOL_SOCKET , SO_RCVTIMEO , &rto , sizeof ( rto ) )  ==  -1
   
   /* First, stop any data streaming or calibration */
   nb = strlen ( IVXEST ) ;
-  xsendto ( s , IVXEST , nb , 0 , 
+  xsendto ( s , IVXEST , nb , 0 ,
     ( struct sockaddr * ) &ivxadd , sizeof ( ivxadd ) ) ;
   
   nb = strlen ( IVXEFX ) ;
-  xsendto ( s , IVXEFX , nb , 0 , 
+  xsendto ( s , IVXEFX , nb , 0 ,
     ( struct sockaddr * ) &ivxadd , sizeof ( ivxadd ) ) ;
   
   nb = strlen ( IVXBRK ) ;
-  xsendto ( s , IVXBRK , nb , 0 , 
+  xsendto ( s , IVXBRK , nb , 0 ,
     ( struct sockaddr * ) &ivxadd , sizeof ( ivxadd ) ) ;
   
   /* Give a moment for straggling messages to arrive */
   while  (  usleep ( BFUSEC ) == -1  &&  errno == EINTR  ) ;
   
   /* Try to flush the receive buffer */
-  while  (  br  ==  xrecvfrom ( s , recbuf , RECBUF , MSG_DONTWAIT )  )
+  while  (  ( br = xrecvfrom ( s , recbuf , RECBUF , MSG_DONTWAIT ) )  )
     if  (  br == -1  && ( errno == EAGAIN  ||  errno == EWOULDBLOCK )  )
       break ;
   
   /* Send ping message */
   nb = strlen ( IVXPNG ) ;
-  xsendto ( s , IVXPNG , nb , 0 , 
+  xsendto ( s , IVXPNG , nb , 0 ,
     ( struct sockaddr * ) &ivxadd , sizeof ( ivxadd ) ) ;
   
   
@@ -910,8 +1972,8 @@ setsockopt ( s , SOL_SOCKET , SO_RCVTIMEO , &rto , sizeof ( rto ) )  ==  -1
   
   /* Receive from socket
    */
-  br  ==  xrecvfrom ( s , recbuf , RECBUF - 1 , 0 ) ;
-
+  br  =  xrecvfrom ( s , recbuf , RECBUF - 1 , 0 ) ;
+  
   /* Check for timeout error */
   if  (  br == -1  && ( errno == EAGAIN  ||  errno == EWOULDBLOCK )  )
   {
@@ -919,7 +1981,7 @@ setsockopt ( s , SOL_SOCKET , SO_RCVTIMEO , &rto , sizeof ( rto ) )  ==  -1
     mexErrMsgIdAndTxt ( "MET:ivxudp:openping" ,
            "ivxudp 'open' , timeout waiting for ping reply" ) ;
   }
-
+  
   /* Set null byte */
   recbuf[ br ] = '\0' ;
   
@@ -939,22 +2001,76 @@ setsockopt ( s , SOL_SOCKET , SO_RCVTIMEO , &rto , sizeof ( rto ) )  ==  -1
 setsockopt ( s , SOL_SOCKET , SO_RCVTIMEO , &def , sizeof ( def ) )  ==  -1
        )
     PEX ( "MET:ivxudp:setsockopt" )
-    
-    
+ 
+ 
 	/*-- Start data streaming --*/
   
   /* Send format command */
   nb = strlen ( IVXFRM ) ;
-  xsendto ( s , IVXFRM , nb , 0 , 
+  xsendto ( s , IVXFRM , nb , 0 ,
     ( struct sockaddr * ) &ivxadd , sizeof ( ivxadd ) ) ;
-
+  
   /* Send start command */
   nb = strlen ( IVXSTR ) ;
-  xsendto ( s , IVXSTR , nb , 0 , 
+  xsendto ( s , IVXSTR , nb , 0 ,
     ( struct sockaddr * ) &ivxadd , sizeof ( ivxadd ) ) ;
+
+
+} /* ivxsock */
+
+
+/* Open the replay file of eye samples , with the optional replay speed ,
+   and start the background receive thread on it. n is the number of
+   input arguments in m. */
+void  ivxfile ( int  n , const mxArray *  m[] )
+{
   
+  /* File name length , and replay speed */
+  size_t  fn ;
+  double  spd = 1 ;
   
-} /* ivxsock */
+  
+  /*--Check input--*/
+  
+  if  ( notstr ( m[ 0 ] ) )
+    mexErrMsgIdAndTxt ( "MET:ivxudp:fileargs" ,
+              "ivxudp 'file' , file must be a string" ) ;
+  
+  if  ( NRHS_FISP - 1  <=  n )
+  {
+    if  (  !mxIsDouble ( m[ 1 ] )  ||  !mxIsScalar ( m[ 1 ] )  ||
+           mxIsComplex ( m[ 1 ] )  ||  mxIsInf ( mxGetScalar ( m[ 1 ] ) )  ||
+           !( 0 < ( spd = mxGetScalar ( m[ 1 ] ) ) )  )
+      mexErrMsgIdAndTxt ( "MET:ivxudp:fileargs" ,
+                "ivxudp 'file' , speed must be a finite double over 0" ) ;
+  }
+  
+  fn = mxGetNumberOfElements( m[ 0 ] ) + 1 ;
+  
+  char  fnm[ fn ] ;
+  mxGetString ( m[ 0 ] , fnm , fn ) ;
+  
+  
+  /*--Open replay backend--*/
+  
+  if  ( eyefile_open ( &ein , fnm , spd )  ==  -1 )
+  {
+    memset ( &ein , 0 , sizeof ( ein ) ) ;
+    mexErrMsgIdAndTxt ( "MET:ivxudp:fileargs" ,
+              "ivxudp 'file' , failed to read %s , %s" , fnm ,
+              strerror ( errno ) ) ;
+  }
+  
+  /* Nothing counted */
+  nspl = nkdr = nrdr = ngap = nbad = nshm = ntrc = 0 ;
+  tprv = tmin = -1.0 ;
+  
+  mexPrintf (  "ivxudp: opened replay file %s at speed %g\n"  ,
+    fnm  ,  spd  ) ;
+  
+  tsstart ( ) ;
+
+} /* ivxfile */
 
 
 /* getport returns 0 if matrix m is not a valid port number. Otherwise,
@@ -985,8 +2101,8 @@ uint16_t  getport ( const mxArray * m )
   /*--Return integer--*/
   
   return  ( uint16_t ) d ;
-  
-  
+
+
 } /* getport */
 
 
@@ -997,15 +2113,15 @@ int  notstr ( const mxArray * m )
   
   /* If not a string i.e. char column or row vector */
   if  (                           mxIsEmpty ( m )  ||
-                                  !mxIsChar ( m )  ||  
-               2 != mxGetNumberOfDimensions ( m )  ||  
+                                  !mxIsChar ( m )  ||
+               2 != mxGetNumberOfDimensions ( m )  ||
         (  1 < mxGetM ( m )  &&  1 < mxGetN ( m )  )
       )
     return  1 ;
   
   /* m is a string */
 	return  0 ;
-  
+
 } /* notstr */
 
 
@@ -1047,12 +2163,12 @@ ssize_t  xrecvfrom ( int  sockfd , void *  buf , size_t  len , int  flags )
     xclose () ;
     errno = e ;
     PEX ( "MET:ivxudp:recv" )
-    
+  
   }
   
   /* Done */
   return  r ;
-  
+
 } /* xrecvfrom */
 
 
@@ -1087,7 +2203,7 @@ ssize_t  xsendto ( int sockfd , const void * buf , size_t len , int flags ,
       mexErrMsgIdAndTxt ( "MET:ivxudp:openargs" ,
               "ivxudp 'open' iipa & iprt , "
          "attempt send to net‐work/broadcast address as though unicast" ) ;
-      
+    
     else if  ( errno == ECONNRESET )
       mexErrMsgIdAndTxt ( "MET:ivxudp:openargs" ,
               "ivxudp 'open' iipa & iprt , connection reset by peer" ) ;
@@ -1098,28 +2214,56 @@ ssize_t  xsendto ( int sockfd , const void * buf , size_t len , int flags ,
     
     else
       PEX ( "MET:ivxudp:sendto" )
-    
+  
   }
   
   /* Done */
   return  r ;
-  
+
 } /* xsendto */
 
 
-/* Closes socket irrespective of signal interruptions */
+/* Closes socket irrespective of signal interruptions , or the replay
+   file */
 void  xclose ( void )
 {
   
-  /* Send stop command */
-  size_t  nb = strlen ( IVXEST ) ;
-  xsendto ( s , IVXEST , nb , 0 , 
-    ( struct sockaddr * ) &ivxadd , sizeof ( ivxadd ) ) ;
+  /* Stop the receive thread before freeing what it uses */
+  tsstop ( ) ;
+  
+  /* Release the ingest backend */
+  if  ( ein.close  !=  NULL )
+    ein.close ( &ein ) ;
+  
+  memset ( &ein , 0 , sizeof ( ein ) ) ;
+  rbc = NULL ;
   
   /* Free receive buffer */
   free ( recbuf ) ;
+  recbuf = NULL ;
   rbi = rbd = 0 ;
   
+  /* Unmap eye shared memory , the receive thread no longer uses it */
+  if  ( eyemap  !=  NULL )
+  {
+    munmap ( eyemap , eyesiz ) ;
+    eyemap = NULL ;
+    eyeon = 0 ;
+    ph = pn = 0 ;
+  }
+  
+  /* Replay file , there is no socket */
+  if  ( !s )
+  {
+    mexPrintf ( "ivxudp: closed replay file\n" ) ;
+    return ;
+  }
+  
+  /* Send stop command */
+  size_t  nb = strlen ( IVXEST ) ;
+  xsendto ( s , IVXEST , nb , 0 ,
+    ( struct sockaddr * ) &ivxadd , sizeof ( ivxadd ) ) ;
+  
   /* Close socket */
   while ( close ( s ) == -1 )
   {
@@ -1129,7 +2273,7 @@ void  xclose ( void )
     
     else
       PEX ( "MET:ivxudp:close" )
-      
+  
   }
   
   /* Report */
@@ -1137,7 +2281,7 @@ void  xclose ( void )
   
   /* Remember to set socket file descriptor to zero, indicating closed */
   s = 0 ;
-  
-  
+
+
 } /* xclose */
 
@@ -0,0 +1,446 @@
+
+/*  ivxudp_bench.c
+  
+  ivxudp_bench  [ N [ rate [ period [ method ] ] ] ]
+  
+  Matlab Electrophysiology Toolbox utility benchmark. Measures how quickly
+  ivxudp's read path can drain a UDP socket of iViewX eye samples. A child
+  process acts as a local iViewX sender on the loopback interface , and
+  streams N binocular ET_SPL datagrams at rate samples per second. Every
+  period microseconds , the parent process drains the socket , like a MET
+  controller that reads new eye samples once per cycle. A period of 0
+  instead waits on the socket with poll ( ) and drains it as soon as any
+  data arrives. The socket is drained using one of the following methods:
+    
+    'f' - One recvfrom ( ) call per datagram , the original ivxudp read.
+    'm' - Batches of up to MMSGN datagrams per recvmmsg ( ) call.
+  
+  If method is not given then both are run in turn. For each method, the
+  number of samples received per second is reported , along with the
+  receiver's CPU time per sample from getrusage ( ) and the number of
+  receiving system calls per sample. Samples that never arrived are
+  reported as dropped.
+  
+  Defaults are N of 100000 , rate of 20000 samples per second , and period
+  of 1000 microseconds. A rate of 0 sends as fast as possible.
+  
+  Build with:  gcc -O2 -o ivxudp_bench ivxudp_bench.c
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* recvmmsg ( ) */
+#define  _GNU_SOURCE
+
+/* Sockets */
+#include  <arpa/inet.h>
+#include  <netinet/in.h>
+#include  <sys/types.h>
+#include  <sys/socket.h>
+
+/* General */
+#include  <errno.h>
+#include  <poll.h>
+#include  <sched.h>
+#include  <signal.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+#include  <unistd.h>
+#include  <sys/resource.h>
+#include  <sys/wait.h>
+
+
+/*--- Define block ---*/
+
+/* System error and exit */
+#define  PEX( s )  { perror ( s ) ; exit ( EXIT_FAILURE ) ; }
+
+/* Default number of samples , sampling rate , and read period */
+#define  DEFNUM  100000
+#define  DEFRAT  20000
+#define  DEFPER  1000
+
+/* Same buffering as ivxudp */
+#define  RECBUF  524288
+#define  BUFTHR  576
+#define  MMSGN   64
+
+/* Loopback port */
+#define  BNCPRT  5555
+
+/* Receiver gives up after this many milliseconds without data */
+#define  IDLEMS  1000
+
+/* Nanoseconds per second */
+#define  NSPERS  1000000000LL
+
+/* Benchmark methods */
+#define  METH_RECVFROM  'f'
+#define  METH_RECVMMSG  'm'
+
+
+/*--- Global variables ---*/
+
+/* User-space receive buffer */
+static char  recbuf[ RECBUF ] ;
+
+/* Batched receive , one message header and io vector per datagram */
+static struct mmsghdr  msgv[ MMSGN ] ;
+static struct iovec     iov[ MMSGN ] ;
+
+
+/*--- Subroutines ---*/
+
+/* Time difference in seconds */
+static double  tdiff ( struct timespec *  a , struct timespec *  b )
+{
+  return  ( b->tv_sec - a->tv_sec )  +  ( b->tv_nsec - a->tv_nsec ) / 1e9 ;
+}
+
+/* Sum of user and system CPU time , in seconds */
+static double  cputime ( void )
+{
+  struct rusage  u ;
+  
+  if  ( getrusage ( RUSAGE_SELF , &u )  ==  -1 )
+    PEX ( "ivxudp_bench:getrusage" )
+  
+  return  u.ru_utime.tv_sec  +  u.ru_utime.tv_usec / 1e6  +
+          u.ru_stime.tv_sec  +  u.ru_stime.tv_usec / 1e6 ;
+}
+
+
+/* Sender. Streams N samples to address a at rate samples per second , in
+   one millisecond bursts. Exits the child process when done. */
+static void  sender ( struct sockaddr_in *  a , long  N , long  rate )
+{
+  
+  /* Socket , sample counter , samples per burst , datagram length */
+  int  s ;
+  long  i , j , b ;
+  int  n ;
+  
+  /* Sample string and time of next burst */
+  char  spl[ BUFTHR ] ;
+  struct timespec  t ;
+  
+  if  ( ( s = socket ( AF_INET , SOCK_DGRAM , 0 ) )  ==  -1 )
+    PEX ( "ivxudp_bench:sender:socket" )
+  
+  /* Samples per burst */
+  b = rate  ?  ( rate + 999 ) / 1000  :  N ;
+  
+  if  ( clock_gettime ( CLOCK_MONOTONIC , &t )  ==  -1 )
+    PEX ( "ivxudp_bench:sender:clock_gettime" )
+  
+  for  ( i = 0  ;  i < N  ;  )
+  {
+    
+    /* One burst */
+    for  ( j = 0  ;  j < b  &&  i < N  ;  j++ , i++ )
+    {
+      
+      /* Binocular sample in the ivxudp ET_FRM format */
+      n = snprintf ( spl , sizeof ( spl ) ,
+        "ET_SPL b %ld %ld %ld %ld %ld %ld %ld %ld %ld\n" ,
+        i * 500 , 8191 + i % 97 , 8191 - i % 89 , 8191 + i % 83 ,
+        8191 - i % 79 , 41 + i % 7 , 42 + i % 5 , 43 + i % 3 , 44L ) ;
+      
+      while  ( sendto ( s , spl , n , 0 , ( struct sockaddr * ) a ,
+                        sizeof ( *a ) )  ==  -1 )
+        
+        if  ( errno == ENOBUFS  ||  errno == EAGAIN )
+          sched_yield ( ) ;
+        
+        else if  ( errno != EINTR )
+          PEX ( "ivxudp_bench:sender:sendto" )
+    
+    } /* burst */
+    
+    /* Wait for next millisecond */
+    if  ( !rate )  continue ;
+    
+    t.tv_nsec += NSPERS / 1000 ;
+    if  ( NSPERS  <=  t.tv_nsec )  { t.tv_nsec -= NSPERS ;  ++t.tv_sec ; }
+    
+    while  ( clock_nanosleep ( CLOCK_MONOTONIC , TIMER_ABSTIME , &t ,
+                               NULL )  ==  EINTR ) ;
+  
+  } /* samples */
+  
+  close ( s ) ;
+  exit ( EXIT_SUCCESS ) ;
+
+} /* sender */
+
+
+/* Drain socket with one recvfrom ( ) per datagram , as ivxudp did. Returns
+   the number of datagrams received and adds system calls to c. */
+static long  drainfrom ( int  s , long *  c )
+{
+  
+  ssize_t  br ;
+  char *  pv = recbuf ;
+  size_t  rem = RECBUF ;
+  long  d = 0 ;
+  
+  while  ( BUFTHR  <=  rem )
+  {
+    
+    ++( *c ) ;
+    
+    if  ( ( br = recvfrom ( s , pv , rem , MSG_DONTWAIT , NULL , NULL ) )
+          ==  -1 )
+    {
+      if  ( errno == EINTR )  continue ;
+      if  ( errno == EAGAIN  ||  errno == EWOULDBLOCK )  break ;
+      PEX ( "ivxudp_bench:recvfrom" )
+    }
+    
+    pv += br ;
+    rem -= br ;
+    ++d ;
+  
+  }
+  
+  return  d ;
+
+} /* drainfrom */
+
+
+/* Drain socket with batches of recvmmsg ( ) , as ivxudp now does. Returns
+   the number of datagrams received and adds system calls to c. */
+static long  drainmmsg ( int  s , long *  c )
+{
+  
+  int  n , r , i ;
+  size_t  br ;
+  char *  pv = recbuf ;
+  size_t  rem = RECBUF ;
+  long  d = 0 ;
+  
+  while  ( BUFTHR  <=  rem )
+  {
+    
+    n = rem / BUFTHR ;
+    if  ( MMSGN  <  n )  n = MMSGN ;
+    
+    for  ( i = 0  ;  i < n  ;  i++ )
+    {
+      iov[ i ].iov_base = pv  +  i * BUFTHR ;
+      iov[ i ].iov_len  = BUFTHR ;
+    }
+    
+    ++( *c ) ;
+    
+    if  ( ( r = recvmmsg ( s , msgv , n , MSG_DONTWAIT , NULL ) )  ==  -1 )
+    {
+      if  ( errno == EINTR )  continue ;
+      if  ( errno == EAGAIN  ||  errno == EWOULDBLOCK )  break ;
+      PEX ( "ivxudp_bench:recvmmsg" )
+    }
+    
+    for  ( i = 0  ;  i < r  ;  i++ )
+    {
+      br = msgv[ i ].msg_len ;
+      if  ( pv != iov[ i ].iov_base )
+        memmove ( pv , iov[ i ].iov_base , br ) ;
+      pv += br ;
+      rem -= br ;
+      ++d ;
+    }
+    
+    if  ( r  <  n )  break ;
+  
+  }
+  
+  return  d ;
+
+} /* drainmmsg */
+
+
+/* Run one benchmark with the given method */
+static void  bench ( char  m , long  N , long  rate , long  per )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Socket , receive buffer size , sender's pid */
+  int  s , rbs = RECBUF ;
+  pid_t  pid ;
+  
+  /* Loopback address */
+  struct sockaddr_in  a ;
+  
+  /* Samples received , receiving system calls , poll ( ) result */
+  long  d = 0 , c = 0 ;
+  int  i ;
+  
+  /* Time and CPU time at first sample and at end , time of next read and
+     of the last data */
+  struct timespec  t0 , t1 , tr , td ;
+  double  u0 = 0 , u1 ;
+  long  n ;
+  
+  /* poll ( ) descriptor */
+  struct pollfd  p ;
+  
+  
+  /*-- Bind receiving socket --*/
+  
+  memset ( &a , 0 , sizeof ( a ) ) ;
+  a.sin_family = AF_INET ;
+  a.sin_port = htons ( BNCPRT ) ;
+  a.sin_addr.s_addr = htonl ( INADDR_LOOPBACK ) ;
+  
+  if  ( ( s = socket ( AF_INET , SOCK_DGRAM , 0 ) )  ==  -1 )
+    PEX ( "ivxudp_bench:socket" )
+  
+  if  ( setsockopt ( s , SOL_SOCKET , SO_RCVBUF , &rbs , sizeof ( rbs ) )
+        ==  -1 )
+    PEX ( "ivxudp_bench:setsockopt" )
+  
+  if  ( bind ( s , ( struct sockaddr * ) &a , sizeof ( a ) )  ==  -1 )
+    PEX ( "ivxudp_bench:bind" )
+  
+  
+  /*-- Start sender --*/
+  
+  fflush ( stdout ) ;
+  
+  if  ( ( pid = fork ( ) )  ==  -1 )
+    PEX ( "ivxudp_bench:fork" )
+  
+  else if  ( !pid )
+  {
+    close ( s ) ;
+    sender ( &a , N , rate ) ;
+  }
+  
+  
+  /*-- Receive --*/
+  
+  p.fd = s ;
+  p.events = POLLIN ;
+  
+  /* Wait for the first sample , then start the clocks */
+  while  ( ( i = poll ( &p , 1 , IDLEMS ) )  ==  -1 )
+    if  ( errno != EINTR )
+      PEX ( "ivxudp_bench:poll" )
+  
+  if  ( clock_gettime ( CLOCK_MONOTONIC , &t0 )  ==  -1 )
+    PEX ( "ivxudp_bench:clock_gettime" )
+  u0 = cputime ( ) ;
+  tr = td = t0 ;
+  
+  while  ( i  &&  d < N )
+  {
+    
+    /* Wait for data */
+    if  ( !per )
+      switch  ( poll ( &p , 1 , IDLEMS ) )
+      {
+        case  -1:  if  ( errno == EINTR )  continue ;
+                   PEX ( "ivxudp_bench:poll" )
+        case   0:  i = 0 ;  continue ;
+      }
+    
+    /* Drain socket */
+    n = m == METH_RECVMMSG  ?  drainmmsg ( s , &c )  :
+                               drainfrom ( s , &c ) ;
+    d += n ;
+    
+    if  ( !per )  continue ;
+    
+    /* Give up once the sender has been quiet for too long */
+    if  ( clock_gettime ( CLOCK_MONOTONIC , &t1 )  ==  -1 )
+      PEX ( "ivxudp_bench:clock_gettime" )
+    
+    if  ( n )
+      td = t1 ;
+    else if  ( IDLEMS / 1e3  <  tdiff ( &td , &t1 ) )
+      break ;
+    
+    /* Sleep until the next read */
+    tr.tv_nsec += per * 1000 ;
+    while  ( NSPERS  <=  tr.tv_nsec )  { tr.tv_nsec -= NSPERS ;  ++tr.tv_sec ; }
+    
+    while  ( clock_nanosleep ( CLOCK_MONOTONIC , TIMER_ABSTIME , &tr ,
+                               NULL )  ==  EINTR ) ;
+  
+  } /* receive */
+  
+  if  ( clock_gettime ( CLOCK_MONOTONIC , &t1 )  ==  -1 )
+    PEX ( "ivxudp_bench:clock_gettime" )
+  u1 = cputime ( ) ;
+  
+  while  ( waitpid ( pid , NULL , 0 )  ==  -1  &&  errno == EINTR ) ;
+  close ( s ) ;
+  
+  
+  /*-- Report --*/
+  
+  if  ( !d )
+  {
+    printf ( "%-8s no samples received\n" ,
+      m == METH_RECVMMSG ? "recvmmsg" : "recvfrom" ) ;
+    return ;
+  }
+  
+  printf ( "%-8s %8ld samples  %10.0f samples/s  %8.1f ns CPU/sample  "
+    "%6.3f calls/sample  %ld dropped\n" ,
+    m == METH_RECVMMSG ? "recvmmsg" : "recvfrom" , d ,
+    d / tdiff ( &t0 , &t1 ) , ( u1 - u0 ) * 1e9 / d , ( double ) c / d ,
+    N - d ) ;
+
+} /* bench */
+
+
+/*--- ivxudp_bench ---*/
+
+int  main ( int  argc , char **  argv )
+{
+  
+  /* Number of samples , sampling rate , read period , counter */
+  long  N = DEFNUM , rate = DEFRAT , per = DEFPER ;
+  int  i ;
+  
+  /* Benchmark methods */
+  char  meth[] = { METH_RECVFROM , METH_RECVMMSG , '\0' } ;
+  
+  if  ( 1 < argc )  N = atol ( argv[ 1 ] ) ;
+  if  ( 2 < argc )  rate = atol ( argv[ 2 ] ) ;
+  if  ( 3 < argc )  per = atol ( argv[ 3 ] ) ;
+  if  ( 4 < argc )  { meth[ 0 ] = argv[ 4 ][ 0 ] ;  meth[ 1 ] = '\0' ; }
+  
+  if  ( N <= 0  ||  rate < 0  ||  per < 0 )
+  {
+    fprintf ( stderr ,
+      "ivxudp_bench: N must be over 0 , rate and period 0 or more\n" ) ;
+    exit ( EXIT_FAILURE ) ;
+  }
+  
+  /* Each batched message header gathers into its own io vector */
+  for  ( i = 0  ;  i < MMSGN  ;  i++ )
+  {
+    msgv[ i ].msg_hdr.msg_iov    = iov + i ;
+    msgv[ i ].msg_hdr.msg_iovlen = 1 ;
+  }
+  
+  printf ( "ivxudp_bench: %ld samples at %ld samples/s , read every %ld us\n" ,
+    N , rate , per ) ;
+  
+  for  ( i = 0  ;  meth[ i ]  ;  i++ )
+    bench ( meth[ i ] , N , rate , per ) ;
+  
+  return  EXIT_SUCCESS ;
+
+} /* ivxudp_bench */
+
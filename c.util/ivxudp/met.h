@@ -0,0 +1 @@
+../../c/met.h
\ No newline at end of file
@@ -0,0 +1,160 @@
+% met_ivxeye_bench
+% 
+% Benchmark of the ivxudp eye pipeline , from iViewX sample to 'eye'
+% shared memory. ivxsim stands in for iViewX on the loopback interface , and
+% streams at 500Hz , 1kHz , and 2kHz in turn. ivxudp's background receive
+% thread writes samples into a private POSIX shared memory that has the
+% same layout as MET's 'eye' shared memory , see ivxudp 'e'. This script
+% plays the part of the only reader. It polls the synchronisation block
+% for each new write , takes the time , reads the eye position array , and
+% acknowledges the write.
+% 
+% The latency of a sample is the time that its write was seen minus the
+% sample's time stamp , which ivxsim takes from the same clock as GetSecs.
+% Thus it includes the receive thread's parsing and conversion , the
+% write itself , and the time for this script to notice the write. Samples
+% that never arrive are reported as lost , next to ivxudp's ring drop
+% counter and ivxsim's own summary. Since no time is given between writes ,
+% samples are written as soon as the last write is acknowledged.
+% 
+% ivxsim must be built first , in the same directory as this script:
+% 
+%   gcc -O2 -o ivxsim ivxsim.c -lm
+% 
+% Requires Psych Toolbox for GetSecs , and ivxudp on the Matlab path. Set
+% sim.opt to add packet loss , reordering , or bursts e.g. '-l 0.01 -o 0.01
+% -b 4'.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
+
+
+%% Constants
+  
+  % Sampling rates , and seconds of streaming at each
+  rates = [ 500 , 1000 , 2000 ] ;
+  dur = 10 ;
+  
+  % ivxsim program and extra options
+  sim.exe = fullfile ( fileparts ( mfilename ( 'fullpath' ) ) , 'ivxsim' ) ;
+  sim.opt = '-t sacc' ;
+  
+  % Host and iViewX addresses and ports
+  ivx.hip = '127.0.0.1' ;
+  ivx.hpt = 5555 ;
+  ivx.iip = '127.0.0.1' ;
+  ivx.ipt = 4444 ;
+  
+  % Private shared memory , its file under /dev/shm , and size in bytes
+  shm.name = '/ivxeye_bench.met' ;
+  shm.file = fullfile ( '/dev/shm' , shm.name ) ;
+  shm.size = 2 ^ 20 ;
+  
+  % Calibration , screen width and height in degrees , no left/right swap ,
+  % and no time between writes
+  cal = [ 40 , -30 , 0 , 0 ] ;
+  
+  % Synchronisation block byte offsets of gen and ack , and the offset of
+  % the data header i.e. MSHM_SYNC
+  SYNGEN = 1 : 4 ;
+  SYNACK = 5 : 8 ;
+  SYNHDR = 64 ;
+  
+  % Bytes in the wshm header of a 2D double array , mxClassID , complexity
+  % flag , number of dimensions , and two dimensions
+  ARRHDR = 4  +  1  +  3 * 8 ;
+
+
+%% Benchmark each rate
+
+% Results , one row per rate: [ samples sent , received , lost , median ,
+% 99th percentile , and maximum latency in ms , writes , ivxudp drops ]
+R = zeros ( numel ( rates ) , 8 ) ;
+
+for  r = 1 : numel ( rates )
+  
+  N = rates( r )  *  dur ;
+  
+  % Make zeroed shared memory , and map it
+  f = fopen ( shm.file , 'w' ) ;
+  fwrite ( f , zeros ( shm.size , 1 , 'uint8' ) ) ;
+  fclose ( f ) ;
+  
+  m = memmapfile ( shm.file , 'Format' , 'uint8' , 'Writable' , true ) ;
+  
+  % Start simulator , it quits when the stream is done
+  system ( sprintf ( '%s -a %s -p %d -r %d -n %d -q %s > %s.txt &' , ...
+    sim.exe , ivx.iip , ivx.ipt , rates( r ) , N , sim.opt , shm.file ) ) ;
+  pause ( 0.5 )
+  
+  % Open with background receive thread , then hand it the shared memory.
+  % There is one reader , this script , and no event fd's.
+  ivxudp ( 'o' , ivx.hip , ivx.hpt , ivx.iip , ivx.ipt , 1 ) ;
+  
+  W = struct ( 'name' , 'eye' , 'file' , shm.name , 'nr' , 1 , ...
+    'wefdv' , zeros ( 1 , 0 ) ) ;
+  ivxudp ( 'e' , W , cal ) ;
+  
+  % Latency of each received sample , and counters
+  lat = zeros ( N , 1 ) ;
+  n = 0 ;
+  w = 0 ;
+  gen = uint32 ( 0 ) ;
+  
+  % Read until no write is seen for a second
+  tw = GetSecs ;
+  
+  while  GetSecs - tw  <  1
+    
+    % New write?
+    g = typecast ( m.Data( SYNGEN ) , 'uint32' ) ;
+    if  g  ==  gen  ,  continue  ,  end
+    
+    tw = GetSecs ;
+    gen = g ;
+    w = w  +  1 ;
+    
+    % Dimensions of the first array , the eye positions , and its first
+    % column of time stamps
+    i = SYNHDR  +  2 * 8  +  ARRHDR ;
+    d = typecast ( m.Data( i - 15 : i ) , 'uint64' ) ;
+    t = typecast ( m.Data( i + 1 : i + 8 * d( 1 ) ) , 'double' ) ;
+    
+    % Acknowledge
+    m.Data( SYNACK ) = typecast ( uint32 ( 1 ) , 'uint8' ) ;
+    
+    j = n + 1 : min ( [ n + d( 1 ) , N ] ) ;
+    if  isempty ( j )  ,  continue  ,  end
+    
+    lat( j ) = tw  -  t( 1 : numel ( j ) ) ;
+    n = j( end ) ;
+  
+  end % read
+  
+  [ ~ , ~ , rdrop ] = ivxudp ( 'n' ) ;
+  ivxudp ( 'c' )
+  
+  clear  m
+  delete ( shm.file )
+  
+  % Simulator's summary
+  type ( [ shm.file , '.txt' ] )
+  delete ( [ shm.file , '.txt' ] )
+  
+  lat = sort ( lat( 1 : n ) )  *  1e3 ;
+  R( r , : ) = [ N , n , N - n , median( lat ) , ...
+    lat( max ( [ 1 , ceil( 0.99 * n ) ] ) ) , lat( end ) , w , rdrop ] ;
+
+end % rates
+
+
+%% Report
+
+fprintf ( [ '\n   rate      sent    recvd   lost   median ms   99%% ms' , ...
+  '   max ms   writes  dropped\n' ] )
+
+for  r = 1 : numel ( rates )
+  fprintf ( '%7d  %8d %8d %6d %11.3f %8.3f %8.3f %8d %8d\n' , ...
+    rates( r ) , R( r , : ) )
+end
+
@@ -0,0 +1,641 @@
+/*  nspring.c
+  
+  [ ... ] = nspring ( fun , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. Packs the events
+  returned by cbmex ( 'trialdata' ) into a ring of compact records for
+  'nsp' shared memory , and unpacks them again for the readers. Used by
+  metcbmex to write 'nsp' shared memory and by metgui , metspkplot , and
+  metraster to read it.
+  
+  Each event is one 8-byte record that holds the row of the event in
+  cbmex 'trialdata' output , i.e. the index of its channel label , a 16-bit
+  value , and the NSP time stamp in number of samples , as a 32-bit
+  unsigned integer. For a spike event , the value is the unit
+  classification , 0 for unclassified and 1 to 5 for sorted units. For a
+  digital input event , the value is the 16-bit digital input. A set of
+  records is handed to Matlab as a 2 x N uint32 array , one record per
+  column , so that met ( 'write' ) and met ( 'read' ) copy it to and from
+  shared memory in one block. The layout of the first uint32 of a column
+  depends on the byte order of the host , so always decode records with
+  nspring.
+  
+  Events are kept in the ring in the order that they were pushed. Within
+  one channel and unit , this is chronological.
+  
+  Sub-functions:
+    
+    nspring ( 'o' , din ) -- Empties the ring and sets the row of the
+      digital input channel in cbmex 'trialdata' output to din , a scalar
+      double.
+    
+    d = nspring ( 'p' , td ) -- Pushes the events in cbmex 'trialdata'
+      output td onto the ring. td is a cell array with the channel labels
+      in the first column. For spike channels , the following columns have
+      the time stamps of each unit classification. For the digital input
+      channel , the second column has time stamps and the third has
+      digital input values. Time stamps and values may be any real numeric
+      type. If the ring is full then the oldest events are dropped ; d is
+      the number of events dropped , as a double.
+    
+    rec = nspring ( 'w' ) -- Returns all events in the ring that have not
+      yet been acknowledged , as a 2 x N uint32 array of records. The ring
+      is not changed.
+    
+    nspring ( 'a' , n ) -- Acknowledges the oldest n events in the ring ,
+      which are released. Call after rec from 'w' has been written to
+      shared memory , with n equal to size ( rec , 2 ).
+    
+    [ r , v , t ] = nspring ( 'd' , rec , hz ) -- Decodes the records in
+      2 x N uint32 array rec. Returns the row , value , and time of each
+      event in N x 1 doubles. hz is the NSP sampling rate , time stamps are
+      divided by hz to get time in seconds.
+    
+    data = nspring ( 'c' , rec , siz , din , hz ) -- Decodes records in
+      rec into a cell array with the same layout as cbmex 'trialdata'
+      output without the label column , i.e. data has siz( 1 ) rows and
+      siz( 2 ) columns. Row din holds digital input time stamps in column
+      1 and values in column 2 ; all other rows hold the time stamps of
+      unit classification 0 in column 1 to unit classification siz( 2 ) -
+      1 in the last column. Each element has a 1 x M double vector , or []
+      if there were no events. Time stamps are divided by hz to get
+      seconds. Events with a row or value that falls outside of data are
+      ignored.
+  
+  NOTE: The ring is allocated by the first call to 'o' and is kept until
+  nspring is cleared.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* General */
+#include  <stdint.h>
+#include  <string.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Empty ring */
+  #define  FUN_OPEN   'o'
+  
+  /* Push cbmex 'trialdata' output */
+  #define  FUN_PUSH   'p'
+  
+  /* Get records that are waiting to be written */
+  #define  FUN_WAIT   'w'
+  
+  /* Acknowledge written records */
+  #define  FUN_ACK    'a'
+  
+  /* Decode records into column vectors */
+  #define  FUN_DECOD  'd'
+  
+  /* Decode records into a cell array */
+  #define  FUN_CELL   'c'
+
+
+/* Number of input and output args , including fun */
+  
+  #define  NRHS_OPEN   2
+  #define  NRHS_PUSH   2
+  #define  NRHS_WAIT   1
+  #define  NRHS_ACK    2
+  #define  NRHS_DECOD  3
+  #define  NRHS_CELL   5
+  #define  NLHS_PUSH   1
+  #define  NLHS_WAIT   1
+  #define  NLHS_DECOD  3
+  #define  NLHS_CELL   1
+
+
+/* Number of records in the ring , a power of two. About 80 seconds of
+   events from 128 channels firing at 100 Hz each. */
+#define  RINGN  1048576
+
+/* Number of uint32 values per record */
+#define  RECU32  2
+
+/* Columns of the digital input row in cbmex 'trialdata' output , without
+   the label column , time stamps then values */
+#define  DINTIM  0
+#define  DINVAL  1
+
+
+/*--- Data types ---*/
+
+/* One NSP event. row is the index of the channel label , starting from 1.
+   val is the unit classification or digital input value. ts is the NSP
+   time stamp in samples. */
+struct nsprec
+{
+  uint16_t  row ;
+  uint16_t  val ;
+  uint32_t  ts  ;
+} ;
+
+
+/*--- Global static variables ---*/
+
+/* The ring , NULL until 'o' */
+static struct nsprec *  ring = NULL ;
+
+/* Head and tail counts. Push advances hd , acknowledge advances tl. Both
+   only ever increase ; the slot of count c is c & ( RINGN - 1 ). */
+static uint64_t  hd = 0 , tl = 0 ;
+
+/* Row of the digital input channel */
+static double  din = 0 ;
+
+
+/*--- Function definitions ---*/
+
+void  ringfree ( void ) ;
+void  ringpush ( int , mxArray ** , const mxArray ** ) ;
+void  ringwait ( mxArray ** ) ;
+void  ringack  ( const mxArray ** ) ;
+void  recdecod ( int , mxArray ** , const mxArray ** ) ;
+void  reccell  ( mxArray ** , const mxArray ** ) ;
+ int  notscalar ( const mxArray * ) ;
+size_t  getrec ( const mxArray * , struct nsprec ** ) ;
+double  getnum ( const mxArray * , size_t ) ;
+
+
+/*** nspring function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  /* Required number of inputs , and maximum number of outputs */
+  int  nin , nout = 0 ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:nspring:fun"  ,
+      "nspring arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:nspring:fun"  ,
+      "nspring arg fun must be a single char"  ) ;
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   nin = NRHS_OPEN  ;  break ;
+    case  FUN_PUSH:   nin = NRHS_PUSH  ;  nout = NLHS_PUSH  ;  break ;
+    case  FUN_WAIT:   nin = NRHS_WAIT  ;  nout = NLHS_WAIT  ;  break ;
+    case  FUN_ACK:    nin = NRHS_ACK   ;  break ;
+    case  FUN_DECOD:  nin = NRHS_DECOD ;  nout = NLHS_DECOD ;  break ;
+    case  FUN_CELL:   nin = NRHS_CELL  ;  nout = NLHS_CELL  ;  break ;
+    
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:nspring:fun"  ,
+        "nspring arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  }
+  
+  if  ( nrhs  !=  nin )
+    
+    mexErrMsgIdAndTxt (  "MET:nspring:fun"  ,
+      "nspring '%c' requires %d input arguments in total"  ,  c[ 0 ]  ,
+        nin  ) ;
+  
+  else if  ( nout  <  nlhs )
+    
+    mexErrMsgIdAndTxt (  "MET:nspring:fun"  ,
+      "nspring '%c' provides at most %d output arguments"  ,  c[ 0 ]  ,
+        nout  ) ;
+  
+  /* Ring functions need the ring */
+  else if  ( ring == NULL  &&  c[ 0 ] != FUN_OPEN  &&
+             c[ 0 ] != FUN_DECOD  &&  c[ 0 ] != FUN_CELL )
+    
+    mexErrMsgIdAndTxt (  "MET:nspring:fun"  ,
+      "nspring must be opened with 'o' before '%c'"  ,  c[ 0 ]  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:
+      
+      if  ( notscalar ( prhs[ 1 ] )  ||  mxGetScalar ( prhs[ 1 ] ) < 1 )
+        mexErrMsgIdAndTxt (  "MET:nspring:open"  ,
+          "nspring 'o' , din must be a scalar double of 1 or more"  ) ;
+      
+      if  ( ring  ==  NULL )
+      {
+        ring = mxMalloc ( RINGN * sizeof ( struct nsprec ) ) ;
+        mexMakeMemoryPersistent ( ring ) ;
+        mexAtExit ( ringfree ) ;
+      }
+      
+      din = mxGetScalar ( prhs[ 1 ] ) ;
+      hd = tl = 0 ;
+      
+      break ;
+    
+    case  FUN_PUSH:   ringpush ( nlhs , plhs , prhs + 1 ) ;  break ;
+    case  FUN_WAIT:   ringwait ( plhs ) ;  break ;
+    case  FUN_ACK:    ringack  ( prhs + 1 ) ;  break ;
+    case  FUN_DECOD:  recdecod ( nlhs , plhs , prhs + 1 ) ;  break ;
+    case  FUN_CELL:   reccell  ( plhs , prhs + 1 ) ;  break ;
+  }
+
+
+} /* nspring */
+
+
+/*---Subroutines---*/
+
+/* Release the ring when nspring is cleared */
+void  ringfree ( void )
+{
+  
+  if  ( ring  !=  NULL )  mxFree ( ring ) ;
+  ring = NULL ;
+
+} /* ringfree */
+
+
+/* Returns non-zero if m is not a real , finite , scalar double */
+int  notscalar ( const mxArray *  m )
+{
+  
+  return  !mxIsDouble ( m )  ||  !mxIsScalar ( m )  ||  mxIsComplex ( m )
+    ||  mxIsNaN ( mxGetScalar ( m ) )  ||  mxIsInf ( mxGetScalar ( m ) ) ;
+
+} /* notscalar */
+
+
+/* Returns element i of real numeric array m as a double. cbmex returns
+   time stamps and values as integers when there were events , but as
+   empty doubles when there were none. */
+double  getnum ( const mxArray *  m , size_t  i )
+{
+  
+  const void *  d = mxGetData ( m ) ;
+  
+  switch  ( mxGetClassID ( m ) )
+  {
+    case  mxDOUBLE_CLASS:  return  ( ( const double   * ) d )[ i ] ;
+    case  mxSINGLE_CLASS:  return  ( ( const float    * ) d )[ i ] ;
+    case  mxINT8_CLASS:    return  ( ( const int8_t   * ) d )[ i ] ;
+    case  mxUINT8_CLASS:   return  ( ( const uint8_t  * ) d )[ i ] ;
+    case  mxINT16_CLASS:   return  ( ( const int16_t  * ) d )[ i ] ;
+    case  mxUINT16_CLASS:  return  ( ( const uint16_t * ) d )[ i ] ;
+    case  mxINT32_CLASS:   return  ( ( const int32_t  * ) d )[ i ] ;
+    case  mxUINT32_CLASS:  return  ( ( const uint32_t * ) d )[ i ] ;
+    case  mxINT64_CLASS:   return  ( ( const int64_t  * ) d )[ i ] ;
+    case  mxUINT64_CLASS:  return  ( ( const uint64_t * ) d )[ i ] ;
+    default:  break ;
+  }
+  
+  mexErrMsgIdAndTxt (  "MET:nspring:push"  ,
+    "nspring 'p' , td must hold real numeric arrays"  ) ;
+  
+  return  0 ;
+
+} /* getnum */
+
+
+/* Push cbmex 'trialdata' output td = m[ 0 ] onto the ring */
+void  ringpush ( int  nlhs , mxArray *  plhs[] , const mxArray *  m[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Counters , number of rows and columns of td , and number of events in
+     one element */
+  size_t  i , j , k , R , C , N ;
+  
+  /* Events dropped */
+  uint64_t  d = 0 ;
+  
+  /* Elements of td , and digital input values */
+  const mxArray  * e , * v ;
+  
+  /* New record */
+  struct nsprec  r ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( !mxIsCell ( m[ 0 ] )  ||  mxGetNumberOfDimensions ( m[ 0 ] ) != 2 )
+    mexErrMsgIdAndTxt (  "MET:nspring:push"  ,
+      "nspring 'p' , td must be a 2D cell array"  ) ;
+  
+  R = mxGetM ( m[ 0 ] ) ;
+  C = mxGetN ( m[ 0 ] ) ;
+  
+  if  ( R  >  UINT16_MAX )
+    mexErrMsgIdAndTxt (  "MET:nspring:push"  ,
+      "nspring 'p' , td has more than %d rows"  ,  UINT16_MAX  ) ;
+  
+  
+  /*-- Push events --*/
+  
+  /* Rows of td , skip the label column */
+  for  ( i = 0  ;  i < R  ;  i++ )
+    for  ( j = 1  ;  j < C  ;  j++ )
+    {
+      
+      /* Element of td */
+      if  ( ( e = mxGetCell ( m[ 0 ] , i  +  j * R ) )  ==  NULL  ||
+            mxIsEmpty ( e ) )
+        continue ;
+      
+      N = mxGetNumberOfElements ( e ) ;
+      r.row = ( uint16_t ) ( i + 1 ) ;
+      r.val = ( uint16_t ) ( j - 1 ) ;
+      v = NULL ;
+      
+      /* Digital input , time stamps are paired with values in the next
+         column , all other columns are skipped */
+      if  ( i + 1  ==  ( size_t ) din )
+      {
+        if  ( j - 1 != DINTIM  ||  C <= j + 1  ||
+              ( v = mxGetCell ( m[ 0 ] , i  +  ( j + 1 ) * R ) ) == NULL )
+          continue ;
+        
+        if  ( mxGetNumberOfElements ( v )  <  N )
+          N = mxGetNumberOfElements ( v ) ;
+      }
+      
+      for  ( k = 0  ;  k < N  ;  k++ )
+      {
+        if  ( v != NULL )  r.val = ( uint16_t ) getnum ( v , k ) ;
+        r.ts = ( uint32_t ) getnum ( e , k ) ;
+        
+        /* Ring is full , drop the oldest event */
+        if  ( hd - tl  ==  RINGN )  {  tl++ ;  d++ ;  }
+        
+        ring[ hd++ & ( RINGN - 1 ) ] = r ;
+      }
+    
+    } /* elements */
+  
+  
+  /*-- Output --*/
+  
+  if  ( nlhs )  plhs[ 0 ] = mxCreateDoubleScalar ( ( double ) d ) ;
+
+} /* ringpush */
+
+
+/* Return events that have not been acknowledged */
+void  ringwait ( mxArray *  plhs[] )
+{
+  
+  /* Number of events , and the number before the end of the ring */
+  size_t  N = ( size_t ) ( hd - tl ) , n ;
+  
+  /* Output records */
+  struct nsprec *  p ;
+  
+  plhs[ 0 ] = mxCreateNumericMatrix ( RECU32 , N , mxUINT32_CLASS ,
+    mxREAL ) ;
+  
+  if  ( !N )  return ;
+  
+  p = mxGetData ( plhs[ 0 ] ) ;
+  n = RINGN  -  ( size_t ) ( tl & ( RINGN - 1 ) ) ;
+  if  ( N  <  n )  n = N ;
+  
+  memcpy ( p , ring + ( tl & ( RINGN - 1 ) ) , n * sizeof ( *p ) ) ;
+  memcpy ( p + n , ring , ( N - n ) * sizeof ( *p ) ) ;
+
+} /* ringwait */
+
+
+/* Acknowledge n = m[ 0 ] events */
+void  ringack ( const mxArray *  m[] )
+{
+  
+  double  n ;
+  
+  if  ( notscalar ( m[ 0 ] )  ||  ( n = mxGetScalar ( m[ 0 ] ) ) < 0  ||
+        ( double ) ( hd - tl ) < n )
+    mexErrMsgIdAndTxt (  "MET:nspring:ack"  ,
+      "nspring 'a' , n must be a scalar double from 0 to the number of "
+      "events waiting"  ) ;
+  
+  tl += ( uint64_t ) n ;
+
+} /* ringack */
+
+
+/* Point *r to the records in m , returns the number of records */
+size_t  getrec ( const mxArray *  m , struct nsprec **  r )
+{
+  
+  if  ( !mxIsUint32 ( m )  ||  mxIsComplex ( m )  ||
+        ( !mxIsEmpty ( m )  &&  mxGetM ( m ) != RECU32 ) )
+    mexErrMsgIdAndTxt (  "MET:nspring:rec"  ,
+      "nspring , rec must be a 2 x N uint32 array"  ) ;
+  
+  *r = mxGetData ( m ) ;
+  
+  return  mxGetNumberOfElements ( m )  /  RECU32 ;
+
+} /* getrec */
+
+
+/* Decode records m[ 0 ] into column vectors , sampling rate m[ 1 ] */
+void  recdecod ( int  nlhs , mxArray *  plhs[] , const mxArray *  m[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Counter , and number of records */
+  size_t  i , N ;
+  
+  /* Records */
+  struct nsprec *  r ;
+  
+  /* Output pointer , and seconds per sample */
+  double  * p , s ;
+  
+  /* Output counter */
+  int  j ;
+  
+  
+  /*-- Check input --*/
+  
+  N = getrec ( m[ 0 ] , &r ) ;
+  
+  if  ( notscalar ( m[ 1 ] )  ||  mxGetScalar ( m[ 1 ] ) <= 0 )
+    mexErrMsgIdAndTxt (  "MET:nspring:decod"  ,
+      "nspring 'd' , hz must be a positive scalar double"  ) ;
+  
+  s = 1.0  /  mxGetScalar ( m[ 1 ] ) ;
+  
+  
+  /*-- Decode --*/
+  
+  for  ( j = 0  ;  j < ( nlhs ? nlhs : 1 )  ;  j++ )
+  {
+    plhs[ j ] = mxCreateDoubleMatrix ( N , 1 , mxREAL ) ;
+    p = mxGetPr ( plhs[ j ] ) ;
+    
+    switch  ( j )
+    {
+      case  0:  for  ( i = 0 ; i < N ; i++ )  p[ i ] = r[ i ].row ;  break ;
+      case  1:  for  ( i = 0 ; i < N ; i++ )  p[ i ] = r[ i ].val ;  break ;
+      case  2:  for  ( i = 0 ; i < N ; i++ )  p[ i ] = r[ i ].ts * s ;
+    }
+  }
+
+} /* recdecod */
+
+
+/* Decode records m[ 0 ] into a cell array of size m[ 1 ] with digital
+   input on row m[ 2 ] , sampling rate m[ 3 ] */
+void  reccell ( mxArray *  plhs[] , const mxArray *  m[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Counter , number of records , rows and columns of data , and linear
+     index of an element */
+  size_t  i , N , R , C , e ;
+  
+  /* Records */
+  struct nsprec *  r ;
+  
+  /* Size , row of digital input , and seconds per sample */
+  const double *  siz ;
+  double  d , s ;
+  
+  /* Number of events per element , then the fill position */
+  size_t *  n ;
+  
+  /* Output vectors */
+  double **  p ;
+  
+  
+  /*-- Check input --*/
+  
+  N = getrec ( m[ 0 ] , &r ) ;
+  
+  if  ( !mxIsDouble ( m[ 1 ] )  ||  mxIsComplex ( m[ 1 ] )  ||
+        mxGetNumberOfElements ( m[ 1 ] ) != 2 )
+    mexErrMsgIdAndTxt (  "MET:nspring:cell"  ,
+      "nspring 'c' , siz must be a 2 element double"  ) ;
+  
+  siz = mxGetPr ( m[ 1 ] ) ;
+  
+  if  ( !( 0 <= siz[ 0 ]  &&  siz[ 0 ] <= UINT16_MAX )  ||
+        !( 2 <= siz[ 1 ]  &&  siz[ 1 ] <= UINT16_MAX ) )
+    mexErrMsgIdAndTxt (  "MET:nspring:cell"  ,
+      "nspring 'c' , siz must have 0 to %d rows and 2 to %d columns"  ,
+        UINT16_MAX  ,  UINT16_MAX  ) ;
+  
+  if  ( notscalar ( m[ 2 ] ) )
+    mexErrMsgIdAndTxt (  "MET:nspring:cell"  ,
+      "nspring 'c' , din must be a scalar double"  ) ;
+  
+  if  ( notscalar ( m[ 3 ] )  ||  mxGetScalar ( m[ 3 ] ) <= 0 )
+    mexErrMsgIdAndTxt (  "MET:nspring:cell"  ,
+      "nspring 'c' , hz must be a positive scalar double"  ) ;
+  
+  R = ( size_t ) siz[ 0 ] ;
+  C = ( size_t ) siz[ 1 ] ;
+  d = mxGetScalar ( m[ 2 ] ) ;
+  s = 1.0  /  mxGetScalar ( m[ 3 ] ) ;
+  
+  n = mxCalloc ( R * C , sizeof ( size_t ) ) ;
+  p = mxCalloc ( R * C , sizeof ( double * ) ) ;
+  
+  
+  /*-- Count events per element --*/
+  
+  for  ( i = 0  ;  i < N  ;  i++ )
+  {
+    if  ( !r[ i ].row  ||  R < r[ i ].row )  continue ;
+    
+    if  ( r[ i ].row  ==  d )
+      
+      n[ r[ i ].row - 1  +  DINTIM * R ]++ ;
+    
+    else if  ( r[ i ].val  <  C )
+      
+      n[ r[ i ].row - 1  +  r[ i ].val * R ]++ ;
+  }
+  
+  /* Digital input has as many values as time stamps */
+  if  ( 1 <= d  &&  d <= R )
+  {
+    e = ( size_t ) d - 1 ;
+    n[ e + DINVAL * R ] = n[ e + DINTIM * R ] ;
+  }
+  
+  
+  /*-- Make output --*/
+  
+  plhs[ 0 ] = mxCreateCellMatrix ( R , C ) ;
+  
+  for  ( e = 0  ;  e < R * C  ;  e++ )
+  {
+    mxSetCell ( plhs[ 0 ] , e ,
+      mxCreateDoubleMatrix ( n[ e ] ? 1 : 0 , n[ e ] , mxREAL ) ) ;
+    
+    p[ e ] = mxGetPr ( mxGetCell ( plhs[ 0 ] , e ) ) ;
+    n[ e ] = 0 ;
+  }
+  
+  
+  /*-- Fill elements --*/
+  
+  for  ( i = 0  ;  i < N  ;  i++ )
+  {
+    if  ( !r[ i ].row  ||  R < r[ i ].row )  continue ;
+    
+    /* Spike events out of range */
+    if  ( r[ i ].row != d  &&  C <= r[ i ].val )  continue ;
+    
+    /* Digital input time stamp element , and its value */
+    if  ( r[ i ].row  ==  d )
+    {
+      e = r[ i ].row - 1  +  DINTIM * R ;
+      p[ e  +  ( DINVAL - DINTIM ) * R ][ n[ e ] ] = r[ i ].val ;
+    }
+    
+    /* Spike time stamp element */
+    else
+      
+      e = r[ i ].row - 1  +  r[ i ].val * R ;
+    
+    p[ e ][ n[ e ]++ ] = r[ i ].ts  *  s ;
+  }
+  
+  mxFree ( n ) ;
+  mxFree ( p ) ;
+
+} /* reccell */
+
@@ -0,0 +1,667 @@
+/*  psthacc.c
+  
+  [ ... ] = psthacc ( fun , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. Accumulates the
+  peri-stimulus time histogram ( PSTH ) of every spike classification ,
+  for metpsth. Each trial's spikes are binned and added to running spike
+  counts , and the running variance of the firing rate , in time
+  proportional to the number of new spikes. The spike classifications
+  are kept in order of their maximum average firing rate over all bins ,
+  and the order is updated as the counts grow. The population PSTH image
+  is then returned ready to plot , with one row per classification in
+  ascending order of maximum firing rate.
+  
+  The average firing rate in a bin is the spike count divided by the
+  number of trials and by the bin width. The variance is accumulated as
+  metpsth always has. When a bin gets its first spikes , its variance
+  estimate is set to the trial's firing rate , as for a Poisson process.
+  After that , a trial with spikes in the bin adds the squared difference
+  between its firing rate and the new average firing rate.
+  
+  Sub-functions:
+    
+    psthacc ( 'o' , ncla , nbins , binwid ) -- Allocates and zeros the
+      buffers for ncla spike classifications and nbins time bins that are
+      binwid milliseconds wide. All scalar doubles.
+    
+    psthacc ( 'r' ) -- Zeros the buffers. Does nothing before 'o'.
+    
+    psthacc ( 'a' , spk , w ) -- Adds one trial. spk is a cell array with
+      ncla elements , each one a double vector of the spike times of one
+      classification , in seconds. w is the 2 element double vector of
+      the start and end of the analysis window , in seconds. Spikes from
+      w( 1 ) to w( 2 ) are binned.
+    
+    [ img , fwd , rev , mx ] = psthacc ( 'i' ) -- Returns the population
+      PSTH image img , an ncla x nbins single array of average firing
+      rates in spikes per second. Row i of img has classification fwd( i
+      ) , and classification i is on row rev( i ) of img. fwd and rev are
+      ncla x 1 uint16. mx is an ncla x 1 single with the maximum average
+      firing rate of each row of img , in ascending order.
+    
+    [ m , e ] = psthacc ( 'm' , j ) -- Returns the average firing rate of
+      the classifications listed in double vector j , and the standard
+      deviation , for each bin in 1 x nbins singles.
+    
+    [ spk , var ] = psthacc ( 'g' ) -- Returns the spike counts in an ncla
+      x nbins uint32 array , and the accumulated variance in an ncla x
+      nbins single array. For saving.
+    
+    psthacc ( 's' , spk , var , n ) -- Sets the spike counts and
+      accumulated variance , as returned by 'g' , and the number of
+      trials n , a scalar double. For loading. Must follow 'o'.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* General */
+#include  <math.h>
+#include  <stdint.h>
+#include  <stdlib.h>
+#include  <string.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Allocate buffers */
+  #define  FUN_OPEN   'o'
+  
+  /* Zero buffers */
+  #define  FUN_RESET  'r'
+  
+  /* Add trial */
+  #define  FUN_ADD    'a'
+  
+  /* Population image */
+  #define  FUN_IMG    'i'
+  
+  /* Average PSTH of a set of classifications */
+  #define  FUN_MEAN   'm'
+  
+  /* Get and set buffers */
+  #define  FUN_GET    'g'
+  #define  FUN_SET    's'
+
+
+/* Number of input and output args , including fun */
+  
+  #define  NRHS_OPEN   4
+  #define  NRHS_RESET  1
+  #define  NRHS_ADD    3
+  #define  NRHS_IMG    1
+  #define  NRHS_MEAN   2
+  #define  NRHS_GET    1
+  #define  NRHS_SET    4
+  #define  NLHS_IMG    4
+  #define  NLHS_MEAN   2
+  #define  NLHS_GET    2
+
+
+/* Maximum number of spike classifications , so that row indices fit in a
+   uint16 */
+#define  MAXCLA  UINT16_MAX
+
+
+/*--- Global static variables ---*/
+
+/* Number of spike classifications and bins , bin width in ms , and number
+   of trials */
+static size_t  ncla = 0 , nbins = 0 ;
+static double  binwid = 0 , ntri = 0 ;
+
+/* Spike counts and accumulated variance , ncla x nbins in column-major
+   order , NULL until 'o' */
+static uint32_t *  cnt = NULL ;
+static float *  var = NULL ;
+
+/* Maximum spike count over bins , per classification */
+static uint32_t *  mxc = NULL ;
+
+/* Classification order , ascending maximum count. fwd[ r ] is the
+   classification on row r , pos[ c ] is the row of classification c. */
+static uint32_t  * fwd = NULL , * pos = NULL ;
+
+/* Per-trial scratch. Bin index of each spike , the trial's count per bin
+   , and a list of the bins that got spikes. */
+static size_t  nsb = 0 ;
+static uint32_t  * sb = NULL , * tcnt = NULL , * tbin = NULL ;
+
+
+/*--- Function definitions ---*/
+
+void  accfree ( void ) ;
+void  accopen ( const mxArray ** ) ;
+void  accreset ( void ) ;
+void  accadd  ( const mxArray ** ) ;
+void  accimg  ( int , mxArray ** ) ;
+void  accmean ( int , mxArray ** , const mxArray ** ) ;
+void  accget  ( int , mxArray ** ) ;
+void  accset  ( const mxArray ** ) ;
+void  accmove ( uint32_t ) ;
+ int  ordcmp  ( const void * , const void * ) ;
+ int  notscalar ( const mxArray * ) ;
+
+
+/*** psthacc function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  /* Required number of inputs , and maximum number of outputs */
+  int  nin , nout = 0 ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:psthacc:fun"  ,
+      "psthacc arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:psthacc:fun"  ,
+      "psthacc arg fun must be a single char"  ) ;
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   nin = NRHS_OPEN  ;  break ;
+    case  FUN_RESET:  nin = NRHS_RESET ;  break ;
+    case  FUN_ADD:    nin = NRHS_ADD   ;  break ;
+    case  FUN_IMG:    nin = NRHS_IMG   ;  nout = NLHS_IMG  ;  break ;
+    case  FUN_MEAN:   nin = NRHS_MEAN  ;  nout = NLHS_MEAN ;  break ;
+    case  FUN_GET:    nin = NRHS_GET   ;  nout = NLHS_GET  ;  break ;
+    case  FUN_SET:    nin = NRHS_SET   ;  break ;
+    
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:psthacc:fun"  ,
+        "psthacc arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  }
+  
+  if  ( nrhs  !=  nin )
+    
+    mexErrMsgIdAndTxt (  "MET:psthacc:fun"  ,
+      "psthacc '%c' requires %d input arguments in total"  ,  c[ 0 ]  ,
+        nin  ) ;
+  
+  else if  ( nout  <  nlhs )
+    
+    mexErrMsgIdAndTxt (  "MET:psthacc:fun"  ,
+      "psthacc '%c' provides at most %d output arguments"  ,  c[ 0 ]  ,
+        nout  ) ;
+  
+  else if  ( cnt == NULL  &&  c[ 0 ] != FUN_OPEN  &&  c[ 0 ] != FUN_RESET )
+    
+    mexErrMsgIdAndTxt (  "MET:psthacc:fun"  ,
+      "psthacc must be opened with 'o' before '%c'"  ,  c[ 0 ]  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   accopen ( prhs + 1 ) ;  break ;
+    case  FUN_RESET:  if  ( cnt != NULL )  accreset ( ) ;  break ;
+    case  FUN_ADD:    accadd  ( prhs + 1 ) ;  break ;
+    case  FUN_IMG:    accimg  ( nlhs , plhs ) ;  break ;
+    case  FUN_MEAN:   accmean ( nlhs , plhs , prhs + 1 ) ;  break ;
+    case  FUN_GET:    accget  ( nlhs , plhs ) ;  break ;
+    case  FUN_SET:    accset  ( prhs + 1 ) ;  break ;
+  }
+
+
+} /* psthacc */
+
+
+/*---Subroutines---*/
+
+/* Returns non-zero if m is not a real , finite , scalar double */
+int  notscalar ( const mxArray *  m )
+{
+  
+  return  !mxIsDouble ( m )  ||  !mxIsScalar ( m )  ||  mxIsComplex ( m )
+    ||  mxIsNaN ( mxGetScalar ( m ) )  ||  mxIsInf ( mxGetScalar ( m ) ) ;
+
+} /* notscalar */
+
+
+/* Release all buffers */
+void  accfree ( void )
+{
+  
+  if  ( cnt  != NULL )  mxFree ( cnt  ) ;
+  if  ( var  != NULL )  mxFree ( var  ) ;
+  if  ( mxc  != NULL )  mxFree ( mxc  ) ;
+  if  ( fwd  != NULL )  mxFree ( fwd  ) ;
+  if  ( pos  != NULL )  mxFree ( pos  ) ;
+  if  ( sb   != NULL )  mxFree ( sb   ) ;
+  if  ( tcnt != NULL )  mxFree ( tcnt ) ;
+  if  ( tbin != NULL )  mxFree ( tbin ) ;
+  
+  cnt = mxc = fwd = pos = sb = tcnt = tbin = NULL ;
+  var = NULL ;
+  nsb = 0 ;
+
+} /* accfree */
+
+
+/* Returns persistent memory for n elements of size s */
+static void *  pmalloc ( size_t  n , size_t  s )
+{
+  
+  void *  p = mxCalloc ( n ? n : 1 , s ) ;
+  mexMakeMemoryPersistent ( p ) ;
+  
+  return  p ;
+
+} /* pmalloc */
+
+
+/* Allocate buffers from m , which holds ncla , nbins , and binwid */
+void  accopen ( const mxArray *  m[] )
+{
+  
+  int  i ;
+  
+  for  ( i = 0  ;  i < NRHS_OPEN - 1  ;  i++ )
+    if  ( notscalar ( m[ i ] )  ||  mxGetScalar ( m[ i ] ) <= 0 )
+      mexErrMsgIdAndTxt (  "MET:psthacc:open"  ,
+        "psthacc 'o' , ncla , nbins , and binwid must be finite , "
+        "positive scalar doubles"  ) ;
+  
+  if  ( MAXCLA  <  mxGetScalar ( m[ 0 ] ) )
+    mexErrMsgIdAndTxt (  "MET:psthacc:open"  ,
+      "psthacc 'o' , ncla can be at most %d"  ,  MAXCLA  ) ;
+  
+  accfree ( ) ;
+  mexAtExit ( accfree ) ;
+  
+  ncla   = ( size_t ) mxGetScalar ( m[ 0 ] ) ;
+  nbins  = ( size_t ) mxGetScalar ( m[ 1 ] ) ;
+  binwid = mxGetScalar ( m[ 2 ] ) ;
+  
+  cnt  = pmalloc ( ncla * nbins , sizeof ( *cnt ) ) ;
+  var  = pmalloc ( ncla * nbins , sizeof ( *var ) ) ;
+  mxc  = pmalloc ( ncla  , sizeof ( *mxc  ) ) ;
+  fwd  = pmalloc ( ncla  , sizeof ( *fwd  ) ) ;
+  pos  = pmalloc ( ncla  , sizeof ( *pos  ) ) ;
+  tcnt = pmalloc ( nbins , sizeof ( *tcnt ) ) ;
+  tbin = pmalloc ( nbins , sizeof ( *tbin ) ) ;
+  
+  accreset ( ) ;
+
+} /* accopen */
+
+
+/* Zero buffers , all classifications tie so they are in index order */
+void  accreset ( void )
+{
+  
+  uint32_t  c ;
+  
+  memset ( cnt , 0 , ncla * nbins * sizeof ( *cnt ) ) ;
+  memset ( var , 0 , ncla * nbins * sizeof ( *var ) ) ;
+  memset ( mxc , 0 , ncla * sizeof ( *mxc ) ) ;
+  
+  for  ( c = 0  ;  c < ncla  ;  c++ )  fwd[ c ] = pos[ c ] = c ;
+  
+  ntri = 0 ;
+
+} /* accreset */
+
+
+/* Classification a comes before c in the order */
+static inline int  before ( uint32_t  a , uint32_t  c )
+{
+  return  mxc[ a ] < mxc[ c ]  ||  ( mxc[ a ] == mxc[ c ]  &&  a < c ) ;
+}
+
+
+/* The maximum count of classification c grew , move it up the order */
+void  accmove ( uint32_t  c )
+{
+  
+  uint32_t  r = pos[ c ] ;
+  
+  while  ( r + 1 < ncla  &&  before ( fwd[ r + 1 ] , c ) )
+  {
+    fwd[ r ] = fwd[ r + 1 ] ;
+    pos[ fwd[ r ] ] = r ;
+    r++ ;
+  }
+  
+  fwd[ r ] = c ;
+  pos[ c ] = r ;
+
+} /* accmove */
+
+
+/* Add one trial of spikes m[ 0 ] in window m[ 1 ] */
+void  accadd ( const mxArray *  m[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Counters , number of spikes , number of bins with spikes , and
+     linear index */
+  size_t  c , i , N , nb , e ;
+  
+  /* Spike times , window , bins per second , and firing rate scale */
+  const double  * s , * w ;
+  double  bps , scl ;
+  
+  /* Spike times of one classification */
+  const mxArray *  t ;
+  
+  /* Previous count , and new firing rate and average */
+  uint32_t  old ;
+  double  r , a ;
+  
+  /* Maximum count grew */
+  int  grow ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( !mxIsCell ( m[ 0 ] )  ||  mxGetNumberOfElements ( m[ 0 ] ) != ncla )
+    mexErrMsgIdAndTxt (  "MET:psthacc:add"  ,
+      "psthacc 'a' , spk must be a cell array with %d elements"  ,
+        ( int ) ncla  ) ;
+  
+  if  ( !mxIsDouble ( m[ 1 ] )  ||  mxIsComplex ( m[ 1 ] )  ||
+        mxGetNumberOfElements ( m[ 1 ] ) != 2 )
+    mexErrMsgIdAndTxt (  "MET:psthacc:add"  ,
+      "psthacc 'a' , w must be a 2 element real double"  ) ;
+  
+  w = mxGetPr ( m[ 1 ] ) ;
+  bps = 1e3  /  binwid ;
+  
+  /* Count the trial first , averages include it */
+  scl = bps  /  ++ntri ;
+  
+  
+  /*-- Bin each classification --*/
+  
+  for  ( c = 0  ;  c < ncla  ;  c++ )
+  {
+    
+    /* Spike times */
+    if  ( ( t = mxGetCell ( m[ 0 ] , c ) ) == NULL  ||  mxIsEmpty ( t ) )
+      continue ;
+    
+    if  ( !mxIsDouble ( t )  ||  mxIsComplex ( t ) )
+      mexErrMsgIdAndTxt (  "MET:psthacc:add"  ,
+        "psthacc 'a' , spk elements must be real doubles"  ) ;
+    
+    s = mxGetPr ( t ) ;
+    N = mxGetNumberOfElements ( t ) ;
+    
+    /* Grow scratch at need */
+    if  ( nsb  <  N )
+    {
+      if  ( sb  !=  NULL )  mxFree ( sb ) ;
+      sb = pmalloc ( N , sizeof ( *sb ) ) ;
+      nsb = N ;
+    }
+    
+    /* Bin index of every spike , starting from 1 , or 0 if the spike is
+       outside of the window. No branches , so this vectorises. A spike on
+       the very start of the window goes into bin 1. */
+    for  ( i = 0  ;  i < N  ;  i++ )
+    {
+      r = ceil ( ( s[ i ] - w[ 0 ] )  *  bps ) ;
+      r = r < 1  ?  1  :  ( r > nbins  ?  nbins  :  r ) ;
+      sb[ i ] = ( uint32_t ) r  *  ( w[ 0 ] <= s[ i ]  &&  s[ i ] <= w[ 1 ] ) ;
+    }
+    
+    /* Count spikes per bin for this trial */
+    for  ( nb = i = 0  ;  i < N  ;  i++ )
+    {
+      if  ( !sb[ i ] )  continue ;
+      
+      if  ( !tcnt[ sb[ i ] - 1 ]++ )  tbin[ nb++ ] = sb[ i ] - 1 ;
+    }
+    
+    /* Add to running counts and variance */
+    for  ( grow = 0 , i = 0  ;  i < nb  ;  i++ )
+    {
+      e = c  +  tbin[ i ] * ncla ;
+      old = cnt[ e ] ;
+      cnt[ e ] += tcnt[ tbin[ i ] ] ;
+      
+      r = tcnt[ tbin[ i ] ]  *  bps ;
+      a = cnt[ e ]  *  scl ;
+      
+      if  ( !old )
+        var[ e ] = ( float ) r ;
+      else
+        var[ e ] += ( float ) ( ( r - a )  *  ( r - a ) ) ;
+      
+      if  ( mxc[ c ]  <  cnt[ e ] )  {  mxc[ c ] = cnt[ e ] ;  grow = 1 ;  }
+      
+      tcnt[ tbin[ i ] ] = 0 ;
+    }
+    
+    if  ( grow )  accmove ( ( uint32_t ) c ) ;
+  
+  } /* classifications */
+
+} /* accadd */
+
+
+/* Population image , row order , and maximum rates */
+void  accimg ( int  nlhs , mxArray *  plhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Row , bin , and output counter */
+  size_t  r , b ;
+  int  j ;
+  
+  /* Firing rate per spike count */
+  float  scl = ntri  ?  ( float ) ( 1e3 / binwid / ntri )  :  0 ;
+  
+  /* Output pointers */
+  float  * f ;
+  uint16_t  * u ;
+  
+  
+  /*-- Outputs --*/
+  
+  for  ( j = 0  ;  j < ( nlhs ? nlhs : 1 )  ;  j++ )
+    switch  ( j )
+    {
+      case  0:
+        
+        plhs[ 0 ] = mxCreateNumericMatrix ( ncla , nbins , mxSINGLE_CLASS ,
+          mxREAL ) ;
+        f = mxGetData ( plhs[ 0 ] ) ;
+        
+        for  ( b = 0  ;  b < nbins  ;  b++ , f += ncla )
+          for  ( r = 0  ;  r < ncla  ;  r++ )
+            f[ r ] = cnt[ fwd[ r ]  +  b * ncla ]  *  scl ;
+        
+        break ;
+      
+      case  1:
+      case  2:
+        
+        plhs[ j ] = mxCreateNumericMatrix ( ncla , 1 , mxUINT16_CLASS ,
+          mxREAL ) ;
+        u = mxGetData ( plhs[ j ] ) ;
+        
+        for  ( r = 0  ;  r < ncla  ;  r++ )
+          u[ r ] = ( uint16_t ) ( ( j == 1 ? fwd[ r ] : pos[ r ] ) + 1 ) ;
+        
+        break ;
+      
+      case  3:
+        
+        plhs[ 3 ] = mxCreateNumericMatrix ( ncla , 1 , mxSINGLE_CLASS ,
+          mxREAL ) ;
+        f = mxGetData ( plhs[ 3 ] ) ;
+        
+        for  ( r = 0  ;  r < ncla  ;  r++ )  f[ r ] = mxc[ fwd[ r ] ] * scl ;
+    }
+
+} /* accimg */
+
+
+/* Average PSTH and standard deviation of classifications m[ 0 ] */
+void  accmean ( int  nlhs , mxArray *  plhs[] , const mxArray *  m[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Counters , number of classifications , and linear index */
+  size_t  i , b , N , e ;
+  
+  /* Classification list , firing rate per spike count */
+  const double *  j ;
+  double  scl = ntri  ?  1e3 / binwid / ntri  :  0 ;
+  
+  /* Sums , then outputs */
+  double  sm , sv ;
+  float  * pm , * pe ;
+  
+  
+  /*-- Check input --*/
+  
+  N = mxGetNumberOfElements ( m[ 0 ] ) ;
+  
+  if  ( !mxIsDouble ( m[ 0 ] )  ||  mxIsComplex ( m[ 0 ] )  ||  !N )
+    mexErrMsgIdAndTxt (  "MET:psthacc:mean"  ,
+      "psthacc 'm' , j must be a non-empty real double"  ) ;
+  
+  j = mxGetPr ( m[ 0 ] ) ;
+  
+  for  ( i = 0  ;  i < N  ;  i++ )
+    if  ( !( 1 <= j[ i ]  &&  j[ i ] <= ncla )  ||  fmod ( j[ i ] , 1 ) )
+      mexErrMsgIdAndTxt (  "MET:psthacc:mean"  ,
+        "psthacc 'm' , j must hold integers from 1 to %d"  ,
+          ( int ) ncla  ) ;
+  
+  
+  /*-- Outputs --*/
+  
+  plhs[ 0 ] = mxCreateNumericMatrix ( 1 , nbins , mxSINGLE_CLASS , mxREAL ) ;
+  pm = mxGetData ( plhs[ 0 ] ) ;
+  
+  if  ( 1 < nlhs )
+  {
+    plhs[ 1 ] = mxCreateNumericMatrix ( 1 , nbins , mxSINGLE_CLASS ,
+      mxREAL ) ;
+    pe = mxGetData ( plhs[ 1 ] ) ;
+  }
+  else
+    pe = NULL ;
+  
+  for  ( b = 0  ;  b < nbins  ;  b++ )
+  {
+    for  ( sm = sv = 0 , i = 0  ;  i < N  ;  i++ )
+    {
+      e = ( size_t ) j[ i ] - 1  +  b * ncla ;
+      sm += cnt[ e ] ;
+      sv += var[ e ] ;
+    }
+    
+    pm[ b ] = ( float ) ( sm * scl / N ) ;
+    
+    if  ( pe != NULL )
+      pe[ b ] = ntri  ?  ( float ) sqrt ( sv / N / ntri )  :  NAN ;
+  }
+
+} /* accmean */
+
+
+/* Return copies of the counts and variance */
+void  accget ( int  nlhs , mxArray *  plhs[] )
+{
+  
+  plhs[ 0 ] = mxCreateNumericMatrix ( ncla , nbins , mxUINT32_CLASS ,
+    mxREAL ) ;
+  memcpy ( mxGetData ( plhs[ 0 ] ) , cnt , ncla * nbins * sizeof ( *cnt ) ) ;
+  
+  if  ( nlhs  <  2 )  return ;
+  
+  plhs[ 1 ] = mxCreateNumericMatrix ( ncla , nbins , mxSINGLE_CLASS ,
+    mxREAL ) ;
+  memcpy ( mxGetData ( plhs[ 1 ] ) , var , ncla * nbins * sizeof ( *var ) ) ;
+
+} /* accget */
+
+
+/* For qsort , order of classifications */
+int  ordcmp ( const void *  a , const void *  b )
+{
+  
+  uint32_t  i = *( const uint32_t * ) a , j = *( const uint32_t * ) b ;
+  
+  return  before ( i , j )  ?  -1  :  ( before ( j , i )  ?  1  :  0 ) ;
+
+} /* ordcmp */
+
+
+/* Set counts m[ 0 ] , variance m[ 1 ] , and number of trials m[ 2 ] */
+void  accset ( const mxArray *  m[] )
+{
+  
+  size_t  c , b ;
+  
+  if  ( !mxIsUint32 ( m[ 0 ] )  ||  mxGetM ( m[ 0 ] ) != ncla  ||
+        mxGetN ( m[ 0 ] ) != nbins  ||
+        !mxIsSingle ( m[ 1 ] )  ||  mxGetM ( m[ 1 ] ) != ncla  ||
+        mxGetN ( m[ 1 ] ) != nbins )
+    mexErrMsgIdAndTxt (  "MET:psthacc:set"  ,
+      "psthacc 's' , spk and var must be %d x %d uint32 and single"  ,
+        ( int ) ncla  ,  ( int ) nbins  ) ;
+  
+  if  ( notscalar ( m[ 2 ] )  ||  mxGetScalar ( m[ 2 ] ) < 0 )
+    mexErrMsgIdAndTxt (  "MET:psthacc:set"  ,
+      "psthacc 's' , n must be a non-negative scalar double"  ) ;
+  
+  memcpy ( cnt , mxGetData ( m[ 0 ] ) , ncla * nbins * sizeof ( *cnt ) ) ;
+  memcpy ( var , mxGetData ( m[ 1 ] ) , ncla * nbins * sizeof ( *var ) ) ;
+  ntri = mxGetScalar ( m[ 2 ] ) ;
+  
+  /* Maximum counts and order from scratch */
+  for  ( c = 0  ;  c < ncla  ;  c++ )
+  {
+    for  ( mxc[ c ] = 0 , b = 0  ;  b < nbins  ;  b++ )
+      if  ( mxc[ c ]  <  cnt[ c + b * ncla ] )
+        mxc[ c ] = cnt[ c + b * ncla ] ;
+    
+    fwd[ c ] = c ;
+  }
+  
+  qsort ( fwd , ncla , sizeof ( *fwd ) , ordcmp ) ;
+  
+  for  ( c = 0  ;  c < ncla  ;  c++ )  pos[ fwd[ c ] ] = c ;
+
+} /* accset */
+
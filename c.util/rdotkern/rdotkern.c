@@ -0,0 +1,392 @@
+/*  rdotkern.c
+  
+  [ ... ] = rdotkern ( fun , key , ctr , dims , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. Random-dot kernels
+  for the random-dot stereogram and kinetogram stimulus definitions.
+  Random values come from a counter-based generator , rather than from a
+  pool of values that is sampled when the trial is initialised. The i'th
+  value of a stream is a pure function of the stream's key and of i , in
+  the manner of SplitMix64 , so that any part of a stream can be made
+  again from the key alone. There is no hidden state. Instead , the caller
+  keeps the key and the counter of the next value , and each sub-function
+  returns the counter that follows the last value that it used.
+  
+  key is a scalar double holding an integer on [ 0 , 2^32 - 1 ]. It is
+  expected that the stimulus definition draws a new key with randi during
+  trial initialisation , so that the key follows Matlab's random number
+  generator ; as metptb records the state of that generator on each trial ,
+  the dots can still be reproduced. ctr is a scalar double holding an
+  integer on [ 0 , 2^53 ) , usually zero for a new key. dims is a double
+  vector of dimension sizes. If dims has a single element n then a row
+  vector of n values is returned , or a 2 by n matrix of dot positions.
+  
+  Sub-functions:
+    
+    [ xy , ctr ] = rdotkern ( 'd' , key , ctr , dims , w , r ) -- Samples
+      dot positions uniformly from an annulus centred on the origin. w is
+      the difference between the squared outer and inner radii , and r is
+      the squared inner radius ; use r = 0 for a circle. Returns single xy
+      of size [ 2 , dims ] , with x-axis coordinates in row 1 and y-axis
+      coordinates in row 2. Uses one value per dot.
+    
+    [ u , ctr ] = rdotkern ( 'u' , key , ctr , dims ) -- Samples single
+      values from the uniform distribution on the open interval ( 0 , 1 ).
+      Returns u with size dims.
+    
+    [ l , ctr ] = rdotkern ( 'l' , key , ctr , dims , p ) -- Samples dot
+      lifetimes , in frames , from the geometric distribution with a
+      probability p of dying on each frame. Returns uint16 l with size
+      dims , where l = ceil ( log ( u ) / log ( 1 - p ) ) for uniform u on
+      ( 0 , 1 ). p is a non-negative scalar double. Lifetimes are
+      saturated at intmax ( 'uint16' ) , which is returned for all dots
+      when p is zero ; they are zero when p is 1 or more.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* General */
+#include  <math.h>
+#include  <stdint.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Dot positions */
+  #define  FUN_DOTS  'd'
+  
+  /* Uniform values */
+  #define  FUN_UNIF  'u'
+  
+  /* Dot lifetimes */
+  #define  FUN_LIFE  'l'
+
+
+/* Number of input and output args , including fun */
+  
+  #define  NRHS_DOTS  6
+  #define  NRHS_UNIF  4
+  #define  NRHS_LIFE  5
+  #define  NLHS       2
+
+
+/* Largest key , and largest counter that a double can hold exactly */
+#define  MAXKEY  4294967295.0
+#define  MAXCTR  9007199254740992.0
+
+/* Maximum number of dimensions in dims */
+#define  MAXDIM  16
+
+/* SplitMix64 increment , the golden ratio */
+#define  GOLDEN  0x9E3779B97F4A7C15ULL
+
+/* Scaling of a 23-bit integer onto ( 0 , 1 ) in single precision , and of
+   a 53-bit integer in double precision. 23 bits , so that the largest
+   value is less than 1 after rounding. */
+#define  SGLSCL  ( 1.0f / 8388608.0f )
+#define  DBLSCL  ( 1.0 / 9007199254740992.0 )
+
+/* Two pi , in single precision */
+#define  TWOPI  6.28318530717958647692f
+
+/* Largest lifetime */
+#define  MAXLIF  65535.0
+
+
+/*--- Function definitions ---*/
+
+void  rdots ( mxArray ** , const mxArray ** , uint64_t , double ) ;
+void  runif ( mxArray ** , const mxArray ** , uint64_t , double ) ;
+void  rlife ( mxArray ** , const mxArray ** , uint64_t , double ) ;
+mxArray *  newarray ( const mxArray * , mwSize , mxClassID , char ) ;
+uint64_t  mix ( uint64_t ) ;
+ int  notscalar ( const mxArray * ) ;
+
+
+/*** rdotkern function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  /* Required number of inputs */
+  int  nin ;
+  
+  /* key and ctr */
+  double  k , n ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:rdotkern:fun"  ,
+      "rdotkern arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:rdotkern:fun"  ,
+      "rdotkern arg fun must be a single char"  ) ;
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_DOTS:  nin = NRHS_DOTS ;  break ;
+    case  FUN_UNIF:  nin = NRHS_UNIF ;  break ;
+    case  FUN_LIFE:  nin = NRHS_LIFE ;  break ;
+    
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:rdotkern:fun"  ,
+        "rdotkern arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  }
+  
+  if  ( nrhs  !=  nin )
+    
+    mexErrMsgIdAndTxt (  "MET:rdotkern:fun"  ,
+      "rdotkern '%c' requires %d input arguments in total"  ,  c[ 0 ]  ,
+        nin  ) ;
+  
+  else if  ( NLHS  <  nlhs )
+    
+    mexErrMsgIdAndTxt (  "MET:rdotkern:fun"  ,
+      "rdotkern '%c' provides at most %d output arguments"  ,  c[ 0 ]  ,
+        NLHS  ) ;
+  
+  /* Key and counter */
+  k = notscalar ( prhs[ 1 ] )  ?  -1  :  mxGetScalar ( prhs[ 1 ] ) ;
+  
+  if  ( k < 0  ||  MAXKEY < k  ||  k != floor ( k ) )
+    
+    mexErrMsgIdAndTxt (  "MET:rdotkern:key"  ,
+      "rdotkern key must be a scalar double integer on [ 0 , 2^32 - 1 ]" ) ;
+  
+  n = notscalar ( prhs[ 2 ] )  ?  -1  :  mxGetScalar ( prhs[ 2 ] ) ;
+  
+  if  ( n < 0  ||  MAXCTR <= n  ||  n != floor ( n ) )
+    
+    mexErrMsgIdAndTxt (  "MET:rdotkern:ctr"  ,
+      "rdotkern ctr must be a scalar double integer on [ 0 , 2^53 )"  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_DOTS:  rdots ( plhs , prhs , ( uint64_t ) k , n ) ;  break ;
+    case  FUN_UNIF:  runif ( plhs , prhs , ( uint64_t ) k , n ) ;  break ;
+    case  FUN_LIFE:  rlife ( plhs , prhs , ( uint64_t ) k , n ) ;  break ;
+  }
+
+
+} /* rdotkern */
+
+
+/*---Subroutines---*/
+
+/* Returns non-zero if m is not a real , finite , scalar double */
+int  notscalar ( const mxArray *  m )
+{
+  
+  return  !mxIsDouble ( m )  ||  !mxIsScalar ( m )  ||  mxIsComplex ( m )
+    ||  mxIsNaN ( mxGetScalar ( m ) )  ||  mxIsInf ( mxGetScalar ( m ) ) ;
+
+} /* notscalar */
+
+
+/* SplitMix64 output function. The i'th value of the stream with key k is
+   mix ( mix ( k ) + ( i + 1 ) * GOLDEN ) , without the increment. */
+uint64_t  mix ( uint64_t  z )
+{
+  
+  z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL ;
+  z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL ;
+  
+  return  z ^ ( z >> 31 ) ;
+
+} /* mix */
+
+
+/* Checks dims input argument d and returns a new numeric array of class
+   cid. If r is non-zero then the output has a leading dimension of r
+   before dims. fun char f is used in error messages. */
+mxArray *  newarray ( const mxArray *  d , mwSize  r , mxClassID  cid ,
+  char  f )
+{
+  
+  /* Output dimensions , number of them , and index */
+  mwSize  s[ MAXDIM + 2 ] , n = 0 , i ;
+  
+  /* Number of elements in d and pointer to values */
+  const size_t  nd = mxGetNumberOfElements ( d ) ;
+  const double *  v ;
+  
+  if  ( !mxIsDouble ( d )  ||  mxIsComplex ( d )  ||  !nd  ||  MAXDIM < nd )
+    
+    mexErrMsgIdAndTxt (  "MET:rdotkern:dims"  ,
+      "rdotkern '%c' , dims must be a real double vector of 1 to %d "
+      "elements"  ,  f  ,  MAXDIM  ) ;
+  
+  v = mxGetPr ( d ) ;
+  
+  if  ( r )  s[ n++ ] = r ;
+  
+  if  ( !r  &&  nd == 1 )  s[ n++ ] = 1 ;
+  
+  for  ( i = 0 ; i < nd ; ++i )
+  {
+    
+    if  ( v[ i ] < 0  ||  v[ i ] != floor ( v[ i ] )  ||  mxIsInf ( v[ i ] ) )
+      
+      mexErrMsgIdAndTxt (  "MET:rdotkern:dims"  ,
+        "rdotkern '%c' , dims must hold non-negative integers"  ,  f  ) ;
+    
+    s[ n++ ] = ( mwSize ) v[ i ] ;
+  
+  } /* dims */
+  
+  return  mxCreateNumericArray ( n , s , cid , mxREAL ) ;
+
+} /* newarray */
+
+
+/* Dot positions in an annulus */
+void  rdots ( mxArray **  plhs , const mxArray **  prhs , uint64_t  k ,
+  double  n )
+{
+  
+  /* Squared width and inner radius */
+  float  w , r ;
+  
+  /* Output array , its values , and number of dots */
+  mxArray *  m ;
+  float *  xy ;
+  size_t  nd , i ;
+  
+  /* Stream offset , random value , radius and angle */
+  uint64_t  z ;
+  uint64_t  u ;
+  float  a , t ;
+  
+  if  ( notscalar ( prhs[ 4 ] )  ||  mxGetScalar ( prhs[ 4 ] ) < 0  ||
+        notscalar ( prhs[ 5 ] )  ||  mxGetScalar ( prhs[ 5 ] ) < 0 )
+    
+    mexErrMsgIdAndTxt (  "MET:rdotkern:dots"  ,
+      "rdotkern 'd' , w and r must be non-negative scalar doubles"  ) ;
+  
+  w = ( float ) mxGetScalar ( prhs[ 4 ] ) ;
+  r = ( float ) mxGetScalar ( prhs[ 5 ] ) ;
+  
+  m = newarray ( prhs[ 3 ] , 2 , mxSINGLE_CLASS , FUN_DOTS ) ;
+  xy = ( float * ) mxGetData ( m ) ;
+  nd = mxGetNumberOfElements ( m )  /  2 ;
+  
+  /* Start of the stream , less one increment so that the first value is
+     used by i = 0 */
+  z = mix ( k )  +  ( uint64_t ) n * GOLDEN ;
+  
+  /* Upper 23 bits give the radius , lower 23 bits the angle */
+  for  ( i = 0 ; i < nd ; ++i )
+  {
+    
+    u = mix ( z += GOLDEN ) ;
+    
+    a = sqrtf (  w * ( ( float ) ( u >> 41 ) + 0.5f ) * SGLSCL  +  r  ) ;
+    t = TWOPI * ( ( float ) ( u & 0x7FFFFF ) + 0.5f ) * SGLSCL ;
+    
+    xy[ 2 * i     ] = a * cosf ( t ) ;
+    xy[ 2 * i + 1 ] = a * sinf ( t ) ;
+  
+  } /* dots */
+  
+  plhs[ 0 ] = m ;
+  plhs[ 1 ] = mxCreateDoubleScalar ( n + nd ) ;
+
+} /* rdots */
+
+
+/* Uniform values */
+void  runif ( mxArray **  plhs , const mxArray **  prhs , uint64_t  k ,
+  double  n )
+{
+  
+  mxArray *  m = newarray ( prhs[ 3 ] , 0 , mxSINGLE_CLASS , FUN_UNIF ) ;
+  float *  u = ( float * ) mxGetData ( m ) ;
+  const size_t  nu = mxGetNumberOfElements ( m ) ;
+  size_t  i ;
+  
+  uint64_t  z = mix ( k )  +  ( uint64_t ) n * GOLDEN ;
+  
+  for  ( i = 0 ; i < nu ; ++i )
+    u[ i ] = ( ( float ) ( mix ( z += GOLDEN ) >> 41 ) + 0.5f ) * SGLSCL ;
+  
+  plhs[ 0 ] = m ;
+  plhs[ 1 ] = mxCreateDoubleScalar ( n + nu ) ;
+
+} /* runif */
+
+
+/* Geometric dot lifetimes */
+void  rlife ( mxArray **  plhs , const mxArray **  prhs , uint64_t  k ,
+  double  n )
+{
+  
+  /* Output array , its values , and number of them */
+  mxArray *  m ;
+  uint16_t *  l ;
+  size_t  nl , i ;
+  
+  /* Stream offset */
+  uint64_t  z ;
+  
+  /* Probability of death , its log complement , and one lifetime */
+  double  p , q , d ;
+  
+  p = notscalar ( prhs[ 4 ] )  ?  -1  :  mxGetScalar ( prhs[ 4 ] ) ;
+  
+  if  ( p < 0 )
+    
+    mexErrMsgIdAndTxt (  "MET:rdotkern:life"  ,
+      "rdotkern 'l' , p must be a non-negative scalar double"  ) ;
+  
+  q = p < 1  ?  log ( 1.0 - p )  :  -INFINITY ;
+  
+  m = newarray ( prhs[ 3 ] , 0 , mxUINT16_CLASS , FUN_LIFE ) ;
+  l = ( uint16_t * ) mxGetData ( m ) ;
+  nl = mxGetNumberOfElements ( m ) ;
+  
+  z = mix ( k )  +  ( uint64_t ) n * GOLDEN ;
+  
+  /* With p of zero , q is zero and every lifetime saturates */
+  for  ( i = 0 ; i < nl ; ++i )
+  {
+    
+    d = q  ?  ceil ( log ( ( ( mix ( z += GOLDEN ) >> 11 ) + 0.5 ) *
+      DBLSCL ) / q )  :  MAXLIF ;
+    
+    l[ i ] = MAXLIF < d  ?  ( uint16_t ) MAXLIF  :  ( uint16_t ) d ;
+  
+  } /* lifetimes */
+  
+  plhs[ 0 ] = m ;
+  plhs[ 1 ] = mxCreateDoubleScalar ( n + nl ) ;
+
+} /* rlife */
+
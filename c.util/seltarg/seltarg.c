@@ -0,0 +1,325 @@
+/*  seltarg.c
+  
+  [ ... ] = seltarg ( fun , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. The state machine
+  that decides which task stimulus the subject has selected , used by
+  mettarget to generate mtarget MET signals. It takes the stimulus that
+  was hit by each new eye or mouse sample , in time order , and returns
+  only the changes of selection , as MET signals that are ready for met (
+  'send' ). Each sample takes the same , small amount of work , no matter
+  how long the selection has lasted.
+  
+  A new stimulus is selected once it has been hit by every valid sample
+  for at least the dwell duration , including task stimulus 'none' when
+  no stimulus is hit. The selection changes at the time of the sample that
+  completes the dwell. Invalid samples , such as those during a blink ,
+  neither change the selection nor interrupt the dwell. But if there is no
+  valid sample for longer than the blink duration , then the eyes are lost
+  and 'none' is selected immediately. The blink is timed from the last
+  valid sample ; if there has never been one then it is timed from the
+  first invalid sample or call that finds none.
+  
+  Sub-functions:
+    
+    seltarg ( 'o' , sid , none , dwell , blink ) -- Sets parameters ,
+      forgets the past , and selects 'none'. sid is the MET signal
+      identifier of mtarget , none is the index of task stimulus 'none' ,
+      dwell is the dwell duration in seconds , and blink is the maximum
+      duration of a blink in seconds. If blink is zero then the selection
+      never changes to 'none' for lack of valid samples , as with a mouse.
+      All scalar doubles.
+    
+    seltarg ( 'r' ) -- Reset for a new trial. Selects 'none' without
+      sending an mtarget signal , and drops any pending selection. The
+      blink timer carries on.
+    
+    [ sig , crg , tim ] = seltarg ( 's' , c , t , now ) -- Takes new
+      samples. c is an N x 1 double with the index of the task stimulus
+      that was hit by each sample , or NaN if the sample is invalid. t is
+      an N x 1 double of sample times , in seconds. Either may be empty
+      if N is zero. now is the current local time in seconds , as from met
+      ( 'select' ) , used to time the blink after the last sample. Returns
+      M x 1 doubles that hold one mtarget MET signal per change of
+      selection , in order , with the signal identifier , cargo i.e. the
+      selected task stimulus , and time. M is zero if nothing changed.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* General */
+#include  <math.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Set parameters */
+  #define  FUN_OPEN   'o'
+  
+  /* Reset for new trial */
+  #define  FUN_RESET  'r'
+  
+  /* Take new samples */
+  #define  FUN_SMPL   's'
+
+
+/* Number of input and output args , including fun */
+  
+  #define  NRHS_OPEN   5
+  #define  NRHS_RESET  1
+  #define  NRHS_SMPL   4
+  #define  NLHS_SMPL   3
+
+
+/*--- Global static variables ---*/
+
+/* Parameters have been set if non-zero */
+static int  son = 0 ;
+
+/* mtarget signal identifier , index of 'none' , dwell and blink
+   durations */
+static double  sid = 0 , none = 0 , dwell = 0 , blink = 0 ;
+
+/* Selected task stimulus , pending stimulus , and time that the pending
+   stimulus was first hit */
+static double  targ = 0 , cand = 0 , tcand = 0 ;
+
+/* Time of the last valid sample , or the start of the current blink if
+   there has never been one. NaN if neither is known. */
+static double  tval = NAN ;
+
+
+/*--- Function definitions ---*/
+
+void  selopen ( const mxArray ** ) ;
+void  selsmpl ( int , mxArray ** , const mxArray ** ) ;
+ int  notscalar ( const mxArray * ) ;
+
+
+/*** seltarg function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  /* Required number of inputs , and maximum number of outputs */
+  int  nin , nout = 0 ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:seltarg:fun"  ,
+      "seltarg arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:seltarg:fun"  ,
+      "seltarg arg fun must be a single char"  ) ;
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   nin = NRHS_OPEN  ;  break ;
+    case  FUN_RESET:  nin = NRHS_RESET ;  break ;
+    case  FUN_SMPL:   nin = NRHS_SMPL  ;  nout = NLHS_SMPL ;  break ;
+    
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:seltarg:fun"  ,
+        "seltarg arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  }
+  
+  if  ( nrhs  !=  nin )
+    
+    mexErrMsgIdAndTxt (  "MET:seltarg:fun"  ,
+      "seltarg '%c' requires %d input arguments in total"  ,  c[ 0 ]  ,
+        nin  ) ;
+  
+  else if  ( nout  <  nlhs )
+    
+    mexErrMsgIdAndTxt (  "MET:seltarg:fun"  ,
+      "seltarg '%c' provides at most %d output arguments"  ,  c[ 0 ]  ,
+        nout  ) ;
+  
+  else if  ( !son  &&  c[ 0 ] != FUN_OPEN )
+    
+    mexErrMsgIdAndTxt (  "MET:seltarg:fun"  ,
+      "seltarg must be opened with 'o' before '%c'"  ,  c[ 0 ]  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   selopen ( prhs + 1 ) ;  break ;
+    case  FUN_RESET:  targ = cand = none ;  break ;
+    case  FUN_SMPL:   selsmpl ( nlhs , plhs , prhs + 1 ) ;  break ;
+  }
+
+
+} /* seltarg */
+
+
+/*---Subroutines---*/
+
+/* Returns non-zero if m is not a real , finite , scalar double */
+int  notscalar ( const mxArray *  m )
+{
+  
+  return  !mxIsDouble ( m )  ||  !mxIsScalar ( m )  ||  mxIsComplex ( m )
+    ||  mxIsNaN ( mxGetScalar ( m ) )  ||  mxIsInf ( mxGetScalar ( m ) ) ;
+
+} /* notscalar */
+
+
+/* Set parameters from m , which holds sid , none , dwell , and blink */
+void  selopen ( const mxArray *  m[] )
+{
+  
+  int  i ;
+  
+  for  ( i = 0  ;  i < NRHS_OPEN - 1  ;  i++ )
+    if  ( notscalar ( m[ i ] )  ||  mxGetScalar ( m[ i ] ) < 0 )
+      mexErrMsgIdAndTxt (  "MET:seltarg:open"  ,
+        "seltarg 'o' , sid , none , dwell , and blink must be finite , "
+        "non-negative scalar doubles"  ) ;
+  
+  sid   = mxGetScalar ( m[ 0 ] ) ;
+  none  = mxGetScalar ( m[ 1 ] ) ;
+  dwell = mxGetScalar ( m[ 2 ] ) ;
+  blink = mxGetScalar ( m[ 3 ] ) ;
+  
+  targ = cand = none ;
+  tcand = 0 ;
+  tval = NAN ;
+  son = 1 ;
+
+} /* selopen */
+
+
+/* Take new samples c = m[ 0 ] at times t = m[ 1 ] , it is now m[ 2 ] */
+void  selsmpl ( int  nlhs , mxArray *  plhs[] , const mxArray *  m[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Counter , number of samples , and number of changes */
+  size_t  i , N , M = 0 ;
+  
+  /* Inputs */
+  const double  * c , * t ;
+  double  now ;
+  
+  /* Selected stimulus and time of each change , at most one per sample
+     and one for the blink at the end */
+  double  * s , * st ;
+  
+  /* Output pointer */
+  double *  p ;
+  
+  
+  /*-- Check input --*/
+  
+  N = mxGetNumberOfElements ( m[ 0 ] ) ;
+  
+  for  ( i = 0  ;  i < 2  ;  i++ )
+    if  ( !mxIsDouble ( m[ i ] )  ||  mxIsComplex ( m[ i ] )  ||
+          mxGetNumberOfElements ( m[ i ] ) != N  ||
+          ( N  &&  mxGetN ( m[ i ] ) != 1 ) )
+      mexErrMsgIdAndTxt (  "MET:seltarg:smpl"  ,
+        "seltarg 's' , c and t must be real N x 1 doubles"  ) ;
+  
+  if  ( notscalar ( m[ 2 ] ) )
+    mexErrMsgIdAndTxt (  "MET:seltarg:smpl"  ,
+      "seltarg 's' , now must be a finite scalar double"  ) ;
+  
+  c = mxGetPr ( m[ 0 ] ) ;
+  t = mxGetPr ( m[ 1 ] ) ;
+  now = mxGetScalar ( m[ 2 ] ) ;
+  
+  s  = mxMalloc ( 2 * ( N + 1 ) * sizeof ( double ) ) ;
+  st = s  +  N + 1 ;
+  
+  
+  /*-- Run state machine --*/
+  
+  for  ( i = 0  ;  i < N  ;  i++ )
+  {
+    
+    /* Invalid sample , eyes lost if the blink has run out */
+    if  ( isnan ( c[ i ] ) )
+    {
+      if  ( isnan ( tval ) )  tval = t[ i ] ;
+      
+      if  ( 0 < blink  &&  blink < t[ i ] - tval  &&  targ != none )
+      {
+        targ = cand = none ;
+        s[ M ] = targ ;  st[ M++ ] = t[ i ] ;
+      }
+      
+      continue ;
+    }
+    
+    tval = t[ i ] ;
+    
+    /* A different stimulus is hit , start its dwell */
+    if  ( c[ i ]  !=  cand )
+    {
+      cand  = c[ i ] ;
+      tcand = t[ i ] ;
+    }
+    
+    /* Pending stimulus has been hit for long enough */
+    if  ( cand != targ  &&  dwell <= t[ i ] - tcand )
+    {
+      targ = cand ;
+      s[ M ] = targ ;  st[ M++ ] = t[ i ] ;
+    }
+  
+  } /* samples */
+  
+  /* Blink after the last sample */
+  if  ( isnan ( tval ) )  tval = now ;
+  
+  if  ( 0 < blink  &&  blink < now - tval  &&  targ != none )
+  {
+    targ = cand = none ;
+    s[ M ] = targ ;  st[ M++ ] = now ;
+  }
+  
+  
+  /*-- Outputs --*/
+  
+  for  ( i = 0  ;  i < ( size_t ) ( nlhs ? nlhs : 1 )  ;  i++ )
+  {
+    plhs[ i ] = mxCreateDoubleMatrix ( M , 1 , mxREAL ) ;
+    p = mxGetPr ( plhs[ i ] ) ;
+    
+    for  ( N = 0  ;  N < M  ;  N++ )
+      p[ N ] = i == 0  ?  sid  :  ( i == 1  ?  s[ N ]  :  st[ N ] ) ;
+  }
+  
+  mxFree ( s ) ;
+
+} /* selsmpl */
+
@@ -0,0 +1,874 @@
+/*  sesstore.c
+  
+  [ ... ] = sesstore ( fun , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. Session store of
+  trial data. Each stream of data in a session , such as MET signals or
+  eye samples , is appended trial by trial to a pair of files in the
+  session's store directory , instead of being written to new files in
+  every trial directory. Analysis can then load any range of trials from
+  a stream with one call.
+  
+  A stream is a table of named columns. Each column is a real numeric ,
+  logical , or char matrix with a fixed class and a fixed number of
+  matrix columns , its width. All columns have the same number of rows in
+  a trial , but the number of rows can change from trial to trial. The
+  first trial that is appended sets the columns of the stream.
+  
+  A stream named f has the data file f.mcs and the index file f.mci. The
+  data file has a header that describes the columns , followed by one
+  chunk per trial. A chunk has a small header with the trial identifier
+  and number of rows , then the data of each column in turn , in Matlab's
+  own column-major order , each padded to a multiple of 8 bytes. The index
+  file has one record per chunk , with its trial identifier , byte offset
+  , and number of rows. Both files are only ever appended to. If a write
+  was cut short , say by a crash , then the next append repairs the index
+  and drops the broken chunk.
+  
+  The reader maps the data file into memory and copies the columns of the
+  selected chunks straight into the output arrays. Chunks that were
+  written after the last index record are found by following the chunks.
+  
+  Sub-functions:
+    
+    sesstore ( 'a' , f , tid , S ) -- Appends the data of trial tid to
+      stream f. f is a string naming the stream's files , without suffix ,
+      and tid is a scalar double. S is a scalar struct with one field per
+      column , each a 2D matrix. Every field must have the same number of
+      rows. For a new stream , the field names , classes , and widths
+      become the stream's columns. Otherwise S must have the same fields
+      in the same order , with the same classes and widths.
+    
+    [ S , T ] = sesstore ( 'r' , f , tid ) -- Reads every trial of stream
+      f with an identifier in the range tid( 1 ) to tid( end ). S has one
+      field per column , holding the rows of all the trials that were read
+      in the order that they were appended. T is an N x 2 double matrix
+      with a row per trial read , giving the trial identifier and its
+      number of rows in S.
+    
+    T = sesstore ( 'i' , f ) -- Returns T for every trial in stream f.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* Files */
+#include  <errno.h>
+#include  <fcntl.h>
+#include  <sys/mman.h>
+#include  <sys/stat.h>
+#include  <unistd.h>
+
+/* General */
+#include  <limits.h>
+#include  <stdint.h>
+#include  <stdio.h>
+#include  <string.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Append trial */
+  #define  FUN_APPEND  'a'
+  
+  /* Read trials */
+  #define  FUN_READ    'r'
+  
+  /* Index */
+  #define  FUN_INDEX   'i'
+
+
+/* Number of input and output args , including fun */
+  
+  #define  NRHS_APPEND  4
+  #define  NRHS_READ    3
+  #define  NRHS_INDEX   2
+  #define  NLHS_APPEND  0
+  #define  NLHS_READ    2
+  #define  NLHS_INDEX   1
+
+
+/* Data and index file suffixes */
+#define  SUFDAT  ".mcs"
+#define  SUFIDX  ".mci"
+
+/* Data file header magic , and chunk magic "MCCK" */
+#define  MCSMAGIC  "METCS001"
+#define  CHKMAGIC  0x4B43434DU
+
+/* Maximum number of columns , bytes of a column name , and maximum
+   width of a column */
+#define  MAXCOL  64
+#define  NAMLEN  32
+#define  MAXWID  65536
+
+/* Round up to a multiple of 8 bytes */
+#define  PAD8( n )  ( ( ( n ) + 7 )  &  ~ ( ( uint64_t ) 7 ) )
+
+
+/*--- Types ---*/
+
+/* Data file header , followed by ncol column descriptors. hsiz is the
+   number of bytes to the first chunk. */
+struct mcshead
+  {
+    char  magic[ 8 ] ;
+    uint32_t  ncol ;
+    uint32_t  hsiz ;
+  } ;
+
+/* Column descriptor. cls indexes CLS[] , wid is the number of matrix
+   columns. */
+struct mcscol
+  {
+    char  name[ NAMLEN ] ;
+    uint32_t  cls ;
+    uint32_t  wid ;
+  } ;
+
+/* Chunk header , followed by column data */
+struct mcschnk
+  {
+    uint32_t  magic ;
+    uint32_t  ncol ;
+    double  tid ;
+    uint64_t  nrow ;
+  } ;
+
+/* Index record */
+struct mcsidx
+  {
+    double  tid ;
+    uint64_t  off ;
+    uint64_t  nrow ;
+  } ;
+
+/* A data file's column layout */
+struct mcsschm
+  {
+    uint32_t  ncol ;
+    uint32_t  hsiz ;
+    struct mcscol  col[ MAXCOL ] ;
+  } ;
+
+
+/*--- Global static variables ---*/
+
+/* Classes that a column may have , and their bytes per element. The
+   index into this list is stored on disk , so only ever add to the end. */
+static const struct { mxClassID  id ; size_t  siz ; }  CLS[] =
+  {
+    { mxDOUBLE_CLASS  , sizeof ( double  ) } ,
+    { mxSINGLE_CLASS  , sizeof ( float   ) } ,
+    { mxINT8_CLASS    , sizeof ( int8_t  ) } ,
+    { mxUINT8_CLASS   , sizeof ( uint8_t ) } ,
+    { mxINT16_CLASS   , sizeof ( int16_t ) } ,
+    { mxUINT16_CLASS  , sizeof ( uint16_t ) } ,
+    { mxINT32_CLASS   , sizeof ( int32_t ) } ,
+    { mxUINT32_CLASS  , sizeof ( uint32_t ) } ,
+    { mxINT64_CLASS   , sizeof ( int64_t ) } ,
+    { mxUINT64_CLASS  , sizeof ( uint64_t ) } ,
+    { mxLOGICAL_CLASS , sizeof ( mxLogical ) } ,
+    { mxCHAR_CLASS    , sizeof ( mxChar ) }
+  } ;
+
+#define  NCLS  ( sizeof ( CLS ) / sizeof ( CLS[ 0 ] ) )
+
+
+/*--- Function definitions ---*/
+
+void  ssappend ( const mxArray ** ) ;
+void  ssread ( int , mxArray ** , const mxArray * , const mxArray * ) ;
+void  mkschema ( const mxArray * , struct mcsschm * ) ;
+ int  rdschema ( int , struct mcsschm * ) ;
+uint64_t  chksiz ( const struct mcsschm * , uint64_t ) ;
+ int  chkok ( const struct mcsschm * , const char * , uint64_t ,
+  uint64_t , uint64_t * ) ;
+const char *  repair ( int , int , const struct mcsschm * ) ;
+mxArray *  mkcol ( mxClassID , size_t , size_t ) ;
+struct mcsidx *  ldindex ( const char * , const struct mcsschm * ,
+  const char * , uint64_t , size_t * ) ;
+void  fname ( char * , const mxArray * , const char * ) ;
+ int  xpwrite ( int , const void * , size_t , off_t ) ;
+
+
+/*** sesstore function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  /* Required number of inputs , and maximum number of outputs */
+  int  nin , nout = 0 ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:fun"  ,
+      "sesstore arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:fun"  ,
+      "sesstore arg fun must be a single char"  ) ;
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_APPEND:  nin = NRHS_APPEND ;  nout = NLHS_APPEND ;  break ;
+    case  FUN_READ:    nin = NRHS_READ   ;  nout = NLHS_READ   ;  break ;
+    case  FUN_INDEX:   nin = NRHS_INDEX  ;  nout = NLHS_INDEX  ;  break ;
+    
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:sesstore:fun"  ,
+        "sesstore arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  }
+  
+  if  ( nrhs  !=  nin )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:fun"  ,
+      "sesstore '%c' requires %d input arguments in total"  ,  c[ 0 ]  ,
+        nin  ) ;
+  
+  else if  ( nout  <  nlhs )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:fun"  ,
+      "sesstore '%c' provides at most %d output arguments"  ,  c[ 0 ]  ,
+        nout  ) ;
+  
+  else if  ( !mxIsChar ( prhs[ 1 ] )  ||  mxGetM ( prhs[ 1 ] ) != 1 )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:f"  ,
+      "sesstore '%c' , f must be a string"  ,  c[ 0 ]  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_APPEND:  ssappend ( prhs + 1 ) ;  break ;
+    case  FUN_READ:    ssread ( nlhs , plhs , prhs[ 1 ] , prhs[ 2 ] ) ;
+                       break ;
+    case  FUN_INDEX:   ssread ( -1 , plhs , prhs[ 1 ] , NULL ) ;  break ;
+  }
+
+
+} /* sesstore */
+
+
+/*---Subroutines---*/
+
+/* Full name of stream f's file with suffix s , in buffer n of PATH_MAX
+   bytes */
+void  fname ( char *  n , const mxArray *  f , const char *  s )
+{
+  
+  char  b[ PATH_MAX ] ;
+  
+  if  ( mxGetString ( f , b , PATH_MAX )  ||
+        PATH_MAX  <=  snprintf ( n , PATH_MAX , "%s%s" , b , s ) )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:f"  ,
+      "sesstore , f is too long"  ) ;
+
+} /* fname */
+
+
+/* pwrite all n bytes of b at offset o. Returns non-zero on error. */
+int  xpwrite ( int  fd , const void *  b , size_t  n , off_t  o )
+{
+  
+  ssize_t  w ;
+  
+  while  ( n )
+  {
+    
+    if  ( ( w = pwrite ( fd , b , n , o ) )  ==  -1 )
+    {
+      if  ( errno  ==  EINTR )  continue ;
+      return  1 ;
+    }
+    
+    b = ( const char * ) b  +  w ;
+    n -= w ;
+    o += w ;
+  
+  }
+  
+  return  0 ;
+
+} /* xpwrite */
+
+
+/* Bytes of a chunk with nrow rows */
+uint64_t  chksiz ( const struct mcsschm *  s , uint64_t  nrow )
+{
+  
+  uint64_t  n = sizeof ( struct mcschnk ) ;
+  uint32_t  i ;
+  
+  for  ( i = 0 ; i < s->ncol ; ++i )
+    n += PAD8 ( nrow  *  s->col[ i ].wid  *  CLS[ s->col[ i ].cls ].siz ) ;
+  
+  return  n ;
+
+} /* chksiz */
+
+
+/* Non-zero if a whole chunk lies at byte offset o of data file d , which
+   has n bytes. Returns the chunk's size in z. */
+int  chkok ( const struct mcsschm *  s , const char *  d , uint64_t  n ,
+  uint64_t  o , uint64_t *  z )
+{
+  
+  const struct mcschnk *  h = ( const struct mcschnk * ) ( d + o ) ;
+  
+  if  ( o % 8  ||  o < s->hsiz  ||  n < o  ||
+        n - o < sizeof ( struct mcschnk )  ||
+        h->magic != CHKMAGIC  ||  h->ncol != s->ncol )
+    return  0 ;
+  
+  /* Guard against nonsense row counts before multiplying */
+  if  ( h->nrow  >  n )  return  0 ;
+  
+  *z = chksiz ( s , h->nrow ) ;
+  
+  return  *z  <=  n - o ;
+
+} /* chkok */
+
+
+/* Column layout of the fields of scalar struct S */
+void  mkschema ( const mxArray *  S , struct mcsschm *  s )
+{
+  
+  /* Field , its class , field and class indices , and number of rows */
+  const mxArray *  m ;
+  mxClassID  id ;
+  int  i ;
+  size_t  j , r = 0 ;
+  const char *  n ;
+  
+  if  ( !mxIsStruct ( S )  ||  !mxIsScalar ( S ) )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:S"  ,
+      "sesstore 'a' , S must be a scalar struct"  ) ;
+  
+  s->ncol = mxGetNumberOfFields ( S ) ;
+  
+  if  ( s->ncol < 1  ||  MAXCOL < s->ncol )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:S"  ,
+      "sesstore 'a' , S must have 1 to %d fields"  ,  MAXCOL  ) ;
+  
+  for  ( i = 0 ; i < ( int ) s->ncol ; ++i )
+  {
+    
+    m = mxGetFieldByNumber ( S , 0 , i ) ;
+    n = mxGetFieldNameByNumber ( S , i ) ;
+    
+    if  ( NAMLEN  <=  strlen ( n ) )
+      
+      mexErrMsgIdAndTxt (  "MET:sesstore:S"  ,
+        "sesstore 'a' , field name %s is longer than %d chars"  ,  n  ,
+          NAMLEN - 1  ) ;
+    
+    id = m  ?  mxGetClassID ( m )  :  mxUNKNOWN_CLASS ;
+    
+    for  ( j = 0 ; j < NCLS  &&  CLS[ j ].id != id ; ++j ) ;
+    
+    if  ( j == NCLS  ||  mxIsComplex ( m )  ||  mxIsSparse ( m )  ||
+          2 < mxGetNumberOfDimensions ( m )  ||  MAXWID < mxGetN ( m ) )
+      
+      mexErrMsgIdAndTxt (  "MET:sesstore:S"  ,
+        "sesstore 'a' , field %s must be a real , full , 2D numeric , "
+        "logical , or char matrix , at most %d columns wide"  ,  n  ,
+          MAXWID  ) ;
+    
+    if  ( i  &&  mxGetM ( m ) != r )
+      
+      mexErrMsgIdAndTxt (  "MET:sesstore:S"  ,
+        "sesstore 'a' , all fields of S must have the same number of rows"
+        ) ;
+    
+    r = mxGetM ( m ) ;
+    
+    memset ( s->col[ i ].name , 0 , NAMLEN ) ;
+    strcpy ( s->col[ i ].name , n ) ;
+    s->col[ i ].cls = j ;
+    s->col[ i ].wid = mxGetN ( m ) ;
+  
+  }
+  
+  s->hsiz = sizeof ( struct mcshead )  +
+    s->ncol * sizeof ( struct mcscol ) ;
+
+} /* mkschema */
+
+
+/* New m x n matrix of class id */
+mxArray *  mkcol ( mxClassID  id , size_t  m , size_t  n )
+{
+  
+  const mwSize  d[ 2 ] = { m , n } ;
+  
+  switch  ( id )
+  {
+    case  mxCHAR_CLASS:     return  mxCreateCharArray ( 2 , d ) ;
+    case  mxLOGICAL_CLASS:  return  mxCreateLogicalMatrix ( m , n ) ;
+    default:  return  mxCreateNumericMatrix ( m , n , id , mxREAL ) ;
+  }
+
+} /* mkcol */
+
+
+/* Read the column layout from the header of data file fd. Returns non-zero
+   if it is not a valid header. */
+int  rdschema ( int  fd , struct mcsschm *  s )
+{
+  
+  struct mcshead  h ;
+  uint32_t  i ;
+  size_t  n ;
+  
+  if  ( pread ( fd , &h , sizeof ( h ) , 0 )  !=  sizeof ( h )  ||
+        memcmp ( h.magic , MCSMAGIC , 8 )  ||
+        h.ncol < 1  ||  MAXCOL < h.ncol )
+    return  1 ;
+  
+  s->ncol = h.ncol ;
+  s->hsiz = h.hsiz ;
+  n = h.ncol * sizeof ( struct mcscol ) ;
+  
+  if  ( h.hsiz  !=  sizeof ( h ) + n  ||
+        pread ( fd , s->col , n , sizeof ( h ) )  !=  ( ssize_t ) n )
+    return  1 ;
+  
+  for  ( i = 0 ; i < s->ncol ; ++i )
+    if  ( NCLS <= s->col[ i ].cls  ||  MAXWID < s->col[ i ].wid  ||
+          s->col[ i ].name[ NAMLEN - 1 ] )
+      return  1 ;
+  
+  return  0 ;
+
+} /* rdschema */
+
+
+/* Bring the index up to date with the data file , then cut off any broken
+   chunk at the end of the data file. fd and fi are the data and index
+   files. Returns an error message , or NULL. */
+const char *  repair ( int  fd , int  fi , const struct mcsschm *  s )
+{
+  
+  /* File sizes , end of last good chunk , and size of a chunk */
+  struct stat  st ;
+  uint64_t  nd , ni , e , z ;
+  
+  /* Index record , and chunk header */
+  struct mcsidx  x ;
+  struct mcschnk  h ;
+  
+  if  ( fstat ( fd , &st ) )  goto  err ;
+  nd = st.st_size ;
+  
+  if  ( fstat ( fi , &st ) )  goto  err ;
+  ni = st.st_size  -  st.st_size % sizeof ( x ) ;
+  
+  /* End of the last indexed chunk */
+  e = s->hsiz ;
+  
+  if  ( ni )
+  {
+    if  ( pread ( fi , &x , sizeof ( x ) , ni - sizeof ( x ) )  !=
+          sizeof ( x ) )  goto  err ;
+    e = x.off  +  chksiz ( s , x.nrow ) ;
+  }
+  
+  /* Index any whole chunks that follow */
+  while  ( e + sizeof ( h )  <=  nd )
+  {
+    
+    if  ( pread ( fd , &h , sizeof ( h ) , e )  !=  sizeof ( h )  ||
+          h.magic != CHKMAGIC  ||  h.ncol != s->ncol  ||  nd < h.nrow )
+      break ;
+    
+    if  ( nd - e  <  ( z = chksiz ( s , h.nrow ) ) )  break ;
+    
+    x.tid = h.tid ;
+    x.off = e ;
+    x.nrow = h.nrow ;
+    
+    if  ( xpwrite ( fi , &x , sizeof ( x ) , ni ) )  goto  err ;
+    
+    ni += sizeof ( x ) ;
+    e += z ;
+  
+  }
+  
+  if  ( ( e < nd  &&  ftruncate ( fd , e ) )  ||
+        ( ni < ( uint64_t ) st.st_size  &&  ftruncate ( fi , ni ) ) )
+    goto  err ;
+  
+  return  NULL ;
+  
+  err:
+    
+    return  strerror ( errno ) ;
+
+} /* repair */
+
+
+/* Append a trial to a stream */
+void  ssappend ( const mxArray **  prhs )
+{
+  
+  /* File names , file descriptors , and their sizes */
+  char  fd_n[ PATH_MAX ] , fi_n[ PATH_MAX ] ;
+  int  fd = -1 , fi = -1 ;
+  struct stat  st ;
+  
+  /* Layout of S , and of the existing stream */
+  struct mcsschm  s , t ;
+  
+  /* Header , chunk , chunk size , bytes of a column , and index record */
+  struct mcshead  h ;
+  struct mcschnk *  c ;
+  uint64_t  z , b ;
+  struct mcsidx  x ;
+  
+  /* Byte pointer and column index */
+  char *  p ;
+  uint32_t  i ;
+  
+  /* Error message */
+  const char *  e = NULL ;
+  
+  fname ( fd_n , prhs[ 0 ] , SUFDAT ) ;
+  fname ( fi_n , prhs[ 0 ] , SUFIDX ) ;
+  
+  if  ( !mxIsDouble ( prhs[ 1 ] )  ||  !mxIsScalar ( prhs[ 1 ] )  ||
+        mxIsComplex ( prhs[ 1 ] ) )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:tid"  ,
+      "sesstore 'a' , tid must be a scalar double"  ) ;
+  
+  mkschema ( prhs[ 2 ] , &s ) ;
+  
+  /* Build the chunk first , so that nothing is left open on error */
+  x.tid = mxGetScalar ( prhs[ 1 ] ) ;
+  x.nrow = mxGetM ( mxGetFieldByNumber ( prhs[ 2 ] , 0 , 0 ) ) ;
+  z = chksiz ( &s , x.nrow ) ;
+  
+  c = mxCalloc ( z , 1 ) ;
+  c->magic = CHKMAGIC ;
+  c->ncol = s.ncol ;
+  c->tid = x.tid ;
+  c->nrow = x.nrow ;
+  
+  for  ( i = 0 , p = ( char * ) ( c + 1 ) ; i < s.ncol ; ++i )
+  {
+    b = x.nrow  *  s.col[ i ].wid  *  CLS[ s.col[ i ].cls ].siz ;
+    if  ( b )  memcpy ( p ,
+      mxGetData ( mxGetFieldByNumber ( prhs[ 2 ] , 0 , i ) ) , b ) ;
+    p += PAD8 ( b ) ;
+  }
+  
+  /* Open the stream */
+  if  ( ( fd = open ( fd_n , O_RDWR | O_CREAT , 0666 ) )  ==  -1  ||
+        ( fi = open ( fi_n , O_RDWR | O_CREAT , 0666 ) )  ==  -1  ||
+        fstat ( fd , &st ) )
+  {
+    e = strerror ( errno ) ;
+    goto  done ;
+  }
+  
+  /* New stream , write the header */
+  if  ( !st.st_size )
+  {
+    
+    memcpy ( h.magic , MCSMAGIC , 8 ) ;
+    h.ncol = s.ncol ;
+    h.hsiz = s.hsiz ;
+    
+    if  ( xpwrite ( fd , &h , sizeof ( h ) , 0 )  ||
+          xpwrite ( fd , s.col , s.hsiz - sizeof ( h ) , sizeof ( h ) )  ||
+          ftruncate ( fi , 0 ) )
+    {
+      e = strerror ( errno ) ;
+      goto  done ;
+    }
+  
+  }
+  
+  /* Existing stream , S must match it */
+  else if  ( rdschema ( fd , &t ) )
+  {
+    e = "not a session store data file" ;
+    goto  done ;
+  }
+  else if  ( t.ncol != s.ncol  ||
+             memcmp ( t.col , s.col , s.ncol * sizeof ( struct mcscol ) ) )
+  {
+    e = "S does not have the same fields , classes , and widths as the "
+        "stream" ;
+    goto  done ;
+  }
+  
+  /* Make sure the index is complete , then append after the last chunk */
+  if  ( ( e = repair ( fd , fi , &s ) ) )  goto  done ;
+  
+  if  ( fstat ( fd , &st ) )
+  {
+    e = strerror ( errno ) ;
+    goto  done ;
+  }
+  
+  x.off = st.st_size ;
+  
+  if  ( xpwrite ( fd , c , z , x.off )  ||  fstat ( fi , &st )  ||
+        xpwrite ( fi , &x , sizeof ( x ) , st.st_size ) )
+    e = strerror ( errno ) ;
+  
+  done:
+    
+    if  ( fd  !=  -1 )  close ( fd ) ;
+    if  ( fi  !=  -1 )  close ( fi ) ;
+    mxFree ( c ) ;
+    
+    if  ( e )
+      mexErrMsgIdAndTxt (  "MET:sesstore:append"  ,
+        "sesstore 'a' , %s , %s"  ,  fd_n  ,  e  ) ;
+
+} /* ssappend */
+
+
+/* Index of the chunks in data file d of n bytes , mapped in memory. Valid
+   records are read from index file fi_n , then any chunks that follow the
+   last one. Returns the records in an mxMalloc'd array , and their number
+   in k. */
+struct mcsidx *  ldindex ( const char *  fi_n , const struct mcsschm *  s ,
+  const char *  d , uint64_t  n , size_t *  k )
+{
+  
+  /* Index file , its size , records , capacity , and end of last chunk */
+  int  fi ;
+  struct stat  st ;
+  struct mcsidx *  x = NULL ;
+  size_t  i , j , m = 0 ;
+  uint64_t  e = s->hsiz , z ;
+  
+  const struct mcschnk *  h ;
+  
+  /* Missing index is not an error , the chunks can be followed */
+  if  ( ( fi = open ( fi_n , O_RDONLY ) )  !=  -1  &&  !fstat ( fi , &st ) )
+  {
+    
+    m = st.st_size  /  sizeof ( struct mcsidx ) ;
+    x = mxMalloc ( ( m ? m : 1 ) * sizeof ( struct mcsidx ) ) ;
+    
+    if  ( pread ( fi , x , m * sizeof ( struct mcsidx ) , 0 )  !=
+          ( ssize_t ) ( m * sizeof ( struct mcsidx ) ) )
+      m = 0 ;
+  
+  }
+  
+  if  ( fi  !=  -1 )  close ( fi ) ;
+  
+  /* Keep records that point at whole chunks in increasing order */
+  for  ( i = j = 0 ; i < m ; ++i )
+  {
+    
+    if  ( x[ i ].off < e  ||  !chkok ( s , d , n , x[ i ].off , &z )  ||
+          ( ( const struct mcschnk * ) ( d + x[ i ].off ) )->nrow !=
+            x[ i ].nrow )
+      continue ;
+    
+    x[ j++ ] = x[ i ] ;
+    e = x[ i ].off  +  z ;
+  
+  }
+  
+  /* Follow unindexed chunks */
+  while  ( chkok ( s , d , n , e , &z ) )
+  {
+    
+    if  ( j  ==  m )
+    {
+      m = m ? 2 * m : 64 ;
+      x = mxRealloc ( x , m * sizeof ( struct mcsidx ) ) ;
+    }
+    
+    h = ( const struct mcschnk * ) ( d + e ) ;
+    x[ j ].tid = h->tid ;
+    x[ j ].off = e ;
+    x[ j ].nrow = h->nrow ;
+    ++j ;
+    e += z ;
+  
+  }
+  
+  *k = j ;
+  
+  return  x ;
+
+} /* ldindex */
+
+
+/* Read trials in range r from stream f. If nlhs is negative then only
+   return the index. */
+void  ssread ( int  nlhs , mxArray **  plhs , const mxArray *  f ,
+  const mxArray *  r )
+{
+  
+  /* File names , data file descriptor , its size , and mapping */
+  char  fd_n[ PATH_MAX ] , fi_n[ PATH_MAX ] ;
+  int  fd ;
+  struct stat  st ;
+  char *  d = NULL ;
+  
+  /* Column layout , index , number of records , and trial range */
+  struct mcsschm  s ;
+  struct mcsidx *  x ;
+  size_t  k , i , j , n ;
+  double  t0 = 0 , t1 = 0 ;
+  
+  /* Output trial list and its values , output struct , and field names */
+  mxArray *  T ;
+  double *  tp ;
+  mxArray *  S ;
+  const char *  fn[ MAXCOL ] ;
+  
+  /* Column bytes per row , bytes in the chunk , row offset , source */
+  size_t  b , w , o ;
+  const char *  p ;
+  char *  q ;
+  uint32_t  c ;
+  
+  fname ( fd_n , f , SUFDAT ) ;
+  fname ( fi_n , f , SUFIDX ) ;
+  
+  if  ( r  &&  ( !mxIsDouble ( r )  ||  mxIsComplex ( r )  ||
+                 mxIsEmpty ( r ) ) )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:tid"  ,
+      "sesstore 'r' , tid must be a non-empty double"  ) ;
+  
+  if  ( r )
+  {
+    t0 = mxGetPr ( r )[ 0 ] ;
+    t1 = mxGetPr ( r )[ mxGetNumberOfElements ( r ) - 1 ] ;
+  }
+  
+  /* Map the data file */
+  if  ( ( fd = open ( fd_n , O_RDONLY ) )  ==  -1 )
+    
+    mexErrMsgIdAndTxt (  "MET:sesstore:open"  ,
+      "sesstore , %s , %s"  ,  fd_n  ,  strerror ( errno )  ) ;
+  
+  if  ( rdschema ( fd , &s ) )
+  {
+    close ( fd ) ;
+    mexErrMsgIdAndTxt (  "MET:sesstore:open"  ,
+      "sesstore , %s is not a session store data file"  ,  fd_n  ) ;
+  }
+  
+  if  ( fstat ( fd , &st )  ||  ( d = mmap ( NULL , st.st_size ,
+          PROT_READ , MAP_SHARED , fd , 0 ) )  ==  MAP_FAILED )
+  {
+    close ( fd ) ;
+    mexErrMsgIdAndTxt (  "MET:sesstore:open"  ,
+      "sesstore , mmap %s , %s"  ,  fd_n  ,  strerror ( errno )  ) ;
+  }
+  
+  close ( fd ) ;
+  
+  /* Chunk index , then keep the selected trials */
+  x = ldindex ( fi_n , &s , d , st.st_size , &k ) ;
+  
+  if  ( r )
+  {
+    for  ( i = j = 0 ; i < k ; ++i )
+      if  ( t0 <= x[ i ].tid  &&  x[ i ].tid <= t1 )  x[ j++ ] = x[ i ] ;
+    k = j ;
+  }
+  
+  /* Trial list */
+  T = mxCreateDoubleMatrix ( k , 2 , mxREAL ) ;
+  tp = mxGetPr ( T ) ;
+  
+  for  ( i = n = 0 ; i < k ; ++i )
+  {
+    tp[ i ] = x[ i ].tid ;
+    tp[ i + k ] = ( double ) x[ i ].nrow ;
+    n += x[ i ].nrow ;
+  }
+  
+  if  ( nlhs  <  0 )
+  {
+    plhs[ 0 ] = T ;
+    goto  done ;
+  }
+  
+  /* Output struct , one field per column , with all selected rows */
+  for  ( c = 0 ; c < s.ncol ; ++c )  fn[ c ] = s.col[ c ].name ;
+  
+  S = mxCreateStructMatrix ( 1 , 1 , s.ncol , fn ) ;
+  
+  for  ( c = 0 ; c < s.ncol ; ++c )
+    mxSetFieldByNumber ( S , 0 , c ,
+      mkcol ( CLS[ s.col[ c ].cls ].id , n , s.col[ c ].wid ) ) ;
+  
+  /* Copy each column of each chunk straight out of the mapping. Matrix
+     column j of the chunk's block goes below the rows of earlier chunks in
+     matrix column j of the output. */
+  for  ( i = o = 0 ; i < k ; o += x[ i++ ].nrow )
+  {
+    
+    p = d  +  x[ i ].off  +  sizeof ( struct mcschnk ) ;
+    
+    for  ( c = 0 ; c < s.ncol ; ++c )
+    {
+      
+      b = CLS[ s.col[ c ].cls ].siz ;
+      w = x[ i ].nrow  *  b ;
+      q = mxGetData ( mxGetFieldByNumber ( S , 0 , c ) ) ;
+      
+      if  ( w )
+        for  ( j = 0 ; j < s.col[ c ].wid ; ++j )
+          memcpy ( q + ( j * n + o ) * b , p + j * w , w ) ;
+      
+      p += PAD8 ( w * s.col[ c ].wid ) ;
+    
+    }
+  
+  }
+  
+  plhs[ 0 ] = S ;
+  if  ( 1 < nlhs )  plhs[ 1 ] = T ;  else  mxDestroyArray ( T ) ;
+  
+  done:
+    
+    mxFree ( x ) ;
+    munmap ( d , st.st_size ) ;
+
+} /* ssread */
+
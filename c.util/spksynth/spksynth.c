@@ -0,0 +1,426 @@
+/*  spksynth.c
+  
+  [ ... ] = spksynth ( fun , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. Synthesises the
+  waveform of a simulated spike train in consecutive chunks , for
+  metsimspk to stream through PsychPortAudio. Memory use is constant , no
+  matter how long the trial lasts , and nothing has to be made before the
+  trial starts.
+  
+  Spikes are a Poisson process with a dead time. Each inter-spike interval
+  is the refractory period plus an exponentially distributed interval
+  whose mean is the reciprocal of the firing rate. Hence , time is spent
+  on each spike rather than on each audio sample. The kernel is added to
+  the waveform at the sample of every spike , and any part of it that
+  runs past the end of one chunk is carried over into the next.
+  
+  The kernel is scaled so that its largest absolute value is 1. Then the
+  waveform ranges from -1 to +1 when the kernel is no longer than the
+  refractory period , otherwise overlapping spikes are clipped to that
+  range.
+  
+  The firing rate can be changed at any time , and applies to all samples
+  in the next chunk. Because a Poisson process has no memory , the next
+  spike is drawn afresh from the new rate , but no sooner than the end of
+  the refractory period of the last spike.
+  
+  Sub-functions:
+    
+    spksynth ( 'o' , fs , k , refract ) -- Sets the audio sampling rate fs
+      in Hz , a scalar double ; the spike kernel k , a vector of doubles
+      or singles sampled at fs ; and the refractory period refract in
+      seconds , a scalar double. Then does the same as 'r' , and sets the
+      firing rate to zero. The random number generator is seeded from the
+      time.
+    
+    spksynth ( 'r' ) -- Reset for a new trial. Sample zero is the next
+      sample to be generated , there is no carried-over kernel , and the
+      last spike is forgotten. The firing rate does not change.
+    
+    spksynth ( 'f' , rate ) -- Sets the firing rate in Hz , a non-negative
+      scalar double.
+    
+    x = spksynth ( 'g' , n ) -- Returns the next n samples of the
+      waveform in a 2 x n single array , for left and right stereo
+      channels that are identical. n is a non-negative scalar double.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* General */
+#include  <math.h>
+#include  <stdint.h>
+#include  <string.h>
+#include  <time.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Set parameters */
+  #define  FUN_OPEN   'o'
+  
+  /* Reset for new trial */
+  #define  FUN_RESET  'r'
+  
+  /* Set firing rate */
+  #define  FUN_RATE   'f'
+  
+  /* Generate samples */
+  #define  FUN_GEN    'g'
+
+
+/* Number of input and output args , including fun */
+  
+  #define  NRHS_OPEN   4
+  #define  NRHS_RESET  1
+  #define  NRHS_RATE   2
+  #define  NRHS_GEN    2
+  #define  NLHS_GEN    1
+
+
+/* Number of audio channels */
+#define  NCHAN  2
+
+/* Scales the top 53 bits of a 64-bit integer into ( 0 , 1 ] */
+#define  RNGSCL  ( 1.0 / 9007199254740992.0 )
+
+
+/*--- Global static variables ---*/
+
+/* Kernel , its length in samples , and the kernel carried over past the
+   end of the last chunk. NULL until 'o'. */
+static float *  kern = NULL ;
+static float *  tail = NULL ;
+static size_t  klen = 0 ;
+
+/* Sampling rate in Hz , refractory period in samples , and firing rate in
+   spikes per sample */
+static double  fs = 0 , refr = 0 , rate = 0 ;
+
+/* Number of samples generated since reset , time of the next spike and of
+   the last one , in samples since reset. The last spike is -INFINITY if
+   there has not been one , and the next is INFINITY if the rate is zero.
+*/
+static double  nsmp = 0 , tnext = INFINITY , tlast = -INFINITY ;
+
+/* Random number generator state , xorshift64* */
+static uint64_t  rng = 0 ;
+
+
+/*--- Function definitions ---*/
+
+void  synfree ( void ) ;
+void  synopen ( const mxArray ** ) ;
+void  synreset ( void ) ;
+void  synrate ( const mxArray * ) ;
+void  syngen ( mxArray ** , const mxArray * ) ;
+double  nextspk ( double ) ;
+ int  notscalar ( const mxArray * ) ;
+
+
+/*** spksynth function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  /* Required number of inputs , and maximum number of outputs */
+  int  nin , nout = 0 ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:spksynth:fun"  ,
+      "spksynth arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:spksynth:fun"  ,
+      "spksynth arg fun must be a single char"  ) ;
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   nin = NRHS_OPEN  ;  break ;
+    case  FUN_RESET:  nin = NRHS_RESET ;  break ;
+    case  FUN_RATE:   nin = NRHS_RATE  ;  break ;
+    case  FUN_GEN:    nin = NRHS_GEN   ;  nout = NLHS_GEN ;  break ;
+    
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:spksynth:fun"  ,
+        "spksynth arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  }
+  
+  if  ( nrhs  !=  nin )
+    
+    mexErrMsgIdAndTxt (  "MET:spksynth:fun"  ,
+      "spksynth '%c' requires %d input arguments in total"  ,  c[ 0 ]  ,
+        nin  ) ;
+  
+  else if  ( nout  <  nlhs )
+    
+    mexErrMsgIdAndTxt (  "MET:spksynth:fun"  ,
+      "spksynth '%c' provides at most %d output arguments"  ,  c[ 0 ]  ,
+        nout  ) ;
+  
+  else if  ( kern == NULL  &&  c[ 0 ] != FUN_OPEN )
+    
+    mexErrMsgIdAndTxt (  "MET:spksynth:fun"  ,
+      "spksynth must be opened with 'o' before '%c'"  ,  c[ 0 ]  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_OPEN:   synopen  ( prhs + 1 ) ;  break ;
+    case  FUN_RESET:  synreset ( ) ;  break ;
+    case  FUN_RATE:   synrate  ( prhs[ 1 ] ) ;  break ;
+    case  FUN_GEN:    syngen   ( plhs , prhs[ 1 ] ) ;  break ;
+  }
+
+
+} /* spksynth */
+
+
+/*---Subroutines---*/
+
+/* Returns non-zero if m is not a real , finite , scalar double */
+int  notscalar ( const mxArray *  m )
+{
+  
+  return  !mxIsDouble ( m )  ||  !mxIsScalar ( m )  ||  mxIsComplex ( m )
+    ||  mxIsNaN ( mxGetScalar ( m ) )  ||  mxIsInf ( mxGetScalar ( m ) ) ;
+
+} /* notscalar */
+
+
+/* Release kernel buffers */
+void  synfree ( void )
+{
+  
+  if  ( kern != NULL )  mxFree ( kern ) ;
+  if  ( tail != NULL )  mxFree ( tail ) ;
+  
+  kern = tail = NULL ;
+  klen = 0 ;
+
+} /* synfree */
+
+
+/* Returns the time of the spike after one at time t , in samples since
+   reset , or INFINITY if the firing rate is zero */
+double  nextspk ( double  t )
+{
+  
+  /* Uniform random number in ( 0 , 1 ] */
+  double  u ;
+  
+  if  ( rate  <=  0 )  return  INFINITY ;
+  
+  rng ^= rng >> 12 ;
+  rng ^= rng << 25 ;
+  rng ^= rng >> 27 ;
+  
+  u = ( double ) ( ( rng * 2685821657736338717ULL ) >> 11 )  *  RNGSCL  +
+    RNGSCL ;
+  
+  return  t  +  refr  -  log ( u ) / rate ;
+
+} /* nextspk */
+
+
+/* Set sampling rate , kernel , and refractory period from m */
+void  synopen ( const mxArray *  m[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Counter , kernel length */
+  size_t  i , n ;
+  
+  /* Largest absolute kernel value */
+  double  kmax = 0 , v ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( notscalar ( m[ 0 ] )  ||  mxGetScalar ( m[ 0 ] ) <= 0 )
+    mexErrMsgIdAndTxt (  "MET:spksynth:open"  ,
+      "spksynth 'o' , fs must be a finite , positive scalar double"  ) ;
+  
+  n = mxGetNumberOfElements ( m[ 1 ] ) ;
+  
+  if  ( !( mxIsDouble ( m[ 1 ] )  ||  mxIsSingle ( m[ 1 ] ) )  ||
+        mxIsComplex ( m[ 1 ] )  ||  !n  ||
+        ( mxGetM ( m[ 1 ] ) != 1  &&  mxGetN ( m[ 1 ] ) != 1 ) )
+    mexErrMsgIdAndTxt (  "MET:spksynth:open"  ,
+      "spksynth 'o' , k must be a real , non-empty double or single "
+      "vector"  ) ;
+  
+  if  ( notscalar ( m[ 2 ] )  ||  mxGetScalar ( m[ 2 ] ) < 0 )
+    mexErrMsgIdAndTxt (  "MET:spksynth:open"  ,
+      "spksynth 'o' , refract must be a finite , non-negative scalar "
+      "double"  ) ;
+  
+  
+  /*-- Kernel --*/
+  
+  synfree ( ) ;
+  mexAtExit ( synfree ) ;
+  
+  kern = mxCalloc ( n , sizeof ( *kern ) ) ;
+  tail = mxCalloc ( n , sizeof ( *tail ) ) ;
+  mexMakeMemoryPersistent ( kern ) ;
+  mexMakeMemoryPersistent ( tail ) ;
+  klen = n ;
+  
+  for  ( i = 0  ;  i < n  ;  i++ )
+  {
+    v = mxIsDouble ( m[ 1 ] )  ?  mxGetPr ( m[ 1 ] )[ i ]  :
+      ( ( float * ) mxGetData ( m[ 1 ] ) )[ i ] ;
+    
+    if  ( !isfinite ( v ) )
+      mexErrMsgIdAndTxt (  "MET:spksynth:open"  ,
+        "spksynth 'o' , k must be finite"  ) ;
+    
+    kern[ i ] = ( float ) v ;
+    if  ( kmax  <  fabs ( v ) )  kmax = fabs ( v ) ;
+  }
+  
+  if  ( kmax  >  0 )
+    for  ( i = 0  ;  i < n  ;  i++ )  kern[ i ] /= ( float ) kmax ;
+  
+  
+  /*-- Parameters --*/
+  
+  fs   = mxGetScalar ( m[ 0 ] ) ;
+  refr = mxGetScalar ( m[ 2 ] )  *  fs ;
+  rate = 0 ;
+  
+  /* Seed must be non-zero */
+  rng = ( uint64_t ) time ( NULL )  ^  ( ( uint64_t ) clock ( ) << 32 )  ^
+    0x9E3779B97F4A7C15ULL ;
+  if  ( !rng )  rng = 1 ;
+  
+  synreset ( ) ;
+
+} /* synopen */
+
+
+/* Reset for a new trial */
+void  synreset ( void )
+{
+  
+  memset ( tail , 0 , klen * sizeof ( *tail ) ) ;
+  
+  nsmp  = 0 ;
+  tlast = -INFINITY ;
+  tnext = nextspk ( -refr ) ;
+
+} /* synreset */
+
+
+/* Set the firing rate from m in Hz , the next spike is redrawn */
+void  synrate ( const mxArray *  m )
+{
+  
+  if  ( notscalar ( m )  ||  mxGetScalar ( m ) < 0 )
+    mexErrMsgIdAndTxt (  "MET:spksynth:rate"  ,
+      "spksynth 'f' , rate must be a finite , non-negative scalar "
+      "double"  ) ;
+  
+  rate = mxGetScalar ( m ) / fs ;
+  
+  /* No sooner than the end of the last spike's refractory period */
+  tnext = nextspk (  tlast + refr  <  nsmp  ?  nsmp - refr  :  tlast  ) ;
+
+} /* synrate */
+
+
+/* Generate the next m samples into plhs[ 0 ] */
+void  syngen ( mxArray *  plhs[] , const mxArray *  m )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Counters , number of samples , and sample of a spike in this chunk */
+  size_t  i , j , n , s ;
+  
+  /* Waveform of this chunk followed by the kernel that carries over */
+  float  * w , v ;
+  
+  /* Output */
+  float *  x ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( notscalar ( m )  ||  mxGetScalar ( m ) < 0 )
+    mexErrMsgIdAndTxt (  "MET:spksynth:gen"  ,
+      "spksynth 'g' , n must be a finite , non-negative scalar double"  ) ;
+  
+  n = ( size_t ) mxGetScalar ( m ) ;
+  
+  plhs[ 0 ] = mxCreateNumericMatrix ( NCHAN , n , mxSINGLE_CLASS ,
+    mxREAL ) ;
+  x = mxGetData ( plhs[ 0 ] ) ;
+  
+  
+  /*-- Stamp kernels --*/
+  
+  w = mxCalloc ( n + klen , sizeof ( *w ) ) ;
+  memcpy ( w , tail , klen * sizeof ( *w ) ) ;
+  
+  while  ( tnext  <  nsmp + n )
+  {
+    s = ( size_t ) ( tnext - nsmp ) ;
+    
+    for  ( j = 0  ;  j < klen  ;  j++ )  w[ s + j ] += kern[ j ] ;
+    
+    tlast = tnext ;
+    tnext = nextspk ( tlast ) ;
+  }
+  
+  memcpy ( tail , w + n , klen * sizeof ( *w ) ) ;
+  nsmp += n ;
+  
+  
+  /*-- Output --*/
+  
+  for  ( i = 0  ;  i < n  ;  i++ )
+  {
+    v = w[ i ] ;
+    if       ( v  >  1 )  v =  1 ;
+    else if  ( v  < -1 )  v = -1 ;
+    
+    for  ( j = 0  ;  j < NCHAN  ;  j++ )  x[ NCHAN * i + j ] = v ;
+  }
+  
+  mxFree ( w ) ;
+
+} /* syngen */
+
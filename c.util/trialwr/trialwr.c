@@ -0,0 +1,866 @@
+/*  trialwr.c
+  
+  [ ... ] = trialwr ( fun , ... )
+  
+  Matlab Electrophysiology Toolbox utility function. Asynchronous writer
+  of trial directory files. MET controllers save a set of files into the
+  current trial's directory at the end of every trial. Writing these to
+  disk , and making sure that they are there , can take a while. Instead ,
+  the controller saves each file to a staging file in memory , then hands
+  it to trialwr. A background writer thread copies each staging file to
+  its place in the trial directory , while the controller moves on to the
+  next trial. The staging file is removed once its copy is safely on
+  disk.
+  
+  The writer thread takes every file that is waiting when it wakes up , as
+  one batch. Each file of the batch is copied into a temporary file next
+  to its destination. Then all files of the batch are flushed to disk ,
+  renamed to their destinations , and each directory that received a file
+  is flushed once. Thus , the set of files that a controller saves at the
+  end of a trial usually costs one round of flushes , and a destination
+  file is never seen half-written.
+  
+  Staging files are kept in STAGDIR , which is in memory on Linux. If
+  Matlab crashes then files that were still waiting can be found there ,
+  named mettw.<pid>.<n>.<file name>.
+  
+  If the writer fails to write a file then the next call to 'w' or 'f'
+  raises an error that names the file and its staging file. Neither the
+  staging file nor a temporary file that was fully copied is removed , so
+  the file can be recovered by hand.
+  
+  While a process has files that are not yet on disk , the empty marker
+  file STAGDIR/mettw.<pid>.busy exists. Hence another MET process can wait
+  with 'a' for every controller's writer to finish , for instance before
+  the session directory is made read-only.
+  
+  Sub-functions:
+    
+    s = trialwr ( 's' , f ) -- Returns a new staging file name s for the
+      destination file f , which is a string. s has the same file name
+      and type suffix as f. The caller then writes s e.g. with save or
+      metsavtxt. The first call starts the writer thread.
+    
+    trialwr ( 'w' , s , f ) -- Hands staging file s to the writer , which
+      will move it to destination f. s must have been returned by 's'.
+      Returns immediately.
+    
+    trialwr ( 'f' ) -- Waits until every file that was handed to the
+      writer so far is in place on disk.
+    
+    trialwr ( 'c' ) -- Waits as for 'f' , then stops the writer thread.
+      The same happens when Matlab exits.
+    
+    n = trialwr ( 'a' , tout ) -- Waits as for 'f' , then waits up to
+      tout seconds for the writers of all other running processes to
+      finish. Returns the number of processes that are still writing , 0
+      if all are done. Errors of this process' writer are not raised
+      here , but by the next 'w' or 'f'.
+  
+  
+  Written by Jackson Smith - DPAG , University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+/* Matlab */
+#include  "mex.h"
+#include  "matrix.h"
+
+/* Files */
+#include  <dirent.h>
+#include  <errno.h>
+#include  <fcntl.h>
+#include  <signal.h>
+#include  <sys/stat.h>
+#include  <unistd.h>
+
+/* Thread */
+#include  <pthread.h>
+
+/* General */
+#include  <inttypes.h>
+#include  <stdint.h>
+#include  <stdio.h>
+#include  <stdlib.h>
+#include  <string.h>
+#include  <time.h>
+
+
+/*--- Define block ---*/
+
+/* fun values */
+  
+  /* Staging file name */
+  #define  FUN_STAGE  's'
+  
+  /* Hand over staging file */
+  #define  FUN_WRITE  'w'
+  
+  /* Flush */
+  #define  FUN_FLUSH  'f'
+  
+  /* Close */
+  #define  FUN_CLOSE  'c'
+  
+  /* Await all writers */
+  #define  FUN_AWAIT  'a'
+
+
+/* Number of input and output args , including fun */
+  
+  #define  NRHS_STAGE  2
+  #define  NRHS_WRITE  3
+  #define  NRHS_FLUSH  1
+  #define  NRHS_CLOSE  1
+  #define  NRHS_AWAIT  2
+  #define  NLHS_STAGE  1
+  #define  NLHS_AWAIT  1
+
+
+/* Staging directory , and the format of staging file names. Process ID ,
+   count of staging names so far , and destination file name. */
+#define  STAGDIR  "/dev/shm"
+#define  STAGFMT  STAGDIR "/mettw.%d.%" PRIu64 ".%s"
+
+/* Busy marker of a process , and its format for reading the process ID */
+#define  BUSYFMT  STAGDIR "/mettw.%d.busy"
+#define  BUSYSCN  "mettw.%d.bus%c%n"
+
+/* Seconds between looks for busy markers */
+#define  AWTDUR  0.01
+
+/* Suffix of the temporary file that is written next to the destination */
+#define  TMPSUF  ".tw"
+
+/* Bytes of the copy buffer */
+#define  CPYBUF  65536
+
+/* Maximum number of files that are flushed together */
+#define  MAXBAT  64
+
+/* States of a file in the writer , held in twjob fd when it is not an
+   open file. Failed , renamed but the directory not yet flushed , and
+   done. */
+#define  TWFAIL  -1
+#define  TWMOVD  -2
+#define  TWDONE  -3
+
+/* Bytes of the error message */
+#define  ERRLEN  1024
+
+
+/*--- Types ---*/
+
+/* A file that waits for the writer. src is the staging file , dst the
+   destination. tmp and fd are used by the writer for the temporary file
+   beside the destination. */
+struct twjob
+  {
+    char *  src ;
+    char *  dst ;
+    char *  tmp ;
+    int  fd ;
+    struct twjob *  next ;
+  } ;
+
+
+/*--- Global static variables ---*/
+
+/* Writer thread , and non-zero while it runs */
+static pthread_t  twid ;
+static int  twon = 0 ;
+
+/* Guards all of the following. cvq signals new files or a stop request ,
+   cvd signals finished files. */
+static pthread_mutex_t  mtx = PTHREAD_MUTEX_INITIALIZER ;
+static pthread_cond_t  cvq = PTHREAD_COND_INITIALIZER ;
+static pthread_cond_t  cvd = PTHREAD_COND_INITIALIZER ;
+
+/* Queue of waiting files , first and last */
+static struct twjob *  qhead = NULL ;
+static struct twjob *  qtail = NULL ;
+
+/* Number of files ever handed over , and the number finished */
+static uint64_t  nque = 0 , ndon = 0 ;
+
+/* Non-zero asks the writer to stop once the queue is empty */
+static int  twstop = 0 ;
+
+/* First error since it was last reported , empty string if none */
+static char  twerr[ ERRLEN ] = "" ;
+
+/* Number of staging names so far */
+static uint64_t  nstg = 0 ;
+
+
+/*--- Function definitions ---*/
+
+void  twstart ( void ) ;
+void  twclose ( void ) ;
+void  twexit ( void ) ;
+void  twflush ( void ) ;
+void  twraise ( void ) ;
+void  twbusy ( int ) ;
+ int  twbusyn ( void ) ;
+mxArray *  twawait ( const mxArray * ) ;
+mxArray *  twstage ( const mxArray * ) ;
+void  twwrite ( const mxArray * , const mxArray * ) ;
+void *  twmain ( void * ) ;
+void  twbatch ( struct twjob ** , size_t ) ;
+ int  twcopy ( struct twjob * ) ;
+void  twfail ( const char * , const struct twjob * , int ) ;
+void  twfree ( struct twjob * ) ;
+char *  cstring ( const mxArray * , int ) ;
+ int  notstring ( const mxArray * ) ;
+
+
+/*** trialwr function definition ***/
+
+void  mexFunction ( int  nlhs ,       mxArray *  plhs[] ,
+                    int  nrhs , const mxArray *  prhs[] )
+{
+  
+  
+  /*-- Variables --*/
+  
+  /* Function character and null byte */
+  char  c[ 2 ] ;
+  
+  /* Required number of inputs , and maximum number of outputs */
+  int  nin , nout = 0 ;
+  
+  
+  /*-- Check input --*/
+  
+  if  ( nrhs  <  1 )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:fun"  ,
+      "trialwr arg fun required"  ) ;
+  
+  else if  (  !mxIsChar ( prhs[ 0 ] )  ||  !mxIsScalar ( prhs[ 0 ] )  ||
+              mxGetString ( prhs[ 0 ] , c , 2 )  )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:fun"  ,
+      "trialwr arg fun must be a single char"  ) ;
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_STAGE:  nin = NRHS_STAGE ;  nout = NLHS_STAGE ;  break ;
+    case  FUN_WRITE:  nin = NRHS_WRITE ;  break ;
+    case  FUN_FLUSH:  nin = NRHS_FLUSH ;  break ;
+    case  FUN_CLOSE:  nin = NRHS_CLOSE ;  break ;
+    case  FUN_AWAIT:  nin = NRHS_AWAIT ;  nout = NLHS_AWAIT ;  break ;
+    
+    default:
+      
+      mexErrMsgIdAndTxt (  "MET:trialwr:fun"  ,
+        "trialwr arg fun unrecognised function char '%c'"  ,  c[ 0 ]  ) ;
+  }
+  
+  if  ( nrhs  !=  nin )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:fun"  ,
+      "trialwr '%c' requires %d input arguments in total"  ,  c[ 0 ]  ,
+        nin  ) ;
+  
+  else if  ( nout  <  nlhs )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:fun"  ,
+      "trialwr '%c' provides at most %d output arguments"  ,  c[ 0 ]  ,
+        nout  ) ;
+  
+  else if  ( !twon  &&  c[ 0 ] == FUN_WRITE )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:fun"  ,
+      "trialwr must return a staging name with 's' before '%c'"  ,
+        c[ 0 ]  ) ;
+  
+  
+  /*-- Run sub-function --*/
+  
+  switch  ( c[ 0 ] )
+  {
+    case  FUN_STAGE:  plhs[ 0 ] = twstage ( prhs[ 1 ] ) ;  break ;
+    case  FUN_WRITE:  twwrite ( prhs[ 1 ] , prhs[ 2 ] ) ;  break ;
+    case  FUN_FLUSH:  twflush ( ) ;  twraise ( ) ;  break ;
+    case  FUN_CLOSE:  twclose ( ) ;  twraise ( ) ;  break ;
+    case  FUN_AWAIT:  plhs[ 0 ] = twawait ( prhs[ 1 ] ) ;  break ;
+  }
+
+
+} /* trialwr */
+
+
+/*---Subroutines---*/
+
+/* Returns non-zero if m is not a non-empty char row vector */
+int  notstring ( const mxArray *  m )
+{
+  
+  return  !mxIsChar ( m )  ||  mxGetM ( m ) != 1  ||  mxGetN ( m ) < 1 ;
+
+} /* notstring */
+
+
+/* Start the writer thread. The MEX file is locked in memory , so that
+   Matlab cannot clear it while the thread runs. */
+void  twstart ( void )
+{
+  
+  int  e ;
+  
+  twstop = 0 ;
+  
+  if  ( ( e = pthread_create ( &twid , NULL , twmain , NULL ) ) )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:thread"  ,
+      "trialwr failed to start writer thread , error %d"  ,  e  ) ;
+  
+  twon = 1 ;
+  mexLock ( ) ;
+  mexAtExit ( twexit ) ;
+
+} /* twstart */
+
+
+/* Wait for the writer to finish all files , then stop it */
+void  twclose ( void )
+{
+  
+  if  ( !twon )  return ;
+  
+  pthread_mutex_lock ( &mtx ) ;
+  twstop = 1 ;
+  pthread_cond_signal ( &cvq ) ;
+  pthread_mutex_unlock ( &mtx ) ;
+  
+  pthread_join ( twid , NULL ) ;
+  
+  twon = 0 ;
+  mexUnlock ( ) ;
+
+} /* twclose */
+
+
+/* Runs when Matlab exits , when nobody is left to catch an error */
+void  twexit ( void )
+{
+  
+  twclose ( ) ;
+  
+  if  ( *twerr )  mexPrintf (  "trialwr: %s\n"  ,  twerr  ) ;
+
+} /* twexit */
+
+
+/* Wait until every file handed over so far is finished */
+void  twflush ( void )
+{
+  
+  uint64_t  n ;
+  
+  if  ( !twon )  return ;
+  
+  pthread_mutex_lock ( &mtx ) ;
+  
+  n = nque ;
+  
+  while  ( ndon  <  n )  pthread_cond_wait ( &cvd , &mtx ) ;
+  
+  pthread_mutex_unlock ( &mtx ) ;
+
+} /* twflush */
+
+
+/* Raise an error if the writer failed since the last report */
+void  twraise ( void )
+{
+  
+  char  e[ ERRLEN ] ;
+  
+  pthread_mutex_lock ( &mtx ) ;
+  strcpy ( e , twerr ) ;
+  *twerr = '\0' ;
+  pthread_mutex_unlock ( &mtx ) ;
+  
+  if  ( *e )
+    mexErrMsgIdAndTxt (  "MET:trialwr:write"  ,  "trialwr: %s"  ,  e  ) ;
+
+} /* twraise */
+
+
+/* Create the busy marker of this process if b is non-zero , otherwise
+   remove it. Call with mtx locked. */
+void  twbusy ( int  b )
+{
+  
+  char  m[ ERRLEN ] ;
+  int  fd ;
+  
+  snprintf (  m  ,  sizeof ( m )  ,  BUSYFMT  ,  ( int ) getpid ( )  ) ;
+  
+  if  ( !b )
+    unlink ( m ) ;
+  else if  ( ( fd = open ( m , O_WRONLY | O_CREAT , 0666 ) )  !=  -1 )
+    close ( fd ) ;
+
+} /* twbusy */
+
+
+/* Count the busy markers of running processes other than this one */
+int  twbusyn ( void )
+{
+  
+  /* Staging directory and entry */
+  DIR *  d ;
+  struct dirent *  e ;
+  
+  /* Process ID , end of scan , and the count */
+  int  p , k , n = 0 ;
+  char  c ;
+  
+  if  ( ( d = opendir ( STAGDIR ) )  ==  NULL )  return  0 ;
+  
+  while  ( ( e = readdir ( d ) ) )
+  {
+    
+    k = 0 ;
+    
+    /* Markers of crashed processes don't count */
+    if  ( sscanf ( e->d_name , BUSYSCN , &p , &c , &k ) == 2  &&
+          c == 'y'  &&  !e->d_name[ k ]  &&  p != ( int ) getpid ( )  &&
+          ( !kill ( p , 0 )  ||  errno == EPERM ) )
+      ++n ;
+  
+  }
+  
+  closedir ( d ) ;
+  
+  return  n ;
+
+} /* twbusyn */
+
+
+/* Wait for this process' writer , then up to tout seconds for those of
+   other processes. Returns the number of processes still writing. */
+mxArray *  twawait ( const mxArray *  tout )
+{
+  
+  /* Time out , and seconds waited */
+  double  t , w = 0 ;
+  
+  /* Number still writing */
+  int  n ;
+  
+  /* Pause between looks */
+  const struct timespec  p = { 0 , ( long ) ( AWTDUR * 1e9 ) } ;
+  
+  if  (  !mxIsDouble ( tout )  ||  mxIsComplex ( tout )  ||
+         !mxIsScalar ( tout )  ||  ( t = mxGetScalar ( tout ) ) < 0  ||
+         t != t  )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:await"  ,
+      "trialwr 'a' , tout must be a real , non-negative double"  ) ;
+  
+  twflush ( ) ;
+  
+  while  ( ( n = twbusyn ( ) )  &&  w < t )
+  {
+    nanosleep ( &p , NULL ) ;
+    w += AWTDUR ;
+  }
+  
+  return  mxCreateDoubleScalar ( n ) ;
+
+} /* twawait */
+
+
+/* Return a new staging file name for destination f */
+mxArray *  twstage ( const mxArray *  f )
+{
+  
+  /* Destination , its file name , and the staging name */
+  char *  d , *  b ;
+  char  s[ ERRLEN ] ;
+  
+  if  ( notstring ( f ) )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:stage"  ,
+      "trialwr 's' , f must be a non-empty string"  ) ;
+  
+  d = mxArrayToString ( f ) ;
+  b = strrchr ( d , '/' ) ;
+  b = b  ?  b + 1  :  d ;
+  
+  if  ( !*b  ||  sizeof ( s )  <=  ( size_t ) snprintf (  s  ,  sizeof ( s ) ,
+          STAGFMT  ,  ( int ) getpid ( )  ,  nstg  ,  b  ) )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:stage"  ,
+      "trialwr 's' , f must end in a file name of reasonable length"  ) ;
+  
+  mxFree ( d ) ;
+  
+  ++nstg ;
+  
+  if  ( !twon )  twstart ( ) ;
+  
+  return  mxCreateString ( s ) ;
+
+} /* twstage */
+
+
+/* Hand staging file s to the writer , for destination f */
+void  twwrite ( const mxArray *  s , const mxArray *  f )
+{
+  
+  /* Prefix of staging names from this process */
+  char  p[ ERRLEN ] ;
+  
+  /* New file */
+  struct twjob *  j ;
+  
+  twraise ( ) ;
+  
+  if  ( notstring ( s )  ||  notstring ( f ) )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:write"  ,
+      "trialwr 'w' , s and f must be non-empty strings"  ) ;
+  
+  j = calloc ( 1 , sizeof ( struct twjob ) ) ;
+  
+  if  ( j  ==  NULL )
+    
+    mexErrMsgIdAndTxt (  "MET:trialwr:write"  ,
+      "trialwr 'w' , out of memory"  ) ;
+  
+  /* The writer thread frees these. Matlab may change directory before the
+     writer gets to f , so make f absolute. */
+  j->src = cstring ( s , 0 ) ;
+  j->dst = cstring ( f , 1 ) ;
+  j->fd = TWFAIL ;
+  
+  if  ( j->src == NULL  ||  j->dst == NULL )
+  {
+    twfree ( j ) ;
+    mexErrMsgIdAndTxt (  "MET:trialwr:write"  ,
+      "trialwr 'w' , out of memory"  ) ;
+  }
+  
+  /* The writer removes s , so it had better be a staging file */
+  snprintf (  p  ,  sizeof ( p )  ,  STAGDIR "/mettw.%d."  ,
+    ( int ) getpid ( )  ) ;
+  
+  if  ( strncmp ( j->src , p , strlen ( p ) ) )
+  {
+    twfree ( j ) ;
+    mexErrMsgIdAndTxt (  "MET:trialwr:write"  ,
+      "trialwr 'w' , s must be a staging name from trialwr 's'"  ) ;
+  }
+  
+  /* Queue it */
+  pthread_mutex_lock ( &mtx ) ;
+  
+  if  ( qtail )
+    qtail->next = j ;
+  else
+    qhead = j ;
+  
+  qtail = j ;
+  
+  if  ( nque++  ==  ndon )  twbusy ( 1 ) ;
+  
+  pthread_cond_signal ( &cvq ) ;
+  pthread_mutex_unlock ( &mtx ) ;
+
+} /* twwrite */
+
+
+/* malloc'd copy of string m. If a is non-zero and m is a relative path
+   then the current directory is put in front. Returns NULL if out of
+   memory. */
+char *  cstring ( const mxArray *  m , int  a )
+{
+  
+  /* Current directory , its length , length of m , and the copy */
+  char  d[ ERRLEN ] = "" ;
+  size_t  nd = 0 , n = mxGetNumberOfElements ( m ) ;
+  char *  c ;
+  
+  if  ( a  &&  mxGetChars ( m )[ 0 ] != '/'  &&  getcwd ( d , ERRLEN ) )
+  {
+    strcat ( d , "/" ) ;
+    nd = strlen ( d ) ;
+  }
+  
+  if  ( ( c = malloc ( nd + n + 1 ) )  ==  NULL )  return  NULL ;
+  
+  memcpy ( c , d , nd ) ;
+  mxGetString ( m , c + nd , n + 1 ) ;
+  
+  return  c ;
+
+} /* cstring */
+
+
+/* Writer thread. Takes the whole queue at once and writes it out in
+   batches of up to MAXBAT files. */
+void *  twmain ( void *  arg )
+{
+  
+  /* Queue that was taken , and the batch */
+  struct twjob *  q ;
+  struct twjob *  b[ MAXBAT ] ;
+  size_t  n ;
+  
+  ( void ) arg ;
+  
+  pthread_mutex_lock ( &mtx ) ;
+  
+  for  ( ;; )
+  {
+    
+    while  ( qhead == NULL  &&  !twstop )
+      pthread_cond_wait ( &cvq , &mtx ) ;
+    
+    /* Only stop once every file is written */
+    if  ( qhead  ==  NULL )  break ;
+    
+    q = qhead ;
+    qhead = qtail = NULL ;
+    
+    pthread_mutex_unlock ( &mtx ) ;
+    
+    while  ( q )
+    {
+      
+      for  ( n = 0 ; q  &&  n < MAXBAT ; ++n , q = q->next )  b[ n ] = q ;
+      
+      twbatch ( b , n ) ;
+      
+      pthread_mutex_lock ( &mtx ) ;
+      ndon += n ;
+      if  ( ndon  ==  nque )  twbusy ( 0 ) ;
+      pthread_cond_broadcast ( &cvd ) ;
+      pthread_mutex_unlock ( &mtx ) ;
+    
+    }
+    
+    pthread_mutex_lock ( &mtx ) ;
+  
+  }
+  
+  pthread_mutex_unlock ( &mtx ) ;
+  
+  return  NULL ;
+
+} /* twmain */
+
+
+/* Write a batch of n files. Copy each into a temporary file beside its
+   destination , flush them all , rename them , then flush each directory
+   once. Staging files are removed only for files that got through all of
+   that. Frees the batch. */
+void  twbatch ( struct twjob **  b , size_t  n )
+{
+  
+  /* Batch indices , directory file descriptor , and the state of files
+     in that directory */
+  size_t  i , j ;
+  int  fd , s ;
+  
+  /* Directory of a destination */
+  char *  d ;
+  
+  /* Copy , but don't flush yet */
+  for  ( i = 0 ; i < n ; ++i )
+    if  ( twcopy ( b[ i ] ) )  b[ i ]->fd = TWFAIL ;
+  
+  /* Flush and rename. A failed file keeps its temporary copy. */
+  for  ( i = 0 ; i < n ; ++i )
+  {
+    
+    if  ( b[ i ]->fd  ==  TWFAIL )  continue ;
+    
+    if  ( fsync ( b[ i ]->fd ) )
+    {
+      twfail ( "fsync" , b[ i ] , errno ) ;
+      close ( b[ i ]->fd ) ;
+    }
+    
+    else if  ( close ( b[ i ]->fd ) )
+      twfail ( "close" , b[ i ] , errno ) ;
+    
+    else if  ( rename ( b[ i ]->tmp , b[ i ]->dst ) )
+      twfail ( "rename" , b[ i ] , errno ) ;
+    
+    else
+    {
+      b[ i ]->fd = TWMOVD ;
+      continue ;
+    }
+    
+    b[ i ]->fd = TWFAIL ;
+  
+  }
+  
+  /* Cut the file name off of each renamed temporary name , leaving its
+     directory. The name isn't needed any more. */
+  for  ( i = 0 ; i < n ; ++i )
+  {
+    
+    if  ( b[ i ]->fd  !=  TWMOVD )  continue ;
+    
+    d = b[ i ]->tmp ;
+    
+    if  ( strrchr ( d , '/' ) )
+      *strrchr ( d , '/' ) = '\0' ;
+    else
+      strcpy ( d , "." ) ;
+  
+  }
+  
+  /* Flush each directory that gained a file once , then settle every file
+     of the batch that went into it */
+  for  ( i = 0 ; i < n ; ++i )
+  {
+    
+    if  ( b[ i ]->fd  !=  TWMOVD )  continue ;
+    
+    d = b[ i ]->tmp ;
+    s = TWDONE ;
+    
+    if  ( ( fd = open ( *d ? d : "/" , O_RDONLY ) )  ==  -1  ||
+          fsync ( fd ) )
+    {
+      twfail ( "fsync directory of" , b[ i ] , errno ) ;
+      s = TWFAIL ;
+    }
+    
+    if  ( fd  !=  -1 )  close ( fd ) ;
+    
+    for  ( j = i + 1 ; j < n ; ++j )
+      if  ( b[ j ]->fd == TWMOVD  &&  !strcmp ( b[ j ]->tmp , d ) )
+        b[ j ]->fd = s ;
+    
+    b[ i ]->fd = s ;
+  
+  }
+  
+  /* Only now is the staging file of a finished file no longer needed */
+  for  ( i = 0 ; i < n ; ++i )
+  {
+    if  ( b[ i ]->fd  ==  TWDONE )  unlink ( b[ i ]->src ) ;
+    twfree ( b[ i ] ) ;
+  }
+
+} /* twbatch */
+
+
+/* Copy the staging file of j into a new temporary file beside the
+   destination. Leaves the temporary file open in j->fd. Returns non-zero
+   on error , when the staging file is kept and a partial copy removed. */
+int  twcopy ( struct twjob *  j )
+{
+  
+  /* Copy buffer , only the writer thread uses it */
+  static char  buf[ CPYBUF ] ;
+  
+  /* Staging file descriptor , bytes read , and bytes written */
+  int  fd ;
+  ssize_t  r , w , k ;
+  
+  /* Directory of the destination must exist , so this works if a
+     file can be made there */
+  j->tmp = malloc ( strlen ( j->dst )  +  sizeof ( TMPSUF ) ) ;
+  
+  if  ( j->tmp  ==  NULL )
+  {
+    twfail ( "malloc" , j , ENOMEM ) ;
+    return  1 ;
+  }
+  
+  strcat ( strcpy ( j->tmp , j->dst ) , TMPSUF ) ;
+  
+  if  ( ( fd = open ( j->src , O_RDONLY ) )  ==  -1 )
+  {
+    twfail ( "open staging file of" , j , errno ) ;
+    return  1 ;
+  }
+  
+  j->fd = open ( j->tmp , O_WRONLY | O_CREAT | O_TRUNC , 0666 ) ;
+  
+  if  ( j->fd  ==  -1 )
+  {
+    twfail ( "open" , j , errno ) ;
+    close ( fd ) ;
+    return  1 ;
+  }
+  
+  while  ( ( r = read ( fd , buf , CPYBUF ) ) )
+  {
+    
+    if  ( r  ==  -1 )
+    {
+      if  ( errno  ==  EINTR )  continue ;
+      twfail ( "read staging file of" , j , errno ) ;
+      break ;
+    }
+    
+    for  ( w = 0 ; w < r ; w += k )
+      
+      if  ( ( k = write ( j->fd , buf + w , r - w ) )  ==  -1 )
+      {
+        if  ( errno  ==  EINTR )  {  k = 0 ;  continue ;  }
+        twfail ( "write" , j , errno ) ;
+        break ;
+      }
+    
+    if  ( w  <  r )  break ;
+  
+  }
+  
+  close ( fd ) ;
+  
+  /* Failed , keep the staging file for the user */
+  if  ( r )
+  {
+    close ( j->fd ) ;
+    unlink ( j->tmp ) ;
+    return  1 ;
+  }
+  
+  return  0 ;
+
+} /* twcopy */
+
+
+/* Remember the first error since the last report , naming the destination
+   and the staging file of j , which is kept */
+void  twfail ( const char *  op , const struct twjob *  j , int  e )
+{
+  
+  pthread_mutex_lock ( &mtx ) ;
+  
+  if  ( !*twerr )
+    snprintf (  twerr  ,  ERRLEN  ,  "%s %s , %s , staging file kept as %s" ,
+      op  ,  j->dst  ,  strerror ( e )  ,  j->src  ) ;
+  
+  pthread_mutex_unlock ( &mtx ) ;
+
+} /* twfail */
+
+
+/* Free a finished file */
+void  twfree ( struct twjob *  j )
+{
+  
+  free ( j->src ) ;
+  free ( j->dst ) ;
+  free ( j->tmp ) ;
+  free ( j ) ;
+
+} /* twfree */
+
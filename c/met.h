@@ -113,6 +113,7 @@
 #define  MSESS_REC    "recovery"
 #define  MSESS_SCHED  "schedule.txt"
 #define  MSESS_STIM   "stim"
+#define  MSESS_STORE  "store"
 #define  MSESS_SUM    "summary.txt"
 #define  MSESS_TLOG   "tasklogic"
 #define  MSESS_TRIAL  "trials"
@@ -136,6 +137,23 @@
 /* Index of number of NSP shared memory readers */
 #define  NSPARG  3
 
+/* Maximum number of shared memory objects , the SHMARG built-in objects
+  plus any named channels that are declared in the .cmet file */
+#define  MAXSHM  16
+
+/* Maximum length of a shared memory name , plus null byte. The file name
+  is /<name>.met */
+#define  MSHM_NAMLEN  16
+#define  MSHM_FNMLEN  ( MSHM_NAMLEN + 5 )
+
+/* Format of a declared shared memory file name */
+#define  MSHM_FNFMT  "/%s.met"
+
+/* metserver option that declares a named channel , and the number of
+  consecutive input arguments per declaration i.e. -shm NAME BYTES NR */
+#define  MSHM_DCL   "-shm"
+#define  MSHM_DCLA  4
+
 /* POSIX shared memory naming strings */
 #define  SNAM_STIM  "stim"
 #define  SNAM_EYE   "eye"
@@ -152,6 +170,10 @@
 #define  MSMS_EYE   2097152  /* 2 to power of 21 ie  2 MBytes */
 #define  MSMS_NSP   2097152  /* 2 to power of 21 ie  2 MBytes */
 
+/* Size limits of declared shared memory , in bytes */
+#define  MSMS_MIN       4096  /* 2 to power of 12 ie  4 KBytes */
+#define  MSMS_MAX  268435456  /* 2 to power of 28 ie 256 MBytes */
+
 /* Header format values */
 #define  MSHF_STRMD  0  /* Stream of double values */
 
@@ -163,8 +185,22 @@
 
 #define  MSMG_NUM      4
 
+/* Bytes reserved at the head of each shared memory for the struct
+  metshmsync synchronisation block. One cache line , so that the data
+  header that follows is never on the same line as the futex words. */
+#define  MSHM_SYNC  64
+
+/* Data header that follows the synchronisation block. size_t header ,
+  number of values , and named indeces. Latter are number of bytes stored
+  past the size_t header , and the number of Matlab arrays stored therein.
+  Shared by met ( 'read' / 'write' ) and any utility that writes shm. */
+#define  SMST_NUM    2
+#define  SMST_BYTES  0
+#define  SMST_NMXAR  1
+
 /* Synchronisation - Value posted by shm reader or writer to
-  its event fd */
+  its event fd. Posts are only made to controllers that are waiting in
+  met ( 'select' ) , see struct metshmsync */
 
 #define  REFD_POST  1
 #define  WEFD_POST  1
@@ -264,6 +300,9 @@
 /* Microseconds per seconds */
 #define  USPERS  1000000.0
 
+/* Nanoseconds per second , integer for struct timespec arithmetic */
+#define  NSPERS  1000000000L
+
 
 /*--- Data structures ---*/
 
@@ -296,3 +335,33 @@ struct metsignal
   } ;
 
 
+/*   MET shared memory synchronisation block   */
+
+/* Sits in the first MSHM_SYNC bytes of every MET shared memory. metserver
+  creates the shm with ftruncate , so all fields start at zero. Fields:
+  
+  gen - Generation counter , futex word. The writer increments gen once
+    each time that new data is written. A reader has new data to read when
+    gen differs from the last generation that it read. Readers wait on gen.
+  ack - Number of readers that have read generation gen , futex word. Each
+    reader increments ack once per generation. The writer may write again
+    when gen is zero or when ack equals the number of readers , and resets
+    ack to zero before incrementing gen. The writer waits on ack.
+  rsel - Bit mask of readers that are blocked in met ( 'select' ) , bit
+    cd - 1 for controller descriptor cd. The writer posts to the event fd
+    of each of these readers after incrementing gen.
+  wsel - Non-zero while the writer is blocked in met ( 'select' ). The
+    last reader to increment ack then posts to the readers' event fd.
+  
+  Hence a write costs one futex wake , and a read at most one , no matter
+  how many readers there are ; event fd's are only touched for select().
+*/
+struct metshmsync
+  {
+    uint32_t  gen ;
+    uint32_t  ack ;
+    uint32_t  rsel ;
+    uint32_t  wsel ;
+  } ;
+
+
@@ -2,28 +2,37 @@
 /*  metchkargv.c
   
   void  metchkargv ( const int  argc , char **  argv ,
+                     const unsigned char  nshm ,
+                     char  nm[][ MSHM_NAMLEN ] ,
                      unsigned char *  shmnr ,
                      unsigned char **  rflg )
   
   Deals with the business of making sure that all input arguments
   to metserver are valid. The first three inputs must be integers
   between 0 and MAXCHLD, meaning there must be that many
-  child controllers reading from shared memory. There must be
-  at least one child controller, and there must be a pair of input
-  arguments for each one. Each pair must consist of first Matlab
-  command line options -nojvm, -nodesktop, or -nosplash and then
-  a child controller function name followed by zero or more
+  child controllers reading from shared memory. Declarations of
+  named shared memory channels may follow, see metshmdcl. There
+  must be at least one child controller, and there must be a pair
+  of input arguments for each one. Each pair must consist of first
+  Matlab command line options -nojvm, -nodesktop, or -nosplash and
+  then a child controller function name followed by zero or more
   valid controller options.
   
-  Requires argc and argv from main (). The following unsigned 
-  char pointer shmnr must be an array with SHMARG many elements.
-  It is used to return the number of readers for each type of
+  Requires argc and argv from main (). nshm is the total number of
+  shared memory objects, built-in plus declared, and nm holds their
+  names ; the reader and writer options of the ith shared memory
+  are -r<nm[ i ]> and -w<nm[ i ]>. The following unsigned char
+  pointer shmnr must be an array with nshm many elements. It is
+  used to return the number of readers for each type of built-in
   shared memory in this order:
   
     shmnr[ 0 ] <- argv[ 1 ] - stimulus variable parameters
     shmnr[ 1 ] <- argv[ 2 ] - eye position
     shmnr[ 2 ] <- argv[ 3 ] - Neural signal processor output
   
+  The remaining elements of shmnr must already hold the number of
+  readers of each declared channel, as returned by metshmdcl.
+  
   Sets the reader flag rflg to 1 whenever a child process reads
   from a given shared memory i.e. for the ith shared memory and
   jth child process, rflg[ i ][ j ] will be set to 1 if child j
@@ -52,11 +61,15 @@
 
 /*--- Define block ---*/
 
-// Maximum length of any option string, plus null byte
-#define  MAXSTR  18
+// Maximum length of any option string, plus null byte. Must fit
+// -r or -w in front of the longest shared memory name.
+#define  MAXSTR  ( MSHM_NAMLEN + 2 )
+
+// Number of resource controller options
+#define  NRSC  3
 
 // Maximum number of option strings in a set
-#define  MAXSET  11
+#define  MAXSET  ( 2 * MAXSHM + NRSC )
 
 
 /*--- Option sets ---*/
@@ -74,14 +87,18 @@ char   nmop   = 11 ;
 char   smop   =  0 ;
 
 /* Controller options 'c' - The reader-writer options must be
- arranged in the first 6 elements of the array for reader
- and writer counting to work, later. */
-char *  cop[] = { "-rstim" , "-reye" , "-rnsp" ,
-                  "-wstim" , "-weye" , "-wnsp" ,
-                  "-cbmex" , "-ivxudp" , "-ptbdaq" } ;
-char   ncop   = 9 ;
+ arranged in the first 2 * nshm elements of the array for reader
+ and writer counting to work, later. They are built from the
+ shared memory names at run-time, in cbuf, and then followed by
+ the resource options. */
+char    cbuf[ 2 * MAXSHM ][ MAXSTR ] ;
+char *  cop[ MAXSET ] ;
+char   ncop   = 0 ;
 char   scop   = 1 ;
 
+/* Resource options */
+char *  rop[ NRSC ] = { "-cbmex" , "-ivxudp" , "-ptbdaq" } ;
+
 
 /*--- nexopt function definition ---*/
 
@@ -123,6 +140,8 @@ char *  nexopt ( char *  c , char *  b )
 /*--- metchkargv function definition ---*/
 
 void  metchkargv ( const int  argc , char **  argv ,
+                   const unsigned char  nshm ,
+                   char  nm[][ MSHM_NAMLEN ] ,
                    unsigned char *  shmnr ,
                    unsigned char **  rflg )
 {
@@ -154,16 +173,38 @@ void  metchkargv ( const int  argc , char **  argv ,
   unsigned char  ri[] = { STMARG , EYEARG , NSPARG } ;
   
   // Reader & writer counters, shared mem.
-  char  rw[ 2 * SHMARG ] ;
+  char  rw[ 2 * MAXSHM ] ;
+  
+  // Index of first controller's Matlab options
+  const int  a0 = SHMARG + 1 + MSHM_DCLA * ( nshm - SHMARG ) ;
   
   // Loop counters
   int  i , j , k ;
   
   // Initialise reader-writer counter to zero
-  for  ( i = 0 ; i < 2 * SHMARG ; ++i )
+  for  ( i = 0 ; i < 2 * nshm ; ++i )
     rw[ i ] = 0 ;
   
   
+  /* Build controller option set */
+  
+  // Reader options then writer options, one per shared memory
+  for  ( i = 0 ; i < nshm ; ++i )
+  {
+    snprintf ( cbuf[ i ] , MAXSTR , "-r%s" , nm[ i ] ) ;
+    snprintf ( cbuf[ i + nshm ] , MAXSTR , "-w%s" , nm[ i ] ) ;
+  }
+  
+  for  ( i = 0 ; i < 2 * nshm ; ++i )
+    cop[ i ] = cbuf[ i ] ;
+  
+  // Resource options last
+  for  ( j = 0 ; j < NRSC ; ++j )
+    cop[ i++ ] = rop[ j ] ;
+  
+  ncop = i ;
+  
+  
   /* Determine number of shared memory readers */
   
   // Loop shm readers
@@ -183,7 +224,7 @@ void  metchkargv ( const int  argc , char **  argv ,
   /* Check that options are all valid */
   
   // Loop input arguments
-  for  ( i = SHMARG + 1 ; i < argc ; /*no action*/ )
+  for  ( i = a0 ; i < argc ; /*no action*/ )
   {
     
     // Loop Matlab and MET controller option sets
@@ -257,13 +298,13 @@ void  metchkargv ( const int  argc , char **  argv ,
               rf[ k ] = 1 ;
             
             // Count shared memory reader/writer options
-            if  ( j == ictrlo  &&  k < 2 * SHMARG )
+            if  ( j == ictrlo  &&  k < 2 * nshm )
             {
               rw[ k ]++ ;
               
               // Set reader flag
-              if  ( k  <  SHMARG )
-                rflg[ k ][ ( i - SHMARG ) / 2 - 1 ] = 1 ;
+              if  ( k  <  nshm )
+                rflg[ k ][ ( i - a0 ) / 2 ] = 1 ;
             }
             
             // Done searching
@@ -292,26 +333,26 @@ void  metchkargv ( const int  argc , char **  argv ,
   
   /* Check that number of readers and reader options match */
   
-  for  ( i = 0 ; i < SHMARG ; ++i )
+  for  ( i = 0 ; i < nshm ; ++i )
     
     if  ( shmnr[ i ] != rw[ i ] )
       FEX ( "metserver: shm reader flag number not same as count" )
     
     // Reader, but no writer
-    else if  ( rw[ i ]  &&  !rw[ i + SHMARG ] )
+    else if  ( rw[ i ]  &&  !rw[ i + nshm ] )
       FEX ( "metserver: shm reader but no writer" )
       
   
   
   /* Check that number of writers is correct */
   
-  for  ( /*no action*/ ; i < 2 * SHMARG ; ++i )
+  for  ( /*no action*/ ; i < 2 * nshm ; ++i )
     
     if  ( MAXWSM < rw[ i ] )
       FEX ( "metserver: too many shm writer flags of same type" )
     
     // Writer, but no reader
-    else if  ( rw[ i ]  &&  !rw[ i - SHMARG ] )
+    else if  ( rw[ i ]  &&  !rw[ i - nshm ] )
       FEX ( "metserver: shm writer but no reader" )
   
   
@@ -18,7 +18,7 @@
   is initialised to a value of zero. Otherwise, it is initialised
   to the value of the request flag.
   
-  n must be no more than SHMARG or MAXCHLD, whichever is larger.
+  n must be no more than MAXSHM or MAXCHLD, whichever is larger.
   No element of r may exceed MAXCHLD, as explained next.
   
   This function is intended to return synchronising event fd's for
@@ -40,7 +40,7 @@
   
   The number of event fd's that were successfully requested is
   returned. Returns -1 on error and sets meterr to ME_INTRN if
-  n exceeds SHMARG, or if any element of the file descriptor array
+  n exceeds MAXSHM, or if any element of the file descriptor array
   fd has already been assigned i.e. it is not FDINIT. meterr is
   set to ME_SYSER for errors that occur during system calls.
   
@@ -81,12 +81,12 @@ int  meteventfd ( const unsigned char      n ,
   /*-- Check input --*/
   
   // n is too big
-  if  ( ( SHMARG < MAXCHLD ? MAXCHLD : SHMARG )  <  n )
+  if  ( ( MAXSHM < MAXCHLD ? MAXCHLD : MAXSHM )  <  n )
   {
     meterr = ME_INTRN ;
     fprintf ( stderr , "metserver:meteventfd: "
-      "n > SHMARG i.e %d or MAXCHLD i.e. %d\n" ,
-      SHMARG , MAXCHLD ) ;
+      "n > MAXSHM i.e %d or MAXCHLD i.e. %d\n" ,
+      MAXSHM , MAXCHLD ) ;
   }
   
   // Check input arrays
@@ -5,6 +5,8 @@
                  pid_t *  cpg ,
                  pid_t *  c ,
                  const int *  br , const int *  qw ,
+                 const unsigned char  nshm ,
+                 char  shmnm[][ MSHM_NAMLEN ] ,
                  const unsigned char *  shmnr ,
                  int *  refd , int **  wefd ,
                  const int  argc , char **  argv )
@@ -49,7 +51,7 @@
   
   The number of POSIX shared memory readers will be provided in
   shmnr, along with synchronising event file descriptors for
-  readers in refd and writers in wefd. There will be SHMARG
+  readers in refd and writers in wefd. There will be nshm
   elements in each of these arrays that are ordered according to
   the type of shared memory as follows:
   
@@ -57,6 +59,11 @@
           STMARG-1 ,             0 , stimulus variable parameters
           EYEARG-1 ,             1 , eye position
           NSPARG-1 ,             2 , Neural signal processor output
+                   ,    3 ... nshm-1 , declared channels
+  
+  The name of each shared memory is in shmnm. Controller options
+  -r<name> and -w<name> read and write it. The names of declared
+  channels are handed to metcontroller in one string.
   
   For example: shmnr[1], refd[1], and wefd[1][] provide the number
   of readers, readers' efd, and writer's efds for the eye position
@@ -66,11 +73,12 @@
   the corresponding command-line argument strings can be skipped in
   argc and argv. Thus, argc will be 4 less and argv have 4 fewer
   elements than what is handed to metserver, discounting also the
-  name of the executed command. That is, the argv given to metforx
-  will only be Matlab and MET controller option strings. Option
-  strings will come in pairs, so that the ith child process will
-  use argv[2*(i-1)] Matlab options and argv[2*(i-1)+1]
-  metcontroller options ; correspondingly, argc must be twice n.
+  name of the executed command and any shm declarations. That is,
+  the argv given to metforx will only be Matlab and MET controller
+  option strings. Option strings will come in pairs, so that the
+  ith child process will use argv[2*(i-1)] Matlab options and
+  argv[2*(i-1)+1] metcontroller options ; correspondingly, argc
+  must be twice n.
   
   Child processes will determine whether they read or write each
   shared memory according to their MET controller options, and they
@@ -119,7 +127,7 @@
 
 // refd
 #define  FDR( i )  i
-#define  FDW( i , j )  SHMARG + i * nc + j
+#define  FDW( i , j )  nshm + i * nc + j
 
 // Error handling char buffer overrun when making line of matlab
 #define  EBUFOSTR \
@@ -165,6 +173,8 @@ static size_t  sbnd ( char **  p , char **  q )
   nc - Total number of child controllers.
   br , qw - The broadcast pipe reading and request pipe writing
     file descriptors for this specific child process.
+  nshm - Number of POSIX shared memory objects.
+  shmnm - Name of each type of POSIX shared memory.
   shmnr - List of readers for each type of POSIX shared memory.
   refd , wefd - Lists the readers' and writer's event fd's for
     synchronising each type of shared memory. wefd can be treated
@@ -178,23 +188,19 @@ static size_t  sbnd ( char **  p , char **  q )
 static void  metcp ( metsource_t  cd ,
                      const unsigned char  nc ,
                      int  br , int  qw ,
+                     const unsigned char  nshm ,
+                     char  shmnm[][ MSHM_NAMLEN ] ,
                      const unsigned char *  shmnr ,
                      int *  refd , int **  wefd ,
                      char *  matopt , char *  metopt )
 {
   
   
-  /*-- CONSTANTS --*/
-  
-  /* Controller options */
+  /*-- Controller options --*/
   
-  // Shared memory writer
-  const char *  WSHMOP[ SHMARG ] = 
-    { "-wstim" , "-weye" , "-wnsp" } ;
-  
-  // Shared memory reader
-  const char *  RSHMOP[ SHMARG ] =
-    { "-rstim" , "-reye" , "-rnsp"  } ;
+  // Shared memory writer and reader , one per shared memory
+  char  WSHMOP[ MAXSHM ][ MSHM_NAMLEN + 2 ] ,
+        RSHMOP[ MAXSHM ][ MSHM_NAMLEN + 2 ] ;
   
   
   /*-- Variables --*/
@@ -217,20 +223,33 @@ static void  metcp ( metsource_t  cd ,
   
   /* Shared memory character flag 'c' closed , 'r' reading ,
     'w' writing , 'b' both reading and writing */
-  char  shmflg[ SHMARG ] ;
-  for  ( i = 0 ; i < SHMARG ; ++i )
+  char  shmflg[ MAXSHM ] ;
+  for  ( i = 0 ; i < nshm ; ++i )
+  {
     shmflg[ i ] = MSMG_CLOSED ;
+    snprintf ( RSHMOP[ i ] , MSHM_NAMLEN + 2 , "-r%s" , shmnm[ i ] ) ;
+    snprintf ( WSHMOP[ i ] , MSHM_NAMLEN + 2 , "-w%s" , shmnm[ i ] ) ;
+  }
+  
+  /* Space-separated names of declared shared memory channels , for
+    metcontroller */
+  char  dclnm[ MAXSHM * MSHM_NAMLEN ] = "" ;
+  for  ( i = SHMARG ; i < nshm ; ++i )
+  {
+    if  ( i > SHMARG )  strcat ( dclnm , " " ) ;
+    strcat ( dclnm , shmnm[ i ] ) ;
+  }
   
   /* The maximum number of file descriptors to keep on exec. This
-    will be number of readers' efds (SHMARG), number of writer's
-    efds (SHMARG * nc), and pipe fds (2). */
-  int  maxkfd = SHMARG * (nc + 1)  +  2 ;
+    will be number of readers' efds (nshm), number of writer's
+    efds (nshm * nc), and pipe fds (2). */
+  int  maxkfd = nshm * (nc + 1)  +  2 ;
   
   /* File descriptor array , enough for pipe fd's and event fd's.
-    fd[ i ] refers to readers' efd for 0 <= i < SHMARG. For
-    writer's efd, it's fd[ SHMARG + i * nc + j ] for same i,
+    fd[ i ] refers to readers' efd for 0 <= i < nshm. For
+    writer's efd, it's fd[ nshm + i * nc + j ] for same i,
     and 0 <= j < nc ; writer's efd on shared mem i, and child
-    j. fd[ SHMARG * (nc + 1)  +  i ] accesses pipe fds for
+    j. fd[ nshm * (nc + 1)  +  i ] accesses pipe fds for
     0 <= i < 2. Use macros FDR and FDW to compute indeces for
     refd and wefd. */
   int  fd[ maxkfd ] ;
@@ -245,7 +264,7 @@ static void  metcp ( metsource_t  cd ,
   /*-- Initialise fd and fdf --*/
   
   // fd - readers' and writer's event file descriptors
-  for  ( i = 0 ; i < SHMARG ; ++i )
+  for  ( i = 0 ; i < nshm ; ++i )
   {
      fd[ FDR( i ) ] = refd[ i ] ;
      
@@ -254,7 +273,7 @@ static void  metcp ( metsource_t  cd ,
   }
   
   // Broadcast and request pipes
-  i = SHMARG * (nc + 1) ;
+  i = nshm * (nc + 1) ;
   fd[ i++ ] = br ;
   fd[ i   ] = qw ;
   
@@ -310,11 +329,13 @@ static void  metcp ( metsource_t  cd ,
     // Find head and tail of next option, get number of characters
     n = sbnd ( &p , &q ) ;
     
-    // Check reader and writer options
-    for  ( i = 0 ; i < SHMARG ; ++i )
+    /* Check reader and writer options. Lengths must match too, as
+      one declared name may be the head of another. */
+    for  ( i = 0 ; i < nshm ; ++i )
     {
       // Read shared memory
-      if  ( !strncmp ( RSHMOP[ i ] , p , n ) )
+      if  ( strlen ( RSHMOP[ i ] ) == n  &&
+            !strncmp ( RSHMOP[ i ] , p , n ) )
       {
         if  ( shmflg[ i ] == MSMG_CLOSED )
           shmflg[ i ] = MSMG_READ ;
@@ -326,7 +347,8 @@ static void  metcp ( metsource_t  cd ,
       }
       
       // Write shared memory
-      else if  ( !strncmp ( WSHMOP[ i ] , p , n ) )
+      else if  ( strlen ( WSHMOP[ i ] ) == n  &&
+                 !strncmp ( WSHMOP[ i ] , p , n ) )
       {
         if  ( shmflg[ i ] == MSMG_CLOSED )
           shmflg[ i ] = MSMG_WRITE ;
@@ -360,7 +382,7 @@ static void  metcp ( metsource_t  cd ,
   
   /*-- Unset event fd's that close-on-exec --*/
   
-  for  ( i = 0 ; i < SHMARG ; ++i )
+  for  ( i = 0 ; i < nshm ; ++i )
   {
     // Readers' efd
     if  ( coe[ FDR( i ) ] )
@@ -451,11 +473,11 @@ static void  metcp ( metsource_t  cd ,
     pipe file descriptor. This is the head of the line. */
   if  (  _POSIX_ARG_MAX  <=
        ( n = snprintf ( argv[ i ] , _POSIX_ARG_MAX ,
-         MATSTR_HEAD , cd , stodup , br , qw ) )  )
+         MATSTR_HEAD , cd , stodup , br , qw , dclnm ) )  )
     EBUFOVER
   
   // Add line for each shared memory
-  for  ( j = 0 ; j  <  SHMARG ; ++j )
+  for  ( j = 0 ; j  <  nshm ; ++j )
   {
     // Always need the shared memory open flag character
     if  ( _POSIX_ARG_MAX  <=  ( n += snprintf ( argv[ i ] + n ,
@@ -585,6 +607,8 @@ int  metforx ( const unsigned char  n ,
                pid_t *  cpg ,
                pid_t *  c ,
                const int *  br , const int *  qw ,
+               const unsigned char  nshm ,
+               char  shmnm[][ MSHM_NAMLEN ] ,
                const unsigned char *  shmnr ,
                int *  refd , int **  wefd ,
                const int  argc , char **  argv )
@@ -619,6 +643,14 @@ int  metforx ( const unsigned char  n ,
     fprintf ( stderr , ERMHDR " cpg points to non-zero value\n" ) ;
   }
   
+  else if  ( nshm < SHMARG  ||  MAXSHM < nshm )
+  {
+    meterr = ME_INTRN ;
+    fprintf ( stderr , ERMHDR
+      " nshm not in range SHMARG to MAXSHM i.e. %d to %d\n" ,
+      SHMARG , MAXSHM ) ;
+  }
+  
   // Check arrays
   else
   {
@@ -637,7 +669,7 @@ int  metforx ( const unsigned char  n ,
         fprintf ( stderr , ERMHDR
           " c[ %d ] is not MCINIT i.e. %d\n" , i , MCINIT ) ;
         
-      else if  ( i < SHMARG )
+      else if  ( i < nshm )
       {
         if  ( MAXCHLD < shmnr[ i ] )
           fprintf ( stderr , ERMHDR
@@ -696,8 +728,9 @@ int  metforx ( const unsigned char  n ,
       
       else
         // Setup for and call exec
-        metcp ( i + 1 , n , br[ i ] , qw [ i ] , shmnr , refd ,
-                wefd , argv[ 2 * i ] , argv[ 2 * i + 1 ] ) ;
+        metcp ( i + 1 , n , br[ i ] , qw [ i ] , nshm , shmnm ,
+                shmnr , refd , wefd , argv[ 2 * i ] ,
+                argv[ 2 * i + 1 ] ) ;
       
       /* If we got here then something went terribly wrong. Start
         by tring to send an mquit MET signal. */
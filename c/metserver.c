@@ -1,7 +1,12 @@
 
 /*  metserver.c
   
-  metserver  RST  REYE  RNSP  MSTR  CSTR  [ MSTR  CSTR ... ]
+  metserver  RST  REYE  RNSP  [ -shm  NAME  BYTES  NR ... ]
+             MSTR  CSTR  [ MSTR  CSTR ... ]
+  
+  Any number of named shared memory channels , up to MAXSHM in
+  total , can be declared after the reader counts of the built-in
+  shared memory. See metshmdcl.
   
   NOTE: Because POSIX shared memory is used, metserver must
   be compiled like this
@@ -79,39 +84,69 @@ int  main ( int  argc , char **  argv )
   
   /*- POSIX shared memory variable definition -*/
   
+  /* Number of shared memory objects , built-in plus declared , and
+    index of first controller input argument */
+  unsigned char  nshm = SHMARG ;
+  int  a0 ;
+  
   // Number of shared memory readers
-  unsigned char  shmnr[ SHMARG ] ;
+  unsigned char  shmnr[ MAXSHM ] ;
   
   // Shared memory file descriptors
-  int  shmfd[ SHMARG ] ;
+  int  shmfd[ MAXSHM ] ;
   
-  // Shared memory file names
-  const char *  shmfn[ SHMARG ] = { MSHM_STIM , MSHM_EYE , MSHM_NSP } ;
+  // Shared memory names , built-in first
+  char  shmnm[ MAXSHM ][ MSHM_NAMLEN ] =
+    { SNAM_STIM , SNAM_EYE , SNAM_NSP } ;
+  
+  // Shared memory file names, and buffer for declared ones
+  const char *  shmfn[ MAXSHM ] = { MSHM_STIM , MSHM_EYE , MSHM_NSP } ;
+  char  shmfb[ MAXSHM ][ MSHM_FNMLEN ] ;
   
   // Shared memory size in bytes
-  size_t  shmfs[ SHMARG ] = { MSMS_STIM , MSMS_EYE , MSMS_NSP } ;
+  size_t  shmfs[ MAXSHM ] = { MSMS_STIM , MSMS_EYE , MSMS_NSP } ;
   
   // Event file descriptors. refd, the readers post to it.
-  int  refd[ SHMARG ] ;
+  int  refd[ MAXSHM ] ;
   
   // initialise shm file descriptors
-  for  ( i = 0 ; i < SHMARG ; ++i )
+  for  ( i = 0 ; i < MAXSHM ; ++i )
     shmfd[ i ] = refd[ i ] = FDINIT ;
   
   
+  /*--- Declared shared memory channels ---*/
+  
+  // Need the built-in reader counts before any declaration
+  if  ( argc - 1 < SHMARG )
+    FEX ( "metserver: too few input arguments" )
+  
+  // Names , sizes , and reader counts
+  nshm += metshmdcl ( argc , argv , shmnm , shmfs , shmnr ) ;
+  
+  // File names
+  for  ( i = SHMARG ; i < nshm ; ++i )
+  {
+    snprintf ( shmfb[ i ] , MSHM_FNMLEN , MSHM_FNFMT , shmnm[ i ] ) ;
+    shmfn[ i ] = shmfb[ i ] ;
+  }
+  
+  // First controller input argument follows the declarations
+  a0 = SHMARG + 1 + MSHM_DCLA * ( nshm - SHMARG ) ;
+  
+  
   /*--- Number of child controllers ---*/
   
   // Check for the minimum allowable number of inputs
-  if  ( argc - 1 < SHMARG + NCTRLA )
+  if  ( argc - a0 < NCTRLA )
     FEX ( "metserver: too few input arguments" )
   
   // Check that each controller has enough input arguments
-  if  ( ( argc - 1 - SHMARG )  %  NCTRLA )
+  if  ( ( argc - a0 )  %  NCTRLA )
     FEX ( "metserver: unbalanced number of "
       "child controller input arguments" )
   
   // Check number of child controllers
-  n = ( argc - 1 - SHMARG ) / NCTRLA ;
+  n = ( argc - a0 ) / NCTRLA ;
   
   if  ( MAXCHLD  <  n )
     FEX ( "metserver: too many child controllers" )
@@ -119,6 +154,10 @@ int  main ( int  argc , char **  argv )
   // Report
   printf ( "Use %d MET child controllers\n" , n ) ;
   
+  for  ( i = SHMARG ; i < nshm ; ++i )
+    printf ( "Declared shm %s , %llu bytes , %d readers\n" ,
+      shmnm[ i ] , (unsigned long long) shmfs[ i ] , shmnr[ i ] ) ;
+  
   
   /*--- Run-time variable definitions ---*/
   
@@ -136,15 +175,15 @@ int  main ( int  argc , char **  argv )
     arrays, the index on the second dimension of wefd and rflg
     will refer to a resource devoted to the controller with
     descriptor of +1 the index. */
-  int  * wefd[ SHMARG ] , wefd_array[ SHMARG * n ] ;
+  int  * wefd[ MAXSHM ] , wefd_array[ nshm * n ] ;
   
   // Reader flag, init 0. 1 for child controller that reads shm.
-  unsigned char  * rflg[ SHMARG ] , rflg_array[ SHMARG * n ] ;
+  unsigned char  * rflg[ MAXSHM ] , rflg_array[ nshm * n ] ;
   
   /* 2D arrays built from 1D. Okay, they're arrays of pointers to
     positions within a contiguous 1D array. But the notation is
     now the same as for 2D array, see initialisation just below. */
-  for  ( i = 0 ; i  <  SHMARG ; ++i )
+  for  ( i = 0 ; i  <  nshm ; ++i )
   {
     wefd[ i ] = wefd_array  +  i * n ;
     rflg[ i ] = rflg_array  +  i * n ;
@@ -161,7 +200,7 @@ int  main ( int  argc , char **  argv )
      c[ i ] = MCINIT ;
     
     // Loop shared memory objects
-    for  ( j = 0 ; j  <  SHMARG ; ++j )
+    for  ( j = 0 ; j  <  nshm ; ++j )
     {
       wefd[ j ][ i ] = FDINIT ;
       rflg[ j ][ i ] = 0 ;
@@ -172,7 +211,7 @@ int  main ( int  argc , char **  argv )
   /*--- Check input ---*/
   
   /* Returns number of shared memory readers. */
-  metchkargv ( argc , argv , shmnr , rflg ) ;
+  metchkargv ( argc , argv , nshm , shmnm , shmnr , rflg ) ;
   
   
   /*--- UNIX signals: register handlers or ignore ---*/
@@ -232,10 +271,10 @@ int  main ( int  argc , char **  argv )
   
   // POSIX shared memory
   if  ( e == ME_NONE )
-    metshm ( SHMARG , shmnr , shmfn , shmfs , shmfd ) ;
+    metshm ( nshm , shmnr , shmfn , shmfs , shmfd ) ;
   
   // Close shared memory file descriptors
-  metclose ( SHMARG , shmfd ) ;
+  metclose ( nshm , shmfd ) ;
   
   // Report errors
   if  ( meterr != ME_NONE )
@@ -251,11 +290,11 @@ int  main ( int  argc , char **  argv )
   
   // Readers' event fd's
   if  ( e == ME_NONE )
-    meteventfd ( SHMARG , shmnr , EFDNONSEM , refd ) ;
+    meteventfd ( nshm , shmnr , EFDNONSEM , refd ) ;
   
   // Writer's event fd's
   for  ( i = 0 ;
-         e == ME_NONE  &&  meterr == ME_NONE  &&  i < SHMARG ;
+         e == ME_NONE  &&  meterr == ME_NONE  &&  i < nshm ;
          ++i )
     
     meteventfd ( n , rflg[ i ] , EFDSEM , wefd[ i ] ) ;
@@ -290,8 +329,8 @@ int  main ( int  argc , char **  argv )
   
   // Create MET child controllers
   if  ( e == ME_NONE )
-    n = metforx ( n , &cpg , c , br , qw , shmnr , refd , wefd ,
-                  argc - SHMARG - 1 , argv + SHMARG + 1 ) ;
+    n = metforx ( n , &cpg , c , br , qw , nshm , shmnm , shmnr ,
+                  refd , wefd , argc - a0 , argv + a0 ) ;
   
   // Report errors
   if  ( meterr != ME_NONE )
@@ -314,10 +353,10 @@ int  main ( int  argc , char **  argv )
   metclose ( n , qw ) ;
   
   // Readers' event file descriptors
-  metclose ( SHMARG , refd ) ;
+  metclose ( nshm , refd ) ;
   
   // Writer's event file descriptors , close set-by-set
-  for  ( i = 0 ; meterr == ME_NONE  &&  i < SHMARG ; ++i )
+  for  ( i = 0 ; meterr == ME_NONE  &&  i < nshm ; ++i )
     metclose ( n , wefd[ i ] ) ;
   
   // Report errors
@@ -349,7 +388,7 @@ int  main ( int  argc , char **  argv )
   RESET_METERR
   
   // Unlink
-  metsmunln ( SHMARG , shmnr , shmfn ) ;
+  metsmunln ( nshm , shmnr , shmfn ) ;
   
   // Report errors
   if  ( meterr != ME_NONE )
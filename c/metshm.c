@@ -16,7 +16,7 @@
   is returned in fd[ i - 1 ]. fs[ i - 1 ] is the number of bytes
   allocated to the ith shared memory.
   
-  n cannot be less than 0 or exceed SHMARG. No element of nr can
+  n cannot be less than 0 or exceed MAXSHM. No element of nr can
   exceed MAXCHLD. No element in fs can exceed SSIZE_MAX. No
   file descriptor value can have been assigned to fd.
   
@@ -73,11 +73,11 @@ int  metshm ( const unsigned char     n ,
   /*-- Check input --*/
   
   // n is too big
-  if  ( SHMARG < n )
+  if  ( MAXSHM < n )
   {
     meterr = ME_INTRN ;
-    fprintf ( stderr , "metserver:metshm: n > SHMARG i.e %d\n" ,
-      SHMARG ) ;
+    fprintf ( stderr , "metserver:metshm: n > MAXSHM i.e %d\n" ,
+      MAXSHM ) ;
   }
   
   // Check input arrays
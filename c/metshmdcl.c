@@ -0,0 +1,148 @@
+
+/*  metshmdcl.c
+  
+  unsigned char  metshmdcl ( const int  argc , char **  argv ,
+                             char  nm[][ MSHM_NAMLEN ] ,
+                             size_t *  fs ,
+                             unsigned char *  nr )
+  
+  Reads declarations of named shared memory channels from the
+  input arguments of metserver. Declarations are optional, and
+  come immediately after the three counts of built-in shared
+  memory readers. Each one is made of MSHM_DCLA consecutive
+  arguments:
+    
+    -shm  NAME  BYTES  NR
+  
+  NAME is the channel's name. It must start with a lower-case
+  letter, followed by lower-case letters, digits, or underscores,
+  to a maximum of MSHM_NAMLEN - 1 characters. It may not be the
+  name of a built-in shared memory or of another declared channel.
+  BYTES is the size of the shared memory, from MSMS_MIN to
+  MSMS_MAX. NR is the number of MET child controllers that read
+  the channel, from 0 to MAXCHLD. MET controllers then read or
+  write the channel using the controller options -rNAME and
+  -wNAME , exactly like the built-in -reye or -weye.
+  
+  The ith declaration is returned in element SHMARG + i - 1 of
+  nm , fs , and nr. Hence, these must have MAXSHM elements. The
+  number of declared channels is returned.
+  
+  Terminates process with error if a declaration is invalid, or
+  if more than MAXSHM - SHMARG channels are declared. Does not
+  set meterr.
+  
+  Written by Jackson Smith - DPAG, University of Oxford
+
+*/
+
+
+/*--- Include block ---*/
+
+#include  <ctype.h>
+
+#include  "met.h"
+#include  "metsrv.h"
+
+
+/*--- Define block ---*/
+
+// Argument index offsets within a declaration
+#define  DCLNAM  1
+#define  DCLSIZ  2
+#define  DCLNR   3
+
+
+/*--- metshmdcl function definition ---*/
+
+unsigned char  metshmdcl ( const int  argc , char **  argv ,
+                           char  nm[][ MSHM_NAMLEN ] ,
+                           size_t *  fs ,
+                           unsigned char *  nr )
+{
+  
+  
+  /* Variable definition */
+  
+  // Input argument index , declared shm index , counter
+  int  a , i , j ;
+  
+  // Name pointer , and end pointer for strtoull ()
+  char  * c , * e ;
+  
+  // Converted numbers
+  unsigned long long  v ;
+  
+  
+  /* Read declarations */
+  
+  for  ( a = SHMARG + 1 , i = SHMARG ;
+         a < argc  &&  !strcmp ( argv[ a ] , MSHM_DCL ) ;
+         a += MSHM_DCLA , ++i )
+  {
+    
+    // Too many
+    if  ( MAXSHM  <=  i )
+      FEX ( "metserver: too many declared shm channels" )
+    
+    // Incomplete declaration
+    if  ( argc  <=  a + DCLNR )
+      FEX ( "metserver: incomplete shm declaration" )
+    
+    
+    /* Name */
+    
+    c = argv[ a + DCLNAM ] ;
+    
+    // Length
+    if  ( *c == '\0'  ||  MSHM_NAMLEN <= strlen ( c ) )
+      FEX ( "metserver: declared shm name has bad length" )
+    
+    // Characters
+    if  ( !islower ( *c ) )
+      FEX ( "metserver: declared shm name must start with a-z" )
+    
+    for  ( j = 1 ; c[ j ] != '\0' ; ++j )
+      if  ( !islower ( c[ j ] )  &&  !isdigit ( c[ j ] )  &&
+            c[ j ] != '_' )
+        FEX ( "metserver: declared shm name has invalid character" )
+    
+    // Unique , nm already holds built-in names
+    for  ( j = 0 ; j < i ; ++j )
+      if  ( !strcmp ( nm[ j ] , c ) )
+        FEX ( "metserver: declared shm name is not unique" )
+    
+    strcpy ( nm[ i ] , c ) ;
+    
+    
+    /* Size in bytes */
+    
+    errno = 0 ;
+    v = strtoull ( argv[ a + DCLSIZ ] , &e , 10 ) ;
+    
+    if  ( errno  ||  *e != '\0'  ||  v < MSMS_MIN  ||  MSMS_MAX < v )
+      FEX ( "metserver: declared shm size out of range" )
+    
+    fs[ i ] = ( size_t )  v ;
+    
+    
+    /* Number of readers */
+    
+    errno = 0 ;
+    v = strtoull ( argv[ a + DCLNR ] , &e , 10 ) ;
+    
+    if  ( errno  ||  *e != '\0'  ||  MAXCHLD < v )
+      FEX ( "metserver: declared shm reader count out of range" )
+    
+    nr[ i ] = ( unsigned char )  v ;
+  
+  } // declarations
+  
+  
+  /* Return number of declared channels */
+  
+  return  i - SHMARG ;
+
+
+} // metshmdcl
+
@@ -9,7 +9,7 @@
   system. The file name of each shared memory is given in fn, while
   the corresponding number of readers is given in nr.
   
-  n must not be greater than SHMARG, while no value in nr may
+  n must not be greater than MAXSHM, while no value in nr may
   exceed MAXCHLD.
   
   nr is provided to error check against the file system. If
@@ -59,11 +59,11 @@ int  metsmunln ( const unsigned char      n ,
   /*-- Check input --*/
   
   // n is too big
-  if  ( SHMARG < n )
+  if  ( MAXSHM < n )
   {
     meterr = ME_INTRN ;
-    fprintf ( stderr , "metserver:metsmunln: n > SHMARG i.e %d\n" ,
-      SHMARG ) ;
+    fprintf ( stderr , "metserver:metsmunln: n > MAXSHM i.e %d\n" ,
+      MAXSHM ) ;
   }
   
   // Check input arrays
@@ -69,10 +69,11 @@ int  findcd ( const unsigned char , const int * , const int ) ;
 /* Matlab [the language] execution string. Remember that
   metcontroller's inputs are controller descriptor, duplicate
   standard output, broadcast read and request write pipe file
-  descriptors, and three groups of arguments with number of
-  readers, readers' event fd, and writer's event fd's, for each
-  type of shared memory. */
-#define  MATSTR_HEAD  "try , metcontroller ( %d , %d , %d , %d"
+  descriptors, a string of space-separated names of declared
+  shared memory channels, and then one group of arguments with
+  number of readers, readers' event fd, and writer's event fd's,
+  for each type of shared memory. */
+#define  MATSTR_HEAD  "try , metcontroller ( %d , %d , %d , %d , '%s'"
 #define  MATSTR_TAIL  " ) ;  catch E , " \
   "met ( 'print' , "\
    "sprintf ( '\\n%%s\\n%%s' , E.identifier , getReport( E ) ) ,"\
@@ -145,17 +146,21 @@ int  findcd ( const unsigned char , const int * , const int ) ;
  size_t metatomic ( int ) ;
     int metbroadcast ( const unsigned char, const int *,
                        void *, const size_t ) ;
-   void metchkargv ( const int, char **, unsigned char *,
+   void metchkargv ( const int, char **, const unsigned char,
+                     char [][ MSHM_NAMLEN ], unsigned char *,
                      unsigned char ** ) ;
     int metclose ( const int, int * ) ;
     int metepoll ( const unsigned char, const int * ) ;
     int metforx ( const unsigned char, pid_t *, pid_t *,
-                  const int *, const int *, const unsigned char *,
+                  const int *, const int *, const unsigned char,
+                  char [][ MSHM_NAMLEN ], const unsigned char *,
                   int *, int **, const int, char ** ) ;
     int metiwait ( const unsigned char, const int, const int * ) ;
     int metpipe ( const int, int *, int * ) ;
     int metsigsrv ( const unsigned char, const int *, const int *,
                     const int, const size_t ) ;
+unsigned char metshmdcl ( const int, char **, char [][ MSHM_NAMLEN ],
+                          size_t *, unsigned char * ) ;
    void metunisig ( void ) ;
     int metwait ( const unsigned char, const unsigned char,
                   pid_t *, const unsigned int ) ;
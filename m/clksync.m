@@ -0,0 +1,46 @@
+% 
+% [ ... ] = clksync ( fun , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. Keeps a running ,
+% robust linear regression of local PTB time stamps on NSP sample
+% numbers , for metcbmex. The regression is fitted to the most recent
+% calibration points , over as many trials as it takes to fill a window of
+% fixed length , so that both the offset and the drift of the two clocks
+% are followed as the session goes on. The coefficients are returned in a
+% two-element row vector c = [ intercept , slope ] so that the local time
+% of NSP sample number nsp is c( 1 ) + c( 2 ) * nsp.
+% 
+% Each new calibration point is first compared with the current fit. Once
+% the fit has MINFIT points , any new point whose residual is more than
+% REJECT times its standard error is rejected as an outlier , and is not
+% added to the window. The standard error grows with the distance from the
+% mean NSP sample number of the fit , according to the uncertainty of the
+% slope , because calibration points come in short bursts. But if every
+% point in a batch of at least MINFIT points is rejected then the clocks
+% are assumed to have been reset , for instance after the NSP restarted ,
+% and the fit starts again from that batch.
+% 
+% After new points are added , the fit is found by iteratively reweighted
+% least squares with Tukey's bisquare weights , as with Matlab's
+% robustfit. The scale of the residuals is their median absolute
+% deviation divided by 0.6745 , but never less than MINSCL seconds.
+% 
+% Sub-functions:
+% 
+%   clksync ( 'o' , n ) -- Allocates a window for the n most recent
+%     calibration points , a scalar double of at least MINFIT , and
+%     forgets any previous fit.
+% 
+%   clksync ( 'r' ) -- Forgets all calibration points.
+% 
+%   [ c , nrej ] = clksync ( 'a' , nsp , ptb ) -- Adds calibration points
+%     and refits. nsp and ptb are double vectors of equal length with the
+%     NSP sample number and local PTB time stamp of each point. Returns
+%     the new coefficients in c , and the number of new points that were
+%     rejected in nrej , a scalar double. c is [ 0 , 0 ] until there are at
+%     least two points with different NSP sample numbers.
+% 
+%   c = clksync ( 'c' ) -- Returns the current coefficients.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
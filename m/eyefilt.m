@@ -0,0 +1,39 @@
+% 
+% [ ... ] = eyefilt ( fun , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. A streaming filter
+% that says which eye samples are valid for targeting , following
+% Rayner et al. 2007. Vision Research, 47(21), 2714–2726. A sample is valid
+% if both eyes are on screen in it and in the two samples before it , and
+% if neither eye's velocity nor acceleration exceeds a threshold. Blinks
+% are not timed here ; seltarg does that with the samples that eyefilt
+% finds invalid. The filter keeps the last two samples between calls , so
+% that each new block of samples is treated as a continuation of the
+% last. Each block is done in one pass that is free of branches , so that
+% the compiler can vectorise it.
+% 
+% Eye samples come as N x 5 double arrays of [ time , x-left , y-left ,
+% x-right , y-right ] , as read from 'eye' shared memory. Positions are in
+% degrees of visual field from the centre of the screen , and time is
+% local time in seconds.
+% 
+% Sub-functions:
+% 
+%   eyefilt ( 'o' , lim , hz , vel , acc ) -- Sets the filter's
+%     parameters and forgets all past samples. lim is a four-element
+%     double [ minhor , maxhor , minver , maxver ] giving the edges of the
+%     screen in degrees ; a position on or beyond an edge is off screen.
+%     hz is the eye sampling rate in Hertz , used to differentiate
+%     positions. vel is the velocity threshold in degrees per second , and
+%     acc the acceleration threshold in degrees per second-squared. All
+%     scalar doubles.
+% 
+%   [ v , p ] = eyefilt ( 'f' , eyepos ) -- Filters the new block of eye
+%     samples in eyepos , which may be empty. Returns:
+% 
+%     v - N x 1 logical - True for each valid sample.
+% 
+%     p - N x 5 double - eyepos , with NaN positions in invalid samples.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
@@ -0,0 +1,71 @@
+% 
+% [ ... ] = frametel ( fun , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. Frame-timing
+% telemetry for metptb. One record is kept for each frame that metptb
+% flips to the screen. Records are appended to a log of the current
+% trial , which metptb saves in the trial directory at the end of the
+% trial. If metptb writes to a shared memory channel that is declared in
+% the .cmet file then each record is also published to a ring in that
+% shared memory as soon as the frame is flipped. Any controller with read
+% access to the channel can then poll the ring for new records while the
+% trial runs.
+% 
+% Each record is one row of FTCOL doubles:
+% 
+%   [ trial , frame , target , vbl , onset , flip , missed , draw ,
+%     d( 1 ) , d( 2 ) , ... d( MAXLNK ) ]
+% 
+% trial is the trial identifier and frame counts the frames of the trial
+% from 1. target is the deadline of the flip. vbl , onset , flip , and
+% missed are the VBLTimestamp , StimulusOnsetTime , FlipTimestamp , and
+% Missed outputs of Screen 'Flip'. d( j ) is the time , in seconds , that
+% was spent in the stimulation function of the j'th stimulus link while
+% the frame was drawn , and draw is the total over all links. Only the
+% first MAXLNK links have their own column , but draw includes the rest.
+% 
+% The ring has one writer and is lock-free. It follows the MSHM_SYNC
+% synchronisation block of the shared memory , which is not used. A small
+% header holds the number of records that were ever written , which the
+% writer stores with release semantics after each new record. A reader
+% copies every record that it has not seen , then checks the count again
+% and drops any record that the writer may have overwritten in the mean
+% time. Hence the writer never waits for readers , and a slow reader only
+% loses the oldest records. The header also holds a generation count
+% that the writer increments each time that it opens the ring. When it
+% changes , a reader starts again from the first record of the new
+% writer. Readers must poll with frametel ( 'p' ) rather than met (
+% 'read' ) or met ( 'select' ).
+% 
+% Sub-functions:
+% 
+%   frametel ( 'o' )
+%   frametel ( 'o' , shm ) -- Opens an empty trial log. If string shm is
+%     given then it names a declared shared memory channel that the
+%     controller writes to , and the ring is initialised there. From then
+%     on , every record is published to the ring.
+% 
+%   frametel ( 'r' , tid , n ) -- Empties the trial log for a new trial
+%     with identifier tid that has n stimulus links , both scalar doubles.
+% 
+%   frametel ( 'a' , target , vbl , onset , flip , missed , d ) -- Adds a
+%     record for the next frame of the trial. All are scalar doubles
+%     except for d , a double vector of draw times for each stimulus link.
+% 
+%   F = frametel ( 'g' ) -- Returns the records of the current trial , one
+%     row per frame. F only has the first 8 + min ( n , MAXLNK ) columns.
+% 
+%   frametel ( 'm' , shm ) -- Maps the ring in the declared shared memory
+%     channel named by string shm , for reading. The first poll returns
+%     all records that remain in the ring.
+% 
+%   [ F , nd ] = frametel ( 'p' ) -- Polls the ring. Returns every record
+%     that was published since the last poll , one row per record , and
+%     the number of records that were lost because they were overwritten
+%     before they could be read. An empty F is returned until the writer
+%     has initialised the ring.
+% 
+%   frametel ( 'c' ) -- Frees the trial log and unmaps any shared memory.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
@@ -0,0 +1,51 @@
+% 
+% [ ... ] = hitgrid ( fun , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. A spatial index of the
+% hit regions of a trial's stimulus links , used by mettarget to find which
+% task stimulus is being targeted by the eyes or mouse. All hit regions
+% are binned once into a uniform grid of cells that covers their bounding
+% boxes , so that each point is only compared against the few hit regions
+% whose bounding boxes overlap its cell. Hence the time taken to check a
+% point does not grow with the number of hit regions that are shown
+% elsewhere on screen.
+% 
+% Hit regions come in the formats of MET ptb-type stimulus definitions ,
+% see MCC.SHM.STIM.RECT8 and .CIRC6 from metctrlconst. That is , N x 8
+% double matrices of rectangles [ x , y , width , height , rotation ,
+% disparity , tolerance , ignore ] or N x 6 matrices of circles [ x , y ,
+% radius , disparity , tolerance , ignore ]. Positions are in degrees of
+% visual field from the centre of the screen and rotation is in degrees ,
+% clockwise. A point is in a rectangle or circle if it is on or
+% inside the edge. Hit regions with a zero in the ignore column are never
+% hit. Disparity is not checked.
+% 
+% Sub-functions:
+% 
+%   hitgrid ( 'o' , lnkind , hitregion ) -- Opens a new trial. lnkind is a
+%     cell array with one element per task stimulus , listing the indices
+%     of its stimulus links. hitregion is a cell array with one element
+%     per stimulus link , holding its hit region matrix , or an empty
+%     matrix if it is not a ptb-type stimulus. See metptblink. No stimulus
+%     is visible until 'v' is called.
+% 
+%   hitgrid ( 'r' , I , H ) -- Replaces the hit regions of stimulus links
+%     with new ones , as when hit regions are read from 'stim' shared
+%     memory. I is a logical index with one element per stimulus link ,
+%     and H is a cell array with the new hit region matrix of each link
+%     where I is true , in order. Does nothing before the first 'o'.
+% 
+%   hitgrid ( 'v' , istim ) -- Sets the visible task stimuli. istim is a
+%     double vector of task stimulus indices , in the order that they are
+%     checked. The first one that is hit is the one that is targeted ;
+%     thus the stimulus drawn last should be first.
+% 
+%   i = hitgrid ( 'q' , x , y ) -- Finds the targeted stimulus at each of
+%     N points. x and y are N x 1 double matrices of mouse positions , or N
+%     x 2 of [ left , right ] eye positions. When there are two points per
+%     row then both must fall in hit regions of the same stimulus link.
+%     Returns N x 1 double i , with the index of the first visible task
+%     stimulus that is hit at each row , or 0 if none is.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
@@ -26,7 +26,7 @@
 % 
 % Sub-functions:
 % 
-%     s = ivxudp ( 'o' , hipa , hprt , iipa , iprt ) -- Make and bind a
+%     s = ivxudp ( 'o' , hipa , hprt , iipa , iprt , bg ) -- Make and bind a
 %       socket. The user must provide the IP address and port for the host
 %       (upon which Matlab is running) and SMI (upon which iViewX is
 %       running) computers. hipa and iprt must be strings containing IP
@@ -39,10 +39,20 @@
 %       scalar double s, which is the value of the socket file descriptor ;
 %       for use with multiplexing functions, like select( ).
 % 
+%       bg is optional. If it is given and is non-zero then a background
+%       receive thread is started. The thread drains the socket as soon as
+%       data arrives, parses eye samples, and keeps them in a ring that
+%       holds up to 16384 samples. ivxudp 'r' then copies samples out of the
+%       ring. Thus, samples are not lost when the MET controller is slow to
+%       read. Samples are only dropped if the ring is full. While the thread
+%       runs, s will not signal new eye samples to select( ), because the
+%       thread has already read them. The default is no thread.
+% 
 %     ivxudp ( 'c' ) -- Stops iViewX from streaming data, and close the
-%       socket.
+%       socket. Stops the background receive thread, if there is one. Closes
+%       the replay file instead, if 'f' opened one.
 % 
-%     [ tret , tim , gaze , diam ] = ivxudp ( 'r' ) -- Read new
+%     [ tret , tim , gaze , diam , rtim ] = ivxudp ( 'r' ) -- Read new
 %       eye samples from the socket buffer. This is a non-blocking read.
 %       So when no new data is available, then all output arguments will be
 %       empty double arrays i.e. they will all be []. The exception is
@@ -53,7 +63,8 @@
 %         This is taken immediately after reading from the socket, and will
 %         be directly comparable to local time measurements returned by
 %         Psych Toolbox functions, like GetSecs( ). If no new data was
-%         available then tret returns zero.
+%         available then tret returns zero. With the background receive
+%         thread, this is taken when samples are copied out of the ring.
 % 
 %       All following outputs will have 1 <= N rows, where the ith row in
 %       each output argument refers to the same data sample.
@@ -76,5 +87,57 @@
 %         both the x- and y-axis, for each eye. In pixels of the eye
 %         tracking video image.
 % 
+%       rtim - N x 1 - The local time at which the kernel received the
+%         datagram that carried each eye sample , taken by the socket option
+%         SO_TIMESTAMPNS. In seconds , on the same clock as tret. Unlike
+%         tret , this does not depend on when Matlab got round to reading
+%         the socket. Paired with tim , it allows gaze-contingent timing and
+%         clock drift estimates that are accurate to the datagram.
+% 
+%     [ nspl , kdrop , rdrop , gaps , nbad , nshm , trunc ] = ...
+%       ivxudp ( 'n' ) --
+%       Returns counters, as scalar doubles, that are reset each time that
+%       ivxudp is opened. nspl is the number of binocular eye samples parsed.
+%       kdrop is the number of datagrams dropped by the kernel because the
+%       socket receive buffer was full. rdrop is the number of samples dropped
+%       because the background receive thread's ring was full, or because
+%       they did not fit into eye shared memory. gaps is the number of times
+%       that consecutive iViewX time stamps were more than 1.5 times the
+%       shortest sample interval apart. nbad is the number of ET_SPL commands
+%       that were not binocular or had no data. nshm is the number of writes
+%       to eye shared memory. trunc is the number of datagrams that were
+%       dropped because they were truncated on receipt. Samples are only
+%       counted when they are parsed, which does not happen if ivxudp 'r' is
+%       called without output arguments and no background thread.
+% 
+%     ivxudp ( 'e' , W , cal ) -- The background receive thread writes eye
+%       samples straight into 'eye' shared memory , in place of the MET
+%       controller. Requires the thread , see 'o' and 'f'. May be called
+%       once after each 'o' or 'f'. W must be returned by met ( 'shmwr' ,
+%       'eye' ) , see met. cal is a four-element double [ scrwid , scrhei ,
+%       xyswap , dur ]. Gaze positions are centred and multiplied by scrwid
+%       or scrhei , the screen width and height in degrees of visual field ;
+%       scrhei is negative when y increases upwards. If xyswap is non-zero
+%       then left and right eyes are swapped. The thread writes no more
+%       often than once every dur seconds , and only when all readers have
+%       read the last write. Writes the same arrays as metdaqeye: [ time ,
+%       x-left , y-left , x-right , y-right ] gaze positions , pupil
+%       diameters with the same columns , and an empty double for mouse
+%       positions. Times are converted to local time by assuming that the
+%       last sample in each batch of datagrams arrived at its kernel receive
+%       time. Samples no longer go to the ring , so ivxudp 'r' returns
+%       nothing new.
+% 
+%     ivxudp ( 'f' , file , speed ) -- Replays recorded iViewX eye samples
+%       from file at their original timing , in place of a live iViewX
+%       stream. Thus , a gaze-driven session can be reproduced offline. file
+%       is a string naming a dump of the datagrams that iViewX streams in the
+%       format that 'o' asks for , such as nc -u -l 5555 > file will save ;
+%       ivxsim streams the same format. speed is an optional scalar double ,
+%       1 by default , that multiplies the replay rate. The background
+%       receive thread is always started , so that 'r' , 'n' , 'e' , and 'c'
+%       work as they do after 'o' with bg. rtim is the local time at which
+%       each sample was due. Time stamps in tim are the recorded ones.
+% 
 % 
 % Written by Jackson Smith - DPAG , University of Oxford
@@ -107,30 +107,45 @@
 %     'open' - Obtain MET-specific resources from the system.
 %    'close' - Release MET-specific resources and send closing signal.
 %    'const' - Return MET constants, both compile and run-time.
+%    'shmwr' - Hand shared memory writing over to another MEX function.
 % 
 % The order matters. Function names are checked against the list in this
 % order. Therefore, the least latency is required to run 'send', and the
-% most latency is taken to run 'const'.
+% most latency is taken to run 'shmwr'.
 % 
 % 
 % Function descriptions:
 % 
 % 
-% n = met ( 'send' , sig , crg , tim , blk )
-% 
-% Sends MET signal requests to the MET server controller. Up to the atomic
-% write limit of signals can be sent, while the ith signal has MET signal
-% identifier sig( i ), cargo crg( i ), and time tim( i ). All signals have
-% a source value of the calling controller's controller descriptor. Returns
-% the number of MET signals that were sent. sig, crg, and tim must be
-% Matlab type double matrices. blk is optional ; if non-zero then a
-% blocking write is performed on the request pipe. Otherwise, a
-% non-blocking write is performed. If tim is an empty double i.e. [] then
-% 'send' takes a time measurement and supplies this to all requested
-% signals.
+% n = met ( 'send' , sig , crg , tim , blk , tout )
+% 
+% Sends MET signal requests to the MET server controller. Any number of
+% signals can be sent, while the ith signal has MET signal identifier
+% sig( i ), cargo crg( i ), and time tim( i ). All signals have a source
+% value of the calling controller's controller descriptor. Returns the
+% number of MET signals that were sent. sig, crg, and tim must be Matlab
+% type double matrices. If tim is an empty double i.e. [] then 'send'
+% takes a time measurement and supplies this to all requested signals.
+% 
+% Signals are written to the request pipe in consecutive chunks of up to
+% the atomic write limit, MC.AWMSIG. Each chunk is written atomically, so
+% that signals from other controllers cannot be interleaved within it, and
+% the chunks are written in the same order as the signals in sig. Every
+% signal is checked before any chunk is written ; thus an error in the ith
+% signal means that none are sent.
+% 
+% blk is optional ; if non-zero then 'send' waits for space in the request
+% pipe before writing each chunk, so that all signals are sent. Otherwise,
+% a non-blocking write is performed ; chunks are written until the request
+% pipe is full and the remaining signals are not sent. tout is optional ,
+% and sets the maximum number of seconds that a blocking 'send' will wait
+% in total. When the timeout expires, 'send' returns the number of signals
+% sent in the chunks that were written so far. If tout is omitted , empty
+% i.e. [] , or Inf then a blocking 'send' waits indefinitely.
 %
 % 
 % i = met ( 'write' , shm , ... )
+% i = met ( 'write' , { shm , tout } , ... )
 % 
 % Writes a set of Matlab arrays to the POSIX shared memory named by shm.
 % All arguments provided after shm are written as a separate array. Returns
@@ -144,10 +159,20 @@
 % written ; this is the default action when no character is prefixed.
 % 
 % Data can be written only when all N readers of the named shared memory
-% have posted 1 to the corresponding readers' event fd i.e. when all
-% readers have read the current contents of the named shared memory. A
-% blocking write fails as an error if the calling controller is also a
-% reader of the shared memory.
+% have acknowledged the current generation in the shared memory's
+% synchronisation block i.e. when all readers have read the current
+% contents of the named shared memory. A blocking write fails as an error
+% if the calling controller is also a reader of the shared memory.
+% 
+% A write increments the generation counter and wakes all blocked readers
+% with one futex wake , regardless of the number of readers. Event fd's are
+% only posted for readers that are waiting in met ( 'select' ).
+% 
+% A blocking write waits on a futex for the readers' acknowledgements, and
+% can be given a timeout by passing shm as the first element of a cell
+% array with tout in the second. Then, a blocking write waits at most tout
+% seconds for the readers and returns 0 if they are not all ready in that
+% time. An empty tout i.e. [] , or Inf , waits indefinitely.
 % 
 % Only struct, cell, char, logical, and numeric arrays may be written. Take
 % heed , nested arrays in a struct or cell must be one of these types. Full
@@ -159,11 +184,14 @@
 %    'eye' - Eye position shared memory.
 %    'nsp' - Neural signal processor shared memory.
 % 
+%   Also valid is the name of any shared memory channel that was declared
+%   in the .cmet file with a line of the form: shm NAME BYTES
+% 
 %   e.g. blocking write to eye shm done by passing '+eye' and non-blocking
 %   writes done by passing '-eye' or simply 'eye'.
 % 
 % 
-% [ n , src , sig , crg , tim ] = met ( 'recv' , blk )
+% [ n , src , sig , crg , tim ] = met ( 'recv' , blk , opt )
 % 
 % Receives MET signals from the MET server controller. The number of
 % signals received is returned in n, with a value of 0 up to the MET signal
@@ -175,8 +203,22 @@
 % blk is an optional argument ; if non-zero then a blocking read is
 % performed , non-blocking if zero.
 % 
+% opt is an optional string of option characters, in any order:
+% 
+%   't' - Typed output. src and sig are returned as uint8 , crg as uint16 ,
+%     and tim as double. These are the native MET signal types , so that
+%     less memory is allocated than with double columns.
+%   'a' - All. Every MET signal that is waiting in the broadcast pipe is
+%     returned by a single read , and n may exceed the atomic read/write
+%     limit. When blocking , 'recv' waits for at least one signal.
+% 
+% e.g. [ n , src , sig ] = met ( 'recv' , 0 , 'ta' ) returns the whole
+% backlog of MET signals as uint8 columns. If opt is omitted or empty then
+% all output arguments are double.
+% 
 % 
 % C = met ( 'read' , shm )
+% C = met ( 'read' , { shm , tout } )
 % 
 % Reads Matlab arrays from the POSIX shared memory named by shm into cell
 % array C. If the shared memory contains N arrays, then C will have N
@@ -189,6 +231,13 @@
 % prefixed then the function immediately returns {} if there is no new
 % data ; this is the default action when no character is prefixed.
 % 
+% A blocking read waits on a futex in the shared memory's synchronisation
+% block until the writer increments its generation counter , and can be
+% given a timeout by passing shm as the first element of a cell array with
+% tout in the second. Then, a blocking read waits at most tout seconds and
+% returns {} if no data was written in that time. An empty tout i.e. []
+% , or Inf , waits indefinitely.
+% 
 % A blocking read fails as an error if the calling controller is also a
 % writer to the shared memory.
 % 
@@ -198,6 +247,9 @@
 %    'eye' - Eye position shared memory.
 %    'nsp' - Neural signal processor shared memory.
 % 
+%   Also valid is the name of any shared memory channel that was declared
+%   in the .cmet file with a line of the form: shm NAME BYTES
+% 
 %   e.g. blocking write to eye shm done by passing '+eye' and non-blocking
 %   writes done by passing '-eye' or simply 'eye'.
 % 
@@ -222,6 +274,8 @@
 %    'eye' - Eye position shared memory.
 %    'nsp' - Neural signal processor shared memory.
 % 
+%   Or the name of a shared memory channel declared in the .cmet file.
+% 
 % 
 % met ( 'print' , str , out )
 % 
@@ -270,6 +324,9 @@
 % 
 % MC = met ( 'open' , 
 %                cd , stdofd , pfd , shmflg , shmnr , refd , wefd , wefdv )
+% MC = met ( 'open' , 
+%                cd , stdofd , pfd , shmflg , shmnr , refd , wefd , wefdv ,
+%                shmnam )
 % 
 % Opens and initialises met. The standard output file descriptor is
 % restored. POSIX shared memory is opened and mapped. A pointer for the
@@ -280,7 +337,10 @@
 % input arguments are the controller descriptor, duplicate standard output
 % file descriptor, pipe file descriptors, shared memory flags, shared
 % memory names, readers' (r) and writer's (w) event file descriptors, and
-% writer's event file descriptor vector.
+% writer's event file descriptor vector. The optional shmnam is a cell
+% array of strings naming the shared memory channels declared in the .cmet
+% file ; the shared memory arguments then have one element for each
+% built-in shared memory followed by one for each declared channel.
 % 
 % 
 % met ( 'close' )
@@ -330,6 +390,26 @@
 % If optional input argument nort is non-zero then no run-time constants
 % are returned , their fields will contain empty matrices i.e. [].
 % 
+%
+% W = met ( 'shmwr' , shm )
+%
+% Returns what another MEX function needs to act as the writer of the POSIX
+% shared memory named by shm , on behalf of the calling controller. This
+% allows a MET utility, such as ivxudp, to write straight into shared
+% memory from C without passing data through Matlab. The utility runs in
+% the same process, so the event file descriptors in W remain valid for
+% it. The calling controller must have write access to shm. W is a struct
+% with fields:
+%
+%   W.name - string - The name of the shared memory e.g. 'eye'.
+%   W.file - string - The POSIX shared memory file name e.g. '/eye.met'.
+%   W.nr - scalar double - The number of readers.
+%   W.wefdv - double row vector - The writer's event fd for each reader.
+%
+% The utility must follow the same protocol as 'write'. Do not call
+% met ( 'write' ) on shm while the utility writes to it. Any blocking mode
+% prefix on shm is ignored.
+%
 % Written by Jackson Smith - DPAG , University of Oxford
 % 
 % 
\ No newline at end of file
@@ -9,15 +9,18 @@ function  metcbmex ( MC_in )
 % file is created for each trial. Header and footer comments are streamed,
 % giving the trial parameters, outcome, and event times. Additionally,
 % measurements are taken to synchronise the NSP clock versus the local
-% system clock. Lastly, incoming data from the NSP is buffered and shared
-% with any MET controller that reads the "nsp" POSIX shared memory. Shared
-% data has time stamps converted to double vectors ; the values are NSP
-% event times in seconds, rather than number of NSP samples. All buffered
-% NSP events are written to the current trial directory in files with form
-% nspevents_<i> where <i> is replaced with the trial identifier, both
-% binary .mat and ASCII .txt versions are saved ; saved copies of the data
-% are left in their original uint32 format and values are in number of NSP
-% samples.
+% system clock ; clksync keeps a robust regression of local time on NSP
+% sample number over the most recent measurements from successive trials.
+% Lastly, incoming data from the NSP is buffered and shared with any MET
+% controller that reads the "nsp" POSIX shared memory. Shared data is
+% packed by nspring into compact event records , and only events that have
+% not yet been shared are written ; readers decode them into NSP event
+% times in seconds, rather than number of NSP samples. Each write also
+% carries the regression coefficients. All buffered NSP events are written
+% to the current trial directory in files with form nspevents_<i> where
+% <i> is replaced with the trial identifier, both binary .mat and ASCII
+% .txt versions are saved ; saved copies of the data are left in their
+% original uint32 format and values are in number of NSP samples.
 % 
 % Comment strings are broken up into 127 character pieces and streamed in
 % sequence. Fully appended, the string will have a separate line for each
@@ -147,6 +150,10 @@ function  metcbmex ( MC_in )
   CALFLG.NEW_NUMCAL = 5 ;
   CALFLG.NEW_CALTHR = 3 ;
   
+  % Number of most recent calibration points , over successive trials ,
+  % that the NSP to PTB time regression is fitted to
+  CALWIN = 100 ;
+  
   % Formatting string for PTB timestamps , use for regression coefficients
   % as well. Accurate to the nearest microsecond.
   TIMFMT = MCC.FMT.TIME ;
@@ -161,7 +168,8 @@ function  metcbmex ( MC_in )
     'MAXCOM' , MAXCOM , 'DINLAB' , DINLAB , 'DINTIM' , DINTIM , ...
     'DINVAL' , DINVAL , 'NUMCAL' , NUMCAL , 'CALDUR' , CALDUR , ...
     'MAXSIG' , MAXSIG , 'CALTHR' , CALTHR , 'CTIMER' , CTIMER , ...
-    'CALFLG' , CALFLG , 'BSHIFT' , BSHIFT , 'TIMFMT' , TIMFMT , ...
+    'CALFLG' , CALFLG , 'CALWIN' , CALWIN , 'BSHIFT' , BSHIFT , ...
+    'TIMFMT' , TIMFMT , ...
     'DATFMT' , DATFMT , 'FTRFLG' , FTRFLG ) ;
   
   % Clean up workspace
@@ -174,9 +182,10 @@ function  metcbmex ( MC_in )
   % timestamp pairs. The number of samples is in 'n', NSP sample numbers
   % are in .nsp, and local PTB time stamps are in .ptb. Hence, nsp ( i )
   % and ptb ( i ) refer to the same MET signal, for 1 <= i <= n. Also keeps
-  % the latest set of the least-squares robust linear regression
-  % coefficients in 'coef' to convert NSP sample number to local PTB time
-  % stamp ; this is two-element row vector with [ y-intercept , slope ].
+  % the latest set of the robust linear regression coefficients in 'coef'
+  % to convert NSP sample number to local PTB time stamp ; this is
+  % two-element row vector with [ y-intercept , slope ]. The regression is
+  % kept by clksync over the most recent C.CALWIN calibration points.
   tbuf.n = 0 ;
   tbuf.nsp = zeros ( 2 * C.CALTHR , 1 ) ;
   tbuf.ptb = zeros ( 2 * C.CALTHR , 1 ) ;
@@ -190,8 +199,8 @@ function  metcbmex ( MC_in )
   
   %%% MET initialisation %%%
   
-  % Block warnings from robustfit saying "Iteration limit reached"
-  warning (  'off'  ,  'stats:statrobustfit:IterationLimit'  )
+  % Running regression of PTB time stamps on NSP sample numbers
+  clksync ( 'o' , C.CALWIN ) ;
   
   % Current session directory on the Host PC
   hpcsdr = '' ;
@@ -339,6 +348,17 @@ function  metcbmex ( MC_in )
       tbuf = fillbuf ( tbuf , nsptime , ptbtime ) ;
       N = N + n ;
       
+      % And to the running regression , getting the latest coefficients.
+      % These will be used during the trial to convert NSP timestamps to
+      % local PTB time.
+      [ tbuf.coef( : ) , n ] = clksync ( 'a' , nsptime , ptbtime ) ;
+      
+      % Report outliers
+      if  n
+        met (  'print'  ,  sprintf ( [ 'metcbmex: %d clock calibration ' ,...
+          'points rejected as outliers' ] , n )  ,  'L'  )
+      end
+      
       % We got calibration points , so reset the timer
       tbuf.timer = GetSecs ;
       
@@ -361,16 +381,15 @@ function  metcbmex ( MC_in )
       cbmex ( 'trialconfig' , 0 )
       hpcnam = '' ;
       
+      % The session may now be closed. Wait for the files of the last trial
+      % to reach the disk , raising any write error for that trial.
+      trialwr ( 'f' )
+      
       % Wait for new trial
       continue
       
     end % mquit or mwait
     
-    % Compute latest coefficients , these will be used during the trial to
-    % convert NSP timestamps to local PTB time
-    i = 1 : tbuf.n ;
-    tbuf.coef( : ) = robustfit ( tbuf.nsp ( i ) , tbuf.ptb ( i ) ) ;
-    
     
     %--- Send header comments ---%
     
@@ -416,8 +435,22 @@ function  metcbmex ( MC_in )
     trialdata.clock_calib_times.nsp = tbuf.nsp ( i ) ;
     trialdata.clock_calib_times.ptb = tbuf.ptb ( i ) ;
     
+    % Append buffered NSP data to the session store. A failure is only
+    % reported , so that the trial directory files are still saved.
+    try
+      savestore ( sd , tid , trialdata )
+    catch  E
+      met (  'print'  ,  sprintf ( [ 'metcbmex: failed to append ' , ...
+        'trial %d to session store , %s' ] , tid , E.message )  ,  'E'  )
+    end
+    
     % Write out buffered NSP data to trial directory on local system
-    savedat ( C , sd , tid , trialdata )
+    if  MCC.STORE.TRIALFILES  ,  savedat ( C , sd , tid , trialdata )  ,  end
+    
+    % No mready trigger is waiting , so the controller idles and the
+    % session may be closed before the next trial. Wait for this trial's
+    % files to reach the disk , raising any write error for this trial.
+    if  ~ mrtflg  ,  trialwr ( 'f' )  ,  end
     
   end % trial loop
   
@@ -827,6 +860,9 @@ function  [ td , msig , mrtflg , mquit ] = ...
   % Number of reads written
   td.w = 0 ;
   
+  % Empty the NSP event ring , events wait here until written to shm
+  nspring ( 'o' , tdinfo.din( 1 ) ) ;
+  
   % MET signal buffer , keep signal IDs , cargos , and times
   msig.n = 0 ;
   msig.sid = zeros ( MC.AWMSIG , 1 ) ;
@@ -923,6 +959,12 @@ function  [ td , msig , mrtflg , mquit ] = ...
       td.n = td.n + 1 ;
       td.data ( : , : , td.n )  =  d ( : , 2 : end ) ;
       
+      % Pack new events into the ring , for shm
+      if  nspring ( 'p' , d )
+        met ( 'print' , ...
+          'metcbmex: nsp event ring full , oldest events dropped' , 'E' )
+      end
+    
     end % trialdata read
     
     
@@ -947,18 +989,18 @@ function  [ td , msig , mrtflg , mquit ] = ...
     % to write, and have we written out less than we've received?
     if  wflag  &&  td.w < td.n
       
-      % Index of layer(s) to combine for writing
-      icom = td.w + 1 : td.n ;
-      
-      % Collapse reads into a single-layered cell array. Casts data to
-      % double, and converts NSP sample number to local PTB time stamp.
-      wshm = tdcollapse ( td , icom , MCC.SHM.NSP.RAWSHZ , tdinfo ) ;
+      % Events that have not been written , as packed records , with the
+      % NSP to PTB time regression coefficients and the channel labels
+      wshm = { nspring( 'w' ) , tid , coef , td.label } ;
 
       % Write to shared memory
-      if  met ( 'write' , 'nsp' , wshm , tid )
+      if  met ( 'write' , 'nsp' , wshm { : } )
+        
+        % Release written events from the ring
+        nspring ( 'a' , size (  wshm{ MCC.SHM.NSP.DATIND }  ,  2  ) ) ;
 
         % Count layers written
-        td.w = td.w  +  numel ( icom ) ;
+        td.w = td.n ;
 
         % Lower write flag
         wflag( 1 ) = false ;
@@ -1119,6 +1161,62 @@ function  comstr = makeftr ( C , msig )
 end % makeftr
 
 
+% Append trial data to streams in the session store. Event times get one
+% row each with the channel and unit i.e. the row and column of .data that
+% they came from. Channel labels , time-conversion coefficients , and
+% clock calibration samples each get a stream of their own.
+function  savestore ( sd , tid , trialdata )
+  
+  
+  %%% Event times %%%
+  
+  % Channel and unit of each cell with data. Columns , find returns rows
+  % when there is only one channel.
+  [ c , u ] = find (  ~ cellfun ( @isempty , trialdata.data )  ) ;
+  c = c( : ) ;  u = u( : ) ;
+  d = trialdata.data(  sub2ind ( size ( trialdata.data ) , c , u )  ) ;
+  
+  % Number of events in each
+  n = cellfun (  @numel  ,  d( : )  ) ;
+  
+  % Concatenate into columns , using the same unsigned 32-bit integers
+  % that are written to the trial directory
+  d = cellfun (  @( d ) d( : )  ,  d  ,  'UniformOutput'  ,  false  ) ;
+  
+  metstore (  sd  ,  'nspevents'  ,  tid  ,  struct (  ...
+    'chan' , uint16 ( repelem( c , n ) ) , ...
+    'unit' , uint16 ( repelem( u , n ) ) , ...
+    'time' , uint32 ( vertcat( zeros( 0 , 1 ) , d{ : } ) )  )  )
+  
+  
+  %%% Channel labels %%%
+  
+  % Character matrix with a fixed width of 32 , padded with trailing spaces
+  L = char (  trialdata.label  ,  blanks ( 32 )  ) ;
+  L = L( 1 : end - 1 , 1 : 32 ) ;
+  
+  metstore (  sd  ,  'nsplabel'  ,  tid  ,  struct ( 'label' , L )  )
+  
+  
+  %%% Time conversion %%%
+  
+  % Coefficients
+  coef = trialdata.nsp2ptb_time_coef ;
+  
+  metstore (  sd  ,  'nspcoef'  ,  tid  ,  struct (  ...
+    'intercept' , double ( coef.intercept( : ) ) , ...
+    'slope' , double ( coef.slope( : ) )  )  )
+  
+  % Clock-to-clock calibration samples
+  cal = trialdata.clock_calib_times ;
+  
+  metstore (  sd  ,  'nspcalib'  ,  tid  ,  struct (  ...
+    'nsp' , double ( cal.nsp( : ) ) , 'ptb' , double ( cal.ptb( : ) )  )  )
+
+
+end % savestore
+
+
 % Save trial data to local system trial directory
 function  savedat ( C , sd , tid , trialdata )
   
@@ -1160,8 +1258,11 @@ function  savedat ( C , sd , tid , trialdata )
   % Attach storage copy of data to the struct
   trialdata.data = data ;
   
-  % Save binary copy of the event times
-  save (  [ f , '.mat' ]  ,  '-struct'  ,  'trialdata'  )
+  % Save binary copy of the event times to a staging file , the trial
+  % directory writer puts it in place
+  stg = trialwr (  's'  ,  [ f , '.mat' ]  ) ;
+  save (  stg  ,  '-struct'  ,  'trialdata'  )
+  trialwr (  'w'  ,  stg  ,  [ f , '.mat' ]  )
   
   
   %-- ASCII data --%
@@ -1206,7 +1307,9 @@ function  savedat ( C , sd , tid , trialdata )
   S = strjoin (  [ S ; trialdata.data ]  ,  '\n'  ) ;
   
   % Write ASCII file
-  metsavtxt (  [ f , '.txt' ]  ,  S  ,  'w'  ,  'metcbmex'  )
+  stg = trialwr (  's'  ,  [ f , '.txt' ]  ) ;
+  metsavtxt (  stg  ,  S  ,  'w'  ,  'metcbmex'  )
+  trialwr (  'w'  ,  stg  ,  [ f , '.txt' ]  )
   
     
 end % savedat
@@ -1,7 +1,7 @@
 
-function  metcontroller ( cd , stodup , br , qw , varargin )
+function  metcontroller ( cd , stodup , br , qw , shmnam , varargin )
 % 
-% metcontroller ( cd , stodup , br , qw , varargin )
+% metcontroller ( cd , stodup , br , qw , shmnam , varargin )
 % 
 % Each Matlab-based Matlab Electrophysiology Toolbox (MET) child controller
 % runs metcontroller to initialise itself and run the controller function.
@@ -18,6 +18,8 @@ function  metcontroller ( cd , stodup , br , qw , varargin )
 %   output to its rightful file descriptor.
 % br , qw - Broadcast reading and request writing pipe file descriptors,
 %   for receiving and sending MET signals.
+% shmnam - String of space-separated names of the POSIX shared memory
+%   channels that were declared in the .cmet file. Empty if there are none.
 %
 % The remainder of arguments can vary in number, hence they are passed
 % through varargin.
@@ -32,7 +34,8 @@ function  metcontroller ( cd , stodup , br , qw , varargin )
 % followed by the number of readers, the readers' efd, and then the list of
 % writer's efds, one per reader. Shared memory argument groups are expected
 % to come in this order by type: variable stimulus parameters (stim), eye
-% position (eye), and Neural Signal Processor output (nsp).
+% position (eye), Neural Signal Processor output (nsp), and then each
+% declared channel in the order given by shmnam.
 % 
 % The first argument after shared memory arguments must name the MET
 % controller function that metcontroller will execute. Following that are
@@ -80,8 +83,11 @@ function  metcontroller ( cd , stodup , br , qw , varargin )
   
   %%% CONSTANTS %%%
   
-  % Number of POSIX shared memory objects
-  SHMARG = 3 ;
+  % Names of declared POSIX shared memory channels
+  shmnam = regexp ( shmnam , '\S+' , 'match' ) ;
+  
+  % Number of POSIX shared memory objects , built-in and declared
+  SHMARG = 3  +  numel ( shmnam ) ;
   
   % Shared mem open flag characters
   MSMG_CLOSED = 'c' ;
@@ -344,10 +350,10 @@ function  metcontroller ( cd , stodup , br , qw , varargin )
   try
     
     clearvars  -except  ...
-      cd stodup pfd  shmflg shmnr refd wefd wefdv  metrsc mcfh
+      cd stodup pfd  shmflg shmnr refd wefd wefdv shmnam  metrsc mcfh
     MC = met ( 'open' , ...
                cd , stodup , pfd , ...
-               shmflg , shmnr , refd , wefd , wefdv ) ;
+               shmflg , shmnr , refd , wefd , wefdv , shmnam ) ;
     
   catch  E
     
@@ -364,7 +370,7 @@ function  metcontroller ( cd , stodup , br , qw , varargin )
   end % open met
   
   % Remove unnecessary variables
-  clearvars  cd  stodup  pfd  shmflg  shmnr  refd  wefd  wefdv
+  clearvars  cd  stodup  pfd  shmflg  shmnr  refd  wefd  wefdv  shmnam
   
   
   %%% Register cleanup object %%%
@@ -74,6 +74,17 @@ function  MCC = metctrlconst ( MC )
   % Session descriptor file name , to be written into the session directory
   MCC.SDFNAM = 'sessdesc.mat' ;
   
+  % Parse cache directory. metparse keeps the parsed schedule , task logic
+  % , and variable parameters of each session here , one file per session
+  % directory. Not in the session directory , which may be archived and
+  % read-only.
+  MCC.PARSEC = fullfile ( tempdir , 'metparse' ) ;
+  
+  % Seconds that metguicentral waits for the trialwr writers of all MET
+  % controllers to put their files on disk , before it finalises a session
+  % directory
+  MCC.TWWAIT = 30 ;
+  
   % Can't find met
   if  isempty ( MC )
     
@@ -130,6 +141,16 @@ function  MCC = metctrlconst ( MC )
   % trial that experienced a crash.
   MCC.CRASHF = 'system_crash.txt' ;
   
+  % Session store. Controllers append each trial's data to streams in the
+  % session's store directory , see metstore and sesstore. When .TRIALFILES
+  % is false , metgui and metcbmex stop writing the same data to .mat and
+  % .txt files in every trial directory.
+  MCC.STORE.TRIALFILES = true ;
+  
+  % Name of the file in the store directory that caches the session index
+  % made by metsessidx
+  MCC.STORE.INDEX = 'metsessidx.mat' ;
+  
   
   %%% Regular Expressions %%%
   
@@ -413,18 +434,24 @@ function  MCC = metctrlconst ( MC )
   %-- nsp --%
   
   % Reads from cbmex shall be packaged into such a data structure as .STRUC
-  % for both saving to a regular file and writing to shared memory. label
-  % is a cell array vector of strings that label each row of the data
-  % field, itself a cell array. nsp2ptb_time_coef holds the slope and
-  % intercept used to convert time stamps from the neural signal processor
-  % into local system time values. n and w are context dependent by MET
-  % controller ; for instance , the controller that reads from cbmex()
-  % might count the number of reads in .n and the number of shm writes to
-  % .w. By convention, .data will contain a n x m cell array of n different
-  % recording channels with up to m separately identified units. The type
-  % of vector in each cell is context dependent. NOTE: 'nsp' shared memory
-  % will convey two arrays ; the first will be a copy of the struct, and
-  % the second will be the trial identifier associated with the read
+  % for saving to a regular file. label is a cell array vector of strings
+  % that label each row of the data field, itself a cell array.
+  % nsp2ptb_time_coef holds the slope and intercept used to convert time
+  % stamps from the neural signal processor into local system time values.
+  % n and w are context dependent by MET controller ; for instance , the
+  % controller that reads from cbmex() might count the number of reads in
+  % .n and the number of shm writes to .w. By convention, .data will
+  % contain a n x m cell array of n different recording channels with up to
+  % m separately identified units. The type of vector in each cell is
+  % context dependent. NOTE: 'nsp' shared memory will convey four arrays ;
+  % the first is a 2 x N uint32 array of packed NSP events from nspring (
+  % 'w' ) , the second is the trial identifier associated with the read ,
+  % and the third is the latest [ intercept , slope ] of the NSP to PTB
+  % time regression from clksync. Hence the local time of NSP sample number
+  % n is intercept + slope * n. The fourth is the label cell array , sent
+  % with every write so that a reader that skips a read still has it.
+  % Readers rebuild .data from the events with nspring ( 'c' ) or nspring (
+  % 'd' ).
   MCC.SHM.NSP.STRUC = desc (  { 'label' , 'nsp2ptb_time_coef' , 'data' ,...
     'n' , 'w' }  ) ;
   MCC.SHM.NSP.STRUC.nsp2ptb_time_coef = desc( { 'intercept' , 'slope' } ) ;
@@ -456,10 +483,13 @@ function  MCC = metctrlconst ( MC )
   % NSP unsigned int 16 value of digital input , column index
   MCC.SHM.NSP.DINVAL = 3 ;
   
-  % 'nsp' shared memory indeces for the data structure and for the
-  % associated trial identifier
+  % 'nsp' shared memory indeces for the packed events , for the associated
+  % trial identifier , for the NSP to PTB time regression coefficients ,
+  % and for the channel labels
   MCC.SHM.NSP.DATIND = 1 ;
   MCC.SHM.NSP.TIDIND = 2 ;
+  MCC.SHM.NSP.COFIND = 3 ;
+  MCC.SHM.NSP.LABIND = 4 ;
   
   % Maximum number of front end channels on NSP
   MCC.SHM.NSP.MAXCHN = 128 ;
@@ -472,6 +502,29 @@ function  MCC = metctrlconst ( MC )
   MCC.SHM.NSP.FOPDUR = 0.4 ;
   
   
+  %-- frametel --%
+  
+  % Optional frame-timing telemetry. Declare with e.g. 'shm frametel 65536'
+  % in the .cmet file and give metptb write access ; metptb then publishes
+  % one record per flip to a lock-free ring inside this shared memory via
+  % the frametel MEX. Readers map it with frametel ( 'm' , name ) and poll
+  % with frametel ( 'p' ) , without using met's shared memory protocol.
+  MCC.SHM.FTEL.NAME = 'frametel' ;
+  
+  % Record columns , links beyond .MAXLNK are not recorded
+  MCC.SHM.FTEL.COLIND = {  'TRIAL' , 1 ;
+                           'FRAME' , 2 ;
+                          'TARGET' , 3 ;
+                             'VBL' , 4 ;
+                           'ONSET' , 5 ;
+                            'FLIP' , 6 ;
+                          'MISSED' , 7 ;
+                            'DRAW' , 8 ;
+                           'LINK1' , 9 }' ;
+  MCC.SHM.FTEL.COLIND = struct ( MCC.SHM.FTEL.COLIND { : } ) ;
+  MCC.SHM.FTEL.MAXLNK = 16 ;
+  
+  
   %%% schedule.txt %%%
   
   % sched and outcome not included here , they're a special case
@@ -36,7 +36,9 @@ function  metdaqeye ( MC )
 % 
 % Valid eye positions must not exceed velocity and accelleration thresholds
 % of 30 deg/s and 8000 deg/s^2. See Rayner et al. 2007. Vision Research,
-% 47(21), 2714–2726.
+% 47(21), 2714–2726. All samples are written to shared memory ; readers
+% apply the thresholds themselves, for example with eyefilt as mettarget
+% does.
 % 
 % NOTE: Depends on customised DaqAInScan.m that checks for device serial
 % number, and discards no data if options.nodiscard is true.
@@ -63,7 +65,16 @@ function  metdaqeye ( MC )
 % analogue copies of the eye positions ; if it is any other valid string
 % then the USB-DAQ device is not used, and all eye data is collected
 % digitally ; valid strings for digital streaming are smiivx (SMI iViewX,
-% uses MET utility ivxudp). HOSTIP and SERVIP must be valid IPv4 addresses,
+% uses MET utility ivxudp), smiivxshm (as smiivx, but ivxudp's background
+% receive thread writes eye samples straight into 'eye' shared memory,
+% without passing through Matlab ; metdaqeye then only handles MET signals
+% ; falls back on smiivx if touchscreen/mouse is enabled, because mouse
+% positions must also be written to 'eye' shared memory), and ivxfile
+% (replays recorded iViewX samples at their original timing, see ivxudp
+% 'f', for offline reproduction of gaze-driven sessions ; written to 'eye'
+% shared memory as for smiivxshm, unless touchscreen/mouse is enabled).
+% ivxfile needs the optional parameter EYEFIL, a string naming the file of
+% recorded samples. HOSTIP and SERVIP must be valid IPv4 addresses,
 % and are taken as strings. HOSTPT and SERVPT must be valid port numbers,
 % taken as numeric values. Here, HOST refers to the local system running
 % MET, and SERVer refers to the remote eye-tracking system. XYSWAP is a
@@ -211,6 +222,9 @@ function  metdaqeye ( MC )
   DAQFLG = 'd' ;
   feyenet = cell ( 1 , 3 ) ;
   
+  % Eye pipeline flag , raised when ivxudp writes to 'eye' shared memory
+  EYEPIP = false ;
+  
   % See whether eye data is being obtained over a network. Note here that
   % DAQFLG will be 'a' for analogue and 'd' for digital. If it becomes zero
   % then an error has occurred. feyenet will be a three-element function
@@ -246,13 +260,80 @@ function  metdaqeye ( MC )
                    @( ) ivxudp( 'r' )  ;
                    @( ) ivxudp( 'c' )  } ;
       
+    % Networking , SMI iViewX UDP stream goes straight to shared memory
+    case  'smiivxshm'
+      
+      str = sprintf (  [ 'metdaqeye: reading digital gaze ' , ...
+        'position and pupil diameter from SMI iViewX\n  host-ip %s,' , ...
+        'host-port %d, iViewX-ip %s, iViewX-port %d' ]  ,  ...
+        peye.HOSTIP , peye.HOSTPT , peye.SERVIP , peye.SERVPT  ) ;
+      
+      feyenet = {  @( ) ivxudp( 'o' , peye.HOSTIP , peye.HOSTPT , ...
+                                      peye.SERVIP , peye.SERVPT )  ;
+                   @( ) ivxudp( 'r' )  ;
+                   @( ) ivxudp( 'c' )  } ;
+      
+      % Mouse positions are written to 'eye' shared memory by metdaqeye ,
+      % so there can't be another writer
+      if  FMOUSE
+        
+        str = [ str , sprintf( [ '\n  touchscreen/mouse enabled , ' , ...
+          'reading eye samples through metdaqeye as for smiivx' ] ) ] ;
+      
+      % Open with background receive thread , then hand 'eye' shared
+      % memory over to it with screen size in degrees for unit conversion
+      else
+        
+        str = [ str , sprintf( [ '\n  eye samples written to ' , ...
+          '''eye'' shared memory by ivxudp' ] ) ] ;
+        
+        feyenet{ 1 } = @( ) ivxudpshm ( @( ) ivxudp ( 'o' , ...
+          peye.HOSTIP , peye.HOSTPT , peye.SERVIP , peye.SERVPT , 1 ) , ...
+            [ SCRWID , SCRHEI , peye.XYSWAP , DEYESW ] ) ;
+        
+        EYEPIP = true ;
+      
+      end % touch/mouse
+    
+    % Replay of recorded SMI iViewX samples , in place of the UDP stream
+    case  'ivxfile'
+      
+      if  ~ isfield ( peye , 'EYEFIL' )  ||  ~ isvector ( peye.EYEFIL )  ||...
+          ~ ischar ( peye.EYEFIL )
+        error ( 'MET:metdaqeye:csv' , [ 'metdaqeye: EYESRC ivxfile ' , ...
+          'needs EYEFIL , a string naming the replay file' ] )
+      end
+      
+      str = sprintf (  [ 'metdaqeye: replaying gaze position and ' , ...
+        'pupil diameter of recorded SMI iViewX samples\n  file %s' ]  , ...
+        peye.EYEFIL  ) ;
+      
+      feyenet = {  @( ) ivxudp( 'f' , peye.EYEFIL )  ;
+                   @( ) ivxudp( 'r' )  ;
+                   @( ) ivxudp( 'c' )  } ;
+      
+      % Replay goes straight to 'eye' shared memory , as for smiivxshm
+      if  ~ FMOUSE
+        
+        str = [ str , sprintf( [ '\n  eye samples written to ' , ...
+          '''eye'' shared memory by ivxudp' ] ) ] ;
+        
+        feyenet{ 1 } = @( ) ivxudpshm ( feyenet{ 1 } , ...
+          [ SCRWID , SCRHEI , peye.XYSWAP , DEYESW ] ) ;
+        
+        EYEPIP = true ;
+      
+      end % touch/mouse
+    
     % Unrecognised option
     otherwise
       
       error (  'MET:metdaqeye:net'  ,  [ 'metdaqeye: ' , ...
         '.csv parameter EYESRC value unrecognised: %s\n' , ...
         '  Recognised strings are:\n  usbdaq (analogue mode)\n' , ...
-        '  smiivx (SensoMotoric Instruments, iViewX)' ] ,  ...
+        '  smiivx (SensoMotoric Instruments, iViewX)\n' , ...
+        '  smiivxshm (iViewX, written to shared memory by ivxudp)\n' , ...
+        '  ivxfile (replay of recorded iViewX samples)' ] , ...
         peye.EYESRC  )
         
   end % networking
@@ -306,7 +387,7 @@ function  metdaqeye ( MC )
     'DAQMAP' , DAQMAP , 'OPTIONS', options, 'PIXDEG' , PIXDEG , ...
     'FMOUSE' , FMOUSE , 'DAQFLG' , DAQFLG , 'XYSWAP' , peye.XYSWAP , ...
     'FEYESW' , FEYESW , 'DEYESW' , DEYESW , 'HMIROR' , pscr.hmirror , ...
-    'VMIROR' , pscr.vmirror ) ;
+    'VMIROR' , pscr.vmirror , 'EYEPIP' , EYEPIP ) ;
   
   % Remove unnecessary variables
   clearvars  -except  MC C feyenet
@@ -524,12 +605,17 @@ function  metdaqeye_run ( MC , C , feyenet )
     
     %-- MET signals --%
     
-    % Check for new MET signals
-    [ ~ , ~ , sig , crg ] = met ( 'recv' ) ;
+    % Check for new MET signals. Wait for them in the eye pipeline , as
+    % ivxudp's receive thread writes to eye shared memory.
+    [ ~ , ~ , sig , crg ] = met ( 'recv' , C.EYEPIP ) ;
     
     % Return if any mquit received
     if  any ( sig  ==  MSID.mquit )  ,  return  ,  end
     
+    % Eye pipeline , check that the receive thread is still running ;
+    % ivxudp 'r' throws an error if it stopped
+    if  C.EYEPIP  ,  feyenet ( ) ;  end
+    
     % Find mready signals
     mrs =  sig == MSID.mready  ;
     
@@ -541,6 +627,9 @@ function  metdaqeye_run ( MC , C , feyenet )
       
     end
     
+    % Eye pipeline , nothing else to do until the next MET signals arrive
+    if  C.EYEPIP  ,  continue  ,  end
+    
     
     %-- Sample eye positions --%
     
@@ -922,3 +1011,23 @@ function  p = readdaqpar
   
 end % readdaqpar
 
+
+
+% Open ivxudp with its background receive thread by calling fopn , then
+% have the thread write eye samples to 'eye' shared memory. fopn runs
+% either ivxudp 'o' with bg , or 'f'. cal is [ screen width , screen height
+% , XYSWAP , minimum duration between writes ] , see ivxudp.
+function  ivxudpshm ( fopn , cal )
+  
+  fopn ( ) ;
+  
+  % Close socket or file if the hand over fails , so the error can be
+  % handled like any other connection failure
+  try
+    ivxudp ( 'e' , met ( 'shmwr' , 'eye' ) , cal ) ;
+  catch  E
+    ivxudp ( 'c' ) ;
+    rethrow ( E )
+  end
+
+end % ivxudpshm
@@ -262,16 +262,16 @@ function  metgui ( MCin )
     
   end
   
-  % Trial nsp buffer. .b is a cell array vector containing each 'nsp' read
-  % in sequence. .n is the number of elements in .b , and .i is the index
-  % in .b of the most recent read. .label is re-set by the first read of
-  % each trial to contain channel label strings. .final is used to collapse
-  % the contents of .b down into a cell array where each element contains a
-  % double vector with all time stamps received over the trial. A couple of
-  % buffer-specific flags aid finalisation: .mstop is true if digin MET
-  % signal mstop has been observed, .msi is the index of the last read that
-  % was checked for a digin mstop value, and .mst is the time when we first
-  % started looking for mstop.
+  % Trial nsp buffer. .b is a cell array vector containing the packed NSP
+  % events of each 'nsp' read in sequence. .n is the number of elements in
+  % .b , and .i is the index in .b of the most recent read. .label is
+  % re-set by every read of the trial to contain channel label strings. .final is used to decode the contents of .b into a cell array
+  % where each element contains a double vector with all time stamps
+  % received over the trial. A couple of buffer-specific flags aid
+  % finalisation: .mstop is true if digin MET signal mstop has been
+  % observed, .msi is the index of the last read that was checked for a
+  % digin mstop value, and .mst is the time when we first started looking
+  % for mstop.
   if  any ( strcmp (  'nsp'  ,  SHMNAM  ) )
     
     % Make struct buffer
@@ -742,13 +742,30 @@ function  metgui ( MCin )
               
             end % finalise nsp
 
-            % Save MET signal data
-            savetdat (  TDFNAM  ,  sd  ,  td  ,  tbuf  )
+            % Append trial data to the session store. A failure is only
+            % reported , so that the trial directory files are still saved.
+            try
+              savestore (  sd  ,  tbuf  )
+            catch  E
+              met ( 'print' , sprintf ( [ 'metgui: failed to append ' , ...
+                'trial %d to session store , %s' ] , sd.trial_id , ...
+                  E.message ) , 'E' )
+            end
+            
+            % Save MET signal data to trial directory
+            if  MCC.STORE.TRIALFILES
+              savetdat (  TDFNAM  ,  sd  ,  td  ,  tbuf  )
+            end
 
             % Save recovery data
             saverec (  fnrec ,  sd  ,  bd  ,  outc.b( 1 : outc.i ) , ...
               blk.b( 1 : blk.i )  ) ;
             
+            % metremote's play button is up , so no trial follows and the
+            % session may be closed. Wait for this trial's files to reach
+            % the disk , so that any write error is raised for this trial.
+            if  ~ mr.start.Value  ,  trialwr ( 'f' )  ,  end
+            
             % Update non-realtime MET GUIs
             for  j = mgui.notrtgui
 
@@ -1453,13 +1470,11 @@ function  tbuf = cpcurb (  BUFDUR  ,  F  ,  cbuf  ,  tbuf  ,  td  )
       % not changed if there is mismatch.
       if  tid  ~=  td.trial_id  ,  return  ,  end
 
-      % Get new time stamps
-      tbuf.b{ i } = cbuf{ MCC.SHM.NSP.DATIND }.data ;
+      % Get new packed events
+      tbuf.b{ i } = cbuf{ MCC.SHM.NSP.DATIND } ;
 
-      % If this is the first read then update the labels
-      if  ~ tbuf.i
-        tbuf.label = cbuf{ MCC.SHM.NSP.DATIND }.label ;
-      end
+      % Channel labels come with every read
+      tbuf.label = cbuf{ MCC.SHM.NSP.LABIND } ;
       
   end % update trial buffer
   
@@ -1511,14 +1526,11 @@ function  nsp = nspmstop ( nsp )
   % mstop MET signal identifier
   msid = MCC.MSID.mstop ;
   
-  % digin value column
-  DIGVAL = MCC.SHM.NSP.DINVAL - 1 ;
-  
   
   %%% Prepare indices %%%
   
   % Locate digital channel
-  dig = strcmp ( nsp.label , MCC.SHM.NSP.DINLAB ) ;
+  dig = find ( strcmp ( nsp.label , MCC.SHM.NSP.DINLAB ) ) ;
   
   if  ~ any ( dig )
     met ( 'print' , 'metgui:nspmstop: no nsp digin channel found' , 'E' )
@@ -1531,8 +1543,9 @@ function  nsp = nspmstop ( nsp )
   % First past the last read checked for mstop to the last read in buffer
   for  i = nsp.msi + 1 : nsp.i
     
-    % Point to digital input values
-    vdig = nsp.b{ i }{ dig , DIGVAL } ;
+    % Decode events and keep digital input values
+    [ r , vdig ] = nspring ( 'd' , nsp.b{ i } , MCC.SHM.NSP.RAWSHZ ) ;
+    vdig = vdig (  r  ==  dig  ) ;
     
     % No digital input events , go to next read
     if  isempty (  vdig  )  ,  continue  ,  end
@@ -1561,37 +1574,33 @@ function  nsp = nspmstop ( nsp )
 end % nspmstop
 
 
-% Collapse trial buffer nsp data down into a 2D cell array where each
-% element contains a double vector will all data from that channel / unit
+% Decode trial buffer nsp data into a 2D cell array where each element
+% contains a double vector will all data from that channel / unit
 function  f = nspfin ( nsp )
   
+  % Global MET controller constants
+  global  MCC
+  
   % Index of last read from nsp
   i = nsp.i ;
   
   % Nothing read from nsp shm
   if  ~ i  ,  return  ,  end
   
-  % Size of one read
-  s = size (  nsp.b { 1 }  ) ;
+  % Size of cbmex 'trialdata' output , less the label column
+  s = [  numel( nsp.label )  ,  MCC.SHM.NSP.MAXUNI + 1  ] ;
   
-  % Concatenate reads together
-  f = cellfun ( @coll , nsp.b { 1 : i } , 'UniformOutput' , false ) ;
+  % Digital input row
+  dig = find ( strcmp ( nsp.label , MCC.SHM.NSP.DINLAB ) ) ;
+  if  isempty ( dig )  ,  dig = 0 ;  end
   
-  % Reshape concatentation from vector to 2D matrix
-  f = reshape (  f  ,  s  ) ;
+  % Concatenate reads together and decode
+  f = nspring ( 'c' , [ nsp.b{ 1 : i } ] , s , dig , ...
+    MCC.SHM.NSP.RAWSHZ ) ;
   
 end % nspfin
 
 
-% Function for cellfun argument in nspfin , collapse input arguments
-% together
-function  c = coll ( varargin )
-  
-  c = [ varargin{ : } ] ;
-  
-end % coll
-
-
 function  savetdat (  TDFNAM  ,  sd  ,  td  ,  tbuf  )
   
 
@@ -1624,8 +1633,10 @@ function  savetdat (  TDFNAM  ,  sd  ,  td  ,  tbuf  )
   crg = msig.b ( i , msig.crg ) ;
   tim = msig.b ( i , msig.tim ) ;
   
-  % Save to file
-  save (  f_msig  ,  'src'  ,  'sig'  ,  'crg'  ,  'tim'  )
+  % Save to staging file , the trial directory writer puts it in place
+  stg = trialwr ( 's' , f_msig ) ;
+  save (  stg  ,  'src'  ,  'sig'  ,  'crg'  ,  'tim'  )
+  trialwr ( 'w' , stg , f_msig )
   
   
   %-- Hit regions --%
@@ -1640,7 +1651,9 @@ function  savetdat (  TDFNAM  ,  sd  ,  td  ,  tbuf  )
     stim = tbuf.stim.final ;
     
     % Save data
-    save ( f_stim , '-struct' , 'stim' )
+    stg = trialwr ( 's' , f_stim ) ;
+    save ( stg , '-struct' , 'stim' )
+    trialwr ( 'w' , stg , f_stim )
     
   end % hitregion
   
@@ -1685,7 +1698,9 @@ function  savetdat (  TDFNAM  ,  sd  ,  td  ,  tbuf  )
     mouse.position = int16 (  100  *  mouse.position  ) ;
     
     % Save data
-    save (  f_eye  ,  'eye'  ,  'pupil'  ,  'mouse'  )
+    stg = trialwr ( 's' , f_eye ) ;
+    save (  stg  ,  'eye'  ,  'pupil'  ,  'mouse'  )
+    trialwr ( 'w' , stg , f_eye )
     
   end % eye positions
   
@@ -1753,7 +1768,9 @@ function  savetdat (  TDFNAM  ,  sd  ,  td  ,  tbuf  )
   f_msig = strrep ( f_msig , '.mat' , '.txt' ) ;
   
   % Save file
-  metsavtxt ( f_msig , S , 'w' , 'metgui' )
+  stg = trialwr ( 's' , f_msig ) ;
+  metsavtxt ( stg , S , 'w' , 'metgui' )
+  trialwr ( 'w' , stg , f_msig )
   
   
   %-- Hit regions --%
@@ -1783,7 +1800,9 @@ function  savetdat (  TDFNAM  ,  sd  ,  td  ,  tbuf  )
       'UniformOutput'  ,  false  ) ;
     
     % Save file
-    metsavtxt ( f_stim , [ S{ : } ] , 'w' , 'metgui' )
+    stg = trialwr ( 's' , f_stim ) ;
+    metsavtxt ( stg , [ S{ : } ] , 'w' , 'metgui' )
+    trialwr ( 'w' , stg , f_stim )
     
   end % hitregion
   
@@ -1825,11 +1844,99 @@ function  savetdat (  TDFNAM  ,  sd  ,  td  ,  tbuf  )
   f_eye = strrep ( f_eye , '.mat' , '.txt' ) ;
   
 	% Save file
-  metsavtxt ( f_eye , S , 'w' , 'metgui' )
+  stg = trialwr ( 's' , f_eye ) ;
+  metsavtxt ( stg , S , 'w' , 'metgui' )
+  trialwr ( 'w' , stg , f_eye )
   
 end % savetdat
 
 
+% Append trial buffers to streams in the session store. Hit regions get
+% one row per region , with the time and index of the 'stim' read that
+% carried it , the index of its stimulus link , and its parameters padded
+% to 8 columns with NaN. Eye positions and diameters are kept in
+% hundredths of degrees and int16 , as in the trial directory files.
+function  savestore (  sd  ,  tbuf  )
+  
+  
+  %%% Global Constants %%%
+  
+  % MET controller constants
+  global  MCC
+  
+  
+  %%% MET signals %%%
+  
+  % Filled rows of the buffer
+  msig = tbuf.msig ;
+  b = msig.b ( 1 : msig.i , : ) ;
+  
+  metstore (  sd  ,  'metsigs'  ,  sd.trial_id  ,  struct (  ...
+    'src' , b( : , msig.src ) , 'sig' , b( : , msig.sig ) , ...
+    'crg' , b( : , msig.crg ) , 'tim' , b( : , msig.tim )  )  )
+  
+  
+  %%% Hit regions %%%
+  
+  if  isfield ( tbuf , 'stim' )
+    
+    % Finalised buffer , reads down rows and stimulus links across columns
+    stim = tbuf.stim.final ;
+    H = stim.( MCC.SDEF.ptb.hitregion.fieldname ) ;
+    
+    % Reads and links with hit regions , and the number of regions in each.
+    % Columns throughout , find returns rows when there is only one read.
+    [ r , l ] = find (  ~ cellfun ( @isempty , H )  ) ;
+    r = r( : ) ;  l = l( : ) ;
+    H = H(  sub2ind ( size ( H ) , r , l )  ) ;
+    H = H( : ) ;
+    n = cellfun (  @( h ) size ( h , 1 )  ,  H  ) ;
+    
+    % Pad circular hit regions to the width of rectangular ones , then
+    % stack them
+    w = max ( MCC.SHM.STIM.NCOL ) ;
+    R = cellfun (  ...
+      @( h ) [ h , nan( size ( h , 1 ) , w - size ( h , 2 ) ) ]  ,  ...
+        H  ,  'UniformOutput'  ,  false  ) ;
+    R = vertcat (  zeros ( 0 , w )  ,  R{ : }  ) ;
+    
+    metstore (  sd  ,  'hitregion'  ,  sd.trial_id  ,  struct (  ...
+      'time' , reshape ( repelem( stim.time( r ) , n ) , [] , 1 ) , ...
+      'read' , uint16 ( repelem( r , n ) ) , ...
+      'link' , uint16 ( repelem( l , n ) ) , 'region' , R  )  )
+  
+  end % hit regions
+  
+  
+  %%% Eye positions %%%
+  
+  if  ~ isfield ( tbuf , 'eye' )  ,  return  ,  end
+  
+  % Column indices of time , eye , and mouse positions
+  I = MCC.SHM.EYE.COLIND ;
+  EI = [ I.XLEFT , I.YLEFT , I.XRIGHT , I.YRIGHT ] ;
+  MI = [ I.XLEFT , I.YLEFT ] ;
+  
+  % Eye trial buffer
+  tb = tbuf.eye ;
+  
+  % One stream each for eye positions , pupil diameters , and mouse
+  % positions , since they have different numbers of samples
+  metstore (  sd  ,  'eye'  ,  sd.trial_id  ,  struct (  ...
+    'time' , tb.b( 1 : tb.i_b , I.TIME ) , ...
+    'position' , int16 ( 100 * tb.b( 1 : tb.i_b , EI ) )  )  )
+  
+  metstore (  sd  ,  'pupil'  ,  sd.trial_id  ,  struct (  ...
+    'time' , tb.d( 1 : tb.i_d , I.TIME ) , ...
+    'diameter' , int16 ( tb.d( 1 : tb.i_d , EI ) )  )  )
+  
+  metstore (  sd  ,  'mouse'  ,  sd.trial_id  ,  struct (  ...
+    'time' , tb.m( 1 : tb.i_m , I.TIME ) , ...
+    'position' , int16 ( 100 * tb.m( 1 : tb.i_m , MI ) )  )  )
+
+end % savestore
+
+
 % Build a line for hit region output string
 function  s = stim2str ( h , t , s )
   
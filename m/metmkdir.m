@@ -179,8 +179,8 @@ function  [ notmade , msg ] = metmkdir ( dname , tlogic , stimdef , sched )
   %%% Make directories %%%
   
   % Session directory and sub-directory names
-  C = { '' , MC.SESS.LOGS , MC.SESS.REC , MC.SESS.STIM , MC.SESS.TLOG , ...
-    MC.SESS.TRIAL } ;
+  C = { '' , MC.SESS.LOGS , MC.SESS.REC , MC.SESS.STIM , MC.SESS.STORE ,...
+    MC.SESS.TLOG , MC.SESS.TRIAL } ;
   C = fullfile ( dname , C ) ;
   
   % Make directories
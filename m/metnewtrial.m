@@ -12,8 +12,9 @@ function  [ td , sd , tdstr ]  =  metnewtrial ( sd , bd , w )
 % descriptor, called <session_dir>/trials/<trial_id>/. The trial descriptor
 % is then written to param_<trial_id>.mat and a text version is written in
 % param_<trial_id>.txt ; the string written to the text file is returned in
-% tdstr. w can be empty i.e. [] or ommitted, in which case tdstr will be
-% empty, [].
+% tdstr. The string is also appended to the 'param' stream of the session
+% store , see metstore. w can be empty i.e. [] or ommitted, in which case
+% tdstr will be empty, [].
 % 
 % NOTE: Looks for global constants MC and MCC naming the MET constants and
 %   MET controller constants. If not found, then they are initialised ; the
@@ -135,6 +136,10 @@ function  [ td , sd , tdstr ]  =  metnewtrial ( sd , bd , w )
     % Write string copy
     metsavtxt ( [ n , '.txt' ]  ,  tdstr , 'w' , 'metnewtrial' )
     
+    % Append string copy to the session store , one character per row
+    metstore (  sd  ,  'param'  ,  td.trial_id  ,  ...
+      struct ( 'text' , tdstr( : ) )  )
+    
     % Write trial identifier to MET root file
     n = fullfile (  MC.ROOT.ROOT  ,  MC.ROOT.TRIAL  ) ;
     metsavtxt ( n ,  tids , 'w' , 'metnewtrial' )
@@ -16,6 +16,14 @@ function  varargout = metparse ( PATH , varargin )
 % definition functions so that the default value of variable parameters can
 % be changed to match the RF preferences. If rfdef is left out then
 % standard default variable parameter values are used.
+%
+% The full parse of a session directory is cached in the directory named
+% by MCC.PARSEC, which is under tempdir ; the session directory itself is
+% never written. The cache is keyed on the contents of schedule.txt, every
+% task logic file, and every stimulus definition function, as well as PATH
+% and rfdef. If none of these have changed since the last full parse then
+% the cached output is returned , instead. The cache is skipped quietly if
+% it can't be written.
 % 
 % Alternatively, the second input argument may be a single character. If
 % given as such, then metparse looks directly in the directory provided by
@@ -440,6 +448,40 @@ function  varargout = metparse ( PATH , varargin )
   end % task logic and stim def func
   
   
+  %%% Parse cache %%%
+  
+  % Full parse of session directory only
+  if  opt  ==  'f'
+    
+    % Cache file , named after the session directory. The key still tells
+    % sessions apart if two names collide.
+    PARSEC = regexprep ( PATH , '\W' , '_' ) ;
+    PARSEC = PARSEC( max ( 1 , end - 199 ) : end ) ;
+    PARSEC = fullfile ( MCC.PARSEC , [ PARSEC , '.mat' ] ) ;
+    
+    % Key , the contents of every source file
+    key = srckey ( PATH , rfdef , SCHED , TLOG , tlogf , STIM , stimf ) ;
+    
+    % Return cached output if it was parsed from the same sources
+    if  exist ( PARSEC , 'file' )
+      
+      try
+        r = load ( PARSEC , 'key' , 'out' ) ;
+        i = isequal ( r.key , key ) ;
+      catch
+        i = false ;
+      end
+      
+      if  i
+        varargout = r.out ;
+        return
+      end
+    
+    end % cache file
+  
+  end % parse cache
+  
+  
   %%% Parse task logic files %%%
   
   % Not vpar only
@@ -617,11 +659,46 @@ function  varargout = metparse ( PATH , varargin )
   varargout = { logic , vpar , task , var , block , evar } ;
   
   
+  %%% Write parse cache %%%
+  
+  % The cache is only a shortcut. If it can't be written , for example
+  % because tempdir is read-only , then the next full parse starts over.
+  try
+    
+    if  ~ exist ( MCC.PARSEC , 'dir' )  ,  mkdir ( MCC.PARSEC ) ;  end
+    
+    out = varargout ;
+    save ( PARSEC , 'key' , 'out' )
+  
+  catch
+  end
+
+
 end % metparse
 
 
 %%% SUB-ROUTINES %%%
 
+function  key = srckey ( PATH , rfdef , SCHED , TLOG , tlogf , STIM , stimf )
+%
+% Returns the key of the parse cache. This is a struct that holds the
+% session directory path , the RF definitions , and the name and contents
+% of every source file. Contents are compared directly , rather than
+% through a hash , as they are small and Matlab can't hash them without
+% Java.
+%
+  
+  % Source files with full path
+  f = [  { SCHED }  ,  fullfile( TLOG , { tlogf.name } )  ,  ...
+    fullfile( STIM , { stimf.name } )  ] ;
+  
+  % Read contents
+  key = struct ( 'path' , PATH , 'rfdef' , { rfdef } , 'file' , { f } , ...
+    'text' , { cellfun( @fileread , f , 'UniformOutput' , false ) } ) ;
+
+end % srckey
+
+
 function  checkvpar ( fn , VALNAM , vpar )
   
   % Variable parameter constants. Number of columns in cell array. Then
@@ -354,8 +354,14 @@ function  metping ( MC , call )
     
     %-- Save buffered mnull signals --%
     
-    % Only the calling function does this
-    if  call  ,  savedat ( REXSAV , tdir , tid , b )  ,  end
+    % Only the calling function does this. metping can't tell if mwait
+    % was received , and the session may be closed before the next trial.
+    % So wait for the file to reach the disk , raising any write error for
+    % this trial.
+    if  call
+      savedat ( REXSAV , tdir , tid , b )
+      trialwr ( 'f' )
+    end
     
     
   end % trial loop
@@ -390,8 +396,11 @@ function  savedat ( REXSAV , tdir , tid , b )
   crg ( j , i ) = 0 ; %#ok
   tim ( j , i ) = 0 ; %#ok
   
-  % Save data
-  save ( f , 'crg' , 'tim' )
+  % Save data to a staging file , the trial directory writer puts it in
+  % place
+  stg = trialwr ( 's' , f ) ;
+  save ( stg , 'crg' , 'tim' )
+  trialwr ( 'w' , stg , f )
   
 end % savedat
 
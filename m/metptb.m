@@ -28,7 +28,14 @@ function  metptb ( MC )
 % ptbframes_<i>.mat where <i> is replaced with the trial's identifier ; an
 % ASCII version of the data will also be saved with a .txt suffix. Saved
 % time stamps will be in units of microseconds since the mstart time i.e.
-% trial start time and will be saved as unsigned 32-bit integers.
+% trial start time and will be saved as unsigned 32-bit integers. This
+% includes FlipTarget , the deadline of each frame's flip , and DrawTime ,
+% the time spent in the stimulation function of each stimulus link during
+% each frame , one column per link. Both are logged with the frametel MEX
+% function. If metptb has write access to the shared memory that is named
+% by MCC.SHM.FTEL.NAME then frametel also publishes each frame's timing
+% to that shared memory as soon as the frame is flipped ; another
+% controller can then monitor frame timing during the trial.
 % 
 % NOTE: Relies on the property values in metscrnpar.csv. Bear in mind that
 %   this includes information about screen physical dimensions, subject
@@ -412,6 +419,9 @@ function  metptb ( MC )
     
     sca
     
+    % Free frame-timing telemetry log and ring
+    frametel ( 'c' )
+    
     cd (  MCC.GUIDIR  )
     figpos = timgui.h.Position ; %#ok
     save (  FIGPOS  ,  'figpos'  )
@@ -486,6 +496,20 @@ function  runc ( MC , MCC , MAXBUF , PHOTOR , DEFSEED , DATFMT , ...
   % Make a fresh PsychToolbox timestamp buffer
   tbuf = mkbuf ( MAXBUF , tconst ) ;
   
+  % Open the frame-timing telemetry log. If this controller writes to the
+  % frame-timing shared memory then records are also published there.
+  if  ~ isempty (  MC.SHM  )  &&  ...
+      any (  strcmp(  MCC.SHM.FTEL.NAME  ,  MC.SHM( : , 1 )  )  &  ...
+        [ MC.SHM{ : , 2 } ]'  ==  'w'  )
+    
+    frametel ( 'o' , MCC.SHM.FTEL.NAME )
+  
+  else
+    
+    frametel ( 'o' )
+  
+  end % frame-timing telemetry
+  
   % Not really a buffer , but varies during the trial so we'll allocate it
   % here. The trial variable struct , is handed to the stimulation function
   % of ptb-type MET stimulus definitions.
@@ -727,6 +751,11 @@ function  runc ( MC , MCC , MAXBUF , PHOTOR , DEFSEED , DATFMT , ...
     % Initialise stimulus descriptor list
     sdl = stiminit ( tconst , D , ptb , td , sdl_c.( td.task ) ) ;
     
+    % Empty the frame-timing telemetry log , and allocate the per-frame
+    % stimulation function durations of each stimulus link
+    frametel (  'r'  ,  str2double ( tid )  ,  numel ( sdl )  )
+    drw = zeros ( 1 , numel ( sdl ) ) ;
+    
     % Compute start-of-trial check-sums
     chksum_start = chksums ( D , ptb , td , sdl ) ;
     
@@ -961,6 +990,9 @@ function  runc ( MC , MCC , MAXBUF , PHOTOR , DEFSEED , DATFMT , ...
       
       %-- Stimulus link stimulation --%
       
+      % No time yet spent in stimulation functions for this frame
+      drw( : ) = 0 ;
+      
       % Loop eye frame buffers
       for  e = EYEBUF
         
@@ -995,8 +1027,11 @@ function  runc ( MC , MCC , MAXBUF , PHOTOR , DEFSEED , DATFMT , ...
           % Assign variable parameter change list
           tvar.varpar = vpc{ j } ;
           
-          % Execute stimulation function
+          % Execute stimulation function , accumulate its duration over
+          % eye frame buffers
+          t0 = GetSecs ;
           [ sdl{ j } , hit ] = D( j ).stim ( sdl{ j } , tconst , tvar ) ;
+          drw( j ) = drw( j )  +  GetSecs  -  t0 ;
           
           % Hit region updated , raise flag and save new hit region list
           if  hit
@@ -1115,6 +1150,9 @@ function  runc ( MC , MCC , MAXBUF , PHOTOR , DEFSEED , DATFMT , ...
         
       end % check timestamp buffer
       
+      % Expected time of the next vertical blank , the flip's target
+      tgt = vbl  +  tconst.flipint ;
+      
       % Flip frame buffer to screen
       [  tbuf.VBLTimestamp{ tbuf.ib }( tbuf.i )  ,  ...
          tbuf.StimulusOnsetTime{ tbuf.ib }( tbuf.i )  ,  ...
@@ -1130,6 +1168,11 @@ function  runc ( MC , MCC , MAXBUF , PHOTOR , DEFSEED , DATFMT , ...
       % Check for skipped frame
       tvar.skip = 0  <  tbuf.Missed{ tbuf.ib }( tbuf.i ) ;
       
+      % Log frame timing and publish telemetry
+      frametel (  'a'  ,  tgt  ,  vbl  ,  stimon  ,  ...
+        tbuf.FlipTimestamp{ tbuf.ib }( tbuf.i )  ,  ...
+        tbuf.Missed{ tbuf.ib }( tbuf.i )  ,  drw  )
+      
       
     end % animation loop
     
@@ -1269,8 +1312,12 @@ function  runc ( MC , MCC , MAXBUF , PHOTOR , DEFSEED , DATFMT , ...
     end % timeout
     
     % mwait received , hence no trial will follow for a time. Reveal the
-    % timeout gui
-    if  mwait  ,  timgui.h.Visible = 'on' ;  end
+    % timeout gui. The session may now be closed , so wait for this trial's
+    % files to reach the disk , raising any write error for this trial.
+    if  mwait
+      timgui.h.Visible = 'on' ;
+      trialwr ( 'f' )
+    end
     
   end % trial loop
   
@@ -1873,6 +1920,16 @@ function  savedat ( MC , MCC , DATFMT , sd , tid , ...
   % time
   d.Beampos = uint32 ( d.Beampos ) ;
   
+  % Frame-timing telemetry log , one row per frame
+  ftel = frametel ( 'g' ) ;
+  C = MCC.SHM.FTEL.COLIND ;
+  
+  % Flip deadlines in microseconds from the start of the trial , and the
+  % time spent in each stimulus link's stimulation function in
+  % microseconds ; DrawTime has one column per link
+  d.FlipTarget = uint32 (  1e6  *  ( ftel( : , C.TARGET ) - trial_start )  );
+  d.DrawTime = uint32 (  1e6  *  ftel( : , C.LINK1 : end )  ) ;
+  
   % Find timeout type popup menu
   c = findobj ( h , 'Style' , 'popupmenu' , 'Tag' , 'type' ) ;
   
@@ -1880,8 +1937,11 @@ function  savedat ( MC , MCC , DATFMT , sd , tid , ...
   d.Timeout_type = c.String {  c.Value  } ;
   d.Timeout_secs = tout ;
   
-  % Save binary copy of the data
-  save (  [ f , '.mat' ]  ,  '-struct'  ,  'd'  )
+  % Save binary copy of the data to a staging file , the trial directory
+  % writer puts it in place
+  stg = trialwr (  's'  ,  [ f , '.mat' ]  ) ;
+  save (  stg  ,  '-struct'  ,  'd'  )
+  trialwr (  'w'  ,  stg  ,  [ f , '.mat' ]  )
   
   
   %-- ASCII data --%
@@ -1929,6 +1989,25 @@ function  savedat ( MC , MCC , DATFMT , sd , tid , ...
     
   end % concat buff
   
+  % Flip deadlines and stimulation function durations , one line per
+  % stimulus link for the latter
+  N = size ( d.DrawTime , 2 ) ;
+  F = [  { 'FlipTarget' }  ,  ...
+    arrayfun( @( j ) sprintf( 'DrawTime_%d' , j ) , 1 : N , ...
+      'UniformOutput' , false )  ] ;
+  C = [  { d.FlipTarget }  ,  num2cell( d.DrawTime , 1 )  ] ;
+  
+  for  i = 1 : numel ( F )
+    
+    % Drop leading comma
+    s = list2str (  C{ i }  ,  ',%d'  ) ;
+    C{ i } = [  F{ i }  ,  ': '  ,  s( 2 : end )  ] ;
+  
+  end % telemetry
+  
+  d.FlipTarget = C{ 1 } ;
+  d.DrawTime = strjoin (  [ { 'DrawTime:' } , C( 2 : end ) ]  ,  '\n'  ) ;
+  
   % Convert Timout type and duration
   d.Timeout_type = [ 'Timeout_type: ' , d.Timeout_type ] ;
   d.Timeout_secs = sprintf ( [ 'Timeout_secs: ' , MCC.FMT.TIME ] , tout ) ;
@@ -1937,7 +2016,9 @@ function  savedat ( MC , MCC , DATFMT , sd , tid , ...
   d = strjoin ( struct2cell( d ) , '\n' ) ;
   
   % Save ASCII file
-  metsavtxt (  [ f , '.txt' ]  ,  d  ,  'w'  ,  'metptb'  )
+  stg = trialwr (  's'  ,  [ f , '.txt' ]  ) ;
+  metsavtxt (  stg  ,  d  ,  'w'  ,  'metptb'  )
+  trialwr (  'w'  ,  stg  ,  [ f , '.txt' ]  )
   
   
 end % savedat
@@ -0,0 +1,298 @@
+
+function  X = metsessidx ( sdir , rebuild )
+% 
+% X = metsessidx ( sdir , rebuild )
+% 
+% Matlab Electrophysiology Toolbox session index. Scans the session
+% directory named by string sdir once and returns a compact index of all
+% its trials in struct X , for offline analysis. Use metsessload to pull
+% the data of selected trials. The index is cached in the session's store
+% directory , in the file named by MCC.STORE.INDEX , so that later calls
+% only scan trial directories that were added since. If scalar logical
+% rebuild is true then the cache is ignored and the whole session is
+% scanned again ; default false.
+% 
+% Trial directories are scanned in parallel with parfor , which runs on
+% the current pool of Matlab workers , if there is one. Each trial's
+% descriptor is read from its param_<trial_id>.mat file. Outcomes come
+% from the 'metsigs' stream of the session store , if the session has
+% one , and otherwise from each trial's metsigs_<trial_id>.mat file.
+% 
+% X has the following fields , with one row per trial in the order of
+% trial identifiers:
+% 
+%   .session_dir - String , sdir.
+%   .tid - Double column vector of trial identifiers.
+%   .outcome - Double column vector of MET outcome codes , see MC.OUT. 0
+%     if the trial has no mstop signal , yet.
+%   .time - Double matrix with two columns , the times of the mstart and
+%     mstop signals. NaN if the signal is missing.
+%   .block_id - Double column vector of block identifiers.
+%   .block_name , .task , .logic - Cell column vectors of strings from the
+%     trial descriptors.
+%   .var - Cell column vector of structs , the task variable values of
+%     each trial i.e. trial descriptor field .var.
+%   .stream - Struct with one field per stream in the session store. Each
+%     is a double matrix with two columns , giving the first row of the
+%     trial in the whole stream and the number of rows that it has. Both
+%     are 0 if the trial is not in the stream. This is not cached , but
+%     read from the stream index files in every call.
+% 
+% Trials without an outcome may still be running. They are scanned again
+% on every call.
+% 
+% NOTE: Looks for global constants MC and MCC naming the MET constants and
+%   MET controller constants. If not found, then they are initialised ; the
+%   MET constants with compile-time constants only.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
+  
+  
+  %%% Global constants %%%
+  
+  % MET constants , MET controller constants
+  global  MC  MCC
+  
+  % If these haven't been set yet then set them. Note , only compile-time
+  % MET constants asked for if not already declared.
+  if  isempty (  MC )  ,   MC = met ( 'const' , 1 ) ;  end
+  if  isempty ( MCC )  ,  MCC = metctrlconst    ;  end
+  
+  % Per-trial fields of the index
+  FIELDS = { 'tid' , 'outcome' , 'time' , 'block_id' , 'block_name' , ...
+    'task' , 'logic' , 'var' } ;
+  
+  % Constants that parfor workers need , as they can't see globals
+  C.TRIAL = MC.SESS.TRIAL ;
+  C.TDNAMS = MCC.TDNAMS ;
+  C.MSIGS = 'metsigs_%d.mat' ;
+  C.MSTART = MCC.MSID.mstart ;
+  C.MSTOP = MCC.MSID.mstop ;
+  
+  
+  %%% Check input %%%
+  
+  % rebuild not given , use default
+  if  nargin  <  2  ,  rebuild = false ;  end
+  
+  % sdir names an existing directory
+  if  ~ isvector ( sdir )  ||  ~ ischar ( sdir )  ||  ...
+      ~ exist ( sdir , 'dir' )
+  
+    error ( 'MET:metsessidx:sdir' , [ 'metsessidx: sdir does not ' , ...
+      'name an existing directory' ] )
+  
+  % rebuild is scalar logical
+  elseif  ~ isscalar ( rebuild )  ||  ~ islogical ( rebuild )
+  
+    error ( 'MET:metsessidx:rebuild' , ...
+      'metsessidx: rebuild is not scalar logical' )
+  
+  end % check input
+  
+  
+  %%% Cached index %%%
+  
+  % Store directory and cache file
+  d = fullfile (  sdir  ,  MC.SESS.STORE  ) ;
+  c = fullfile (  d  ,  MCC.STORE.INDEX  ) ;
+  
+  % Empty index , one field per trial column
+  X = [  FIELDS  ;  cell( size ( FIELDS ) )  ] ;
+  X = struct (  X { : }  ) ;
+  X.tid = zeros ( 0 , 1 ) ;  X.outcome = zeros ( 0 , 1 ) ;
+  X.time = zeros ( 0 , 2 ) ;  X.block_id = zeros ( 0 , 1 ) ;
+  X.block_name = cell ( 0 , 1 ) ;  X.task = cell ( 0 , 1 ) ;
+  X.logic = cell ( 0 , 1 ) ;  X.var = cell ( 0 , 1 ) ;
+  
+  % Load the cache , unless asked not to
+  if  ~ rebuild  &&  exist ( c , 'file' )
+    r = load (  c  ,  'X'  ) ;
+    X = r.X ;
+  end
+  
+  % Drop trials without an outcome , so that they are scanned again
+  X = subidx (  X  ,  X.outcome  ~=  0  ,  FIELDS  ) ;
+  
+  
+  %%% Scan new trials %%%
+  
+  % Trial directories are named by their trial identifier
+  t = dir (  fullfile ( sdir , MC.SESS.TRIAL )  ) ;
+  t = str2double (  { t( [ t.isdir ] ).name }  ) ;
+  
+  % Trials that are not in the index
+  t = setdiff (  t( ~ isnan ( t ) )  ,  X.tid  ) ;
+  t = t( : ) ;
+  
+  % Outcomes come from the store if it has MET signals
+  fsig = fullfile (  d  ,  'metsigs'  ) ;
+  sflg = exist (  [ fsig , '.mcs' ]  ,  'file'  ) ;
+  
+  % Scan each new trial directory , in parallel
+  Y = cell (  numel ( t )  ,  1  ) ;
+  
+  parfor  i = 1 : numel ( t )
+    Y{ i } = scantrial (  sdir  ,  t( i )  ,  ~ sflg  ,  C  ) ;
+  end
+  
+  % Concatenate new trials
+  Y = [  Y{ : }  ] ;
+  
+  if  ~ isempty ( Y )
+  
+    % Trial columns
+    Y = struct (  'tid' , t , 'outcome' , [ Y.outcome ]' , ...
+      'time' , reshape( [ Y.time ] , 2 , [] )' , ...
+      'block_id' , [ Y.block_id ]' , ...
+      'block_name' , { { Y.block_name }' } , 'task' , { { Y.task }' } , ...
+      'logic' , { { Y.logic }' } , 'var' , { { Y.var }' }  ) ;
+  
+    % Outcomes and times from the store , in one read
+    if  sflg
+      [ S , T ] = sesstore (  'r'  ,  fsig  ,  t( [ 1 , end ] )  ) ;
+      [ Y.outcome , Y.time ] = sigout (  S  ,  T  ,  t  ,  C  ) ;
+    end
+  
+    % Add to index , in order of trial identifier
+    for  F = FIELDS
+      X.( F{ 1 } ) = [  X.( F{ 1 } )  ;  Y.( F{ 1 } )  ] ;
+    end
+  
+    [ ~ , i ] = sort ( X.tid ) ;
+    X = subidx (  X  ,  i  ,  FIELDS  ) ;
+  
+    % Cache trials with outcomes. Warn only , the index is still good.
+    try
+  
+      if  ~ exist ( d , 'dir' )  ,  mkdir ( d ) ;  end
+      save (  c  ,  'X'  )
+  
+    catch  E
+  
+      warning ( 'MET:metsessidx:cache' , ...
+        'metsessidx: failed to cache index in %s , %s' , c , E.message )
+  
+    end
+  
+  end % new trials
+  
+  
+  %%% Streams %%%
+  
+  X.session_dir = sdir ;
+  X.stream = struct ;
+  
+  % Every stream in the store
+  s = dir (  fullfile ( d , '*.mcs' )  ) ;
+  
+  for  i = 1 : numel ( s )
+  
+    % Stream name and index of trials
+    [ ~ , n ] = fileparts ( s( i ).name ) ;
+    T = sesstore (  'i'  ,  fullfile ( d , n )  ) ;
+  
+    % First row of each trial in the whole stream
+    o = cumsum (  [ 1 ; T( : , 2 ) ]  ) ;
+  
+    % Locate indexed trials in the stream
+    [ j , k ] = ismember (  X.tid  ,  T( : , 1 )  ) ;
+  
+    X.stream.( n ) = zeros (  numel ( X.tid )  ,  2  ) ;
+    X.stream.( n )( j , : ) = [  o( k( j ) )  ,  T( k( j ) , 2 )  ] ;
+  
+  end % streams
+  
+  
+end % metsessidx
+
+
+%%% Subroutines %%%
+
+% Keep rows i of each trial column F of index X
+function  X = subidx (  X  ,  i  ,  F  )
+  
+  for  F = F  ,  f = F{ 1 } ;  X.( f ) = X.( f )( i , : ) ;  end
+  
+end % subidx
+
+
+% Reads the trial descriptor and , if sflg is true , the MET signals of
+% trial t in session directory sdir
+function  Y = scantrial (  sdir  ,  t  ,  sflg  ,  C  )
+  
+  % Trial directory
+  tids = num2str ( t ) ;
+  d = fullfile (  sdir  ,  C.TRIAL  ,  tids  ) ;
+  
+  % Trial descriptor
+  f = fullfile (  d  ,  sprintf ( C.TDNAMS , tids )  ) ;
+  
+  if  exist ( f , 'file' )
+    r = load (  f  ,  'td'  ) ;
+    td = r.td ;
+  else
+    td = struct (  'block_id' , NaN , 'block_name' , '' , 'task' , '' , ...
+      'logic' , '' , 'var' , struct  ) ;
+  end
+  
+  Y.block_id = td.block_id ;
+  Y.block_name = td.block_name ;
+  Y.task = td.task ;
+  Y.logic = td.logic ;
+  Y.var = td.var ;
+  
+  % No outcome , yet
+  Y.outcome = 0 ;
+  Y.time = [ NaN , NaN ] ;
+  
+  % MET signals from trial directory
+  f = fullfile (  d  ,  sprintf ( C.MSIGS , t )  ) ;
+  
+  if  sflg  &&  exist ( f , 'file' )
+    S = load (  f  ,  'sig'  ,  'crg'  ,  'tim'  ) ;
+    [ Y.outcome , Y.time ] = sigout (  S  ,  [ t , numel( S.sig ) ]  ,  ...
+      t  ,  C  ) ;
+  end
+  
+end % scantrial
+
+
+% Finds the outcome of each trial t , along with the times of its mstart
+% and mstop signals , from MET signals S that were read with trial index T
+function  [ out , tim ] = sigout (  S  ,  T  ,  t  ,  C  )
+  
+  % Default , no outcome
+  out = zeros (  numel ( t )  ,  1  ) ;
+  tim = nan (  numel ( t )  ,  2  ) ;
+  
+  % Last row of each trial in S
+  r = cumsum (  T( : , 2 )  ) ;
+  
+  for  i = 1 : size ( T , 1 )
+  
+    % Trial in output
+    j = find (  t  ==  T( i , 1 )  ,  1  ) ;
+    if  isempty ( j )  ,  continue  ,  end
+  
+    % Signals of the trial
+    k = r( i ) - T( i , 2 ) + 1 : r( i ) ;
+    sig = S.sig( k ) ;
+  
+    % mstart time
+    m = find (  sig  ==  C.MSTART  ,  1  ,  'first'  ) ;
+    if  ~ isempty ( m )  ,  tim( j , 1 ) = S.tim( k( m ) ) ;  end
+  
+    % mstop outcome and time
+    m = find (  sig  ==  C.MSTOP  ,  1  ,  'last'  ) ;
+  
+    if  ~ isempty ( m )
+      out( j ) = S.crg( k( m ) ) ;
+      tim( j , 2 ) = S.tim( k( m ) ) ;
+    end
+  
+  end % trials
+  
+end % sigout
+
@@ -0,0 +1,224 @@
+
+function  D = metsessload ( X , tid , name )
+% 
+% D = metsessload ( X , tid , name )
+% 
+% Matlab Electrophysiology Toolbox session loader. Loads the data of
+% selected trials from a session , for offline analysis. X is the session
+% index returned by metsessidx. tid is a numeric vector of trial
+% identifiers. name is a string or cell array of strings naming streams of
+% the session store , such as 'metsigs' , 'eye' , or 'nspevents'.
+% 
+% D is a struct array with one element per trial in tid , and the same
+% shape. D( i ).tid is tid( i ). For each stream there is a field of the
+% same name ; D( i ).( name ) is a struct with one field per column of the
+% stream , holding the rows of trial tid( i ). It is [] if the trial is not
+% in the stream.
+% 
+% Streams are loaded in parallel with parfor , which runs on the current
+% pool of Matlab workers , if there is one. Each stream is read from the
+% session store , with one sesstore call per run of consecutive trials in
+% the index. Sessions without a store , or without the named stream , are
+% read from the trial directories instead ; in parallel across trials. This
+% is only possible for 'metsigs' , 'eye' , 'pupil' , 'mouse' , and
+% 'nspevents' , whose trial directory files are converted into the
+% columns of the stream.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
+  
+  
+  %%% Global constants %%%
+  
+  % MET constants
+  global  MC
+  
+  % Only compile-time MET constants asked for if not already declared
+  if  isempty (  MC )  ,   MC = met ( 'const' , 1 ) ;  end
+  
+  % Constants that parfor workers need , as they can't see globals
+  C.TRIAL = MC.SESS.TRIAL ;
+  C.STORE = MC.SESS.STORE ;
+  
+  
+  %%% Check input %%%
+  
+  % Single stream name
+  if  ischar ( name )  ,  name = { name } ;  end
+  
+  % X is a session index
+  if  ~ isstruct ( X )  ||  ~ isscalar ( X )  ||  ...
+      ~ all ( isfield(  X  ,  { 'session_dir' , 'tid' , 'stream' }  ) )
+  
+    error ( 'MET:metsessload:X' , ...
+      'metsessload: X is not a session index from metsessidx' )
+  
+  % tid is numeric
+  elseif  ~ isnumeric ( tid )  ||  ~ isreal ( tid )
+  
+    error ( 'MET:metsessload:tid' , ...
+      'metsessload: tid is not a real numeric array' )
+  
+  % name is a cell array of strings
+  elseif  ~ iscellstr ( name )
+  
+    error ( 'MET:metsessload:name' , ...
+      'metsessload: name is not a string or cell array of strings' )
+  
+  end % check input
+  
+  
+  %%% Load streams %%%
+  
+  % Trial identifiers as doubles
+  tid = double ( tid ) ;
+  
+  % Streams that are in the store
+  s = isfield (  X.stream  ,  name  ) ;
+  
+  % One cell per stream , each with one cell per trial
+  L = cell ( size(  name  ) ) ;
+  
+  parfor  i = 1 : numel ( name )
+  
+    if  s( i )
+      L{ i } = ldstore (  X  ,  tid  ,  name{ i }  ,  C  ) ;
+    else
+      L{ i } = ldtrial (  X  ,  tid  ,  name{ i }  ,  C  ) ;
+    end
+  
+  end % streams
+  
+  % Output struct , one element per trial
+  D = struct (  'tid'  ,  num2cell ( tid )  ) ;
+  
+  % Set trial data of each stream
+  for  i = 1 : numel ( name )
+    [ D.( name{ i } ) ] = L{ i }{ : } ;
+  end
+  
+  
+end % metsessload
+
+
+%%% Subroutines %%%
+
+% Reads the trials in tid from stream n of the session store. Returns a
+% cell array with one trial's columns per element.
+function  L = ldstore (  X  ,  tid  ,  n  ,  C  )
+  
+  % Stream files
+  f = fullfile (  X.session_dir  ,  C.STORE  ,  n  ) ;
+  
+  % Output , unfilled trials are empty
+  L = cell (  numel ( tid )  ,  1  ) ;
+  
+  % Index rows of trials that are in the stream , in index order
+  [ i , j ] = ismember (  tid( : )  ,  X.tid  ) ;
+  i( i ) = X.stream.( n )( j( i ) , 2 )  >  0 ;
+  r = unique (  j( i )  ) ;
+  
+  if  isempty ( r )  ,  return  ,  end
+  
+  % Runs of consecutive index rows , the first and last row of each
+  e = [  0  ;  find( diff ( r ) > 1 )  ;  numel( r )  ] ;
+  
+  for  k = 1 : numel ( e ) - 1
+  
+    % One read for the whole run
+    [ S , T ] = sesstore (  'r'  ,  f  ,  ...
+      X.tid( r( [ e( k ) + 1 , e( k + 1 ) ] ) )  ) ;
+  
+    % Split columns by trial
+    S = splitcol (  S  ,  T( : , 2 )  ) ;
+  
+    % Give each requested trial its columns
+    [ a , b ] = ismember (  tid( : )  ,  T( : , 1 )  ) ;
+    L( a ) = S( b( a ) ) ;
+  
+  end % runs
+  
+end % ldstore
+
+
+% Split each column of S into a struct per trial , with n( i ) rows for
+% the ith trial. Returns a cell array of structs.
+function  L = splitcol (  S  ,  n  )
+  
+  % Column names
+  F = fieldnames ( S ) ;
+  
+  % One cell per trial and column
+  L = cell (  numel ( n )  ,  numel ( F )  ) ;
+  
+  for  i = 1 : numel ( F )
+    c = S.( F{ i } ) ;
+    L( : , i ) = mat2cell (  c  ,  n  ,  size ( c , 2 )  ) ;
+  end
+  
+  % Make structs
+  L = cellfun (  @( c ) cell2struct ( c' , F , 1 )  ,  ...
+    num2cell ( L , 2 )  ,  'UniformOutput'  ,  false  ) ;
+  
+end % splitcol
+
+
+% Reads the trials in tid of stream n from the trial directories ,
+% converting each file's variables into the stream's columns
+function  L = ldtrial (  X  ,  tid  ,  n  ,  C  )
+  
+  % Trial directory file name format and variable to load
+  switch  n
+    case  'metsigs'  ,  f = 'metsigs_%d.mat' ;  v = {} ;
+    case  { 'eye' , 'pupil' , 'mouse' }  ,  f = 'eyepos_%d.mat' ;  v = { n };
+    case  'nspevents'  ,  f = 'nspevents_%d.mat' ;  v = { 'data' } ;
+    otherwise
+      error ( 'MET:metsessload:name' , [ 'metsessload: no stream ' , ...
+        '''%s'' in the session store of %s' ] , n , X.session_dir )
+  end
+  
+  % Output , unfilled trials are empty
+  L = cell (  numel ( tid )  ,  1  ) ;
+  
+  parfor  i = 1 : numel ( tid )
+  
+    % File with full path
+    p = fullfile (  X.session_dir  ,  C.TRIAL  ,  num2str ( tid( i ) )  ,...
+      sprintf ( f , tid( i ) )  ) ;
+  
+    % Trial has no such file
+    if  ~ exist ( p , 'file' )  ,  continue  ,  end
+  
+    % Load and convert
+    d = load (  p  ,  v{ : }  ) ;
+  
+    switch  n
+      case  'metsigs'  ,  L{ i } = d ;
+      case  { 'eye' , 'pupil' , 'mouse' }  ,  L{ i } = d.( n ) ;
+      case  'nspevents'  ,  L{ i } = nspcol ( d.data ) ;
+    end
+  
+  end % trials
+  
+end % ldtrial
+
+
+% Converts the cell array of NSP event times from a trial directory into
+% the columns of the 'nspevents' stream. Rows of the cell array are
+% channels and columns are units.
+function  S = nspcol ( data )
+  
+  % Channel and unit of each cell with data
+  [ c , u ] = find (  ~ cellfun ( @isempty , data )  ) ;
+  d = data(  sub2ind ( size ( data ) , c , u )  ) ;
+  
+  % Number of events in each
+  n = cellfun (  @numel  ,  d  ) ;
+  d = cellfun (  @( d ) d( : )  ,  d  ,  'UniformOutput'  ,  false  ) ;
+  
+  S = struct (  'chan' , uint16 ( repelem( c , n ) ) , ...
+    'unit' , uint16 ( repelem( u , n ) ) , ...
+    'time' , uint32 ( vertcat( zeros( 0 , 1 ) , d{ : } ) )  ) ;
+  
+end % nspcol
+
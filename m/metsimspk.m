@@ -22,13 +22,15 @@ function  metsimspk ( MC )
 % rate whenever a named task stimulus is being presented (see task logic
 % files for names).
 % 
-% Spike trains are freshly generated for each trial by sampling spike times
-% from a Poisson distribution, and then excluding any spikes that fall
-% within a 2ms refractory period. The spike train is then convolved with a
-% kernel to produce a continuous signal. The kernel is a 1 ms pulse from a
-% 1000Hz sinusoid ; in other words, an action-potential-like waveform is
-% used. The continuous signal is then generated by playing it out through
-% the audio device.
+% Spike trains are synthesised while the trial runs by the spksynth MEX
+% function, one short chunk at a time, and streamed to the audio device.
+% Spike times are a Poisson process in which no spike can fall within the
+% refractory period of the last one. A kernel is added to the signal at
+% each spike time to produce a continuous signal. The kernel is a 1 ms
+% pulse from a 1000Hz sinusoid ; in other words, an action-potential-like
+% waveform is used. The audio device is kept a few chunks ahead of
+% playback, so a change of firing rate is heard within a few chunk
+% durations.
 %
 % metsimspk.csv is a MET csv parameter file that provides the name of the
 % scheduled task variable, the name of a task stimulus, and various spiking
@@ -49,8 +51,11 @@ function  metsimspk ( MC )
 %   baseline - Baseline firing rate , in Hz
 %   maxtest - Maximum possible firing rate , in Hz
 %   refract - The refractory period duration , in seconds
-%   basedur - Duration of baseline signal to create per trial , in seconds
-%   testdur - Duration of test signal to create per trial , in seconds
+%   chunkdur - Optional. Duration of each chunk of signal that is
+%     streamed to the audio device , in seconds. Default 0.02.
+% 
+% Parameters basedur and testdur of older versions are no longer used.
+% They may stay in metsimspk.csv , where they are ignored.
 % 
 % Example metsimspk.csv:
 % 
@@ -64,8 +69,7 @@ function  metsimspk ( MC )
 %     baseline,10
 %     maxtest,150
 %     refract,0.002
-%     basedur,10
-%     testdur,5
+%     chunkdur,0.02
 % 
 % Written by Jackson Smith - July 2017 - DPAG , University of Oxford
 % 
@@ -78,8 +82,7 @@ function  metsimspk ( MC )
   
   % List of required parameter names
   PARNAM = { 'taskvar' , 'tvnorm' , 'taskstim' , 'faudio' , ...
-    'kernwidth' , 'kernfreq' , 'baseline' , 'maxtest' , 'refract' , ...
-    'basedur' , 'testdur' } ;
+    'kernwidth' , 'kernfreq' , 'baseline' , 'maxtest' , 'refract' } ;
   
   % First numeric parameter's index , in PARNAM
   INUM = 4 ;
@@ -123,6 +126,27 @@ function  metsimspk ( MC )
     
   end % check non-zero numbers
   
+  % Optional chunk duration , 20ms by default
+  if  isfield ( p , 'chunkdur' )
+    
+    if  ischar ( p.chunkdur )
+      p.chunkdur = str2double ( p.chunkdur ) ;
+    end
+    
+    if  ~ isscalar ( p.chunkdur )  ||  ~ isreal ( p.chunkdur )  ||  ...
+        ~ ( 0 < p.chunkdur  &&  p.chunkdur < Inf )
+      
+      error (  'MET:metsimspk:chunkdur'  ,  ...
+        'metsimspk: chunkdur must be a real number over zero'  )
+      
+    end
+    
+  else
+    
+    p.chunkdur = 0.02 ;
+    
+  end % chunk duration
+  
   
   %%% Build kernel %%%
   
@@ -141,11 +165,11 @@ function  metsimspk ( MC )
   % Open master sound device 9 = 1 + 8 , playback plus master device
   mpa = PsychPortAudio ( 'open' , [] , 9 , [] , p.faudio ) ;
 
-  % Now open slave devices, one per firing rate. Order of elements is
-  % [ baseline spike rate , test spike rate ]. This convention holds with
-  % runc variables.
-  spa = [  PsychPortAudio( 'OpenSlave' , mpa )  ,  ...
-           PsychPortAudio( 'OpenSlave' , mpa )  ] ;
+  % Now open slave device that plays the spike train
+  spa = PsychPortAudio ( 'OpenSlave' , mpa ) ;
+  
+  % Give kernel and refractory period to spike train synthesiser
+  spksynth ( 'o' , p.faudio , k , p.refract ) ;
          
 	% Start master playback
   PsychPortAudio (  'Start'  ,  mpa  ,  0  ,  0  ,  1  ) ;
@@ -162,7 +186,7 @@ function  metsimspk ( MC )
   % Catch any errors raised during operation
   try
     
-    runc ( MC , p , k , spa )
+    runc ( MC , p , spa )
     
   catch  E
   end
@@ -185,8 +209,8 @@ end % metsimspk
 
 
 % Runs the controller. Received MET compile-time constants, controller .csv
-% parameters, kernel vector, and slave Port Audio device handles.
-function  runc ( MC , p , k , spa )
+% parameters, and slave Port Audio device handle.
+function  runc ( MC , p , spa )
   
   
   %%% Constants %%%
@@ -200,15 +224,18 @@ function  runc ( MC , p , k , spa )
   % Blocking on MET signalling i.e. wait for operation
   WAIT_FOR_SIG = 1 ;
   
+  % Number of chunks to keep in the audio buffer ahead of playback
+  NBUF = 2 ;
+  
   
   %%% Variables %%%
   
-  % Spike rates [ baseline , test ]. Baseline computed once. Test computed
-  % each trial.
-  r = [  p.baseline / p.faudio  ,  0  ] ;
+  % Spike rates in Hz [ baseline , test ]. Baseline computed once. Test
+  % computed each trial.
+  r = [  p.baseline  ,  0  ] ;
   
-  % Number of samples 
-  n = ceil (  [  p.basedur  ,  p.testdur  ]  *  p.faudio  ) ;
+  % Number of samples per chunk
+  n = ceil (  p.chunkdur  *  p.faudio  ) ;
   
   
   %%% Complete MET initialisation %%%
@@ -272,48 +299,25 @@ function  runc ( MC , p , k , spa )
     % maximum test firing rate
     w = getweight ( p , sd , td , c ) ;
     
-    % Calculate test firing rate per sample
-    r( 2 ) = p.maxtest  *  w  /  p.faudio ;
-    
-    
-    %-- Simulate fresh spike trains --%
-    
-    % Loop slave audio devices: baseline , test
-    for  i = 1 : numel ( spa )
-      
-      % Making test spike train but task stimulus unavailable , skip
-      if  i == 2  &&  ~ w  ,  continue  ,  end
-      
-      % Generate binary spike train
-      x = rand ( 1 , n( i ) )  <  r( i ) ;
-      
-      % Remove spikes in refractory period. First, get spike times
-      t = find ( x )  *  p.faudio ;
-      
-      % Now find spikes that are in a refractory period
-      j = find ( diff( t )  <=  p.refract )  +  1 ;
-      
-      % Remove refractory spikes
-      x( j ) = 0 ;
-      
-      % Convolve binary spike train to a waveform
-      x = conv (  single ( x )  ,  k  ) ;
-      
-      % Normalise by absolute maximum , scales range from -1 to +1
-      x = x  /  max ( abs(  x  ) ) ;
-      
-      % Add to sound buffer
-      PsychPortAudio (  'FillBuffer'  ,  spa( i )  ,  [ x ; x ]  ) ;
-      
-    end % slave audio devices
+    % Calculate test firing rate
+    r( 2 ) = p.maxtest  *  w ;
     
     
     %-- Final initialisation --%
     
     % Test rate flag , non-zero when test firing rate is in use. Zero for
     % baseline. Initialise based on whether named task stimulus is present
-    % in the start state.
-    tstflg = any ( sd.logic.( td.logic ).istate.start  ==  s ) ;
+    % in the start state , and available.
+    tstflg = w  &&  any ( sd.logic.( td.logic ).istate.start  ==  s ) ;
+    
+    % Reset spike train synthesiser for a new trial , at the initial rate
+    spksynth ( 'r' ) ;
+    spksynth ( 'f' , r( tstflg + 1 ) ) ;
+    
+    % Fill the audio buffer with the start of the spike train. nw counts
+    % the number of samples written to the buffer.
+    nw = NBUF  *  n ;
+    PsychPortAudio (  'FillBuffer'  ,  spa  ,  spksynth ( 'g' , nw )  ) ;
     
     
     %-- Synchronise start of trial with MET --%
@@ -322,7 +326,7 @@ function  runc ( MC , p , k , spa )
     met ( 'send' , MSID.mready , MC.MREADY.REPLY , [] , WAIT_FOR_SIG ) ;
     
     % Wait for start of trial MET signal mstart
-    while  ~ any ( i )
+    while  true
       
       % Block on the broadcast pipe
       [ ~ , ~ , sig ] = met (  'recv'  ,  WAIT_FOR_SIG  ) ;
@@ -342,8 +346,9 @@ function  runc ( MC , p , k , spa )
       
     end % mstart
     
-    % Start spike train playback
-    PsychPortAudio (  'Start'  ,  spa ( tstflg + 1 )  ,  0  ) ;
+    % Start spike train playback , played once while new chunks are
+    % appended to the buffer
+    PsychPortAudio (  'Start'  ,  spa  ,  1  ) ;
     
     
     %-- Trial event loop --%
@@ -351,10 +356,23 @@ function  runc ( MC , p , k , spa )
     while  true
       
       
+      %-- Stream spike train --%
+      
+      % Append new chunks until the audio buffer holds at least NBUF chunks
+      % that have not yet been played
+      ps = PsychPortAudio (  'GetStatus'  ,  spa  ) ;
+      
+      while  nw  -  ps.ElapsedOutSamples  <  NBUF  *  n
+        PsychPortAudio ( 'FillBuffer' , spa , spksynth ( 'g' , n ) , 1 ) ;
+        nw = nw  +  n ;
+      end
+      
+      
       %-- Signal handling --%
       
-      % Wait for MET signals , block on the broadcast pipe
-      [ i , ~ , sig , crg ] = met (  'recv'  ,  WAIT_FOR_SIG  ) ;
+      % Wait up to one chunk for MET signals , then read without blocking
+      met (  'select'  ,  p.chunkdur  ) ;
+      [ i , ~ , sig , crg ] = met (  'recv'  ) ;
       
       % Signals received
       if  i
@@ -388,6 +406,11 @@ function  runc ( MC , p , k , spa )
         % No change of state , wait for new MET signals
         if  isempty (  i  )  ,  continue  ,  end
         
+      % No signals , keep streaming
+      else
+        
+        continue
+      
       end % signal handling
       
       
@@ -407,15 +430,12 @@ function  runc ( MC , p , k , spa )
         
       end % no change required
       
-      % The firing rate must changed. Stop the current firing rate.
-      PsychPortAudio (  'Stop'  ,  spa ( tstflg + 1 )  ) ;
-      
-      % Switch flag state to signal the other firing rate
+      % The firing rate must changed. Switch flag state to signal the other
+      % firing rate.
       tstflg = ~ tstflg ;
       
-      % And start playing the other firing rate
-      PsychPortAudio ( 'Start' , ...
-        spa( tstflg + 1 ) , 0 , [] , [] , [] , 1 ) ;
+      % And synthesise the rest of the spike train at the other firing rate
+      spksynth (  'f'  ,  r( tstflg + 1 )  ) ;
       
     end % trial event loop
     
@@ -423,7 +443,7 @@ function  runc ( MC , p , k , spa )
     %-- End of trial --%
     
     % Stop audio output
-    PsychPortAudio (  'Stop'  ,  spa ( tstflg + 1 )  ) ;
+    PsychPortAudio (  'Stop'  ,  spa  ) ;
     
     
   end % trial loop
@@ -0,0 +1,49 @@
+
+function  metstore ( sd , name , tid , S )
+% 
+% metstore ( sd , name , tid , S )
+% 
+% Matlab Electrophysiology Toolbox session store. Appends the data of
+% trial tid to the stream called name in the store directory of the
+% session with descriptor sd. tid is a scalar double or a string. S is a
+% scalar struct with one field per column of the stream , each a 2D
+% numeric , logical , or char matrix with the same number of rows. The
+% first trial that is appended sets the class and number of matrix columns
+% of each field ; the rest must match. The store directory is made if the
+% session does not yet have one. Use sesstore ( 'r' , f , tid ) to read
+% trials back , where f is fullfile ( sd.session_dir , MC.SESS.STORE ,
+% name ).
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
+  
+  
+  %%% Global constants %%%
+  
+  global  MC
+  
+  
+  %%% Append trial %%%
+  
+  % Trial identifier as a number
+  if  ischar ( tid )  ,  tid = str2double ( tid ) ;  end
+  
+  % Store directory
+  d = fullfile (  sd.session_dir  ,  MC.SESS.STORE  ) ;
+  
+  % Sessions made before the store was introduced have no such directory
+  if  ~ exist ( d , 'dir' )
+  
+    [ i , msg ] = mkdir ( d ) ;
+  
+    if  ~ i
+      error ( 'MET:metstore:mkdir' , 'metstore: mkdir , %s' , msg )
+    end
+  
+  end
+  
+  % Append to the stream
+  sesstore (  'a'  ,  fullfile ( d , name )  ,  tid  ,  S  )
+  
+  
+end % metstore
@@ -20,7 +20,10 @@ function  mettarget ( MC_in )
 % duration). A simple blink filter is applied to eye positions, allowing no
 % more than 200 ms of invalid samples before the controller sends a mtarget
 % signal with 'none' for cargo i.e. it reports that nothing on screen is
-% being targeted.
+% being targeted. The thresholds are applied to every new eye sample by the
+% eyefilt MEX function, which keeps its state between reads of 'eye' shared
+% memory. The blink filter is part of the seltarg MEX function, a state
+% machine that turns the stimulus hit by each sample into mtarget signals.
 % 
 % Shared memory 'stim' and 'eye' must be readable. Positions received
 % through eye shared memory must be in degrees of visual stimulus in a
@@ -33,7 +36,10 @@ function  mettarget ( MC_in )
 % stimulus links should come over stim shm. That is, after receiving an
 % mready trigger but before receiving mstart. mettarget will only send an
 % mready reply after it has received the initialising hit-regions. mstate
-% events are used to determine which stimuli are currently visible.
+% events are used to determine which stimuli are currently visible. Hit
+% regions are kept in a spatial index by the hitgrid MEX function, which
+% finds the targeted stimulus. A hit region is ignored if its ignore column
+% is zero, for either eye.
 % 
 % NOTE: If iViewX is the eye-tracking program, then make sure that
 % out-of-range behaviour is set to clipping. That way, when the eyes are
@@ -46,7 +52,9 @@ function  mettarget ( MC_in )
 % threshold in degrees per second, and ACCTHR is the acceleration threshold
 % in degrees per second-squared. THRMUL is a scaling term that is
 % multiplied into both thresholds, for convenience. FBLINK is the duration
-% of the blink filter in seconds.
+% of the blink filter in seconds. Optional parameter DWELL is the number of
+% seconds that a new stimulus must be targeted for before it is selected ;
+% zero if not given, in which case the selection changes at once.
 %
 %   Example:
 % 
@@ -55,6 +63,7 @@ function  mettarget ( MC_in )
 %   VELTHR,30
 %   ACCTHR,8000
 %   FBLINK,0.2
+%   DWELL,0
 % 
 % Written by Jackson Smith - Feb 2017 - DPAG , University of Oxford
 % 
@@ -102,7 +111,7 @@ function  mettarget ( MC_in )
   % Eye velocity and acceleration thresholds , in degrees per second and
   % degrees per second-squared. Eye positions that exceed these thresholds
   % are not reported. Blink filter maximum blink duration in seconds.
-  [ VELTHR , ACCTHR , FBLINK ] = readpar ;
+  [ VELTHR , ACCTHR , FBLINK , DWELL ] = readpar ;
   
   % Eye sampling rate
   EYESHZ = MCC.SHM.EYE.SHZ ;
@@ -117,7 +126,7 @@ function  mettarget ( MC_in )
   % List of variable names to clear before running controller
   CLRVAR = { 'INDEV' , 'METSHM' , 'SHMERR' , 'MPOLLR' , ...
     'STMSCR' , 'SCRHOR' , 'SCRVER' , 'VELTHR' , 'ACCTHR' , 'EYESHZ' , ...
-    'PIXDEG' , 'FBLINK' , 'CLRVAR' } ;
+    'PIXDEG' , 'FBLINK' , 'DWELL' , 'CLRVAR' } ;
   
   
   %%% Environment check %%%
@@ -139,17 +148,6 @@ function  mettarget ( MC_in )
   end % shm read access
   
   
-  %%% Blink filter %%%
-  
-  % Bundle together into a struct. maxdur is the maximum duration in
-  % seconds that a blink is allowed to take. If this is set to zero
-  % then no blink filter is used ; this is done if the touchscreen/mouse is
-  % the main input device. flag is raised when a putative blink has been
-  % detected, and time is approximately when. Note, flag is down if there
-  % is no blink going on , flag is up if a blink is occurring.
-  fblink = struct ( 'maxdur' , FBLINK , 'flag' , false , 'time' , 0 ) ;
-  
-  
   %%% Input device %%%
   
   % Set input device function and descriptor
@@ -158,9 +156,6 @@ function  mettarget ( MC_in )
     % Mouse
     case  'm'  ,  indevf = @indev_mouse ;
       
-      % Turn off the blink filter
-      fblink.maxdur = 0 ;
-      
       % Mouse input device descriptor contains constants for converting the
       % mouse position unit from pixels to visual degrees from the centre
       % of the stimulation screen
@@ -168,34 +163,32 @@ function  mettarget ( MC_in )
                        'XL'  ,  MCC.SHM.EYE.COLIND.XLEFT  ,  ...
                        'YL'  ,  MCC.SHM.EYE.COLIND.YLEFT  ) ;
       
+      % Selection state machine , there is no blink filter so the mouse is
+      % never lost
+      seltarg ( 'o' , MSID.mtarget , MCC.SDEF.none , DWELL , 0 )
+      
       met ( 'printf' , 'mettarget: Using mouse as input device' , 'e' )
     
     % Eyes
     case  'e'  ,  indevf = @indev_eyes  ;
       
-      % Define eye input device descriptor , start with constants
+      % Define eye input device descriptor , column indices of 'eye' shm
       indev.C = struct ( ...
-        'MINHOR' , - SCRHOR / 2 / PIXDEG , ...
-        'MINVER' , - SCRVER / 2 / PIXDEG , ...
-        'MAXHOR' , + SCRHOR / 2 / PIXDEG , ...
-        'MAXVER' , + SCRVER / 2 / PIXDEG , ...
-        'VELTHR' , VELTHR , 'ACCTHR' , ACCTHR , 'EYESHZ' , EYESHZ , ...
          'T' , MCC.SHM.EYE.COLIND.TIME , ...
         'XL' , MCC.SHM.EYE.COLIND.XLEFT , ...
         'YL' , MCC.SHM.EYE.COLIND.YLEFT , ...
         'XR' , MCC.SHM.EYE.COLIND.XRIGHT , ...
-        'YR' , MCC.SHM.EYE.COLIND.YRIGHT , ...
-        'BUFSIZ' , 3 ) ;
+        'YR' , MCC.SHM.EYE.COLIND.YRIGHT ) ;
+      
+      % Set up the eye filter with the screen edges in degrees and the
+      % velocity and acceleration thresholds. It keeps the last two samples
+      % between calls , so that velocity and acceleration can be computed
+      % when only one eye sample is received.
+      eyefilt ( 'o' , [ - SCRHOR , + SCRHOR , - SCRVER , + SCRVER ] / ...
+        2 / PIXDEG , EYESHZ , VELTHR , ACCTHR )
       
-      % Prepare a short eye position buffer so that velocity and
-      % acceleration can be computed when only one eye sample is received.
-      % Field .b holds the most recent 3 eye positions as they were
-      % received from 'eye' shm, ordered chronologically by row. Field
-      % .v( i ) is true if both eye positions in sample .b( i , : ) are in
-      % the range [ 0 , maxpx ) where maxpx is the length of the screen in
-      % that dimension, in pixels.
-      indev.b = zeros ( indev.C.BUFSIZ , MCC.SHM.EYE.NCOL ) ;
-      indev.v = false ( indev.C.BUFSIZ , 1 ) ;
+      % Selection state machine , with dwell and blink filter durations
+      seltarg ( 'o' , MSID.mtarget , MCC.SDEF.none , DWELL , FBLINK )
       
       met ( 'printf' , 'mettarget: Using eye tracker as input device' , ...
         'e' )
@@ -221,9 +214,6 @@ function  mettarget ( MC_in )
   % Eye positions read from shared memory
   newpos = [] ;
   
-  % Currently targeted concrete stimulus index , 0 means none
-  targ = 0 ;
-  
   
   %%% Complete MET initialisation %%%
   
@@ -305,11 +295,8 @@ function  mettarget ( MC_in )
           
         end % MET SID returned
         
-        % Take square hit region lists , return reverse translation for
-        % application to eye/touchscreen positions , and un-translated
-        % square
-        hitregion( I ) = cellfun (  @prephitsquare  ,  hitregion( I )  ,...
-          'UniformOutput'  ,  false  ) ;
+        % Compile the trial's hit regions into a spatial index
+        hitgrid ( 'o' , lnkind , hitregion )
         
         % Determine which task stimuli are currently shown
         state = logic.nstate { 1 } ;
@@ -317,6 +304,7 @@ function  mettarget ( MC_in )
         % Get task stimuli indeces , reverse the order , see below for
         % reason.
         istim = logic.stim.( state )( end : -1 : 1 ) ;
+        hitgrid ( 'v' , istim )
         
         % Send mready reply to report that this controller is ready to run
         % the new trial
@@ -327,11 +315,11 @@ function  mettarget ( MC_in )
       % Remove any mready
       sig = sig ( ~ isig ) ;
       
-      % mstart received , trial is running , reset targ to task stimulus
-      % 'none'
+      % mstart received , trial is running , reset selection to task
+      % stimulus 'none'
       if  any ( sig  ==  MSID.mstart )
         tstat( 1 ) = 1 ;
-         targ( 1 ) = MCC.SDEF.none ;
+        seltarg ( 'r' )
       end
       
       % mstate received , update list of task stimuli that are currently
@@ -346,6 +334,7 @@ function  mettarget ( MC_in )
         % Get task stimuli indeces , reverse the order , see below for
         % reason.
         istim = logic.stim.( state )( end : -1 : 1 ) ;
+        hitgrid ( 'v' , istim )
         
       end % mstate received
       
@@ -379,12 +368,8 @@ function  mettarget ( MC_in )
             % Logical index of stimulus links with new hit regions
             I = C {  MCC.SHM.STIM.LINDEX  } ;
             
-            % Copy the new hit regions
-            hitregion( I ) = C (  MCC.SHM.STIM.HITREG : end  ) ;
-            
-            % Get square hit region targeting data
-            hitregion( I ) = cellfun (  @prephitsquare  ,  ...
-              hitregion( I )  ,  'UniformOutput'  ,  false  ) ;
+            % Replace them in the spatial index
+            hitgrid ( 'r' , I , C(  MCC.SHM.STIM.HITREG : end  ) )
           
         end % map shm output
         
@@ -393,103 +378,40 @@ function  mettarget ( MC_in )
     end % read shared memory
     
     
-    %-- Get currently selected point --%
+    %-- Get currently selected points --%
     
-    % Returns x and y as [] if no valid position, or returns vectors where
-    % x( i ) and y( i ) give the location of the ith point. t is a scalar
-    % time measurement.
-    [ x , y , t , indev ] = indevf ( indev , newpos ) ;
+    % Returns x and y with one row per new sample and one column per point
+    % , [ left , right ] for the eyes. t is the time of each sample , and v
+    % is true for valid samples.
+    [ x , y , t , v ] = indevf ( indev , newpos ) ;
     
     % Discard used eye samples
     if  ~ isempty (  newpos  )  ,  newpos = [] ;  end
     
-    
-    %-- No valid data --%
-    
     % Trial not running , so continue to next event
-    if  ~ tstat
-      
-      continue
-      
-    % No valid point selection available at this time
-    elseif  isempty ( x )
-    
-      % If the blink filter is on then we suspect that a blink is why there
-      % is currently no eye data available
-      if  fblink.maxdur
-        
-        % We are monitoring the duration of an ongoing blink
-        if  fblink.flag
-          
-          % This blink has lasted too long to be considered a blink. The
-          % eyes are shut or the subject is looking off screen. We need to
-          % take action if we still think that an on-screen stimulus is
-          % being targeted.
-          if  fblink.maxdur  <  tim - fblink.time  &&  ...
-              targ  ~=  MCC.SDEF.none
-
-            % No stimulus is being targeted
-            targ = MCC.SDEF.none ;
-
-            % Report this with an mtarget MET signal
-            met (  'send'  ,  MSID.mtarget  ,  targ  ,  tim  ) ;
-
-          end % nothing selected
-          
-        % This appears to be a new blink
-        else
-
-          % Raise the flag i.e. a blink is going on
-          fblink.flag( 1 ) = true ;
-          
-          % Remember approximately when it started
-          fblink.time( 1 ) = tim ;
-        
-        end % handle blink
-        
-      end % blink filter
-      
-      % To the next event
-      continue
-      
-    % There is valid data and we were monitoring an ongoing blink
-    elseif  fblink.flag
-      
-      % Lower blink filter flag , there is no longer any blink to time
-      fblink.flag( 1 ) = false ;
-      
-    end % no valid data
+    if  ~ tstat  ,  continue  ,  end
     
     
     %-- Determine selected target --%
     
-    % Compare each concrete stimulus against the selected point. Run
+    % Compare each visible task stimulus against each sample. istim runs
     % backwards so that the last thing drawn is on top of everything else,
-    % and is the first thing hit. When the loop finally breaks, i will be
-    % the index of the task stimulus that is currently selected.
-    for  i = istim
-
-      % Stimulus link indeces , if li is empty then cellfun returns nothing
-      % and any returns false
-      li = lnkind { i } ;
-      
-      % Check each linked hit region , empty matrix place holders where
-      % ptb-style stimuli are absent
-      hit = any ( cellfun(  @( h )  hitchk ( MCC , x , y , h )  ,  ...
-        hitregion( li )  ) ) ;
-      
-      % Task stimulus i is being targeted by the subject
-      if  hit  ,  break  ,  end
-      
-    end % task stimuli
+    % and is the first thing hit. i( j ) is the index of the task stimulus
+    % that sample j hit, or zero if it hit nothing.
+    i = hitgrid ( 'q' , x , y ) ;
+    
+    % Nothing hit , task stimulus 'none' is selected. Invalid samples
+    % select nothing.
+    i( ~ i ) = MCC.SDEF.none ;
+    i( ~ v ) = NaN ;
     
-    % This stimulus is already being targeted , continue to next event
-    if  targ  ==  i  ,  continue  ,  end
+    % Run the selection state machine. Returns an mtarget MET signal for
+    % each change of selection , including 'none' when the eyes are lost
+    % for longer than a blink.
+    [ tsig , tcrg , ttim ] = seltarg ( 's' , i , t , tim ) ;
     
-    % Newly targeted stimulus , update selection and report with an mtarget
-    % MET signal
-    targ = i ;
-    met (  'send'  ,  MSID.mtarget  ,  targ  ,  t  ) ;
+    % Report newly targeted stimuli
+    if  ~ isempty ( tsig )  ,  met ( 'send' , tsig , tcrg , ttim ) ;  end
     
   end % event loop
   
@@ -500,7 +422,7 @@ end % mettarget
 %%% Subroutines %%%
 
 % Reads in mettarget.csv parameter file and returns relevant parameters
-function  [ VELTHR , ACCTHR , FBLINK ] = readpar
+function  [ VELTHR , ACCTHR , FBLINK , DWELL ] = readpar
   
   % Location of metdaqeye.csv , first get containing directory then add
   % file name
@@ -543,6 +465,24 @@ function  [ VELTHR , ACCTHR , FBLINK ] = readpar
   % ... and blink filter duration
   FBLINK = p.FBLINK ;
   
+  % Optional dwell duration , none by default
+  DWELL = 0 ;
+  
+  if  isfield ( p , 'DWELL' )
+    
+    DWELL = p.DWELL ;
+    if  ischar ( DWELL )  ,  DWELL = str2double ( DWELL ) ;  end
+    
+    if  ~ isscalar ( DWELL )  ||  ~ isreal ( DWELL )  ||  ...
+        ~ ( 0 <= DWELL  &&  DWELL < Inf )
+      
+      error ( 'MET:mettarget:csv' , ...
+        'mettarget: DWELL must be a non-negative real number' )
+    
+    end
+  
+  end % dwell
+  
 end % readpar
 
 
@@ -590,164 +530,32 @@ function  [ INDEV , STMSCR , PIXDEG ] = readindev
 end % readindev
 
 
-% Turns information about square hit regions into a reverse translation
-% that is applied to eye/touchschreen positions, along with an
-% un-translated square. Column order [ x-axis translation ,
-% y-axis translation , cosine of clockwise rotation , sin of cwr ,
-% left of square , top , right , bottom , ignore ]
-function  t = prephitsquare ( h )
-  
-
-  %%% Global MET controller constants %%%
-  
-  global  MCC
-  
-  
-  %%% Check input %%%
-  
-  % If h is empty or defines circular hit regions then return it
-  % immediately
-  if  isempty ( h )  ||  size ( h , 2 )  ==  6
-    t = h ;
-    return
-  end
-  
-  
-  %%% Convert hit region %%%
-  
-  % Get rectangular hit region constants
-  C = MCC.SHM.STIM.RECT8 ;
-  
-  % Build output matrix , each row is a different square , initialised to
-  % [ x-trans , y-trans , cos , sin , left , right , bottom , top , ignore]
-  %         1 ,       2 ,   3 ,   4 ,    5 ,     6 ,      7 ,   8 ,      9
-  t = [  -h( : , [ C.XCOORD , C.YCOORD ] )  ,  ...
-         cosd( -[ h( : , C.ROTATION ) , h( : , C.ROTATION ) - 90 ] )  , ...
-         h( : , C.WIDTH  ) * [ -0.5 , 0.5 ]  ,  ...
-         h( : , C.HEIGHT ) * [ -0.5 , 0.5 ]  ,  ...
-         h( : , C.IGNORE )  ] ;
-  
-	% Swap column positions of right, bottom, and top so that we return
-	% PsychToolbox-style rectangles [ left , top , right , bottom ]
-  t( : , 6 : 8 ) = t ( : , [ 8 , 6 , 7 ] ) ;
-  
-  
-end % prephitsquare
-
-
-% Hit-check. Return true if the selected point lands in any of the listed
-% hit regions
-function  hit = hitchk ( MCC , x , y , h )
-  
-  % Not a ptb-style stimulus , hence h is empty
-  if  isempty ( h )
-    hit = false ;
-    return
-  end
-  
-  % Hit regions are either rectangular (9 columns) or circular (6 columns)
-  switch  size (  h  ,  2  )
-    
-    % Rectangular hit regions , 9 columns because of prephitsquare
-    case  9
-      
-      % Transform selected position into 'rectangle' space , start with
-      % translation then apply rotation
-      P = cell2mat (  ...
-            arrayfun (  ...
-              @( x , y , c , s )  [ x , y ]  *  [ c , s ; -s , c ]  ,  ...
-                x( 1 ) + h( : , 1 )  ,  y( 1 ) + h( : , 2 )  ,  ...
-                h( : , 3 )  ,  h( : , 4 )  ,  ...
-                  'UniformOutput'  ,  false  )  ) ;
-      
-      % Check left eye/mouse position versus hit regions
-      hit = any (  h( : , 9 )  &  ...
-        h( : , 5 ) <= P( : , 1 )  &  P( : , 1 ) <= h( : , 7 )  &  ...
-        h( : , 8 ) <= P( : , 2 )  &  P( : , 2 ) <= h( : , 6 )  ) ;
-      
-      % Mouse position only returns one selected point
-      if  numel ( x )  ==  1  ,  return  ,  end
-      
-      % Tranform right-eye position
-      P = cell2mat (  ...
-            arrayfun (  ...
-              @( x , y , c , s )  [ x , y ]  *  [ c , s ; -s , c ]  ,  ...
-                x( 2 ) + h( : , 1 )  ,  y( 2 ) + h( : , 2 )  ,  ...
-                h( : , 3 )  ,  h( : , 4 )  ,  ...
-                  'UniformOutput'  ,  false  )  ) ;
-      
-      % Two points returned by eyes , so check second point. Both points
-      % must sit within the hit region for the stimulus to be selected.
-      hit = hit  &&  any (  ...
-        h( : , 5 ) <= P( : , 1 )  &  P( : , 1 ) <= h( : , 7 )  &  ...
-        h( : , 8 ) <= P( : , 2 )  &  P( : , 2 ) <= h( : , 6 )  ) ;
-      
-      
-    % Circular hit regions
-    case  6
-      
-      % Circular hit region constants
-      C = MCC.SHM.STIM.CIRC6 ;
-      
-      % Squared radii
-      r2 = h( : , C.RADIUS )  .^  2 ;
-      
-      % Compute squared distance between selected point and centre of each
-      % hit region
-      d2 = ( h( : , C.XCOORD ) - x( 1 ) ) .^ 2  +  ...
-           ( h( : , C.YCOORD ) - y( 1 ) ) .^ 2  ;
-      
-      % Hit region is selected if any distance is at most the radius
-      hit = any (  h( : , C.IGNORE )  &  d2  <=  r2  ) ;
-      
-      % Mouse position only returns one selected point
-      if  numel ( x )  ==  1  ,  return  ,  end
-      
-      % Two points returned by eyes , so compute squared distance of second
-      % point
-      d2 = ( h( : , C.XCOORD ) - x( 2 ) ) .^ 2  +  ...
-           ( h( : , C.YCOORD ) - y( 2 ) ) .^ 2  ;
-      
-      % Both points must sit within the hit region for the stimulus to be
-      % selected
-      hit = hit  &&  any (  d2  <=  r2  ) ;
-      
-    % Internal error , wrong hit region format sent
-    otherwise
-      
-      error ( 'MET:mettarget:hitregion' , ...
-        'mettarget: unrecognised hit region format' )
-    
-  end % hit check
-  
-end % hitchk
-
-
 %%% Input device functions %%%
 
-function  [ x , y , t , indev ] = indev_mouse ( indev , mousepos )
+function  [ x , y , t , v ] = indev_mouse ( indev , mousepos )
   
   
   %%% Initialise output arguments %%%
   
-  x = [] ;  y = [] ;  t = [] ;
+  x = zeros ( 0 , 1 ) ;  y = x ;  t = x ;  v = true ( 0 , 1 ) ;
   
   
-  %%% Return position %%%
+  %%% Return positions %%%
   
   % No samples provided , so there are none to select , end function
   if  isempty ( mousepos )  ,  return  ,  end
   
-  % Gather the most recent sample
-  x = mousepos ( end , indev.XL ) ;
-  y = mousepos ( end , indev.YL ) ;
-  t = mousepos ( end , indev.T  ) ;
+  % Gather all samples , every mouse position is valid
+  x = mousepos ( : , indev.XL ) ;
+  y = mousepos ( : , indev.YL ) ;
+  t = mousepos ( : , indev.T  ) ;
+  v = true ( size ( t ) ) ;
   
   
 end % indev_mouse
 
 
-function  [ x , y , t , indev ] = indev_eyes ( indev , eyepos )
+function  [ x , y , t , v ] = indev_eyes ( indev , eyepos )
   
   
   %%% Constants %%%
@@ -757,82 +565,23 @@ function  [ x , y , t , indev ] = indev_eyes ( indev , eyepos )
   
   %%% Initialise output arguments %%%
   
-  x = [] ;  y = [] ;  t = [] ;
+  x = zeros ( 0 , 2 ) ;  y = x ;  t = zeros ( 0 , 1 ) ;  v = true ( 0 , 1 ) ;
   
   
-  %%% Update buffer %%%
+  %%% Filter new samples %%%
   
   % No samples provided , so there are none to select , end function
   if  isempty ( eyepos )  ,  return  ,  end
   
-  % Number of samples received
-  n = size ( eyepos , 1 ) ;
-  
-  % Enough samples received to fill the buffer
-  if  C.BUFSIZ  <=  n
-    
-    % Grab them
-    n = C.BUFSIZ ;
-    indev.b( : , : ) = eyepos ( end - n + 1 : end , : ) ;
-    
-  % Fewer were received
-  else
-    
-    % Shift old samples already in the buffer
-    indev.b( 1 : end - n , : ) = indev.b ( n + 1 : end , : ) ;
-    indev.v( 1 : end - n     ) = indev.v ( n + 1 : end     ) ;
-    
-    % Place new samples
-    indev.b ( end - n + 1 : end , : ) = eyepos ;
-    
-  end
-  
-  % Check new samples for validity i.e. have not clipped to screen edge
-  % along the horizontal
-  n = C.BUFSIZ  -  n  +  1 ;
-  i = [ C.XL , C.XR ] ;
-  indev.v( n : end ) = all (  C.MINHOR  <  indev.b ( n : end , i )  &  ...
-    indev.b ( n : end , i )  <  C.MAXHOR  ,  2  ) ;
-  
-  % Or the vertical
-  i = [ C.YL , C.YR ] ;
-  indev.v( n : end ) = indev.v( n : end )  &  ...
-    all (  C.MINVER  <  indev.b ( n : end , i )  &  ...
-      indev.b ( n : end , i )  <  C.MAXVER  ,  2  ) ;
-  
-  
-  %%% Compute velocity and acceleration %%%
-  
-  % Not enough valid samples , no point selected , end function
-  if  ~ all ( indev.v )  ,  return  ,  end
-  
-  % Compute the marginal velocity of new samples with column ordered by eye
-  % [ left , right ]
-  vx = diff (  indev.b ( : , [ C.XL , C.XR ] )  )  *  C.EYESHZ ;
-  vy = diff (  indev.b ( : , [ C.YL , C.YR ] )  )  *  C.EYESHZ ;
-  
-  % Compute marginal acceleration of new samples
-  ax = diff ( vx )  *  C.EYESHZ ;
-  ay = diff ( vy )  *  C.EYESHZ ;
-  
-  % Vector velocity magnitude
-  v = sqrt ( vx( end , : ) .^ 2  +  vy( end , : ) .^ 2 ) ;
-  
-  % Acceleration
-  a = sqrt ( ax .^ 2  +  ay .^ 2 ) ;
-  
-  
-  %%% Determine selected point %%%
-  
-  % Current eye position exceeds velocity or acceleration threshold , no
-  % point selected , end function
-  if  any (  C.VELTHR  <  v  |  C.ACCTHR  <  a  )  ,  return  ,  end
+  % Samples that are off screen , or exceed the velocity or acceleration
+  % thresholds , are invalid
+  v = eyefilt ( 'f' , eyepos ) ;
   
-  % Return binoccular eye position and time point , eyes column ordered
+  % Return binoccular eye positions and time points , eyes column ordered
   % [ Left , Right ]
-  x = indev.b ( end , [ C.XL , C.XR ] ) ;
-  y = indev.b ( end , [ C.YL , C.YR ] ) ;
-  t = indev.b ( end , C.T ) ;
+  x = eyepos ( : , [ C.XL , C.XR ] ) ;
+  y = eyepos ( : , [ C.YL , C.YR ] ) ;
+  t = eyepos ( : , C.T ) ;
   
   
 end % indev_eyes
@@ -662,6 +662,20 @@ function  finalise ( sd )
   footer ( sd )
   
   
+  %%% Wait for trial files %%%
+  
+  % Controllers flush their trialwr writers before they idle , but their
+  % files must all be on disk before the session is made read-only
+  if  trialwr ( 'a' , MCC.TWWAIT )
+    
+    met (  'print'  ,  sprintf (  [ 'metguicentral: trial files still ' ,...
+      'being written after %d s , not finalising %s' ]  ,  ...
+        MCC.TWWAIT  ,  sd.session_dir  )  ,  'E'  )
+    return
+    
+  end
+  
+  
   %%% Command strings %%%
   
   str = cell ( 2 , 1 ) ;
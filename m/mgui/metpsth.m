@@ -180,24 +180,17 @@ function  [ h , update , reset , recover , close ] = metpsth
   % nval is a vector of nbin values where nval( i ) is the number of values
   %   observed in the ith time bin i.e. the number of trials. Type unsigned
   %   16-bit integers.
-  % spk counts the number of spikes per time bin for each type of spike
-  %   classification. The first dimension is indexed across all spike class
+  % Spike counts per time bin for each type of spike classification , and
+  %   the accumulated variance of the spike rate , are kept by the psthacc
+  %   MEX function. Classifications are indexed across all spike class
   %   types ; in other words, the linear indexing of a channel by unit
-  %   matrix is rolled out onto a single dimention i.e. spk( i , : ) is the
-  %   set of time bins for data{ i } of the trial-buffer nsp finalised
-  %   field that contains only the first 128 rows. The second dimension of
-  %   spk is indexed along all time bins. spk is of type uint32 and must be
-  %   converted to double in order to obtain mean firing rates.
-  % maxspk is a column vector with as many rows as spk, and stores the
-  %   maximum firing rate observed from each spike classification.
+  %   matrix is rolled out onto a single dimention i.e. classification i
+  %   is data{ i } of the trial-buffer nsp finalised field that contains
+  %   only the first 128 rows.
+  % maxspk is a column vector with one row per spike classification, and
+  %   stores the maximum firing rate observed from each classification in
+  %   ascending order i.e. for each row of the population PSTH image.
   %   single-precision floating point.
-  % var accumulates the spike rate variance per classification and time
-  %   bin. It has the same arrangement as spk. But it is a single-precision
-  %   floating point array. Variance is estimated on each trial by
-  %   subtracting the current estimate of the mean spike rate from the
-  %   current trial's spike rate, then taking the square. When the average
-  %   of the squared differences is found then we have an estimate of the
-  %   variance.
   % g is a struct that links to the channel/unit popup menus, and the
   %   population psth image. These things are frequently referenced.
   %
@@ -208,8 +201,8 @@ function  [ h , update , reset , recover , close ] = metpsth
     'msoffset1' , D.msoffset1 , 'msoffset2' , D.msoffset2 , ...
     'binwid' , D.binwid , 'binend' , 0 , ...
     'nbins' , floor (  ( D.msoffset2 - D.msoffset1 )  /  D.binwid  ) , ...
-    'binflg' , true ,  'nval' , [] , 'xval' , [] , 'spk' , [] , ...
-    'maxspk' , zeros( MAXCLA , 1 , 'single' ) , 'var' , [] , 'g' , [] ) ;
+    'binflg' , true ,  'nval' , [] , 'xval' , [] , ...
+    'maxspk' , zeros( MAXCLA , 1 , 'single' ) , 'g' , [] ) ;
   
   % Apply default channel and unit
   if  ~ strcmp ( D.chan , AVGMAX )
@@ -359,10 +352,10 @@ function  [ h , update , reset , recover , close ] = metpsth
   
   % PSTH image , population. The UserData contains a struct with both a
   % forward and reverse mapping. The forward mapping is a one-to-one index
-  % vector mapping rows of the figure's .UserData.spk to rows of the
-  % image's CData, to produce an image that is sorted by the maximum firing
-  % rate of each row. The reverse mapping is a one-to-one mapping of rows
-  % of the image's CData back to the figure's .spk.
+  % vector mapping spike classifications to rows of the image's CData, to
+  % produce an image that is sorted by the maximum firing rate of each row.
+  % The reverse mapping is a one-to-one mapping of rows of the image's
+  % CData back to spike classifications. Both are returned by psthacc.
   h.UserData.g.imgpop = image ( 'Parent' , c.popaxe , ...
     'XData' , [] , 'YData' , 1 : MAXCLA , 'CData' , [] , ...
     'CDataMapping' , 'scaled' , 'Tag' , 'imgpop' , ...
@@ -645,62 +638,14 @@ function  drawnew = fupdate ( h , sd , ~ , td , ~ , tbuf )
   
   %-- Count spikes per bin --%
   
-  % Now return the spike classification index, bin index, and number of
-  % spikes per bin
-  [ lind , nspk ] = arrayfun (  ...
-    @( c , s )  spk2bin ( h.UserData , w , c , s{ 1 } )  , ...
-      ( 1 : MAXCLA )' ,  spk ( : )  ,  'UniformOutput'  ,  false  ) ;
-    
-  % Concatenate output into row vectors
-  lind = [  lind{ : }  ] ;
-  nspk = [  nspk{ : }  ] ;
-  
-  % Find non-zero bins , this has been crashing for some reason so it is
-  % wrapped in a try-catch statement until a solution can be found
-  try
-    
-    k = 0  <  h.UserData.spk ( lind ) ;
-    
-  catch
-    
-    met (  'print'  ,  sprintf ( ...
-      [ 'metpsth line 659 failure: k = 0  <  h.UserData.spk ( lind )\n',...
-        '  size h.UserData.spk: [%s ]\n  size lind: [%s ]' ] , ...
-          sprintf( ' %d' , size( h.UserData.spk ) ) , ...
-            sprintf( ' %d' , size( lind ) ) )  ,  'E'  )
-    return
-    
-  end % non-zero bins
-  
-  % Now add these values to existing buffers
-  h.UserData.spk( lind ) = h.UserData.spk( lind )  +  nspk ;
+  % Bin the spikes of every classification and add them to the running
+  % spike counts and variance
+  psthacc ( 'a' , spk ( : ) , w ) ;
   
   
   %-- Number of trials per bin --%
   
-%   % Find index of the first bin to have even partial representation in this
-%   % trial
-%   if  w( 1 )  <  tim ( mstart )
-%     b1 = ceil (  ...
-%       ( tim( mstart )  -  w( 1 ) )  *  1e3  /  h.UserData.binwid  ) ;
-%   else
-%     b1 = 1 ;
-%   end
-%   
-%   % Same, but for the last bin
-%   if  tim ( mstop )  <  w ( 2 )
-%     b2 = ceil(  ...
-%       ( tim( mstop )  -  w( 1 ) )  *  1e3  /  h.UserData.binwid  ) ;
-%   else
-%     b2 = h.UserData.nbins ;
-%   end
-%   
-%   % Make an index vector
-%   j = b1 : b2 ;
-  
-  % Increase trial count for bins that were not entirely cut off by the
-  % start or end of the trial
-%   h.UserData.nval( j ) = h.UserData.nval( j )  +  1 ;
+  % Increase trial count for all bins
   h.UserData.nval( : ) = h.UserData.nval  +  1 ;
   
   
@@ -709,55 +654,15 @@ function  drawnew = fupdate ( h , sd , ~ , td , ~ , tbuf )
   % Find the population firing rate image
   imgpop = h.UserData.g.imgpop ;
   
-  % Compute the average firing rate for all updated bins , this also
-  % updates the population firing rate plot
-  imgpop.CData( : , : ) = ...
-    single(  h.UserData.spk  )  /  h.UserData.binwid  *  1e3  ./  ...
-      repmat(  single(  h.UserData.nval  )  ,  MAXCLA  ,  1  ) ;
-   
-  % Compute maximum firing rate for updates
-  h.UserData.maxspk = max (  imgpop.CData  ,  []  ,  2  ) ;
-  
-  % And sort it ascending
-  [ ~ , i ] = sort (  h.UserData.maxspk  ) ;
-  
-  % Save the mapping of figure .spk rows to image .CData rows. That is,
-  % .forward( i ) returns the row of .spk that maps to row i of .CData.
-  imgpop.UserData.forward = uint16 ( i ) ;
-  
-  % Sort the forward mapping to find the reverse mapping
-  [ ~ , i ] = sort (  imgpop.UserData.forward  ) ;
-  
-  % Now .reverse( i ) returns the row of .CData that maps to row i of .spk
-  imgpop.UserData.reverse = uint16 ( i ) ;
-  
-  % Set colour axis of population psth axes
-  caxis (  imgpop.Parent  ,  [ 0 , h.UserData.maxspk( end ) ]  ) ;
-  
-  
-  %-- Accumulate variance --%
-  
-  % Bins with no spikes get the current firing rate , which is the variance
-  % assuming a Poisson process
-  h.UserData.var(  lind( ~ k )  ) = single(  nspk( ~ k )  )  /  ...
-    h.UserData.binwid  *  1e3 ;
-  
-  % Get subset of row and bin indeces, and spike count
-  lind = lind ( k ) ;  nspk = nspk ( k ) ;
-  
-  % Bins with spikes accumulate variance by taking the squared difference
-  % of the current trial firing rate with the current average firing rate
-  h.UserData.var( lind ) = h.UserData.var( lind )  +  ...
-    (  single ( nspk )  /  h.UserData.binwid  *  1e3  -  ...
-      imgpop.CData ( lind )  )  .^  2 ;
-  
-  % Sort spike classification average rates by which one has the maximum.
-  % We waited until now because we needed the averages to be ordered for
-  % the previous operation. Notice that since .CData is set to be a scaled
-  % version of .spk, it has the same row order. Now, if we apply the
-  % forward mapping then .CData rows will be sorted the same way as
-  % h.UserData.maxspk.
-  imgpop.CData( : , : ) = imgpop.CData ( imgpop.UserData.forward , : ) ;
+  % Get average firing rates with rows sorted ascending by the maximum
+  % firing rate of each spike classification. Also get the mapping of
+  % classifications to image .CData rows. That is, .forward( i ) returns
+  % the classification on row i of .CData , and .reverse( i ) returns the
+  % row of .CData with classification i.
+  [ img , fwd , rev , h.UserData.maxspk ] = psthacc ( 'i' ) ;
+  imgpop.CData = img ;
+  imgpop.UserData.forward = fwd ;
+  imgpop.UserData.reverse = rev ;
   
   % Look for units that have not produced any spikes
   k = h.UserData.maxspk  ==  0 ;
@@ -768,6 +673,9 @@ function  drawnew = fupdate ( h , sd , ~ , td , ~ , tbuf )
     % ... then set the y-axis limits to show only those units
     ylim (  imgpop.Parent  ,  [  sum(  k  )  ,  MAXCLA  ]  +  0.5  )
     
+    % ... and the colour axis up to the maximum firing rate
+    caxis (  imgpop.Parent  ,  [ 0 , h.UserData.maxspk( end ) ]  ) ;
+    
   end % imgpop YLim
   
   
@@ -894,9 +802,8 @@ function  freset ( h , v )
       
       % Reset the buffers
       h.UserData.nval( : ) = 0 ;
-      h.UserData.spk( : ) = 0 ;
       h.UserData.maxspk( : ) = 0 ;
-      h.UserData.var( : ) = 0 ;
+      psthacc ( 'r' ) ;
       imgpop.CData( : ) = 0 ;
       
       % Find the example PSTH axes ...
@@ -929,7 +836,7 @@ function  frecover ( h , d )
   % UserData fields to save/load
   F = { 'chan' , 'unit' , 'logic' , 'task' , 'tasksel' , 'state' , ...
     'msoffset1' , 'msoffset2' , 'binwid' , 'binend' , 'nbins' , 'nval' ,...
-    'xval' , 'spk' , 'maxspk' , 'var' } ;
+    'xval' } ;
   
   % Control's whose .String property should not be saved or loaded
   CFNOST = { 'chnpop' , 'unipop' } ;
@@ -1017,6 +924,9 @@ function  frecover ( h , d )
         
       end % uicontrols
       
+      % Add spike counts and variance
+      [ s.spk , s.var ] = psthacc ( 'g' ) ;
+      
       % Write recovery file
       save ( frec , '-struct' , 's' )
       
@@ -1068,33 +978,17 @@ function  frecover ( h , d )
       imgpop.Parent.XLim = h.UserData.binwid * [ -0.5 , 0.5 ]  +  ...
         h.UserData.xval( [ 1 , end ] ) ;
       
-      % Sort maximum spike rate of each channel/unit ascending
-      [ ~ , i ] = sort (  h.UserData.maxspk  ) ;
-
-      % Save the mapping of figure .spk rows to image .CData rows. That is,
-      % .forward( i ) returns the row of .spk that maps to row i of .CData.
-      imgpop.UserData.forward = uint16 ( i ) ;
-
-      % Sort the forward mapping to find the reverse mapping
-      [ ~ , i ] = sort (  imgpop.UserData.forward  ) ;
+      % Restore the spike counts and variance
+      psthacc ( 'o' , MAXCLA , nbins , h.UserData.binwid ) ;
+      psthacc ( 's' , s.spk , s.var , double ( max ( h.UserData.nval ) ) ) ;
 
-      % Now .reverse( i ) returns the row of .CData that maps to row i of
-      % .spk
-      imgpop.UserData.reverse = uint16 ( i ) ;
-
-      % Set colour axis of population psth axes
-      caxis (  imgpop.Parent  ,  [ 0 , h.UserData.maxspk( end ) ]  ) ;
-      
-      % Get forward mapping again
-      i = imgpop.UserData.forward ;
-      
-      % Allocate memory for the image
-      imgpop.CData = zeros (  h.UserData.MAXCLA  ,  nbins  , 'single'  ) ;
-      
-      % Replot the firing rates
-      imgpop.CData( : , : ) = single(  h.UserData.spk( i , : )  )  /  ...
-        h.UserData.binwid  *  1e3  ./  ...
-          repmat(  single( h.UserData.nval ) ,  MAXCLA ,  1  ) ;
+      % Replot the firing rates , sorted ascending by the maximum firing rate
+      % of each channel/unit , and get the mapping of channel/unit to image
+      % .CData rows
+      [ img , fwd , rev , h.UserData.maxspk ] = psthacc ( 'i' ) ;
+      imgpop.CData = img ;
+      imgpop.UserData.forward = fwd ;
+      imgpop.UserData.reverse = rev ;
         
       % Look for units that have not produced any spikes
       k = h.UserData.maxspk  ==  0 ;
@@ -1104,6 +998,9 @@ function  frecover ( h , d )
 
         % ... then set the y-axis limits to show only those units
         ylim (  imgpop.Parent  ,  [  sum(  k  )  ,  MAXCLA  ]  +  0.5  )
+        
+        % ... and the colour axis up to the maximum firing rate
+        caxis (  imgpop.Parent  ,  [ 0 , h.UserData.maxspk( end ) ]  ) ;
 
       end % imgpop YLim
         
@@ -1492,9 +1389,7 @@ function  done_cb ( h , cbdat )
       
       % It is , so we must reset the buffers
       f.UserData.nval( : ) = 0 ;
-      f.UserData.spk( : ) = 0 ;
       f.UserData.maxspk( : ) = 0 ;
-      f.UserData.var( : ) = 0 ;
       imgpop.CData( : ) = 0 ;
       
     end
@@ -1518,8 +1413,7 @@ function  done_cb ( h , cbdat )
   f.UserData.nval = zeros ( 1 , nbins , 'uint16' ) ;
   f.UserData.xval = ( 1 : nbins ) * f.UserData.binwid  -  ...
     f.UserData.binwid / 2  +  f.UserData.msoffset1 ;
-  f.UserData.spk = zeros (  MAXCLA  ,  nbins  ,  'uint32'  ) ;
-  f.UserData.var = zeros (  MAXCLA  ,  nbins  ,  'single'  ) ;
+  psthacc ( 'o' , MAXCLA , nbins , f.UserData.binwid ) ;
   imgpop.CData = zeros (  MAXCLA  ,  nbins  ,  'single'  ) ;
   
   % Reset image XData
@@ -1590,48 +1484,6 @@ function  i = zerowin ( h , d )
 end % zerowin
 
 
-% Return lind( j ) will give a spike-classification/bin linear index, while
-% nspk( j ) is the number of spikes observed from that classification in
-% that bin. ud is the figure's UserData. w is the earliest and latest spike
-% time that will be binned. c is the classification index, this will be
-% repeated and returned in ispk. s is the vector of spike times, in seconds
-% on the NSP clock.
-function  [ lind , nspk ] = spk2bin ( ud , w , c , s )
-  
-  % Initialise empty matrices
-  lind = uint32 ( [] ) ;  nspk = uint32 ( [] ) ;
-
-  % Look for spikes that sit within a bin
-  i = w ( 1 )  <=  s  &  s  <=  w ( 2 ) ;
-  
-  % No binnable spikes , quit now
-  if  ~ any ( i )  ,  return  ,  end
-  
-  % Get binnable spikes and zero time on start of analysis window. Then
-  % divide by the bin width and round up to get the index of the bin that
-  % each spike landed in.
-  s = ceil ( 1e3 * (  s( i )  -  w( 1 )  )  /  ud.binwid ) ;
-  
-  % Look for any spike that landed on the very edge of the first bin. This
-  % will have a bin index of 0, but it should belong to bin 1.
-  s(  s  ==  0  ) = 1 ;
-  
-  % Spike times are already sorted chronologically. Therefore, take the
-  % difference of the bin indeces. This will return 0 when a bin index is
-  % repeated and non-zero where it is not. Hence why we add an element to
-  % the end that is 1 plus the last observed bin. In other words, identify
-  % the last spike to land in each bin.
-  i = 0  <  [ s( 2 : end ) , s( end ) + 1 ]  -  s ;
-  
-  % Find the number of spikes to land in each bin
-  nspk = uint32 ( diff(  [ 0 , find( i ) ]  ) ) ;
-  
-  % Compute linear indeces for each bin that receives spikes, for each
-  % spike classification
-  lind = uint32 (  ud.MAXCLA  *  ( s( i ) - 1 )  +  c  ) ;
-  
-end % spk2bin
-
   
 % Plot the selected PSTH
 function  selpsthplot ( h )
@@ -1707,14 +1559,11 @@ function  selpsthplot ( h )
   % The set line graphics objects
   g = a.UserData ;
   
-  % Number of samples per bin
-  Ns = h.UserData.nval ;
-  
-  % Current mean spike rate for selected unit
-  m = mean (  imgpop.CData(  rmap( j )  ,  :  )  ,  1  ) ;
+  % Current mean spike rate for selected unit , and the current standard
+  % deviation
+  [ m , e ] = psthacc ( 'm' , j ) ;
   
-  % And the current standard deviation, above and below the mean
-  e = sqrt (  mean(  h.UserData.var( j , : )  ,  1  )  ./  single( Ns )  );
+  % Standard deviation above and below the mean
   e = [  m - e  ;  m + e  ] ;
   
   % Update average ...
@@ -5,7 +5,7 @@ function  [ h , update , reset , recover , close ] = metraster
 % 
 % Displays run-time raster plot of incoming cbmex trialdata. Expects that
 % new data in the .nsp current buffer will be the same as written out by
-% metcbmex.
+% metcbmex i.e. packed NSP events that are decoded with nspring.
 % 
 % Written by Jackson Smith - Oct 2016 - DPAG , University of Oxford
 % 
@@ -43,6 +43,9 @@ function  [ h , update , reset , recover , close ] = metraster
   % it is set to that.
   s.time_0 = 0 ;
   s.a = [] ;
+  
+  % Channel labels , sent with the first nsp data of each trial
+  s.label = {} ;
   s.MSID = MSID ;
   
   
@@ -124,17 +127,28 @@ function  drawnew = updatef ( h , cbuf )
   % Report change
   drawnew = false ;
   
-  % Point to nsp data
-  nsp = cbuf.nsp{ 1 } ;
+  % Channel labels come with all nsp data
+  u.label = cbuf.nsp{ MCC.SHM.NSP.LABIND } ;
+  h.UserData = u ;
+  
+  % Can't tell what the events are without labels
+  if  isempty ( u.label )  ,  return  ,  end
+  nsp.label = u.label ;
   
   % First, look for signal events
-  din = strcmp ( nsp.label , 'digin' ) ;
+  din = find ( strcmp ( nsp.label , 'digin' ) ) ;
+  if  isempty ( din )  ,  din = 0 ;  end
+  
+  % Decode packed nsp data into the label row , value , and time of each
+  % event
+  [ r , v , t ] = nspring ( 'd' , cbuf.nsp{ MCC.SHM.NSP.DATIND } , ...
+    MCC.SHM.NSP.RAWSHZ ) ;
   
   % Get signal id's and times as recorded by NSP , IDs will be in the
   % lower-order bits
-    i = nsp.data { din , 2 }  <=  MCC.DAT.MAXSIG ;
-  sig = nsp.data { din , 2 } ( i ) ;
-  tim = nsp.data { din , 1 } ( i ) ;
+    i = r == din  &  v <= MCC.DAT.MAXSIG ;
+  sig = v ( i ) ;
+  tim = t ( i ) ;
   
   % Any mstart events? Use this for time zero
   i =  find ( sig == u.MSID.mstart , 1 , 'last' )  ;
@@ -146,28 +160,13 @@ function  drawnew = updatef ( h , cbuf )
   % Zero signal times
   tim = tim - u.time_0 ;
   
-  % Prepare to gather spike time stamps , find spike front-end channels ,
-  % and make data gathering cell array
+  % Find spike front-end channels
   I = ~ cellfun( @( c )  isempty ( c ) , strfind( nsp.label , 'chan' ) ) ;
   NCHAN = sum ( I ) ;
-  C = cell ( NCHAN , 2 ) ;
-  
-  % Loop channels and concatenate time stamps
-  for  i = 1 : size ( nsp.data , 1 )
-    
-    % Not spike channel , next
-    if  ~ I ( i )  ,  continue  ,  end
-    
-    % Gather together all spikes
-    C { i , 1 } = cell2mat ( nsp.data ( i , : )' ) ;
-    
-    % Then assign channel number to each spike
-    C { i , 2 } = ones ( size ( C { i , 1 } ) )  *  i ;
-    
-  end % gather all spikes
   
-  % Pack all spikes into one array
-  C = cell2mat ( C ) ;
+  % Pack all spike times with the channel number of each spike
+  i = I ( r ) ;
+  C = [ t( i ) , r( i ) ] ;
   
   % If there is data
   if  ~ isempty ( C )
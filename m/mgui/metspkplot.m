@@ -67,6 +67,9 @@ function  [ h , update , reset , recover , close ] = metspkplot
   % Row index of cbmex 'trialdata' output that contains NSP digital input
   C.digin = 0 ;
   
+  % Channel labels , from the first 'nsp' shm read of the trial
+  C.label = {} ;
+  
   % Trial event buffer. In case we ever see an mstart, mstate, or mstop
   % signal in NSP digital input that was recorded before its cargo
   C.sigbuf = [] ;
@@ -76,6 +79,11 @@ function  [ h , update , reset , recover , close ] = metspkplot
   C.strnsp = -1 ;
   C.strptb = -1 ;
   
+  % NSP to PTB time regression coefficients [ intercept , slope ] , from
+  % the latest 'nsp' shm read. PTB time of NSP sample number n is
+  % intercept + slope * n.
+  C.coef = [ 0 , 0 ] ;
+  
   % Trial stop event flag , lower when stop event is plotted
   C.stpflg = true ;
   
@@ -268,8 +276,21 @@ function  drawnew = updatef ( h , sd , td , cbuf )
       % comes with an obsolete trial identifier
       if  h.UserData.stpflg  &&  h.UserData.strnsp  ~=  -1
         
-        % Time of event is PTB-stop min PTB-start plus NSP-start
-        tim = cbuf.msig.tim( i ) - h.UserData.strptb + h.UserData.strnsp ;
+        % Time of event in NSP seconds , from the NSP to PTB time
+        % regression
+        c = h.UserData.coef ;
+        
+        if  c( 2 )
+          
+          tim = ( cbuf.msig.tim( i ) - c( 1 ) )  /  ...
+            ( c( 2 ) * MCC.SHM.NSP.RAWSHZ ) ;
+        
+        % No regression , PTB-stop min PTB-start plus NSP-start
+        else
+          
+          tim = cbuf.msig.tim( i ) - h.UserData.strptb + h.UserData.strnsp ;
+        
+        end
         
         % Outcome line and text
         EVTXT = text (  tim  ,  C.A.YLim( 2 )  ,  ...
@@ -319,8 +340,17 @@ function  drawnew = updatef ( h , sd , td , cbuf )
   % This 'nsp' shm read did not come from this trial, ignore it
   if  tid  ~=  td.trial_id  ,  return  ,  end
   
-  % Point to new data
-  nsp = cbuf.nsp { MCC.SHM.NSP.DATIND } ;
+  % Latest NSP to PTB time regression
+  h.UserData.coef = cbuf.nsp { MCC.SHM.NSP.COFIND } ;
+  
+  % Channel labels come with every read
+  h.UserData.label = cbuf.nsp { MCC.SHM.NSP.LABIND } ;
+  
+  % Without channel labels , there is no way to know what events are
+  if  isempty ( h.UserData.label )  ,  return  ,  end
+  
+  % Point to channel labels
+  nsp.label = h.UserData.label ;
   
   
   %-- Trial initialisation --%
@@ -398,6 +428,14 @@ function  drawnew = updatef ( h , sd , td , cbuf )
   end % trial init
   
   
+  %-- Decode events --%
+  
+  % Unpack new events into a cell array laid out like cbmex 'trialdata'
+  nsp.data = nspring ( 'c' , cbuf.nsp { MCC.SHM.NSP.DATIND } , ...
+    [ numel( nsp.label ) , MCC.SHM.NSP.MAXUNI + 1 ] , ...
+      h.UserData.digin , MCC.SHM.NSP.RAWSHZ ) ;
+  
+  
   %-- Trial events --%
   
   % Initialise tmax
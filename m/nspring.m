@@ -0,0 +1,68 @@
+% 
+% [ ... ] = nspring ( fun , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. Packs the events
+% returned by cbmex ( 'trialdata' ) into a ring of compact records for
+% 'nsp' shared memory , and unpacks them again for the readers. Used by
+% metcbmex to write 'nsp' shared memory and by metgui , metspkplot , and
+% metraster to read it.
+% 
+% Each event is one 8-byte record that holds the row of the event in
+% cbmex 'trialdata' output , i.e. the index of its channel label , a 16-bit
+% value , and the NSP time stamp in number of samples , as a 32-bit
+% unsigned integer. For a spike event , the value is the unit
+% classification , 0 for unclassified and 1 to 5 for sorted units. For a
+% digital input event , the value is the 16-bit digital input. A set of
+% records is handed to Matlab as a 2 x N uint32 array , one record per
+% column , so that met ( 'write' ) and met ( 'read' ) copy it to and from
+% shared memory in one block. The layout of the first uint32 of a column
+% depends on the byte order of the host , so always decode records with
+% nspring.
+% 
+% Events are kept in the ring in the order that they were pushed. Within
+% one channel and unit , this is chronological.
+% 
+% Sub-functions:
+% 
+%   nspring ( 'o' , din ) -- Empties the ring and sets the row of the
+%     digital input channel in cbmex 'trialdata' output to din , a scalar
+%     double.
+% 
+%   d = nspring ( 'p' , td ) -- Pushes the events in cbmex 'trialdata'
+%     output td onto the ring. td is a cell array with the channel labels
+%     in the first column. For spike channels , the following columns have
+%     the time stamps of each unit classification. For the digital input
+%     channel , the second column has time stamps and the third has
+%     digital input values. Time stamps and values may be any real numeric
+%     type. If the ring is full then the oldest events are dropped ; d is
+%     the number of events dropped , as a double.
+% 
+%   rec = nspring ( 'w' ) -- Returns all events in the ring that have not
+%     yet been acknowledged , as a 2 x N uint32 array of records. The ring
+%     is not changed.
+% 
+%   nspring ( 'a' , n ) -- Acknowledges the oldest n events in the ring ,
+%     which are released. Call after rec from 'w' has been written to
+%     shared memory , with n equal to size ( rec , 2 ).
+% 
+%   [ r , v , t ] = nspring ( 'd' , rec , hz ) -- Decodes the records in
+%     2 x N uint32 array rec. Returns the row , value , and time of each
+%     event in N x 1 doubles. hz is the NSP sampling rate , time stamps are
+%     divided by hz to get time in seconds.
+% 
+%   data = nspring ( 'c' , rec , siz , din , hz ) -- Decodes records in
+%     rec into a cell array with the same layout as cbmex 'trialdata'
+%     output without the label column , i.e. data has siz( 1 ) rows and
+%     siz( 2 ) columns. Row din holds digital input time stamps in column
+%     1 and values in column 2 ; all other rows hold the time stamps of
+%     unit classification 0 in column 1 to unit classification siz( 2 ) -
+%     1 in the last column. Each element has a 1 x M double vector , or []
+%     if there were no events. Time stamps are divided by hz to get
+%     seconds. Events with a row or value that falls outside of data are
+%     ignored.
+% 
+% NOTE: The ring is allocated by the first call to 'o' and is kept until
+% nspring is cleared.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
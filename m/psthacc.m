@@ -0,0 +1,55 @@
+% 
+% [ ... ] = psthacc ( fun , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. Accumulates the
+% peri-stimulus time histogram ( PSTH ) of every spike classification ,
+% for metpsth. Each trial's spikes are binned and added to running spike
+% counts , and the running variance of the firing rate , in time
+% proportional to the number of new spikes. The spike classifications
+% are kept in order of their maximum average firing rate over all bins ,
+% and the order is updated as the counts grow. The population PSTH image
+% is then returned ready to plot , with one row per classification in
+% ascending order of maximum firing rate.
+% 
+% The average firing rate in a bin is the spike count divided by the
+% number of trials and by the bin width. The variance is accumulated as
+% metpsth always has. When a bin gets its first spikes , its variance
+% estimate is set to the trial's firing rate , as for a Poisson process.
+% After that , a trial with spikes in the bin adds the squared difference
+% between its firing rate and the new average firing rate.
+% 
+% Sub-functions:
+% 
+%   psthacc ( 'o' , ncla , nbins , binwid ) -- Allocates and zeros the
+%     buffers for ncla spike classifications and nbins time bins that are
+%     binwid milliseconds wide. All scalar doubles.
+% 
+%   psthacc ( 'r' ) -- Zeros the buffers. Does nothing before 'o'.
+% 
+%   psthacc ( 'a' , spk , w ) -- Adds one trial. spk is a cell array with
+%     ncla elements , each one a double vector of the spike times of one
+%     classification , in seconds. w is the 2 element double vector of
+%     the start and end of the analysis window , in seconds. Spikes from
+%     w( 1 ) to w( 2 ) are binned.
+% 
+%   [ img , fwd , rev , mx ] = psthacc ( 'i' ) -- Returns the population
+%     PSTH image img , an ncla x nbins single array of average firing
+%     rates in spikes per second. Row i of img has classification fwd( i
+%     ) , and classification i is on row rev( i ) of img. fwd and rev are
+%     ncla x 1 uint16. mx is an ncla x 1 single with the maximum average
+%     firing rate of each row of img , in ascending order.
+% 
+%   [ m , e ] = psthacc ( 'm' , j ) -- Returns the average firing rate of
+%     the classifications listed in double vector j , and the standard
+%     deviation , for each bin in 1 x nbins singles.
+% 
+%   [ spk , var ] = psthacc ( 'g' ) -- Returns the spike counts in an ncla
+%     x nbins uint32 array , and the accumulated variance in an ncla x
+%     nbins single array. For saving.
+% 
+%   psthacc ( 's' , spk , var , n ) -- Sets the spike counts and
+%     accumulated variance , as returned by 'g' , and the number of
+%     trials n , a scalar double. For loading. Must follow 'o'.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
@@ -0,0 +1,45 @@
+% 
+% [ ... ] = rdotkern ( fun , key , ctr , dims , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. Random-dot kernels
+% for the random-dot stereogram and kinetogram stimulus definitions.
+% Random values come from a counter-based generator , rather than from a
+% pool of values that is sampled when the trial is initialised. The i'th
+% value of a stream is a pure function of the stream's key and of i , in
+% the manner of SplitMix64 , so that any part of a stream can be made
+% again from the key alone. There is no hidden state. Instead , the caller
+% keeps the key and the counter of the next value , and each sub-function
+% returns the counter that follows the last value that it used.
+% 
+% key is a scalar double holding an integer on [ 0 , 2^32 - 1 ]. It is
+% expected that the stimulus definition draws a new key with randi during
+% trial initialisation , so that the key follows Matlab's random number
+% generator ; as metptb records the state of that generator on each trial ,
+% the dots can still be reproduced. ctr is a scalar double holding an
+% integer on [ 0 , 2^53 ) , usually zero for a new key. dims is a double
+% vector of dimension sizes. If dims has a single element n then a row
+% vector of n values is returned , or a 2 by n matrix of dot positions.
+% 
+% Sub-functions:
+% 
+%   [ xy , ctr ] = rdotkern ( 'd' , key , ctr , dims , w , r ) -- Samples
+%     dot positions uniformly from an annulus centred on the origin. w is
+%     the difference between the squared outer and inner radii , and r is
+%     the squared inner radius ; use r = 0 for a circle. Returns single xy
+%     of size [ 2 , dims ] , with x-axis coordinates in row 1 and y-axis
+%     coordinates in row 2. Uses one value per dot.
+% 
+%   [ u , ctr ] = rdotkern ( 'u' , key , ctr , dims ) -- Samples single
+%     values from the uniform distribution on the open interval ( 0 , 1 ).
+%     Returns u with size dims.
+% 
+%   [ l , ctr ] = rdotkern ( 'l' , key , ctr , dims , p ) -- Samples dot
+%     lifetimes , in frames , from the geometric distribution with a
+%     probability p of dying on each frame. Returns uint16 l with size
+%     dims , where l = ceil ( log ( u ) / log ( 1 - p ) ) for uniform u on
+%     ( 0 , 1 ). p is a non-negative scalar double. Lifetimes are
+%     saturated at intmax ( 'uint16' ) , which is returned for all dots
+%     when p is zero ; they are zero when p is 1 or more.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
@@ -0,0 +1,47 @@
+% 
+% [ ... ] = seltarg ( fun , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. The state machine
+% that decides which task stimulus the subject has selected , used by
+% mettarget to generate mtarget MET signals. It takes the stimulus that
+% was hit by each new eye or mouse sample , in time order , and returns
+% only the changes of selection , as MET signals that are ready for met (
+% 'send' ). Each sample takes the same , small amount of work , no matter
+% how long the selection has lasted.
+% 
+% A new stimulus is selected once it has been hit by every valid sample
+% for at least the dwell duration , including task stimulus 'none' when
+% no stimulus is hit. The selection changes at the time of the sample that
+% completes the dwell. Invalid samples , such as those during a blink ,
+% neither change the selection nor interrupt the dwell. But if there is no
+% valid sample for longer than the blink duration , then the eyes are lost
+% and 'none' is selected immediately. The blink is timed from the last
+% valid sample ; if there has never been one then it is timed from the
+% first invalid sample or call that finds none.
+% 
+% Sub-functions:
+% 
+%   seltarg ( 'o' , sid , none , dwell , blink ) -- Sets parameters ,
+%     forgets the past , and selects 'none'. sid is the MET signal
+%     identifier of mtarget , none is the index of task stimulus 'none' ,
+%     dwell is the dwell duration in seconds , and blink is the maximum
+%     duration of a blink in seconds. If blink is zero then the selection
+%     never changes to 'none' for lack of valid samples , as with a mouse.
+%     All scalar doubles.
+% 
+%   seltarg ( 'r' ) -- Reset for a new trial. Selects 'none' without
+%     sending an mtarget signal , and drops any pending selection. The
+%     blink timer carries on.
+% 
+%   [ sig , crg , tim ] = seltarg ( 's' , c , t , now ) -- Takes new
+%     samples. c is an N x 1 double with the index of the task stimulus
+%     that was hit by each sample , or NaN if the sample is invalid. t is
+%     an N x 1 double of sample times , in seconds. Either may be empty
+%     if N is zero. now is the current local time in seconds , as from met
+%     ( 'select' ) , used to time the blink after the last sample. Returns
+%     M x 1 doubles that hold one mtarget MET signal per change of
+%     selection , in order , with the signal identifier , cargo i.e. the
+%     selected task stimulus , and time. M is zero if nothing changed.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
@@ -0,0 +1,51 @@
+% 
+% [ ... ] = sesstore ( fun , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. Session store of
+% trial data. Each stream of data in a session , such as MET signals or
+% eye samples , is appended trial by trial to a pair of files in the
+% session's store directory , instead of being written to new files in
+% every trial directory. Analysis can then load any range of trials from
+% a stream with one call.
+% 
+% A stream is a table of named columns. Each column is a real numeric ,
+% logical , or char matrix with a fixed class and a fixed number of
+% matrix columns , its width. All columns have the same number of rows in
+% a trial , but the number of rows can change from trial to trial. The
+% first trial that is appended sets the columns of the stream.
+% 
+% A stream named f has the data file f.mcs and the index file f.mci. The
+% data file has a header that describes the columns , followed by one
+% chunk per trial. A chunk has a small header with the trial identifier
+% and number of rows , then the data of each column in turn , in Matlab's
+% own column-major order , each padded to a multiple of 8 bytes. The index
+% file has one record per chunk , with its trial identifier , byte offset
+% , and number of rows. Both files are only ever appended to. If a write
+% was cut short , say by a crash , then the next append repairs the index
+% and drops the broken chunk.
+% 
+% The reader maps the data file into memory and copies the columns of the
+% selected chunks straight into the output arrays. Chunks that were
+% written after the last index record are found by following the chunks.
+% 
+% Sub-functions:
+% 
+%   sesstore ( 'a' , f , tid , S ) -- Appends the data of trial tid to
+%     stream f. f is a string naming the stream's files , without suffix ,
+%     and tid is a scalar double. S is a scalar struct with one field per
+%     column , each a 2D matrix. Every field must have the same number of
+%     rows. For a new stream , the field names , classes , and widths
+%     become the stream's columns. Otherwise S must have the same fields
+%     in the same order , with the same classes and widths.
+% 
+%   [ S , T ] = sesstore ( 'r' , f , tid ) -- Reads every trial of stream
+%     f with an identifier in the range tid( 1 ) to tid( end ). S has one
+%     field per column , holding the rows of all the trials that were read
+%     in the order that they were appended. T is an N x 2 double matrix
+%     with a row per trial read , giving the trial identifier and its
+%     number of rows in S.
+% 
+%   T = sesstore ( 'i' , f ) -- Returns T for every trial in stream f.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
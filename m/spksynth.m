@@ -0,0 +1,48 @@
+% 
+% [ ... ] = spksynth ( fun , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. Synthesises the
+% waveform of a simulated spike train in consecutive chunks , for
+% metsimspk to stream through PsychPortAudio. Memory use is constant , no
+% matter how long the trial lasts , and nothing has to be made before the
+% trial starts.
+% 
+% Spikes are a Poisson process with a dead time. Each inter-spike interval
+% is the refractory period plus an exponentially distributed interval
+% whose mean is the reciprocal of the firing rate. Hence , time is spent
+% on each spike rather than on each audio sample. The kernel is added to
+% the waveform at the sample of every spike , and any part of it that
+% runs past the end of one chunk is carried over into the next.
+% 
+% The kernel is scaled so that its largest absolute value is 1. Then the
+% waveform ranges from -1 to +1 when the kernel is no longer than the
+% refractory period , otherwise overlapping spikes are clipped to that
+% range.
+% 
+% The firing rate can be changed at any time , and applies to all samples
+% in the next chunk. Because a Poisson process has no memory , the next
+% spike is drawn afresh from the new rate , but no sooner than the end of
+% the refractory period of the last spike.
+% 
+% Sub-functions:
+% 
+%   spksynth ( 'o' , fs , k , refract ) -- Sets the audio sampling rate fs
+%     in Hz , a scalar double ; the spike kernel k , a vector of doubles
+%     or singles sampled at fs ; and the refractory period refract in
+%     seconds , a scalar double. Then does the same as 'r' , and sets the
+%     firing rate to zero. The random number generator is seeded from the
+%     time.
+% 
+%   spksynth ( 'r' ) -- Reset for a new trial. Sample zero is the next
+%     sample to be generated , there is no carried-over kernel , and the
+%     last spike is forgotten. The firing rate does not change.
+% 
+%   spksynth ( 'f' , rate ) -- Sets the firing rate in Hz , a non-negative
+%     scalar double.
+% 
+%   x = spksynth ( 'g' , n ) -- Returns the next n samples of the
+%     waveform in a 2 x n single array , for left and right stereo
+%     channels that are identical. n is a non-negative scalar double.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
@@ -0,0 +1,60 @@
+% 
+% [ ... ] = trialwr ( fun , ... )
+% 
+% Matlab Electrophysiology Toolbox utility function. Asynchronous writer
+% of trial directory files. MET controllers save a set of files into the
+% current trial's directory at the end of every trial. Writing these to
+% disk , and making sure that they are there , can take a while. Instead ,
+% the controller saves each file to a staging file in memory , then hands
+% it to trialwr. A background writer thread copies each staging file to
+% its place in the trial directory , while the controller moves on to the
+% next trial. The staging file is removed once its copy is safely on
+% disk.
+% 
+% The writer thread takes every file that is waiting when it wakes up , as
+% one batch. Each file of the batch is copied into a temporary file next
+% to its destination. Then all files of the batch are flushed to disk ,
+% renamed to their destinations , and each directory that received a file
+% is flushed once. Thus , the set of files that a controller saves at the
+% end of a trial usually costs one round of flushes , and a destination
+% file is never seen half-written.
+% 
+% Staging files are kept in STAGDIR , which is in memory on Linux. If
+% Matlab crashes then files that were still waiting can be found there ,
+% named mettw.<pid>.<n>.<file name>.
+% 
+% If the writer fails to write a file then the next call to 'w' or 'f'
+% raises an error that names the file and its staging file. Neither the
+% staging file nor a temporary file that was fully copied is removed , so
+% the file can be recovered by hand.
+% 
+% While a process has files that are not yet on disk , the empty marker
+% file STAGDIR/mettw.<pid>.busy exists. Hence another MET process can wait
+% with 'a' for every controller's writer to finish , for instance before
+% the session directory is made read-only.
+% 
+% Sub-functions:
+% 
+%   s = trialwr ( 's' , f ) -- Returns a new staging file name s for the
+%     destination file f , which is a string. s has the same file name
+%     and type suffix as f. The caller then writes s e.g. with save or
+%     metsavtxt. The first call starts the writer thread.
+% 
+%   trialwr ( 'w' , s , f ) -- Hands staging file s to the writer , which
+%     will move it to destination f. s must have been returned by 's'.
+%     Returns immediately.
+% 
+%   trialwr ( 'f' ) -- Waits until every file that was handed to the
+%     writer so far is in place on disk.
+% 
+%   trialwr ( 'c' ) -- Waits as for 'f' , then stops the writer thread.
+%     The same happens when Matlab exits.
+% 
+%   n = trialwr ( 'a' , tout ) -- Waits as for 'f' , then waits up to
+%     tout seconds for the writers of all other running processes to
+%     finish. Returns the number of processes that are still writing , 0
+%     if all are done. Errors of this process' writer are not raised
+%     here , but by the next 'w' or 'f'.
+% 
+% Written by Jackson Smith - DPAG , University of Oxford
+% 
@@ -138,16 +138,11 @@ classdef  rds_motion_handle  <  handle
       % image , columns by dot , and layers by RDS.
       v
       
-      % Randomness buffer. Random values will be sampled during
-      % initialisation then scaled during stimulation. Values are simply
-      % recycled if they are all used up before a trial is complete. Size
-      % matches xy. The fourth dimension is indexed over frames. Since row
-      % two will always provide polar coordinate dot angles, these can be
-      % pre-computed and stored in r. ir is the index of the last used
-      % frame. nr is the number of frames of values available.
-      r
-      ir = 0 ;
-      nr = 0 ;
+    % Random-dot generator. Dot positions are sampled by rdotkern from a
+    % counter-based generator. key is drawn anew on each trial , and ctr
+    % is the counter of the next value in the key's stream.
+    key = 0 ;
+    ctr = 0 ;
       
     % Dynamic dot buffers change size during a trial
       
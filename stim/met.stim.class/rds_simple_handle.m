@@ -189,18 +189,11 @@ classdef  rds_simple_handle  <  handle
       % Logical vector identifies anti-correlated dots
       acor
       
-      % Randomness buffer. Random values will be sampled during
-      % initialisation then scaled during stimulation. Values are simply
-      % recycled if they are all used up before a trial is complete. Enough
-      % space for uncorrelated dots in all RDS over a specified amount of
-      % time. Size matches xy in the first four dimensions. The fifth
-      % dimension is indexed over frames. Since row two will always provide
-      % polar coordinate dot angles, these can be pre-computed and stored
-      % in r. ir is the index of the last used frame. nr is the number of
-      % frames of values available.
-      r
-      ir = 0 ;
-      nr = 0 ;
+      % Random-dot generator. Dot positions are sampled by rdotkern from a
+      % counter-based generator. key is drawn anew on each trial , and ctr
+      % is the counter of the next value in the key's stream.
+      key = 0 ;
+      ctr = 0 ;
       
     % Dynamic dot buffers change size during a trial
       
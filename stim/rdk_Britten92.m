@@ -34,6 +34,11 @@ function  ...
 % mitigate some finite-precision machine error by adding small values with
 % small values so that they aren't lost by first summing with very large
 % values.
+%
+% Dot positions and lifetimes are sampled on the fly by the rdotkern MEX
+% function , from a counter-based random number generator. A new key for
+% the generator is drawn from Matlab's random number generator during
+% trial initialisation.
 % 
 % 
 % Variable parameters:
@@ -482,8 +487,13 @@ function  S = finit ( vpar , tconst , ~ )
   % Contains x-coord in row 1 and y-coord in row 2.
   S.xy = zeros (  2  ,  S.Nd_total_max  ) ;
   
+  % Draw a new key for the random-dot generator , and start from the
+  % beginning of its stream
+  S.key = randi ( [ 0 , 2 ^ 32 - 1 ] ) ;
+  S.ctr = 0 ;
+  
   % Initialise positions but don't add translation, yet
-  S.xy( : , 1 : S.Nd_total ) = rndpos ( S.radius , S.Nd_total ) ;
+  [ S.xy( : , 1 : S.Nd_total ) , S.ctr ] = rndpos ( S , S.Nd_total ) ;
   
   % Translation buffer , we're trading use of memory for speed of
   % translations
@@ -522,8 +532,9 @@ function  S = finit ( vpar , tconst , ~ )
   
   % Initialise signal dot lifetimes from a geometric distribution , add 1
   % so that the first signal dots are guaranteed to get at least 2 frames
-  S.lifetime( i ) = ...
-    ceil( log( rand( size( i ) ) )  /  log( 1 - S.prob_survival ) )  +  1 ;
+  [ S.lifetime( i ) , S.ctr ] = ...
+    rdotkern ( 'l' , S.key , S.ctr , size( i ) , S.prob_survival ) ;
+  S.lifetime( i ) = S.lifetime( i )  +  1 ;
   
   % Colour buffer , initialise with one layer for monocular, or two for
   % binocular
@@ -948,7 +959,7 @@ function  [ S , h ] = fstim ( S , tconst , tvar )
         
         % Sample new dot positions for signal dots that were not replaced
         % by a noise dot
-        S.xy( : , norep ) = rndpos (  S.radius  ,  numel ( norep )  ) ;
+        [ S.xy( : , norep ) , S.ctr ] = rndpos ( S , numel ( norep ) ) ;
         
         % Undo rotation of new signal dots ...
         rxy = S.cwrot  *  S.xy( : , dead ) ;
@@ -965,8 +976,9 @@ function  [ S , h ] = fstim ( S , tconst , tvar )
         S.xy( 1 , dead ) = S.xy( 1 , dead )  +  S.displacement ;
         
         % Sample lifetimes for new dots , use geometric distribution
-        S.lifetime( dead ) = ceil( log( rand( size( dead ) ) )  /  ...
-          log( 1 - S.prob_survival ) )  +  1 ;
+        [ S.lifetime( dead ) , S.ctr ] = rdotkern ( 'l' , S.key , ...
+          S.ctr , size( dead ) , S.prob_survival ) ;
+        S.lifetime( dead ) = S.lifetime( dead )  +  1 ;
         
         % Add 1 to dots that were not replaced by an existing noise dot ,
         % so that all signal dots exist for at least 2 frames
@@ -988,10 +1000,13 @@ function  [ S , h ] = fstim ( S , tconst , tvar )
       % Skip if no dots are in peril
       if  nfall
         
+        % Sample two random values per dot , for the y-axis location in
+        % row 1 and the nudge in row 2
+        [ u , S.ctr ] = rdotkern ( 'u' , S.key , S.ctr , [ 2 , nfall ] ) ;
+        
         % In a circle centred on origin with no rotation, give these dots a
         % random y-axis location , use patch radius
-        S.xy( 2 , fall ) = 2  *  S.radius  *  rand ( 1 , nfall )  -  ...
-          S.radius ;
+        S.xy( 2 , fall ) = 2  *  S.radius  *  u( 1 , : )  -  S.radius ;
         
         % Find x-coordinate where horizontal line intercepts leading edge
         % of circle
@@ -999,7 +1014,7 @@ function  [ S , h ] = fstim ( S , tconst , tvar )
     
         % Nudge dots just off the tailing edge so that one frame's worth of
         % travel will bring them in by some random fraction of a step
-        S.xy( 1 , fall ) = -e  -  S.step  *  rand ( 1 , nfall ) ;
+        S.xy( 1 , fall ) = -e  -  S.step  *  u( 2 , : ) ;
         
         % Compute distance of dots to leading edge of aperture
         S.distance( fall ) = e  -  S.xy( 1 , fall ) ;
@@ -1042,8 +1057,7 @@ function  [ S , h ] = fstim ( S , tconst , tvar )
     nd = S.Nsig_total + 1 : S.Nd_total ;
 
     % Sample new dot positions
-    S.xy( : , nd ) = ...
-      rndpos (  S.radius  ,  S.Nnoise_total  ) ;
+    [ S.xy( : , nd ) , S.ctr ] = rndpos (  S  ,  S.Nnoise_total  ) ;
     
     % And apply translation
     S.xy( : , nd ) = S.xy( : , nd )  +  S.translation ( : , nd ) ;
@@ -1315,8 +1329,8 @@ function  [ S , ns ] = remapsd ( S )
     repmat ( ns_total + kn + nn * ( 0 : S.Np - 1 ) , dnn , 1 ) ;
   
   % Re-sample de novo noise dot positions , and translate into position
-  S.xy( : , c ) = rndpos ( S.radius , numel( c ) )  +  ...
-    S.translation ( : , c ) ;
+  [ S.xy( : , c ) , S.ctr ] = rndpos ( S , numel( c ) ) ;
+  S.xy( : , c ) = S.xy( : , c )  +  S.translation ( : , c ) ;
   
   % Number of signal dots
   S.Nsig       = ns ;
@@ -1366,17 +1380,15 @@ end % hitregloc
 
 
 % Random dot positions , returns 2 by n matrix with x-coordinates in first
-% row and y-coordinates in the second row , each column defines one dot
-function  pos = rndpos ( r , n )
+% row and y-coordinates in the second row , each column defines one dot.
+% Dots are sampled within the patch radius. Also returns the new counter of
+% the random-dot generator.
+function  [ pos , ctr ] = rndpos ( S , n )
   
-  % Convert from real number on [ 0 , 1 ] into an angle ...
-  theta = 2 * pi * rand( 1 , n ) ;
+  [ pos , ctr ] = rdotkern ( 'd' , S.key , S.ctr , n , S.rad_sq , 0 ) ;
   
-  % ... and radius
-  radius = r * sqrt( rand( 1 , n ) ) ;
-    
-  % Polar to cartesian coordinates
-  pos = [  radius .* cos( theta )  ;  radius .* sin( theta )  ] ;
+  % Dot buffers are double
+  pos = double ( pos ) ;
   
 end % randdotxy
 
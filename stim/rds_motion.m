@@ -27,9 +27,11 @@ function  [ type , varpar , init , stim , close , chksum ] = ...
 %     are selective for absolute, not relative, disparity. J. Neurosci.
 %     19(13):5602.
 %
-% The check-sum is calculated for each trial by summing the first frame's
-% worth of values in the random-value pool. See variable parameter
-% secs_rnd, below.
+% Dot positions are sampled on the fly by the rdotkern MEX function , from
+% a counter-based random number generator. A new key for the generator is
+% drawn from Matlab's random number generator during trial
+% initialisation. The check-sum is calculated for each trial by summing
+% the first frame's worth of values that follow from the key.
 % 
 %
 % Variable parameters:
@@ -137,13 +139,11 @@ function  [ type , varpar , init , stim , close , chksum ] = ...
 %     of light versus dark dots, assuming a mid-grey background i.e. with
 %     greyscale value 0.5, where 0 is black and 1 is white. Default 1.
 %   
-%   secs_rnd - The number of seconds of random values to sample during
-%     initialisation. One value is sampled for each dot in each RDS for
-%     each frame, assuming a full magnitude of central relative to surround
-%     disparity and that all dots are uncorrelated. This random-value pool
-%     is used during the trial rather than generating values on the fly. If
-%     the trial runs longer than the specified time then random values are
-%     recycled. Cannot be zero. Rounds up to next frame. Default 3.
+%   secs_rnd - No longer used. This once set the number of seconds of
+%     random values to sample into a pool during initialisation. Dot
+%     positions are now sampled on the fly by rdotkern , so the value is
+%     ignored. It is kept so that existing task logic remains valid.
+%     Default 3.
 %   
 %   
 %   %-- Central dot parameters --%
@@ -207,8 +207,8 @@ function  [ type , varpar , init , stim , close , chksum ] = ...
 % NOTE: Stimulus events that ask for a parameter changes that would affect
 %   how many dots there are will be silently ignored. This includes
 %   fnumrds, ffirst, flast, centre_radius, surround_width, dot_type,
-%   dot_width, and dot_density. Likewise, secs_rnd can not change during a
-%   trial, nor orientation or speed.
+%   dot_width, and dot_density. Likewise, orientation and speed can not
+%   change during a trial.
 % 
 % NOTE: Requires the rds_simple_handle class, a subclass of handle. This
 %   should be in met/stim/met.stim.class
@@ -396,12 +396,6 @@ function  Sret = finit ( vpar , tconst , Sold )
       'ffirst (%d) must not exceed flast (%d)' ]  ,  vpar.ffirst  ,  ...
       vpar.flast  )
     
-  % Randomness buffer cannot be empty
-  elseif  vpar.secs_rnd  <=  0
-    
-    error (  'MET:rds_motion:secs_rnd'  ,  [ 'rds_motion: ' , ...
-      'secs_rnd must be non-zero i.e. rand buffer cannot be empty' ]  )
-    
   end % varpar check
   
   
@@ -545,27 +539,6 @@ function  Sret = finit ( vpar , tconst , Sold )
     balloc ( h , 'ddxy' , [ 2 , h.ibuf ] )
     balloc ( h , 'ddcl' , [ 4 , h.ibuf ] )
     
-    % Randomness buffer
-      
-      % How many frames? Round up to next frame.
-      h.nr( 1 ) = ceil ( h.vp.secs_rnd  /  tconst.flipint );
-      
-      % Attempt to allocate buffer , this could be a big one so catch the
-      % error and inform user
-      try
-        
-        balloc( h , 'r' , [ 2 , h.nbuf , h.numrds , h.nr ] , 'single' )
-        
-      catch  E
-        
-        fprintf (  [ '\nrds_simple: failure to allocate randomness ' , ...
-          'buffer containing %d bytes\n' ]  ,  ...
-            4 * 2 * h.nbuf * h.numrds * h.nr  )
-          
-        rethrow (  E  )
-        
-      end % allocate rand buffer
-      
     
   % Initialise buffers
   
@@ -573,22 +546,10 @@ function  Sret = finit ( vpar , tconst , Sold )
     % lookup table
     greymap ( h )
     
-    % Randomness buffer frame index
-    h.ir( 1 ) = 0 ;
-    
-    % Sample random values
-    h.r( : ) = rand( size(  h.r  ) ) ;
-    
-    % Pre-compute angles , but only for surround dots
-    i = h.ncen + 1 : h.nbuf ;
-    h.r( 2 , i , : , : ) = 2  *  pi  *  h.r( 2 , i , : , : ) ;
-    
-    % Load up first frame's worth of random values into the xy buffer for
-    % central dots , row 2 already has pre-computed radian angles
-    h.xy( : , h.icen , : ) = h.r( : , h.icen , : , 1 ) ;
-    
-    % Convert y-axis value to an angle in radians so that rnddot will work
-    h.xy( 2 , h.icen , : ) = 2  *  pi  *  h.xy( 2 , h.icen , : ) ;
+    % Draw a new key for the random-dot generator , and start from the
+    % beginning of its stream
+    h.key( 1 ) = randi ( [ 0 , 2 ^ 32 - 1 ] ) ;
+    h.ctr( 1 ) = 0 ;
     
     % Sample central dot positions relative to the centre of the RDS
     rnddot ( h , h.icen , h.rcen2 , 0 )
@@ -793,16 +754,6 @@ function  [ Sio , hitflg ] = fstim ( Sio , tconst , tvar )
     
     %  New RDS image  %
 
-    % Advance random-buffer index by one frame , loop back to frame one
-    % if the buffer has run out
-    h.ir( 1 ) = h.ir  +  1 ;
-
-    if  h.nr  <  h.ir  ,  h.ir( 1 ) = 1 ;  end
-
-    % Load up one frame's worth of random values into the xy buffer for
-    % surround dots , row 2 already has pre-computed radian angles
-    h.xy( : , isur , : ) = h.r( : , isur , : , h.ir ) ;
-
     % Sample surround dot positions
     rnddot ( h , isur , h.rdif2 , h.rsin2 )
     
@@ -822,10 +773,14 @@ function  [ Sio , hitflg ] = fstim ( Sio , tconst , tvar )
       % No dots fell off , continue to next rds
       if   ~ any (  k  )  ,  continue  ,  end
       
+      % Sample two random values per dot , for the y-axis position in row
+      % 2 and the horizontal jitter in row 1
+      [ u , h.ctr( 1 ) ] = ...
+        rdotkern ( 'u' , h.key , h.ctr , [ 2 , sum( k ) ] ) ;
+      
       % Sample y-axis position , recall that xy columns are ordered in
       % blocks of dots by type [ central , surrount ]
-      h.xy( 2 , k , rds ) = ...
-        2  *  h.rcen  *  h.r( 2 , k , rds , h.ir )  -  h.rcen ;
+      h.xy( 2 , k , rds ) = 2  *  h.rcen  *  u( 2 , : )  -  h.rcen ;
       
       % Calculate the x-axis position of the dots when projected to the
       % right hand edge of the circle
@@ -837,8 +792,7 @@ function  [ Sio , hitflg ] = fstim ( Sio , tconst , tvar )
       
       % Jitter horizontal position of dots to simulate dots arriving from
       % outside of the aperture
-      h.xy( 1 , k , rds ) = h.step  *  h.r( 1 , k , rds , h.ir )  +  ...
-        h.xy( 1 , k , rds ) ;
+      h.xy( 1 , k , rds ) = h.step  *  u( 1 , : )  +  h.xy( 1 , k , rds ) ;
       
       % Distance of dots to edge of circle
       h.cdist( 1 , k , rds ) = crx  -  h.xy( 1 , k , rds ) ;
@@ -960,15 +914,9 @@ function  c = fchksum ( Sin )
   % Point to data handle
   h = Sin.h ;
   
-  % Sum across dots , rds , eyes , x-y coordinate. Return double value from
-  % single.
-  c = double ...
-    (  ...
-      sum ...
-      (  ...
-        sum( sum(  h.r( : , : , : , 1 )  ,  2  ) ,  3 )  ...
-      )  ...
-    ) ;
+  % Sum the first frame's worth of random values that follow from the
+  % key. Return double value from single.
+  c = double (  sum(  rdotkern( 'u' , h.key , 0 , numel( h.xy ) )  )  ) ;
   
 end % chksum
 
@@ -1309,20 +1257,16 @@ function  hitregpos ( h , tconst )
 end % hitregpos
 
 
-% Transform top row of random values into radii , then transform from polar
-% to cartesian coordinates. n dot positions in an annular region. The
-% difference of squared radii between inner and outer radius is given as
-% width w. The squared inner radius is given as r. Samples new dots at each
-% location in dot buffer given by index i. Data handle h.
+% Sample dot positions in an annular region , in cartesian coordinates.
+% The difference of squared radii between inner and outer radius is given
+% as width w. The squared inner radius is given as r. Samples new dots at
+% each location in dot buffer given by index i , in every RDS. Data handle
+% h. Advances the counter of the random-dot generator past the values that
+% were used.
 function  rnddot ( h , i , w , r )
   
-  % Convert row 1 into radii
-  h.xy( 1 , i , : ) = sqrt (  w  *  h.xy( 1 , i , : )   +   r  ) ;
-  
-  % Transform polar coordinates to Cartesian and return
-  h.xy( : , i , : ) = ...
-    [  h.xy( 1 , i , : )  .*  cos(  h.xy( 2 , i , : )  )  ;
-       h.xy( 1 , i , : )  .*  sin(  h.xy( 2 , i , : )  )  ] ;
+  [ h.xy( : , i , : ) , h.ctr( 1 ) ] = rdotkern ( 'd' , h.key , h.ctr , ...
+    [ numel( i ) , h.numrds ] , w , r ) ;
   
 end % rnddot
 
@@ -41,9 +41,11 @@ function  [ type , varpar , init , stim , close , chksum ] = ...
 % while reducing the opportunity for memory fragmentation, which can lead
 % to serious frame skips.
 %
-% The check-sum is calculated for each trial by summing the first frame's
-% worth of values in the random-value pool. See variable parameter
-% secs_rnd, below.
+% Dot positions are sampled on the fly by the rdotkern MEX function , from
+% a counter-based random number generator. A new key for the generator is
+% drawn from Matlab's random number generator during trial
+% initialisation. The check-sum is calculated for each trial by summing
+% the first frame's worth of values that follow from the key.
 % 
 %
 % Variable parameters:
@@ -156,13 +158,11 @@ function  [ type , varpar , init , stim , close , chksum ] = ...
 %     of light versus dark dots, assuming a mid-grey background i.e. with
 %     greyscale value 0.5, where 0 is black and 1 is white. Default 1.
 %   
-%   secs_rnd - The number of seconds of random values to sample during
-%     initialisation. One value is sampled for each dot in each RDS for
-%     each frame, assuming a full magnitude of central relative to surround
-%     disparity and that all dots are uncorrelated. This random-value pool
-%     is used during the trial rather than generating values on the fly. If
-%     the trial runs longer than the specified time then random values are
-%     recycled. Cannot be zero. Rounds up to next frame. Default 3.
+%   secs_rnd - No longer used. This once set the number of seconds of
+%     random values to sample into a pool during initialisation. Dot
+%     positions are now sampled on the fly by rdotkern , so the value is
+%     ignored. It is kept so that existing task logic remains valid.
+%     Default 3.
 %   
 %   
 %   %-- Binocular dot parameters --%
@@ -256,8 +256,7 @@ function  [ type , varpar , init , stim , close , chksum ] = ...
 % NOTE: Stimulus events that ask for a parameter changes that would affect
 %   how many dots there are will be silently ignored. This includes
 %   fnumrds, ffirst, flast, centre_radius, surround_width, dot_type,
-%   dot_width, and dot_density. Likewise, secs_rnd can not change during a
-%   trial.
+%   dot_width, and dot_density.
 % 
 % NOTE: Requires the rds_simple_handle class, a subclass of handle. This
 %   should be in met/stim/met.stim.class
@@ -452,12 +451,6 @@ function  Sret = finit ( vpar , tconst , Sold )
       'ffirst (%d) must not exceed flast (%d)' ]  ,  vpar.ffirst  ,  ...
       vpar.flast  )
     
-  % Randomness buffer cannot be empty
-  elseif  vpar.secs_rnd  <=  0
-    
-    error (  'MET:rds_simple:secs_rnd'  ,  [ 'rds_simple: ' , ...
-      'secs_rnd must be non-zero i.e. rand buffer cannot be empty' ]  )
-    
   end % varpar check
   
   
@@ -626,27 +619,6 @@ function  Sret = finit ( vpar , tconst , Sold )
     balloc ( h , 'ddxy' , [ 2 , h.ibuf ] )
     balloc ( h , 'ddcl' , [ 4 , h.ibuf ] )
     
-    % Randomness buffer
-      
-      % How many frames? Round up to next frame.
-      h.nr( 1 ) = ceil ( h.vp.secs_rnd  /  tconst.flipint );
-      
-      % Attempt to allocate buffer , this could be a big one so catch the
-      % error and inform user
-      try
-        
-        balloc( h , 'r' , [ 2 , h.nbuf , h.numrds , 2 , h.nr ] , 'single' )
-        
-      catch  E
-        
-        fprintf (  [ '\nrds_simple: failure to allocate randomness ' , ...
-          'buffer containing %d bytes\n' ]  ,  ...
-            4 * 2 * h.nbuf * h.numrds * 2 * h.nr  )
-          
-        rethrow (  E  )
-        
-      end % allocate rand buffer
-      
     
   % Initialise buffers
   
@@ -664,14 +636,10 @@ function  Sret = finit ( vpar , tconst , Sold )
     % Make sure that anti-correlation flag vector is low
     h.acor( : ) = 0 ;
     
-    % Randomness buffer frame index
-    h.ir( 1 ) = 0 ;
-    
-    % Sample random values
-    h.r( : ) = rand( size(  h.r  ) ) ;
-    
-    % Pre-compute angles
-    h.r( 2 , : , : , : , : ) = 2  *  pi  *  h.r( 2 , : , : , : , : ) ;
+    % Draw a new key for the random-dot generator , and start from the
+    % beginning of its stream
+    h.key( 1 ) = randi ( [ 0 , 2 ^ 32 - 1 ] ) ;
+    h.ctr( 1 ) = 0 ;
     
     % Initialise anti-correlation and colour lookup buffers
     anticor (  h  )
@@ -936,16 +904,6 @@ function  [ Sio , hitflg ] = fstim ( Sio , tconst , tvar )
       iuasur = h.iuasur ;
       idot = h.idot ;
       
-      % Advance random-buffer index by one frame , loop back to frame one
-      % if the buffer has run out
-      h.ir( 1 ) = h.ir  +  1 ;
-      
-      if  h.nr  <  h.ir  ,  h.ir( 1 ) = 1 ;  end
-      
-      % Load up one frame's worth of random values into the xy buffer , row
-      % 2 already has pre-computed radian angles
-      h.xy( : ) = h.r( : , : , : , : , h.ir ) ;
-      
       % Sample central dot positions relative to the centre of the RDS
       rnddot ( h , icen , left , h.rcen2 , 0 )
       
@@ -1151,18 +1109,9 @@ function  c = fchksum ( Sin )
   % Point to data handle
   h = Sin.h ;
   
-  % Load in first frame of random values to the xy buffer
-  h.xy( : ) = h.r( : , : , : , : , 1 ) ;
-  
-  % Sum across dots , rds , eyes , x-y coordinate. Return double value from
-  % single.
-  c = double ...
-    (  ...
-      sum ...
-      (  ...
-        sum( sum( sum(  h.xy  ,  2  ) ,  3 ) ,  4 )  ...
-      )  ...
-    ) ;
+  % Sum the first frame's worth of random values that follow from the
+  % key. Return double value from single.
+  c = double (  sum(  rdotkern( 'u' , h.key , 0 , numel( h.xy ) )  )  ) ;
   
 end % chksum
 
@@ -1616,21 +1565,16 @@ function  hitregpos ( h , tconst )
 end % hitregpos
 
 
-% Transform top row of random values into radii , then transform from polar
-% to cartesian coordinates. n dot positions in an annular region. The
-% difference of squared radii between inner and outer radius is given as
-% width w. The squared inner radius is given as r. Samples new dots at each
-% location in dot buffer given by index i. Data handle h. e is the eye
-% index , either 1 for left or 2 for right.
+% Sample dot positions in an annular region , in cartesian coordinates.
+% The difference of squared radii between inner and outer radius is given
+% as width w. The squared inner radius is given as r. Samples new dots at
+% each location in dot buffer given by index i , in every RDS. Data handle
+% h. e is the eye index , either 1 for left or 2 for right. Advances the
+% counter of the random-dot generator past the values that were used.
 function  rnddot ( h , i , e , w , r )
   
-  % Convert row 1 into radii
-  h.xy( 1 , i , : , e ) = sqrt (  w  *  h.xy( 1 , i , : , e )   +   r  ) ;
-  
-  % Transform polar coordinates to Cartesian and return
-  h.xy( : , i , : , e ) = ...
-    [  h.xy( 1 , i , : , e )  .*  cos(  h.xy( 2 , i , : , e )  )  ;
-       h.xy( 1 , i , : , e )  .*  sin(  h.xy( 2 , i , : , e )  )  ] ;
+  [ h.xy( : , i , : , e ) , h.ctr( 1 ) ] = rdotkern ( 'd' , h.key , ...
+    h.ctr , [ numel( i ) , h.numrds ] , w , r ) ;
   
 end % rnddot
 